@@ -0,0 +1,613 @@
+/* @file:	tezdhar/src/annotate.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/annotate.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	tezdhar-annotate, searches every position of the games of PGN
+ * 		files and writes them back with evaluations, mistakes and
+ * 		blunders marked and the better moves as variations.
+ *
+ *
+ *			-----------------
+ *			Game Annotation
+ *			-----------------
+ *
+ * The games are first located with a pass over the files, then handed out
+ * one at a time to the worker threads by an atomic counter. A worker
+ * searches the positions of its game from the first to the last with a
+ * fixed number of nodes each, in MultiPV mode so that the best moves get
+ * exact scores. Its transposition table is cleared only between games:
+ * the position after a move lies in the tree searched for the position
+ * before it, so every search starts from the results of the previous one.
+ *
+ * The score of the played move is its MultiPV score if it is one of the
+ * best lines, and the negated score of the next position otherwise. The
+ * loss of a move is the score of the best move less the score of the
+ * played move, both clamped to ANNOTATE_CLAMP so that moves in decided
+ * positions are not flagged. A loss of the mistake threshold gets the NAG
+ * $2 (?), of the blunder threshold $4 (??), and the best line is added as
+ * a variation.
+ *
+ * The games are written in input order: a finished game is stored in its
+ * slot, and whoever stores the next game to be written also writes all
+ * the finished games following it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "pgn.h"
+#include "search.h"
+#include "tt.h"
+
+#include <stdio.h>	// for printf, snprintf, perror, fopen, fwrite
+#include <stdlib.h>	// for calloc, realloc, free, atoi, strtoull
+#include <string.h>	// for memcpy, strcpy, strlen
+
+#ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>	// for gettimeofday
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for getopt, sysconf
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create, pthread_mutex_lock
+#endif
+
+#define ANNOTATE_MAX_FILES	1024
+#define ANNOTATE_MAX_THREADS	256
+#define ANNOTATE_MAX_PLIES	1024		// longer games are copied unchanged
+#define ANNOTATE_NODES		20000		// default nodes per position
+#define ANNOTATE_MULTIPV	3		// default lines per position
+#define ANNOTATE_MISTAKE	100		// default loss for $2, centipawns
+#define ANNOTATE_BLUNDER	300		// default loss for $4
+#define ANNOTATE_CLAMP		1000		// scores beyond are equally decided
+#define ANNOTATE_TT_KB		16384		// default table per thread
+#define ANNOTATE_PV_PLIES	8		// moves of a variation
+#define ANNOTATE_LINE		79		// wrap movetext before this column
+#define ANNOTATE_UNKNOWN	(-SCORE_INF - 1)	// played move not in the lines
+
+/* Where a game starts */
+struct annotate_game {
+	int file;
+	uint64_t offset;
+};
+
+struct annotate {
+	struct pgn_file pgn[ANNOTATE_MAX_FILES];
+	int nfiles;
+	struct annotate_game *games;
+	uint64_t ngames;
+	struct search_limits limits;
+	int mistake, blunder;
+	size_t tt_kb;
+	uint64_t next;			// next game to be taken
+	char **done;			// annotated games not yet written
+	size_t *done_len;
+	uint64_t written;		// games written so far
+	FILE *out;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t out_lock;
+#endif
+};
+
+/* Search results of a position of a game */
+struct annotate_ply {
+	move_t move;			// played move
+	int score;			// best score, side to move's view
+	int played;			// score of the played move, or ANNOTATE_UNKNOWN
+	struct search_line best;	// best line
+};
+
+struct annotate_worker {
+	struct annotate *a;
+	struct search s;
+	struct tt tt;
+	struct board *pos;		// positions of the game
+	struct annotate_ply *ply;
+	char *text;			// annotated game
+	size_t len, cap, col;		// length, size and current column
+	uint64_t games, positions, nodes, mistakes, blunders, errors;
+	bool failed;
+};
+
+
+/* Iteration callback, the search prints nothing */
+static void annotate_report(const struct search *s, const int depth)
+{
+	(void)s;
+	(void)depth;
+}
+
+
+/* Append text to the annotated game */
+static bool annotate_put(struct annotate_worker *w, const char *str, const size_t n)
+{
+	char *p;
+
+	if (w->len + n + 1 > w->cap) {
+		size_t cap = w->cap ? w->cap : 4096;
+
+		while (w->len + n + 1 > cap) {
+			cap *= 2;
+		}
+		if (!(p = realloc(w->text, cap))) {
+			perror("realloc failed");
+			w->failed = true;
+			return false;
+		}
+		w->text = p;
+		w->cap = cap;
+	}
+	memcpy(w->text + w->len, str, n);
+	w->len += n;
+	w->text[w->len] = '\0';
+	return true;
+}
+
+
+/* Append a movetext token, wrapping the line before ANNOTATE_LINE */
+static void annotate_token(struct annotate_worker *w, const char *tok)
+{
+	const size_t n = strlen(tok);
+
+	if (w->col && w->col + 1 + n >= ANNOTATE_LINE) {
+		annotate_put(w, "\n", 1);
+		w->col = 0;
+	} else if (w->col) {
+		annotate_put(w, " ", 1);
+		w->col++;
+	}
+	annotate_put(w, tok, n);
+	w->col += n;
+}
+
+
+/* Score from White's point of view as a comment, e.g. { +0.35 } or { #-3 } */
+static void annotate_score(struct annotate_worker *w, const int score, const enum color side)
+{
+	const int v = side == WHITE ? score : -score;
+	char buf[32];
+
+	if (v > SCORE_MATE - MAX_PLY) {
+		snprintf(buf, sizeof(buf), "{ #%d }", (SCORE_MATE - v + 1) / 2);
+	} else if (v < -SCORE_MATE + MAX_PLY) {
+		snprintf(buf, sizeof(buf), "{ #-%d }", (SCORE_MATE + v + 1) / 2);
+	} else {
+		snprintf(buf, sizeof(buf), "{ %+.2f }", (double)v / 100);
+	}
+	annotate_token(w, buf);
+}
+
+
+/* Append a move, with its number if White moves or if it follows a
+ * comment or a variation */
+static void annotate_move(struct annotate_worker *w, struct board *brd, const move_t m, const bool number)
+{
+	char buf[MAX_MOVE_LEN + 16];
+	char san[MAX_MOVE_LEN];
+
+	move_to_san(brd, m, san);
+	if (brd->turn == WHITE) {
+		snprintf(buf, sizeof(buf), "%u. %s", brd->fullMoves, san);
+	} else if (number) {
+		snprintf(buf, sizeof(buf), "%u... %s", brd->fullMoves, san);
+	} else {
+		snprintf(buf, sizeof(buf), "%s", san);
+	}
+	annotate_token(w, buf);
+}
+
+
+static int annotate_clamp(const int score)
+{
+	return score > ANNOTATE_CLAMP ? ANNOTATE_CLAMP : score < -ANNOTATE_CLAMP ? -ANNOTATE_CLAMP : score;
+}
+
+
+/* Search every position of the game, the first to the last */
+static void annotate_search(struct annotate_worker *w, const int nply)
+{
+	struct annotate_ply *p;
+	struct move_list legal;
+
+	tt_clear(&w->tt);
+	for (int i = 0; i <= nply; i++) {
+		p = &w->ply[i];
+		p->played = ANNOTATE_UNKNOWN;
+		p->best.pv_len = 0;
+
+		if (!gen_legal_moves(&w->pos[i], &legal)) {
+			p->score = in_check(&w->pos[i], w->pos[i].turn) ? -SCORE_MATE : 0;
+			continue;
+		}
+
+		search_init(&w->s, &w->pos[i], &w->a->limits);
+		w->s.report = annotate_report;
+		w->s.tt = &w->tt;
+		search_position(&w->s);
+
+		p->score = w->s.best_score;
+		p->best = w->s.lines[0];
+		for (int j = 0; j < w->s.nlines && i < nply; j++) {
+			if (w->s.lines[j].pv_len && w->s.lines[j].pv[0] == p->move) {
+				p->played = w->s.lines[j].score;
+			}
+		}
+		w->positions++;
+		w->nodes += w->s.stats.nodes;
+	}
+}
+
+
+/* Write the movetext of a searched game */
+static void annotate_write(struct annotate_worker *w, const int nply, const char *result)
+{
+	const struct annotate *a = w->a;
+	struct board brd;
+	struct undo u;
+	int played, loss;
+
+	w->col = 0;
+	for (int i = 0; i < nply; i++) {
+		const struct annotate_ply *p = &w->ply[i];
+		const enum color side = w->pos[i].turn;
+
+		brd = w->pos[i];
+		annotate_move(w, &brd, p->move, true);
+
+		played = p->played != ANNOTATE_UNKNOWN ? p->played : -w->ply[i + 1].score;
+		loss = annotate_clamp(p->score) - annotate_clamp(played);
+		if (p->best.pv_len && p->best.pv[0] != p->move && loss >= a->blunder) {
+			annotate_token(w, "$4");
+			w->blunders++;
+		} else if (p->best.pv_len && p->best.pv[0] != p->move && loss >= a->mistake) {
+			annotate_token(w, "$2");
+			w->mistakes++;
+		} else {
+			loss = 0;
+		}
+
+		/* no score once the game is decided on the board */
+		if (i + 1 < nply || w->ply[i + 1].best.pv_len) {
+			annotate_score(w, played, side);
+		}
+
+		if (loss) {
+			brd = w->pos[i];
+			annotate_token(w, "(");
+			for (int j = 0; j < p->best.pv_len && j < ANNOTATE_PV_PLIES; j++) {
+				annotate_move(w, &brd, p->best.pv[j], j < 2);
+				if (!j) {
+					annotate_score(w, p->score, side);
+				}
+				make_move(&brd, p->best.pv[j], &u);
+			}
+			annotate_token(w, ")");
+		}
+	}
+
+	annotate_token(w, result);
+	annotate_put(w, "\n\n", 2);
+}
+
+
+/* Replay and annotate a game. Games which do not replay are copied */
+static void annotate_game(struct annotate_worker *w, const struct pgn_game *gm)
+{
+	const struct pgn_span *tag = pgn_tag(gm, "Result");
+	char fen[MAX_FEN_LEN], buf[MAX_MOVE_LEN], result[8] = "*";
+	struct pgn_lexer lx;
+	struct pgn_token tok;
+	struct move mv;
+	struct undo u;
+	int depth = 0, nply = 0;
+	size_t tags;
+	move_t m;
+
+	w->len = 0;
+	if (tag && (pgn_span_eq(tag, "1-0") || pgn_span_eq(tag, "0-1") || pgn_span_eq(tag, "1/2-1/2"))) {
+		pgn_span_copy(tag, result, sizeof(result));
+	}
+	if (!pgn_span_copy(pgn_tag(gm, "FEN"), fen, sizeof(fen))) {
+		strcpy(fen, INITIAL_FEN);
+	}
+	if (!init_board(fen, &w->pos[0], AI, AI)) {
+		goto copy;
+	}
+
+	pgn_lexer_init(&lx, &gm->movetext);
+	while (pgn_next_token(&lx, &tok) != PGN_TOKEN_END) {
+		if (tok.type == PGN_TOKEN_OPEN) {
+			depth++;
+		} else if (tok.type == PGN_TOKEN_CLOSE) {
+			depth -= depth ? 1 : 0;
+		} else if (tok.type == PGN_TOKEN_RESULT && !depth) {
+			pgn_span_copy(&tok.text, result, sizeof(result));
+		}
+		if (tok.type != PGN_TOKEN_MOVE || depth) {
+			continue;	// comments and variations are replaced
+		}
+
+		if (tok.text.len >= MAX_MOVE_LEN || nply == ANNOTATE_MAX_PLIES) {
+			goto copy;
+		}
+		memcpy(buf, tok.text.ptr, tok.text.len);
+		buf[tok.text.len] = '\0';
+		mv = parse_input_move(buf);
+		if ((m = resolve_move(&w->pos[nply], &mv)) == MOVE_NONE) {
+			goto copy;
+		}
+		w->ply[nply].move = m;
+		w->pos[nply + 1] = w->pos[nply];
+		make_move(&w->pos[nply + 1], m, &u);
+		nply++;
+	}
+
+	/* the tag pairs are kept as they are */
+	tags = (size_t)(gm->movetext.ptr - gm->text.ptr);
+	while (tags && (gm->text.ptr[tags - 1] == '\n' || gm->text.ptr[tags - 1] == '\r' ||
+				gm->text.ptr[tags - 1] == ' ')) {
+		tags--;
+	}
+	annotate_put(w, gm->text.ptr, tags);
+	annotate_put(w, tags ? "\n\n" : "", tags ? 2 : 0);
+	annotate_search(w, nply);
+	annotate_write(w, nply, result);
+	w->games++;
+	return;
+
+copy:
+	w->len = 0;
+	annotate_put(w, gm->text.ptr, gm->text.len);
+	annotate_put(w, "\n", 1);
+	w->errors++;
+}
+
+
+/* Hand a finished game over, and write the games which are next in order */
+static void annotate_output(struct annotate_worker *w, const uint64_t id)
+{
+	struct annotate *a = w->a;
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&a->out_lock);
+#endif
+	a->done[id] = w->text;
+	a->done_len[id] = w->len;
+	w->text = NULL;
+	w->len = w->cap = 0;
+
+	while (a->written < a->ngames && a->done[a->written]) {
+		fwrite(a->done[a->written], 1, a->done_len[a->written], a->out);
+		free(a->done[a->written]);
+		a->done[a->written++] = NULL;
+	}
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&a->out_lock);
+#endif
+}
+
+
+static void *annotate_worker(void *arg)
+{
+	struct annotate_worker *w = arg;
+	struct annotate *a = w->a;
+	struct pgn_reader r;
+	struct pgn_game gm;
+	uint64_t id;
+
+	while (!w->failed && (id = __atomic_fetch_add(&a->next, 1, __ATOMIC_RELAXED)) < a->ngames) {
+		const struct annotate_game *g = &a->games[id];
+
+		pgn_reader_init(&r, &a->pgn[g->file], g->offset, g->offset + 1, PGN_FULL);
+		if (pgn_next_game(&r, &gm)) {
+			annotate_game(w, &gm);
+		}
+		if (!w->text && !annotate_put(w, "", 0)) {
+			break;
+		}
+		annotate_output(w, id);
+	}
+
+	return NULL;
+}
+
+
+/* Find where the games of all files start. The movetext is parsed too, as
+ * a line of a comment may look like a tag pair */
+static bool annotate_locate(struct annotate *a)
+{
+	struct annotate_game *p;
+	struct pgn_reader r;
+	struct pgn_game gm;
+	size_t cap = 0;
+
+	for (int f = 0; f < a->nfiles; f++) {
+		pgn_reader_init(&r, &a->pgn[f], 0, a->pgn[f].size, PGN_FULL);
+		while (pgn_next_game(&r, &gm)) {
+			if (a->ngames == cap) {
+				cap = cap ? cap * 2 : 1024;
+				if (!(p = realloc(a->games, cap * sizeof(*p)))) {
+					perror("realloc failed");
+					return false;
+				}
+				a->games = p;
+			}
+			a->games[a->ngames].file = f;
+			a->games[a->ngames++].offset = gm.offset;
+		}
+	}
+
+	if (!(a->done = calloc((size_t)(a->ngames ? a->ngames : 1), sizeof(*a->done))) ||
+			!(a->done_len = calloc((size_t)(a->ngames ? a->ngames : 1), sizeof(*a->done_len)))) {
+		perror("calloc failed");
+		return false;
+	}
+	return true;
+}
+
+
+static void annotate_usage(const char *prog)
+{
+	printf("Usage: %s [-j threads] [-n nodes] [-v lines] [-m cp] [-b cp] [-H kb] -o file PGN ...\n\n", prog);
+	printf("Search every position of the games and write them with evaluations, the\n");
+	printf("mistakes ($2) and blunders ($4) marked, and the best line after them.\n\n");
+	printf("  -j threads	number of games annotated at once (default: all cores)\n");
+	printf("  -n nodes	nodes searched per position (default: %d)\n", ANNOTATE_NODES);
+	printf("  -v lines	best moves scored exactly per position (default: %d)\n", ANNOTATE_MULTIPV);
+	printf("  -m cp		loss of a mistake in centipawns (default: %d)\n", ANNOTATE_MISTAKE);
+	printf("  -b cp		loss of a blunder in centipawns (default: %d)\n", ANNOTATE_BLUNDER);
+	printf("  -H kb		transposition table per thread (default: %d)\n", ANNOTATE_TT_KB);
+	printf("  -o file	annotated PGN file to write\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	static struct annotate a;
+	struct annotate_worker *w;
+	struct timeval start, end;
+	const char *out = NULL;
+	uint64_t games = 0, positions = 0, nodes = 0, mistakes = 0, blunders = 0, errors = 0;
+	int opt, threads = 1;
+	double secs;
+	bool ok = true;
+#ifdef HAVE_PTHREAD_H
+	pthread_t tid[ANNOTATE_MAX_THREADS];
+	int started = 0;
+#endif
+
+#if defined HAVE_SYSCONF && defined _SC_NPROCESSORS_ONLN
+	threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	a.limits.nodes = ANNOTATE_NODES;
+	a.limits.multipv = ANNOTATE_MULTIPV;
+	a.mistake = ANNOTATE_MISTAKE;
+	a.blunder = ANNOTATE_BLUNDER;
+	a.tt_kb = ANNOTATE_TT_KB;
+
+	while ((opt = getopt(argc, argv, "j:n:v:m:b:H:o:h")) != -1) {
+		switch (opt) {
+			case 'j': threads = atoi(optarg); break;
+			case 'n': a.limits.nodes = strtoull(optarg, NULL, 10); break;
+			case 'v': a.limits.multipv = atoi(optarg); break;
+			case 'm': a.mistake = atoi(optarg); break;
+			case 'b': a.blunder = atoi(optarg); break;
+			case 'H': a.tt_kb = strtoull(optarg, NULL, 10); break;
+			case 'o': out = optarg; break;
+			case 'h': annotate_usage(argv[0]); return EXIT_SUCCESS;
+			default:  annotate_usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+
+	if (!out || optind == argc || argc - optind > ANNOTATE_MAX_FILES || threads < 1 || !a.limits.nodes ||
+			a.limits.multipv < 1 || a.limits.multipv > MAX_MULTIPV || a.mistake <= 0 ||
+			a.blunder < a.mistake) {
+		annotate_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads > ANNOTATE_MAX_THREADS) {
+		threads = ANNOTATE_MAX_THREADS;
+	}
+
+	init_leaper_attacks();
+	init_magic_numbers();
+	init_slider_attacks();
+	init_zobrist_keys();
+
+	a.nfiles = argc - optind;
+	for (int f = 0; f < a.nfiles; f++) {
+		if (!pgn_open(&a.pgn[f], argv[optind + f])) {
+			return EXIT_FAILURE;
+		}
+	}
+	if (!annotate_locate(&a)) {
+		return EXIT_FAILURE;
+	}
+	if (!(a.out = fopen(out, "w"))) {
+		perror(out);
+		return EXIT_FAILURE;
+	}
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_init(&a.out_lock, NULL);
+#endif
+
+	if (!(w = calloc((size_t)threads, sizeof(*w)))) {
+		perror("calloc failed");
+		return EXIT_FAILURE;
+	}
+	for (int t = 0; t < threads; t++) {
+		w[t].a = &a;
+		if (!tt_init(&w[t].tt, a.tt_kb) ||
+				!(w[t].pos = calloc(ANNOTATE_MAX_PLIES + 1, sizeof(*w[t].pos))) ||
+				!(w[t].ply = calloc(ANNOTATE_MAX_PLIES + 1, sizeof(*w[t].ply)))) {
+			perror("calloc failed");
+			return EXIT_FAILURE;
+		}
+	}
+
+	gettimeofday(&start, NULL);
+#ifdef HAVE_PTHREAD_H
+	for (int t = 1; t < threads; t++) {
+		if (pthread_create(&tid[started], NULL, annotate_worker, &w[t]) == 0) {
+			started++;
+		}
+	}
+	annotate_worker(&w[0]);
+	for (int t = 0; t < started; t++) {
+		pthread_join(tid[t], NULL);
+	}
+#else
+	annotate_worker(&w[0]);
+#endif
+	gettimeofday(&end, NULL);
+
+	secs = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1e6;
+	if (secs <= 0) {
+		secs = 1e-6;
+	}
+
+	for (int t = 0; t < threads; t++) {
+		games += w[t].games;
+		positions += w[t].positions;
+		nodes += w[t].nodes;
+		mistakes += w[t].mistakes;
+		blunders += w[t].blunders;
+		errors += w[t].errors;
+		ok = ok && !w[t].failed;
+		tt_free(&w[t].tt);
+		free(w[t].pos);
+		free(w[t].ply);
+		free(w[t].text);
+	}
+	free(w);
+
+	if (ferror(a.out) | fclose(a.out) || a.written != a.ngames) {
+		perror(out);
+		ok = false;
+	}
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_destroy(&a.out_lock);
+#endif
+
+	printf("%llu games annotated, %llu copied unchanged, %llu mistakes, %llu blunders\n",
+			(unsigned long long)games, (unsigned long long)errors,
+			(unsigned long long)mistakes, (unsigned long long)blunders);
+	printf("%llu positions, %llu nodes in %.2f seconds with %d threads, %.1f positions per second\n",
+			(unsigned long long)positions, (unsigned long long)nodes, secs, threads,
+			(double)positions / secs);
+
+	for (int f = 0; f < a.nfiles; f++) {
+		pgn_close(&a.pgn[f]);
+	}
+	free(a.games);
+	free(a.done);
+	free(a.done_len);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -11,12 +11,6 @@
 #include "bitboard.h"
 #include "chess.h"
 
-/* Bishop lookup table for magic index */
-static struct magic_lut B_lut[64];
-
-/* Bishop attacks table [square][blocker_occupancy_variation] */
-static uint64_t Battacks[64][512];	// 256 KiB (4 KiB for each square)
-
 
 /* mask relevant bishop occupancy bits excluding edges */
 static uint64_t bishop_occu_mask(const enum square sq)
@@ -108,32 +102,37 @@ bool init_bishop_magic(const bool use_pre_calc_magic)
 	enum square sq;
 	for (sq = A1; sq <= H8; sq++) {
 		/* bishop attack mask excluding edges */
-		B_lut[sq].mask = bishop_occu_mask(sq);
+		attack_tables->bishop_lut[sq].mask = bishop_occu_mask(sq);
 
 		/* bishop relevant occupancy bits count */
-		B_lut[sq].obits = count_bits(B_lut[sq].mask);
+		attack_tables->bishop_lut[sq].obits = count_bits(attack_tables->bishop_lut[sq].mask);
 
 		if (use_pre_calc_magic) {
-			B_lut[sq].magic = bishop_magic_numbers[sq];
+			attack_tables->bishop_lut[sq].magic = bishop_magic_numbers[sq];
 		} else {
-			B_lut[sq].magic = find_magic_number(BISHOP, sq, B_lut[sq].mask, B_lut[sq].obits);
+			attack_tables->bishop_lut[sq].magic = find_magic_number(BISHOP, sq, attack_tables->bishop_lut[sq].mask, attack_tables->bishop_lut[sq].obits);
 		}
 
-		if (!B_lut[sq].magic) {
+		if (!attack_tables->bishop_lut[sq].magic) {
 			dbg_print("Failed to get bishop magic no. for sq %s\n", sqr_to_coords[sq]);
 			return false;
 		}
-		printf("\rGenerating magic numbers for Bishop: %.2f %%", ((double)sq / 0.63));
-		fflush(stdout);
+		/* only a search for new magics takes long enough to show */
+		if (!use_pre_calc_magic) {
+			printf("\rGenerating magic numbers for Bishop: %.2f %%", ((double)sq / 0.63));
+			fflush(stdout);
+		}
+	}
+	if (!use_pre_calc_magic) {
+		printf("\n");
 	}
-	printf("\n");
 
 #ifdef DEBUG
 	for (sq = A1; sq <= H8; sq++) {
 		//printf("Occupancy mask for bishop at [%s]", sqr_to_coords[sq]);
-		//print_bitboard(B_lut[sq].mask);
-		//printf("Bishop occupancy relevant bits on [%d] = %d\n", sqr_to_coords[sq], B_lut[sq].obits);
-		//printf("Bishop magic number[%s] = 0x%llx\n", sqr_to_coords[sq], B_lut[sq].magic);
+		//print_bitboard(attack_tables->bishop_lut[sq].mask);
+		//printf("Bishop occupancy relevant bits on [%d] = %d\n", sqr_to_coords[sq], attack_tables->bishop_lut[sq].obits);
+		//printf("Bishop magic number[%s] = 0x%llx\n", sqr_to_coords[sq], attack_tables->bishop_lut[sq].magic);
 	}
 #endif
 	return true;
@@ -149,17 +148,17 @@ void init_bishop_attacks(void)
 
 	for (sq = A1; sq <= H8; sq++) {
 		//printf("\n\n\n <<<<================= [ %d ] =================>>>>\n\n", sq);
-		for (i = 0; i < (1 << B_lut[sq].obits); i++) {
-			occu = set_occupancy(i, B_lut[sq].obits, B_lut[sq].mask);
+		for (i = 0; i < (1 << attack_tables->bishop_lut[sq].obits); i++) {
+			occu = set_occupancy(i, attack_tables->bishop_lut[sq].obits, attack_tables->bishop_lut[sq].mask);
 
-			magic_idx = (int)((occu * B_lut[sq].magic) >> (64 - B_lut[sq].obits));
+			magic_idx = (int)((occu * attack_tables->bishop_lut[sq].magic) >> (64 - attack_tables->bishop_lut[sq].obits));
 
-			Battacks[sq][magic_idx] = bishop_attacks_on_the_fly(sq, occu);
+			attack_tables->bishop[sq][magic_idx] = bishop_attacks_on_the_fly(sq, occu);
 #if DEBUG
 			//printf("Bishop Occu variation [%2d][%3d] = 0x%-16llx\t", sq, i, occu);
-			//printf("Relv bits: %2d\tMagic[%2d]: 0x%-16llx\t", B_lut[sq].obits, sq, B_lut[sq].magic);
+			//printf("Relv bits: %2d\tMagic[%2d]: 0x%-16llx\t", attack_tables->bishop_lut[sq].obits, sq, attack_tables->bishop_lut[sq].magic);
 			//printf("Magic index: %3d\t", magic_idx);
-			//printf("Battacks[%2d][%3d] = 0x%llx\n", sq, magic_idx, Battacks[sq][magic_idx]);
+			//printf("Battacks[%2d][%3d] = 0x%llx\n", sq, magic_idx, attack_tables->bishop[sq][magic_idx]);
 #endif
 		}
 	}
@@ -169,10 +168,12 @@ void init_bishop_attacks(void)
 /* Return bishop attacks for a particular blocker occupancy */
 uint64_t get_bishop_attacks(const enum square sq, uint64_t occu)
 {
-	occu &= B_lut[sq].mask;
-	occu *= B_lut[sq].magic;
-	occu >>= 64 - B_lut[sq].obits;
+	const struct magic_lut *lut = &attack_tables->bishop_lut[sq];
+
+	occu &= lut->mask;
+	occu *= lut->magic;
+	occu >>= 64 - lut->obits;
 
-	return Battacks[sq][occu];
+	return attack_tables->bishop[sq][occu];
 }
 
@@ -124,7 +124,7 @@ static inline int __attribute((hot)) get_ls1b(const uint64_t bb)
 
 
 /* get bitboard containing all white pieces only */
-static uint64_t get_white_pieces(const struct bitboards * const bb)
+uint64_t get_white_pieces(const struct bitboards * const bb)
 {
 	return (bb->wKing | bb->wQueen | bb->wBishop |
 			bb->wKnight | bb->wRook | bb->wPawn);
@@ -132,15 +132,15 @@ static uint64_t get_white_pieces(const struct bitboards * const bb)
 
 
 /* get bitboard containing all black pieces only */
-static uint64_t get_black_pieces(const struct bitboards * const bb)
+uint64_t get_black_pieces(const struct bitboards * const bb)
 {
 	return (bb->bKing | bb->bQueen | bb->bBishop |
 			bb->bKnight | bb->bRook | bb->bPawn);
 }
 
 
-/* get bitboard containing all black pieces present on chessboard */
-static uint64_t get_all_pieces(const struct bitboards * const bb)
+/* get bitboard containing all pieces present on chessboard */
+uint64_t get_all_pieces(const struct bitboards * const bb)
 {
 	return (get_white_pieces(bb) | get_black_pieces(bb));
 }
@@ -229,6 +229,21 @@ struct magic_lut {
 	int obits;		// occupancy mask relevant bits
 };
 
+/* Attack lookup tables of all pieces. They are built once at startup and
+ * only read afterwards, so that processes can share them, see tables.h */
+struct attack_tables {
+	struct magic_lut bishop_lut[64];
+	struct magic_lut rook_lut[64];
+	uint_fast64_t pawn[2][64];
+	uint_fast64_t knight[64];
+	uint_fast64_t king[64];
+	uint64_t bishop[64][512];	// 256 KiB (4 KiB for each square)
+	uint64_t rook[64][4096];	// 2048 KiB (32 KiB for each square)
+};
+
+/* tables in use, of this process or shared */
+extern struct attack_tables *attack_tables;
+
 
 /* Pre-calculated magic numbers: To use these magics define the macro
  * USE_PRE_CALCULATED_MAGIC during compile time else the engine will
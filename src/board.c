@@ -50,6 +50,7 @@ bool init_board(char *fen, struct board *brd, enum player w, enum player b)
 	}
 
 	update_bitboards(brd);
+	brd->key = zobrist_key(brd);
 	//dbg_print_all_bitboards(&brd->bb);
 	return true;
 }
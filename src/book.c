@@ -0,0 +1,289 @@
+/* @file:	tezdhar/src/book.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/book.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Polyglot opening book reader. The book file is mapped with
+ * 		mmap() and the entries of a position are found by binary
+ * 		search on the sorted keys, without reading the book into
+ * 		memory.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "book.h"
+
+#include <stdio.h>	// for fprintf, perror
+#include <string.h>	// for memset
+
+#ifdef HAVE_TIME_H
+#  include <time.h>	// for time
+#endif
+
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>	// for open
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for close, getpid
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>	// for fstat
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>	// for mmap, madvise
+#endif
+
+/* promotion piece of Polyglot move encoding, indexed by bits 12 .. 14 */
+static const enum chessmen book_promo[8] = {
+	EMPTY, KNIGHT, BISHOP, ROOK, QUEEN, EMPTY, EMPTY, EMPTY
+};
+
+
+static uint64_t read_be(const uint8_t *p, const int bytes)
+{
+	uint64_t v = 0;
+
+	for (int i = 0; i < bytes; i++) {
+		v = (v << 8) | p[i];
+	}
+
+	return v;
+}
+
+
+static void write_be(uint8_t *p, uint64_t v, const size_t bytes)
+{
+	for (size_t i = bytes; i-- > 0; ) {
+		p[i] = (uint8_t)(v & 0xff);
+		v >>= 8;
+	}
+}
+
+
+/* Decode the i-th entry of the book */
+void book_get_entry(const struct book *bk, const uint64_t i, struct book_entry *e)
+{
+	const uint8_t *p = bk->map + i * BOOK_ENTRY_SIZE;
+
+	e->key = read_be(p, 8);
+	e->move = (uint16_t)read_be(p + 8, 2);
+	e->weight = (uint16_t)read_be(p + 10, 2);
+	e->learn = (uint32_t)read_be(p + 12, 4);
+}
+
+
+/* Encode an entry into 16 bytes of a book file */
+void book_put_entry(uint8_t *buf, const struct book_entry *e)
+{
+	write_be(buf, e->key, 8);
+	write_be(buf + 8, e->move, 2);
+	write_be(buf + 10, e->weight, 2);
+	write_be(buf + 12, e->learn, 4);
+}
+
+
+/* Polyglot encoding of a move. Castling becomes king takes own rook */
+uint16_t book_encode_move(const move_t m)
+{
+	int to = MOVE_TO(m);
+	int promo = 0;
+
+	if (m & MOVE_CASTLING) {
+		to = (to & 7) == 6 ? to + 1 : to - 2;
+	}
+
+	switch (piece_type(MOVE_PROMOTED(m))) {
+		case KNIGHT:	promo = 1; break;
+		case BISHOP:	promo = 2; break;
+		case ROOK:	promo = 3; break;
+		case QUEEN:	promo = 4; break;
+		case KING:
+		case PAWN:
+		case EMPTY:
+		default:	break;
+	}
+
+	return (uint16_t)(to | ((int)MOVE_FROM(m) << 6) | (promo << 12));
+}
+
+
+/* Find the legal move matching a Polyglot move, MOVE_NONE if none does,
+ * e.g. because of a hash collision */
+static move_t book_decode_move(const struct move_list * const legal, const uint16_t bm)
+{
+	const int from = (bm >> 6) & 63;
+	const enum chessmen promo = book_promo[(bm >> 12) & 7];
+	int to = bm & 63;
+
+	for (int i = 0; i < legal->count; i++) {
+		const move_t m = legal->moves[i];
+		int mto = MOVE_TO(m);
+
+		if (m & MOVE_CASTLING) {
+			mto = (mto & 7) == 6 ? mto + 1 : mto - 2;
+		}
+		if ((int)MOVE_FROM(m) == from && mto == to &&
+				piece_type(MOVE_PROMOTED(m)) == promo) {
+			return m;
+		}
+	}
+
+	return MOVE_NONE;
+}
+
+
+/* Map a Polyglot book file into memory */
+bool book_open(struct book *bk, const char *path)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	struct stat st;
+	void *map;
+	int fd;
+
+	memset(bk, 0, sizeof(*bk));
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		perror(path);
+		return false;
+	}
+
+	if (fstat(fd, &st) || st.st_size < BOOK_ENTRY_SIZE ||
+			st.st_size % BOOK_ENTRY_SIZE) {
+		fprintf(stderr, "Not a Polyglot book: %s\n", path);
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror("mmap failed");
+		return false;
+	}
+
+#ifdef HAVE_MADVISE
+	/* a probe touches only the few pages of its binary search */
+	madvise(map, (size_t)st.st_size, MADV_RANDOM);
+#endif
+
+	bk->map = map;
+	bk->size = (size_t)st.st_size;
+	bk->entries = bk->size / BOOK_ENTRY_SIZE;
+	bk->rng = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+	if (!bk->rng) {
+		bk->rng = 1;
+	}
+	return true;
+#else
+	memset(bk, 0, sizeof(*bk));
+	fprintf(stderr, "Opening books need mmap(): %s\n", path);
+	return false;
+#endif
+}
+
+
+void book_close(struct book *bk)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	if (bk->map) {
+		munmap((void *)(uintptr_t)bk->map, bk->size);
+	}
+#endif
+	memset(bk, 0, sizeof(*bk));
+}
+
+
+/* Index of the first entry with key not less than given key */
+static uint64_t book_lower_bound(const struct book *bk, const uint64_t key)
+{
+	uint64_t lo = 0, hi = bk->entries, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (read_be(bk->map + mid * BOOK_ENTRY_SIZE, 8) < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+
+/* Look up the book moves of a position. Fills at most max legal moves and
+ * their weights, and returns their number */
+int book_probe(const struct book *bk, struct board *brd, move_t *moves, uint16_t *weights, const int max)
+{
+	const uint64_t key = polyglot_key(brd);
+	struct move_list legal;
+	struct book_entry e;
+	int n = 0;
+
+	if (!bk->map) {
+		return 0;
+	}
+
+	gen_legal_moves(brd, &legal);
+	for (uint64_t i = book_lower_bound(bk, key); i < bk->entries && n < max; i++) {
+		book_get_entry(bk, i, &e);
+		if (e.key != key) {
+			break;
+		}
+		if ((moves[n] = book_decode_move(&legal, e.move)) != MOVE_NONE) {
+			weights[n++] = e.weight;
+		}
+	}
+
+	return n;
+}
+
+
+/* xorshift64 generator for weighted move selection */
+static uint64_t book_random(struct book *bk)
+{
+	bk->rng ^= bk->rng << 13;
+	bk->rng ^= bk->rng >> 7;
+	bk->rng ^= bk->rng << 17;
+	return bk->rng;
+}
+
+
+/* Choose a book move for the position, MOVE_NONE if out of book */
+move_t book_move(struct book *bk, struct board *brd, const enum book_select sel)
+{
+	move_t moves[BOOK_MAX_MOVES];
+	uint16_t weights[BOOK_MAX_MOVES];
+	uint64_t total = 0, r;
+	int n, best = 0;
+
+	if (!(n = book_probe(bk, brd, moves, weights, BOOK_MAX_MOVES))) {
+		return MOVE_NONE;
+	}
+
+	for (int i = 0; i < n; i++) {
+		total += weights[i];
+		if (weights[i] > weights[best]) {
+			best = i;
+		}
+	}
+
+	if (sel == BOOK_BEST || !total) {
+		return moves[best];
+	}
+
+	r = book_random(bk) % total;
+	for (int i = 0; i < n; i++) {
+		if (r < weights[i]) {
+			return moves[i];
+		}
+		r -= weights[i];
+	}
+
+	return moves[best];
+}
@@ -0,0 +1,71 @@
+/* @file:	tezdhar/src/book.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/book.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Polyglot opening book reader.
+ *
+ *
+ *			--------------------
+ *			Polyglot Book Format
+ *			--------------------
+ *
+ * A .bin book is an array of 16 byte entries sorted by key, all numbers
+ * stored big-endian:
+ *
+ *	key	8 bytes		Polyglot hash key of the position
+ *	move	2 bytes		bits  0 ..  2	to file
+ *				bits  3 ..  5	to row
+ *				bits  6 ..  8	from file
+ *				bits  9 .. 11	from row
+ *				bits 12 .. 14	promotion: none, N, B, R, Q
+ *	weight	2 bytes		how often the move should be played
+ *	learn	4 bytes		unused by us
+ *
+ * Castling is stored as the king capturing its own rook, e.g. e1h1. The
+ * whole file is mapped and searched in place, so opening even a very
+ * large book costs a single mmap() call.
+ */
+
+#ifndef __BOOK_H__
+#define __BOOK_H__	1
+
+#include "chess.h"
+
+#define BOOK_ENTRY_SIZE		16
+#define BOOK_MAX_MOVES		64	// book moves returned for a position
+
+/* How to choose among the book moves of a position */
+enum book_select {
+	BOOK_WEIGHTED,			// randomly, in proportion to weight
+	BOOK_BEST			// always the highest weight
+};
+
+/* Book entry in host byte order */
+struct book_entry {
+	uint64_t key;
+	uint16_t move;
+	uint16_t weight;
+	uint32_t learn;
+};
+
+/* An opened book */
+struct book {
+	const uint8_t *map;		// mmap'd file contents
+	size_t size;			// file size
+	uint64_t entries;		// number of entries
+	uint64_t rng;			// state of weighted move selection
+};
+
+
+/* Function prototypes */
+bool book_open(struct book *bk, const char *path);
+void book_close(struct book *bk);
+void book_get_entry(const struct book *bk, uint64_t i, struct book_entry *e);
+void book_put_entry(uint8_t *buf, const struct book_entry *e);
+uint16_t book_encode_move(move_t m);
+int book_probe(const struct book *bk, struct board *brd, move_t *moves, uint16_t *weights, int max);
+move_t book_move(struct book *bk, struct board *brd, enum book_select sel);
+
+
+#endif	/* __BOOK_H__ */
@@ -0,0 +1,489 @@
+/* @file:	tezdhar/src/bookgen.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/bookgen.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	tezdhar-book, builds a Polyglot opening book from PGN files.
+ *
+ *
+ *			------------------
+ *			Parallel Book Build
+ *			------------------
+ *
+ * The PGN files are mapped into memory and cut into chunks of BOOKGEN_CHUNK
+ * bytes, and worker threads take the next chunk from a shared atomic
+ * counter. A game belongs to the chunk in which its first tag starts, so a
+ * worker skips the end of a game running into its chunk and reads past the
+ * end of the chunk to finish its last game. Games are read in place with
+ * the zero-copy reader of pgn.c.
+ *
+ * Every worker replays its games and counts wins, draws and losses of the
+ * side to move for each (position key, move) pair in a private open
+ * addressing hash map, so workers never share memory while counting. The
+ * maps are merged at the end by sorting all counters, and the weight of a
+ * move is 2 * wins + draws, like the Polyglot make-book command computes
+ * it. Weights of a position are scaled down together if one of them does
+ * not fit 16 bits.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "bitboard.h"
+#include "book.h"
+#include "chess.h"
+#include "pgn.h"
+
+#include <stdio.h>	// for printf, fprintf
+#include <stdlib.h>	// for calloc, free, qsort
+#include <string.h>	// for memcpy, strcpy
+#include <time.h>	// for time, difftime
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for getopt, sysconf
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create
+#endif
+
+#define BOOKGEN_CHUNK		(4LL << 20)	// bytes of PGN per work unit
+#define BOOKGEN_MAX_FILES	1024
+#define BOOKGEN_MAX_THREADS	256
+#define BOOKGEN_MAP_INIT	(1 << 16)	// initial hash map slots
+
+/* Counts of one move played in one position */
+struct bookgen_stat {
+	uint64_t key;			// Polyglot key of the position
+	uint16_t move;			// Polyglot move, 0 marks an empty slot
+	uint32_t win, draw, loss;	// results for the side to move
+};
+
+/* Private hash map of a worker */
+struct bookgen_map {
+	struct bookgen_stat *slot;
+	size_t size;			// number of slots, power of 2
+	size_t used;
+};
+
+struct bookgen;
+
+struct bookgen_worker {
+	struct bookgen *g;
+	struct bookgen_map map;
+	uint64_t games, moves, errors;
+	bool failed;			// out of memory
+};
+
+struct bookgen {
+	char **files;
+	struct pgn_file pgn[BOOKGEN_MAX_FILES];	// mapped files
+	int nfiles;
+	int max_ply;			// only the first plies of games are used
+	uint32_t min_games;		// moves played less often are dropped
+
+	int64_t chunks;			// total number of chunks
+	int64_t next;			// next chunk to be taken
+};
+
+
+/* Insert a result into the map of a worker. score is 2, 1 or 0 for a win,
+ * draw or loss of the side to move */
+static bool bookgen_count(struct bookgen_map *m, const uint64_t key, const uint16_t move, const int score)
+{
+	struct bookgen_stat *s;
+	size_t i;
+
+	if (2 * (m->used + 1) > m->size) {
+		struct bookgen_map bigger = {NULL, m->size ? 2 * m->size : BOOKGEN_MAP_INIT, 0};
+
+		if (!(bigger.slot = calloc(bigger.size, sizeof(*bigger.slot)))) {
+			perror("calloc failed");
+			return false;
+		}
+		for (i = 0; i < m->size; i++) {
+			if (m->slot[i].move) {
+				size_t j = (m->slot[i].key ^ m->slot[i].move) & (bigger.size - 1);
+				while (bigger.slot[j].move) {
+					j = (j + 1) & (bigger.size - 1);
+				}
+				bigger.slot[j] = m->slot[i];
+			}
+		}
+		bigger.used = m->used;
+		free(m->slot);
+		*m = bigger;
+	}
+
+	for (i = (key ^ move) & (m->size - 1); m->slot[i].move; i = (i + 1) & (m->size - 1)) {
+		if (m->slot[i].key == key && m->slot[i].move == move) {
+			break;
+		}
+	}
+
+	s = &m->slot[i];
+	if (!s->move) {
+		s->key = key;
+		s->move = move;
+		m->used++;
+	}
+
+	switch (score) {
+		case 2:  s->win++; break;
+		case 1:  s->draw++; break;
+		default: s->loss++; break;
+	}
+	return true;
+}
+
+
+/* Replay a complete game and count its book moves */
+static void bookgen_replay(struct bookgen_worker *w, const struct pgn_game *gm)
+{
+	const struct pgn_span *result = pgn_tag(gm, "Result");
+	char fen[MAX_FEN_LEN], buf[MAX_MOVE_LEN];
+	struct pgn_lexer lx;
+	struct pgn_token tok;
+	struct board brd;
+	struct move mv;
+	struct undo u;
+	int white, score, depth = 0, ply = 0;
+	move_t m;
+
+	if (pgn_span_eq(result, "1-0")) {
+		white = 2;
+	} else if (pgn_span_eq(result, "0-1")) {
+		white = 0;
+	} else if (pgn_span_eq(result, "1/2-1/2")) {
+		white = 1;
+	} else {
+		return;		// unfinished games tell nothing
+	}
+
+	if (!pgn_span_copy(pgn_tag(gm, "FEN"), fen, sizeof(fen))) {
+		strcpy(fen, INITIAL_FEN);
+	}
+	if (!init_board(fen, &brd, AI, AI)) {
+		w->errors++;
+		return;
+	}
+
+	w->games++;
+	pgn_lexer_init(&lx, &gm->movetext);
+	while (ply < w->g->max_ply && pgn_next_token(&lx, &tok) != PGN_TOKEN_END) {
+		if (tok.type == PGN_TOKEN_OPEN) {
+			depth++;
+		} else if (tok.type == PGN_TOKEN_CLOSE) {
+			depth -= depth ? 1 : 0;
+		}
+		if (tok.type != PGN_TOKEN_MOVE || depth) {
+			continue;	// variations are not played
+		}
+
+		if (tok.text.len >= MAX_MOVE_LEN) {
+			w->errors++;
+			return;
+		}
+		memcpy(buf, tok.text.ptr, tok.text.len);
+		buf[tok.text.len] = '\0';
+
+		mv = parse_input_move(buf);
+		if ((m = resolve_move(&brd, &mv)) == MOVE_NONE) {
+			w->errors++;
+			return;
+		}
+
+		score = brd.turn == WHITE ? white : 2 - white;
+		if (!bookgen_count(&w->map, polyglot_key(&brd), book_encode_move(m), score)) {
+			w->failed = true;
+			return;
+		}
+		make_move(&brd, m, &u);
+		w->moves++;
+		ply++;
+	}
+}
+
+
+/* Read the games starting within [begin, end) of a PGN file */
+static void bookgen_read_chunk(struct bookgen_worker *w, const struct pgn_file *f, const int64_t begin, const int64_t end)
+{
+	struct pgn_reader r;
+	struct pgn_game gm;
+
+	pgn_reader_init(&r, f, (uint64_t)begin, (uint64_t)end, PGN_FULL);
+	while (!w->failed && pgn_next_game(&r, &gm)) {
+		bookgen_replay(w, &gm);
+	}
+}
+
+
+static void *bookgen_worker(void *arg)
+{
+	struct bookgen_worker *w = arg;
+	struct bookgen *g = w->g;
+	int64_t chunk, begin;
+	int f;
+
+	while (!w->failed && (chunk = __atomic_fetch_add(&g->next, 1, __ATOMIC_RELAXED)) < g->chunks) {
+		/* find file and offset of the chunk */
+		for (f = 0; f < g->nfiles; f++) {
+			const int64_t n = ((int64_t)g->pgn[f].size + BOOKGEN_CHUNK - 1) / BOOKGEN_CHUNK;
+			if (chunk < n) {
+				break;
+			}
+			chunk -= n;
+		}
+		begin = chunk * BOOKGEN_CHUNK;
+		bookgen_read_chunk(w, &g->pgn[f], begin, begin + BOOKGEN_CHUNK);
+	}
+
+	return NULL;
+}
+
+
+/* Order by key, then by move */
+static int bookgen_cmp_stat(const void *a, const void *b)
+{
+	const struct bookgen_stat *x = a, *y = b;
+
+	if (x->key != y->key) {
+		return x->key < y->key ? -1 : 1;
+	}
+	return (x->move > y->move) - (x->move < y->move);
+}
+
+
+/* Order by key, then by decreasing weight */
+static int bookgen_cmp_entry(const void *a, const void *b)
+{
+	const struct book_entry *x = a, *y = b;
+
+	if (x->key != y->key) {
+		return x->key < y->key ? -1 : 1;
+	}
+	return (x->weight < y->weight) - (x->weight > y->weight);
+}
+
+
+/* Merge the counters of all workers into sorted book entries. Returns the
+ * number of entries, or -1 if out of memory */
+static int64_t bookgen_merge(const struct bookgen *g, struct bookgen_worker *w, const int threads,
+		struct book_entry **entries)
+{
+	struct bookgen_stat *all;
+	struct book_entry *e;
+	size_t total = 0, n = 0, k, i, j;
+	uint64_t max, weight;
+
+	for (int t = 0; t < threads; t++) {
+		total += w[t].map.used;
+	}
+
+	if (!(all = malloc((total ? total : 1) * sizeof(*all)))) {
+		perror("malloc failed");
+		return -1;
+	}
+	for (int t = 0; t < threads; t++) {
+		for (i = 0; i < w[t].map.size; i++) {
+			if (w[t].map.slot[i].move) {
+				all[n++] = w[t].map.slot[i];
+			}
+		}
+		free(w[t].map.slot);
+		w[t].map.slot = NULL;
+	}
+
+	qsort(all, n, sizeof(*all), bookgen_cmp_stat);
+
+	/* add up counters of the same move from different workers */
+	for (i = 0, k = 0; i < n; i++) {
+		if (k && all[k - 1].key == all[i].key && all[k - 1].move == all[i].move) {
+			all[k - 1].win += all[i].win;
+			all[k - 1].draw += all[i].draw;
+			all[k - 1].loss += all[i].loss;
+		} else {
+			all[k++] = all[i];
+		}
+	}
+
+	if (!(e = malloc((k ? k : 1) * sizeof(*e)))) {
+		perror("malloc failed");
+		free(all);
+		return -1;
+	}
+
+	/* weights of each position, scaled to 16 bits if necessary */
+	for (i = 0, n = 0; i < k; i = j) {
+		for (j = i, max = 0; j < k && all[j].key == all[i].key; j++) {
+			weight = 2ULL * all[j].win + all[j].draw;
+			max = weight > max ? weight : max;
+		}
+
+		for (size_t x = i; x < j; x++) {
+			weight = 2ULL * all[x].win + all[x].draw;
+			if (all[x].win + all[x].draw + all[x].loss < g->min_games || !weight) {
+				continue;
+			}
+			if (max > UINT16_MAX) {
+				weight = weight * UINT16_MAX / max;
+			}
+			e[n].key = all[x].key;
+			e[n].move = all[x].move;
+			e[n].weight = (uint16_t)(weight ? weight : 1);
+			e[n++].learn = 0;
+		}
+	}
+
+	free(all);
+	qsort(e, n, sizeof(*e), bookgen_cmp_entry);
+	*entries = e;
+	return (int64_t)n;
+}
+
+
+static bool bookgen_write(const char *file, const struct book_entry *e, const int64_t n)
+{
+	char tmp[4096];
+	uint8_t buf[BOOK_ENTRY_SIZE];
+	FILE *fp;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", file) >= (int)sizeof(tmp) ||
+			!(fp = fopen(tmp, "wb"))) {
+		perror(file);
+		return false;
+	}
+
+	for (int64_t i = 0; i < n; i++) {
+		book_put_entry(buf, &e[i]);
+		if (fwrite(buf, sizeof(buf), 1, fp) != 1) {
+			break;
+		}
+	}
+
+	if (ferror(fp) | fclose(fp) || rename(tmp, file)) {
+		perror(file);
+		remove(tmp);
+		return false;
+	}
+	return true;
+}
+
+
+static void bookgen_usage(const char *prog)
+{
+	printf("Usage: %s [-j threads] [-p plies] [-g games] [-o book.bin] PGN ...\n\n", prog);
+	printf("Build a Polyglot opening book from the games of PGN files.\n\n");
+	printf("  -j threads	number of worker threads (default: all cores)\n");
+	printf("  -p plies	use only the first plies of each game (default: 40)\n");
+	printf("  -g games	drop moves played in fewer games (default: 3)\n");
+	printf("  -o file	output book (default: book.bin)\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	static struct bookgen g = {NULL, {{NULL, 0, false}}, 0, 40, 3, 0, 0};
+	struct bookgen_worker *w;
+	struct book_entry *entries = NULL;
+	const char *out = "book.bin";
+	uint64_t games = 0, moves = 0, errors = 0;
+	int opt, threads = 1;
+	int64_t n;
+	bool ok = true;
+	time_t start = time(NULL);
+#ifdef HAVE_PTHREAD_H
+	pthread_t tid[BOOKGEN_MAX_THREADS];
+	int started = 0;
+#endif
+
+#if defined HAVE_SYSCONF && defined _SC_NPROCESSORS_ONLN
+	threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	while ((opt = getopt(argc, argv, "j:p:g:o:h")) != -1) {
+		switch (opt) {
+			case 'j': threads = atoi(optarg); break;
+			case 'p': g.max_ply = atoi(optarg); break;
+			case 'g': g.min_games = (uint32_t)atoi(optarg); break;
+			case 'o': out = optarg; break;
+			case 'h': bookgen_usage(argv[0]); return EXIT_SUCCESS;
+			default:  bookgen_usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+
+	if (optind == argc || argc - optind > BOOKGEN_MAX_FILES || threads < 1 || g.max_ply < 1) {
+		bookgen_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads > BOOKGEN_MAX_THREADS) {
+		threads = BOOKGEN_MAX_THREADS;
+	}
+
+	g.files = &argv[optind];
+	g.nfiles = argc - optind;
+	for (int f = 0; f < g.nfiles; f++) {
+		if (!pgn_open(&g.pgn[f], g.files[f])) {
+			return EXIT_FAILURE;
+		}
+		g.chunks += ((int64_t)g.pgn[f].size + BOOKGEN_CHUNK - 1) / BOOKGEN_CHUNK;
+	}
+
+	if (!(w = calloc((size_t)threads, sizeof(*w)))) {
+		perror("calloc failed");
+		return EXIT_FAILURE;
+	}
+
+	init_leaper_attacks();
+	init_magic_numbers();
+	init_slider_attacks();
+
+	for (int t = 0; t < threads; t++) {
+		w[t].g = &g;
+	}
+
+#ifdef HAVE_PTHREAD_H
+	for (int t = 1; t < threads; t++) {
+		if (pthread_create(&tid[started], NULL, bookgen_worker, &w[t]) == 0) {
+			started++;
+		}
+	}
+	bookgen_worker(&w[0]);
+	for (int t = 0; t < started; t++) {
+		pthread_join(tid[t], NULL);
+	}
+#else
+	bookgen_worker(&w[0]);
+#endif
+
+	for (int t = 0; t < threads; t++) {
+		games += w[t].games;
+		moves += w[t].moves;
+		errors += w[t].errors;
+		if (w[t].failed) {
+			ok = false;
+		}
+	}
+
+	if (ok && (n = bookgen_merge(&g, w, threads, &entries)) >= 0 &&
+			bookgen_write(out, entries, n)) {
+		printf("\n%llu games, %llu moves, %llu games with errors\n",
+				(unsigned long long)games, (unsigned long long)moves,
+				(unsigned long long)errors);
+		printf("Wrote %lld entries to %s in %.0f seconds\n",
+				(long long)n, out, difftime(time(NULL), start));
+	} else {
+		ok = false;
+	}
+
+	for (int t = 0; t < threads; t++) {
+		free(w[t].map.slot);
+	}
+	for (int f = 0; f < g.nfiles; f++) {
+		pgn_close(&g.pgn[f]);
+	}
+	free(entries);
+	free(w);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
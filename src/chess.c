@@ -38,8 +38,53 @@
 
 #include "chess.h"
 #include "bitboard.h"
+#include "book.h"
+#include "cpu.h"
+#include "mem.h"
+#include "search.h"
+#include "serve.h"
+#include "tables.h"
+#include "tb.h"
+#include "tt.h"
+#include "uci.h"
 
-#include <stdlib.h>	// for exit
+#include <stdlib.h>	// for exit, strtoull
+#include <string.h>	// for strlen, strcpy
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for getopt
+#endif
+
+#ifdef HAVE_GETOPT_H
+#  include <getopt.h>	// for getopt_long
+#endif
+
+#define BENCH_ROUNDS	3	// bench runs in each kind of pages
+
+/* long options without a short one */
+enum long_opt {
+	OPT_SERVE = 256,
+	OPT_THREADS,
+	OPT_HASH,
+	OPT_TABLES,
+	OPT_FORK_SERVER,
+	OPT_PREFORK,
+	OPT_BENCH,
+	OPT_CPU_INFO
+};
+
+static const struct option long_opts[] = {
+	{"serve",	required_argument,	NULL,	OPT_SERVE},
+	{"threads",	required_argument,	NULL,	OPT_THREADS},
+	{"hash",	required_argument,	NULL,	OPT_HASH},
+	{"tables",	required_argument,	NULL,	OPT_TABLES},
+	{"fork-server",	required_argument,	NULL,	OPT_FORK_SERVER},
+	{"prefork",	required_argument,	NULL,	OPT_PREFORK},
+	{"bench",	required_argument,	NULL,	OPT_BENCH},
+	{"cpu-info",	no_argument,		NULL,	OPT_CPU_INFO},
+	{"help",	no_argument,		NULL,	'h'},
+	{NULL,		0,			NULL,	0}
+};
 
 
 static bool is_player_turn(const struct board * const brd)
@@ -87,30 +132,295 @@ static enum game_status start_game(enum player wPlayer, enum player bPlayer, str
 }
 
 
+static void usage(const char *prog)
+{
+	printf("Usage: %s [options]\n"
+			"  -f FEN    position to analyse (default: initial position)\n"
+			"  -d N      search to depth N\n"
+			"  -m MS     search for MS milliseconds\n"
+			"  -t DIR    endgame tablebase directory\n"
+			"  -l N      probe tablebases in search up to N pieces\n"
+			"  -H FILE   keep the transposition table in FILE to resume the analysis\n"
+			"  -z MB     size of a new transposition table file (default: %d)\n"
+			"  -b FILE   play moves from Polyglot opening book\n"
+			"  -s        play best book move instead of a weighted random one\n"
+			"  -p N      count leaf nodes of move generation to depth N\n"
+			"  -u        talk the UCI protocol on stdin and stdout\n"
+			"  --serve ADDR  serve analysis requests on Unix socket ADDR, or on\n"
+			"                127.0.0.1 if ADDR is :PORT (see src/serve.h)\n"
+			"  --threads N   worker threads of the server (default: online CPUs)\n"
+			"  --hash MB     hash table of every server worker, or of the bench\n"
+			"                (default: %d)\n"
+			"  --fork-server ADDR  like --serve, but serve every client in a child\n"
+			"                forked from this initialised process\n"
+			"  --prefork N   children waiting for clients (default: %d)\n"
+			"  --bench N     search test positions to depth N in normal and in\n"
+			"                huge pages, and compare the best nodes per second\n"
+			"  --cpu-info    show the CPU features and the code picked for them\n"
+			"  --tables SHM  share the attack tables with other processes in the\n"
+			"                shared memory object SHM, \"/name\" or \"fd:N\"\n"
+			"  -h        show this help\n", prog, TT_FILE_MB, SERVE_HASH_MB, SERVE_PREFORK);
+}
+
+
+/* Search the position and print the best move, unless the book has one */
+static void analyse(const struct board * const brd, const struct search_limits *limits,
+		struct book *bk, const enum book_select sel, struct tt *tt)
+{
+	static struct search s;		// too large for the stack
+	struct board pos = *brd;
+	char uci[MAX_UCI_LEN];
+	move_t best;
+
+	if ((best = book_move(bk, &pos, sel)) != MOVE_NONE) {
+		printf("info string book move\n");
+	} else {
+		search_init(&s, brd, limits);
+		s.tt = tt;
+		best = search_position(&s);
+	}
+
+	if (best == MOVE_NONE) {
+		printf("bestmove (none)\n");
+	} else {
+		move_to_uci(best, uci);
+		printf("bestmove %s\n", uci);
+	}
+}
+
+
+/* Positions of the bench, from the opening to the endgame */
+static const char *const bench_fens[] = {
+	INITIAL_FEN,
+	"r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	"r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+	"6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"
+};
+
+
+/* Keep the bench quiet */
+static void bench_report(const struct search *s, const int depth)
+{
+	(void)s;
+	(void)depth;
+}
+
+
+/* Search the bench positions to depth with a hash table of hash_mb
+ * megabytes, with the hash and attack tables in huge pages if large, and
+ * store the nodes per second in nps */
+static bool bench_run(const int depth, const size_t hash_mb, const int tb_probe_limit,
+		const bool large, double *nps)
+{
+	static struct search s;		// too large for the stack
+	const struct search_limits limits = {depth, 0, 0, tb_probe_limit, 0};
+	const size_t n = sizeof(bench_fens) / sizeof(bench_fens[0]);
+	char fen[MAX_FEN_LEN];
+	uint64_t nodes = 0;
+	struct board brd;
+	struct tt tt;
+	long ms = 0;
+
+	mem_large_pages = large;
+	tables_free();
+	tables_init(NULL);
+	if (!tt_init(&tt, hash_mb * 1024)) {
+		return false;
+	}
+	printf("info string bench hash %zu MB in %s pages, attack tables in %s pages\n",
+			hash_mb, mem_pages_name(tt.pages), mem_pages_name(tables_pages()));
+
+	for (size_t i = 0; i < n; i++) {
+		strcpy(fen, bench_fens[i]);
+		if (!init_board(fen, &brd, AI, AI)) {
+			fprintf(stderr, "Bad bench position: %s\n", bench_fens[i]);
+			tt_free(&tt);
+			return false;
+		}
+		search_init(&s, &brd, &limits);
+		s.tt = &tt;
+		s.report = bench_report;
+		search_position(&s);
+		nodes += s.stats.nodes;
+		ms += search_elapsed(&s);
+	}
+	tt_free(&tt);
+
+	*nps = (double)nodes * 1000 / (double)(ms > 0 ? ms : 1);
+	printf("info string bench %s pages: %llu nodes in %ld ms, %.0f nps\n",
+			large ? "huge" : "normal", (unsigned long long)nodes, ms, *nps);
+	return true;
+}
+
+
+/* Run the bench BENCH_ROUNDS times in normal and in huge pages, taking
+ * turns at going first so that neither gains from warm caches, and
+ * compare the best nodes per second of both. The attack tables are
+ * rebuilt for every run, so shared tables are refused */
+static int bench(const int depth, const size_t hash_mb, const int tb_probe_limit)
+{
+	double nps, best[2] = {0};
+
+	if (tables_shared()) {
+		fprintf(stderr, "The bench builds its own attack tables, run it without --tables\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("info string bench move generation and evaluation for %s\n", cpu_level());
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		for (int i = 0; i < 2; i++) {
+			const int large = (round + i) & 1;
+
+			if (!bench_run(depth, hash_mb, tb_probe_limit, large, &nps)) {
+				mem_large_pages = true;
+				return EXIT_FAILURE;
+			}
+			if (nps > best[large]) {
+				best[large] = nps;
+			}
+		}
+	}
+	mem_large_pages = true;
+
+	printf("info string best of %d: normal pages %.0f nps, huge pages %.0f nps, %+.1f%%\n",
+			BENCH_ROUNDS, best[0], best[1], (best[1] / best[0] - 1) * 100);
+	return EXIT_SUCCESS;
+}
+
+
 /*
  * Main entry point for the program
  */
 int main(int argc, char *argv[])
 {
+	struct search_limits limits = {0, 0, 0, TB_MAX_PIECES, 0};
+	char fen[MAX_FEN_LEN] = INITIAL_FEN;
+	enum book_select book_sel = BOOK_WEIGHTED;
+	const char *tbpath = NULL, *bookpath = NULL, *ttpath = NULL, *serve = NULL, *tables = NULL;
+	const char *fork_server = NULL;
+	struct book book = {0};
+	struct tt tt = {0};
+	size_t tt_mb = TT_FILE_MB;
+	bool analysis = false, uci = false, shared_built;
+	size_t serve_mb = SERVE_HASH_MB;
+	int opt, perft_depth = 0, serve_threads = 0, prefork = SERVE_PREFORK, bench_depth = 0;
 	struct board board;
+	U64 occupancy = 0ULL;
 
-	printf("Tezdhar Chess Engine %s by %s\n%s\n", VERSION, AUTHOR, URL);
-	printf("This is free software: you are free to redistribute it.\n");
-	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	while ((opt = getopt_long(argc, argv, "f:d:m:t:l:H:z:b:sp:uh", long_opts, NULL)) != -1) {
+		switch (opt) {
+			case 'f':
+				if (strlen(optarg) >= MAX_FEN_LEN) {
+					fprintf(stderr, "FEN too long: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				strcpy(fen, optarg);
+				break;
+			case 'd': limits.depth = atoi(optarg); analysis = true; break;
+			case 'm': limits.movetime = atol(optarg); analysis = true; break;
+			case 't': tbpath = optarg; break;
+			case 'l': limits.tb_probe_limit = atoi(optarg); break;
+			case 'H': ttpath = optarg; break;
+			case 'z': tt_mb = strtoull(optarg, NULL, 10); break;
+			case 'b': bookpath = optarg; break;
+			case 's': book_sel = BOOK_BEST; break;
+			case 'p': perft_depth = atoi(optarg); break;
+			case 'u': uci = true; break;
+			case OPT_SERVE: serve = optarg; break;
+			case OPT_THREADS: serve_threads = atoi(optarg); break;
+			case OPT_HASH: serve_mb = strtoull(optarg, NULL, 10); break;
+			case OPT_TABLES: tables = optarg; break;
+			case OPT_FORK_SERVER: fork_server = optarg; break;
+			case OPT_PREFORK: prefork = atoi(optarg); break;
+			case OPT_BENCH: bench_depth = atoi(optarg); break;
+			case OPT_CPU_INFO: cpu_print_info(); exit(EXIT_SUCCESS);
+			case 'h': usage(argv[0]); exit(EXIT_SUCCESS);
+			default:  usage(argv[0]); exit(EXIT_FAILURE);
+		}
+	}
 
-	if (!init_board(NULL, &board, HUMAN, AI)) {
+	/* a GUI expects UCI on stdout from the first line */
+	fprintf(uci ? stderr : stdout, "Tezdhar Chess Engine %s by %s\n%s\n"
+			"This is free software: you are free to redistribute it.\n"
+			"There is NO WARRANTY, to the extent permitted by law.\n\n", VERSION, AUTHOR, URL);
+
+	if (tables && tables_open(tables, &shared_built)) {
+		printf("info string attack tables %s in %s\n", shared_built ? "built" : "shared", tables);
+	} else {
+		tables_init(NULL);
+	}
+	init_zobrist_keys();
+
+	if (!init_board(fen, &board, HUMAN, AI)) {
 		printf("Failed to initialize chess board. Exiting ...\n");
 		exit(EXIT_FAILURE);
 	}
 
-	init_leaper_attacks();
-	init_magic_numbers();
-	init_slider_attacks();
+	if (bookpath && !book_open(&book, bookpath)) {
+		fprintf(stderr, "Playing without opening book\n");
+	}
 
-//#ifdef TEST_CODE
-	// define test bitboard
-	U64 occupancy = 0ULL;
+	if (tbpath && !tb_init(tbpath)) {
+		fprintf(stderr, "No tablebases found in %s\n", tbpath);
+	}
+	if (!tbpath) {
+		limits.tb_probe_limit = 0;
+	}
+
+	if (perft_depth > 0) {
+		for (int d = 1; d <= perft_depth; d++) {
+			printf("perft %d: %llu\n", d, (unsigned long long)perft(&board, d));
+		}
+		return 0;
+	}
+
+	if (bench_depth > 0) {
+		opt = bench(bench_depth, serve_mb, limits.tb_probe_limit);
+		book_close(&book);
+		tb_free();
+		return opt;
+	}
+
+	if (serve) {
+		opt = serve_loop(serve, serve_threads, serve_mb, limits.tb_probe_limit);
+		book_close(&book);
+		tb_free();
+		return opt;
+	}
 
+	/* the children inherit the tables, tablebases and book set up above */
+	if (fork_server) {
+		opt = serve_fork_loop(fork_server, prefork > 0 ? prefork : 1, serve_mb, limits.tb_probe_limit);
+		book_close(&book);
+		tb_free();
+		return opt;
+	}
+
+	if (uci) {
+		opt = uci_loop(&book, book_sel, limits.tb_probe_limit);
+		book_close(&book);
+		tb_free();
+		return opt;
+	}
+
+	if (analysis) {
+		/* an adjourned analysis resumes with the results of the last runs */
+		if (ttpath && tt_open(&tt, ttpath, tt_mb * 1024)) {
+			printf("info string hash file %s generation %llu, %zu MB\n", ttpath,
+					(unsigned long long)tt.generation, tt.map_size >> 20);
+		}
+		analyse(&board, &limits, &book, book_sel, tt.table ? &tt : NULL);
+		tt_free(&tt);
+		book_close(&book);
+		tb_free();
+		return 0;
+	}
+
+//#ifdef TEST_CODE
 	// set blocker pieces on board
 	SET_BIT(occupancy, C5);
 	SET_BIT(occupancy, F2);
@@ -290,17 +290,108 @@ struct board
 	uint16_t halfMoves;		// number of half moves
 	uint16_t fullMoves;		// number of full moves
 	int8_t enpassant;		// en-passant square number
+	uint64_t key;			// zobrist_key() of the position
 };
 
 
+/* Moves generated by the engine are packed into 32 bits:
+ *	bits  0 ..  5	from square
+ *	bits  6 .. 11	to square
+ *	bits 12 .. 15	moving piece (enum pieces)
+ *	bits 16 .. 19	captured piece (enum pieces)
+ *	bits 20 .. 23	promoted piece (enum pieces)
+ *	bits 24 .. 26	special move flags */
+typedef U32 move_t;
+
+#define MOVE_NONE		0U
+#define MOVE_EP			(1U << 24)	// en-passant capture
+#define MOVE_DOUBLE_PUSH	(1U << 25)	// pawn moves two squares
+#define MOVE_CASTLING		(1U << 26)	// king moves two squares
+
+#define MOVE_FROM(m)		((enum square)((m) & 0x3f))
+#define MOVE_TO(m)		((enum square)(((m) >> 6) & 0x3f))
+#define MOVE_PIECE(m)		((enum pieces)(((m) >> 12) & 0xf))
+#define MOVE_CAPTURED(m)	((enum pieces)(((m) >> 16) & 0xf))
+#define MOVE_PROMOTED(m)	((enum pieces)(((m) >> 20) & 0xf))
+
+#define MAX_MOVES	256	// more than the legal moves of any position
+#define MAX_UCI_LEN	6	// e.g. "e7e8q" plus Null terminator
+
+
+/* Moves generated for a position */
+struct move_list {
+	move_t moves[MAX_MOVES];
+	int count;
+};
+
+
+/* Board state which can not be restored from the move itself */
+struct undo {
+	bool castling[4];		// castling rights before the move
+	uint16_t halfMoves;		// half move clock before the move
+	uint16_t fullMoves;		// full move number before the move
+	int8_t enpassant;		// en-passant square before the move
+	uint64_t key;			// hash key before the move
+};
+
+
+/* color of a piece on board, not valid for EMPTY_SQR */
+static inline enum color piece_color(const enum pieces p)
+{
+	return p >= WHITE_ROOK ? WHITE : BLACK;
+}
+
+
+/* type of a piece irrespective of its color */
+static inline enum chessmen piece_type(const enum pieces p)
+{
+	switch (p) {
+		case BLACK_ROOK:   case WHITE_ROOK:	return ROOK;
+		case BLACK_KNIGHT: case WHITE_KNIGHT:	return KNIGHT;
+		case BLACK_BISHOP: case WHITE_BISHOP:	return BISHOP;
+		case BLACK_QUEEN:  case WHITE_QUEEN:	return QUEEN;
+		case BLACK_KING:   case WHITE_KING:	return KING;
+		case BLACK_PAWN:   case WHITE_PAWN:	return PAWN;
+		case EMPTY_SQR:
+		default:				return EMPTY;
+	}
+}
+
+
+/* piece of given type and color */
+static inline enum pieces make_piece(const enum chessmen type, const enum color c)
+{
+	switch (type) {
+		case ROOK:	return c == WHITE ? WHITE_ROOK : BLACK_ROOK;
+		case KNIGHT:	return c == WHITE ? WHITE_KNIGHT : BLACK_KNIGHT;
+		case BISHOP:	return c == WHITE ? WHITE_BISHOP : BLACK_BISHOP;
+		case QUEEN:	return c == WHITE ? WHITE_QUEEN : BLACK_QUEEN;
+		case KING:	return c == WHITE ? WHITE_KING : BLACK_KING;
+		case PAWN:	return c == WHITE ? WHITE_PAWN : BLACK_PAWN;
+		case EMPTY:
+		default:	return EMPTY_SQR;
+	}
+}
+
+
+/* pack a move into the layout described above */
+static inline move_t encode_move(const int from, const int to, const enum pieces pc,
+		const enum pieces cap, const enum pieces promo, const U32 flags)
+{
+	return (U32)from | ((U32)to << 6) | ((U32)pc << 12) |
+		((U32)cap << 16) | ((U32)promo << 20) | flags;
+}
+
+
 /* Function prototypes */
 void print_fen_str(struct board *brd);
+void board_to_fen(const struct board * const brd, char * const fen);
 bool init_board(char *fen, struct board *brd, enum player w, enum player b);
 void print_board(struct board *brd);
 void print_board_struct_info(struct board *brd);
 void parse_san_input(char *input);
 char *input_user_move(char * const buf, const struct board * const brd);
-struct move parse_input_move(char * const movetext);
+struct move parse_input_move(const char * const movetext);
 void print_move_struct_info(const char *f, int l, const char *func, struct move *m);
 bool parse_fen_record(char *fen, struct board *brd);
 void clear_castling_rights(struct board *brd);
@@ -330,6 +421,29 @@ bool init_rook_magic(const bool);
 void init_rook_attacks(void);
 void init_leaper_attacks(void);
 void init_slider_attacks(void);
+uint64_t get_white_pieces(const struct bitboards * const bb);
+uint64_t get_black_pieces(const struct bitboards * const bb);
+uint64_t get_all_pieces(const struct bitboards * const bb);
+uint64_t *piece_bitboard(struct bitboards * const bb, const enum pieces p);
+bool is_square_attacked(const struct board * const brd, const enum square sq, const enum color by);
+bool in_check(const struct board * const brd, const enum color side);
+uint64_t pinned_pieces(const struct board * const brd, const enum color side);
+void gen_moves(const struct board * const brd, struct move_list * const list, const bool captures_only);
+bool make_move(struct board * const brd, const move_t m, struct undo * const u);
+void unmake_move(struct board * const brd, const move_t m, const struct undo * const u);
+int gen_legal_moves(struct board * const brd, struct move_list * const list);
+void move_to_uci(const move_t m, char * const buf);
+void move_to_san(struct board * const brd, const move_t m, char * const buf);
+move_t resolve_move(struct board * const brd, const struct move * const mv);
+uint64_t perft(struct board * const brd, const int depth);
+void init_zobrist_keys(void);
+uint64_t zobrist_key(const struct board * const brd);
+uint64_t zobrist_state(const struct board * const brd);
+uint64_t zobrist_scheme(void);
+uint64_t polyglot_key(const struct board * const brd);
+int evaluate(const struct board * const brd);
+
+extern uint64_t zobrist_pieces[16][64];
 
 
 #endif	/* __CHESS_H__ */
@@ -0,0 +1,72 @@
+/* @file:	tezdhar/src/cpu.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/cpu.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Features of the CPU and the clones of the hot functions picked
+ * 		for it. See cpu.h.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "cpu.h"
+
+#include <stdio.h>	// for printf
+
+
+/* Level of the clones the loader picked: the highest level of CPU_CLONES
+ * which the CPU supports, checked with the names of cpu.h */
+const char *cpu_level(void)
+{
+#ifdef CPU_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports(CPU_LEVEL_V4)) {
+		return CPU_LEVEL_V4;
+	}
+	if (__builtin_cpu_supports(CPU_LEVEL_V3)) {
+		return CPU_LEVEL_V3;
+	}
+	if (__builtin_cpu_supports(CPU_LEVEL_V2)) {
+		return CPU_LEVEL_V2;
+	}
+	return "default";
+#else
+	return "default, built without clones";
+#endif
+}
+
+
+/* Print the features of the CPU which the clones use */
+void cpu_print_info(void)
+{
+#ifdef CPU_X86
+	/* __builtin_cpu_supports() takes string literals only, and needs no
+	 * __builtin_cpu_init() outside of constructors */
+	const struct {
+		const char *name;
+		int has;
+	} features[] = {
+		{"popcnt", __builtin_cpu_supports("popcnt")},
+		{"bmi1", __builtin_cpu_supports("bmi")},
+		{"bmi2", __builtin_cpu_supports("bmi2")},
+		{"avx2", __builtin_cpu_supports("avx2")},
+		{"avx512f", __builtin_cpu_supports("avx512f")},
+		{"avx512vpopcntdq", __builtin_cpu_supports("avx512vpopcntdq")}
+	};
+
+	printf("cpu features:");
+	for (size_t i = 0; i < sizeof(features) / sizeof(features[0]); i++) {
+		if (features[i].has) {
+			printf(" %s", features[i].name);
+		}
+	}
+	printf("\n");
+#else
+	printf("cpu features: not detected\n");
+#endif
+	printf("move generation and evaluation: %s\n", cpu_level());
+	printf("slider attacks: magic bitboards\n");
+}
@@ -0,0 +1,58 @@
+/* @file:	tezdhar/src/cpu.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/cpu.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Dispatch of the hot functions to the instruction set of the CPU
+ * 		the program runs on.
+ *
+ *
+ *			------------
+ *			CPU Dispatch
+ *			------------
+ *
+ * A generic x86-64 build may not use POPCNT, TZCNT, BLSR or AVX, so that
+ * BITS() and LSB() become library calls or longer sequences. The hot
+ * functions marked CPU_CLONES are compiled once for each x86-64 level:
+ *
+ *	default		any x86-64
+ *	popcnt		POPCNT
+ *	x86-64-v3	POPCNT, BMI1, BMI2, LZCNT, AVX2, FMA
+ *	x86-64-v4	v3 with AVX-512 F, BW, CD, DQ and VL
+ *
+ * and the loader picks the highest level the CPU runs through an ifunc,
+ * once for all. The static functions they call are inlined into every
+ * clone. The clones are hidden like the rest of the library, so that
+ * libtezdhar.so exports only the tezdhar_* API.
+ *
+ * count_bits() and get_ls1b() of bitboard.c are not cloned: they only
+ * run while the attack tables are built and magic numbers searched, and
+ * when bitboards are printed. The similarity index picks its vector
+ * kernels on its own (see sim.h). "tezdhar --cpu-info" shows the
+ * features of the CPU and the clone used.
+ */
+
+#ifndef __CPU_H__
+#define __CPU_H__	1
+
+#include "chess.h"
+
+#if defined HAVE_FUNC_ATTRIBUTE_TARGET_CLONES && defined __x86_64__
+/* levels above default, as named by __builtin_cpu_supports() */
+#  define CPU_LEVEL_V4	"x86-64-v4"
+#  define CPU_LEVEL_V3	"x86-64-v3"
+#  define CPU_LEVEL_V2	"popcnt"
+#  define CPU_CLONES	__attribute__((visibility("hidden"), target_clones("default", \
+				CPU_LEVEL_V2, "arch=" CPU_LEVEL_V3, "arch=" CPU_LEVEL_V4)))
+#  define CPU_X86	1
+#else
+#  define CPU_CLONES
+#endif
+
+
+/* Function prototypes */
+const char *cpu_level(void);
+void cpu_print_info(void);
+
+
+#endif	/* __CPU_H__ */
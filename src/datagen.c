@@ -0,0 +1,477 @@
+/* @file:	tezdhar/src/datagen.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/datagen.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	tezdhar-datagen, plays self-play games on every core and
+ * 		writes their quiet positions as training data.
+ *
+ *
+ *			-----------------
+ *			Self-Play Games
+ *			-----------------
+ *
+ * Every worker thread plays one game at a time with its own search and a
+ * small transposition table, which is cleared before each game so that
+ * games do not depend on each other. The games are handed out by a shared
+ * atomic counter, so all cores stay busy until the last game starts.
+ *
+ * A game starts with weighted book moves, if a book is given, followed by
+ * a few random legal moves, so that games do not repeat. Then every move
+ * is searched to a fixed number of nodes. A game ends by mate, stalemate,
+ * the 50 move rule, threefold repetition, bare kings, or when one side
+ * has been winning by the adjudication score for DATAGEN_ADJ_PLIES plies.
+ *
+ * The positions of a game are kept by the worker until its result is
+ * known, then written as one run, so that they can be chained in the
+ * training file (see train.h). Noisy positions are not written: positions
+ * in check, positions whose best move is a capture or a promotion, since
+ * their static evaluation is far from the searched score, and positions
+ * scored beyond the score limit or as mate.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "bitboard.h"
+#include "book.h"
+#include "search.h"
+#include "train.h"
+#include "tt.h"
+
+#include <stdio.h>	// for printf, fprintf, perror
+#include <stdlib.h>	// for calloc, free, atoi, strtoull
+
+#ifdef HAVE_TIME_H
+#  include <time.h>	// for time
+#endif
+
+#ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>	// for gettimeofday
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for getopt, sysconf
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create, pthread_mutex_lock
+#endif
+
+#define DATAGEN_MAX_THREADS	256
+#define DATAGEN_MAX_PLIES	512	// longer games are adjudicated a draw
+#define DATAGEN_ADJ_PLIES	8	// plies beyond the adjudication score
+#define DATAGEN_NODES		5000	// default nodes per move
+#define DATAGEN_RANDOM		8	// default random opening plies
+#define DATAGEN_SCORE_LIMIT	2000	// default score limit of written positions
+#define DATAGEN_ADJ_SCORE	2500	// default adjudication score
+#define DATAGEN_TT_KB		1024	// default table size per thread
+
+struct datagen {
+	struct board start;		// initial position
+	struct book book;
+	bool use_book;
+	struct search_limits limits;
+	int games;			// games to play
+	int random_plies;
+	int score_limit;
+	int adj_score;
+	size_t tt_kb;
+	uint64_t seed;
+	int next;			// next game to be taken
+	struct train_writer out;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t out_lock;
+#endif
+};
+
+struct datagen_worker {
+	struct datagen *c;
+	struct search s;
+	struct tt tt;
+	struct book book;		// own copy for its random state
+	uint64_t rng;
+	struct train_pos *pos;		// kept positions of the game
+	int *ply;			// and their plies
+	move_t *moves;			// moves of the game
+	uint64_t *keys;			// keys of the positions of the game
+	uint64_t games, positions, plies, nodes;
+	uint64_t wins, draws, losses;	// results for White
+	bool failed;
+};
+
+
+static uint64_t datagen_random(struct datagen_worker *w)
+{
+	w->rng ^= w->rng << 13;
+	w->rng ^= w->rng >> 7;
+	w->rng ^= w->rng << 17;
+	return w->rng;
+}
+
+
+/* Iteration callback, the search prints nothing */
+static void datagen_report(const struct search *s, const int depth)
+{
+	(void)s;
+	(void)depth;
+}
+
+
+/* Has the position at ply occurred twice before */
+static bool datagen_threefold(const struct datagen_worker *w, const struct board *brd, const int ply)
+{
+	const size_t p = (size_t)ply;
+	int seen = 0;
+
+	/* d plies back, within the reversible moves */
+	for (size_t d = 2; d <= p && d <= brd->halfMoves; d += 2) {
+		if (w->keys[p - d] == w->keys[p] && ++seen == 2) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/* Play the opening: book moves, then random moves. Returns the number of
+ * plies played, or -1 if the game already ended */
+static int datagen_opening(struct datagen_worker *w, struct board *brd)
+{
+	struct move_list legal;
+	struct undo u;
+	move_t m;
+	int ply = 0;
+
+	while (w->c->use_book && ply < DATAGEN_MAX_PLIES / 2 &&
+			(m = book_move(&w->book, brd, BOOK_WEIGHTED)) != MOVE_NONE) {
+		w->moves[ply] = m;
+		make_move(brd, m, &u);
+		w->keys[++ply] = brd->key;
+	}
+
+	for (int i = 0; i < w->c->random_plies; i++) {
+		if (!gen_legal_moves(brd, &legal)) {
+			return -1;
+		}
+		m = legal.moves[datagen_random(w) % (uint64_t)legal.count];
+		w->moves[ply] = m;
+		make_move(brd, m, &u);
+		w->keys[++ply] = brd->key;
+	}
+
+	return gen_legal_moves(brd, &legal) ? ply : -1;
+}
+
+
+/* Is the position worth writing */
+static bool datagen_quiet(const struct datagen *c, const struct board *brd, const move_t best,
+		const int score)
+{
+	return !in_check(brd, brd->turn) && MOVE_CAPTURED(best) == EMPTY_SQR &&
+		MOVE_PROMOTED(best) == EMPTY_SQR && !IS_MATE_SCORE(score) &&
+		score <= c->score_limit && score >= -c->score_limit;
+}
+
+
+/* Write the kept positions of a finished game */
+static void datagen_write(struct datagen_worker *w, const int kept, const int8_t result)
+{
+	struct datagen *c = w->c;
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&c->out_lock);
+#endif
+	for (int i = 0; i < kept && c->out.ok; i++) {
+		w->pos[i].result = result;
+		train_write(&c->out, &w->pos[i],
+				i && w->ply[i] == w->ply[i - 1] + 1 ? w->moves[w->ply[i - 1]] : MOVE_NONE);
+	}
+	if (!c->out.ok) {
+		w->failed = true;
+	}
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&c->out_lock);
+#endif
+
+	w->positions += (uint64_t)kept;
+	if (result > 0) {
+		w->wins++;
+	} else if (result < 0) {
+		w->losses++;
+	} else {
+		w->draws++;
+	}
+}
+
+
+/* Play a game and write its quiet positions */
+static void datagen_game(struct datagen_worker *w)
+{
+	struct datagen *c = w->c;
+	struct board brd = c->start;
+	struct undo u;
+	int8_t result = 0;
+	int ply, kept = 0, adj = 0, score;
+	move_t m;
+
+	tt_clear(&w->tt);
+	w->keys[0] = brd.key;
+	if ((ply = datagen_opening(w, &brd)) < 0) {
+		return;		// the opening ended the game, it is not played
+	}
+
+	for (; ply < DATAGEN_MAX_PLIES; ply++) {
+		const int white = brd.turn == WHITE ? 1 : -1;
+
+		if (brd.halfMoves >= 100 || datagen_threefold(w, &brd, ply) ||
+				BITS(get_all_pieces(&brd.bb)) == 2) {
+			break;
+		}
+
+		search_init(&w->s, &brd, &c->limits);
+		w->s.tt = &w->tt;
+		w->s.report = datagen_report;
+		m = search_position(&w->s);
+		w->nodes += w->s.stats.nodes;
+		w->plies++;
+
+		if (m == MOVE_NONE) {
+			/* mated or stalemated */
+			result = (int8_t)(in_check(&brd, brd.turn) ? -white : 0);
+			break;
+		}
+
+		score = w->s.best_score;
+		if (datagen_quiet(c, &brd, m, score)) {
+			w->pos[kept].brd = brd;
+			w->pos[kept].best = m;
+			w->pos[kept].score = (int16_t)score;
+			w->ply[kept++] = ply;
+		}
+
+		/* adjudicate once the score stayed beyond the limit for a while */
+		adj = score >= c->adj_score || score <= -c->adj_score ? adj + 1 : 0;
+		if (adj >= DATAGEN_ADJ_PLIES) {
+			result = (int8_t)(score > 0 ? white : -white);
+			break;
+		}
+
+		w->moves[ply] = m;
+		make_move(&brd, m, &u);
+		w->keys[ply + 1] = brd.key;
+	}
+
+	w->games++;
+	datagen_write(w, kept, result);
+}
+
+
+static void *datagen_worker(void *arg)
+{
+	struct datagen_worker *w = arg;
+	struct datagen *c = w->c;
+
+	while (!w->failed && __atomic_fetch_add(&c->next, 1, __ATOMIC_RELAXED) < c->games) {
+		datagen_game(w);
+	}
+
+	return NULL;
+}
+
+
+static bool datagen_alloc(struct datagen_worker *w, const int t)
+{
+	struct datagen *c = w->c;
+
+	if (!tt_init(&w->tt, c->tt_kb)) {
+		return false;
+	}
+	if (!(w->pos = calloc(DATAGEN_MAX_PLIES, sizeof(*w->pos))) ||
+			!(w->ply = calloc(DATAGEN_MAX_PLIES, sizeof(*w->ply))) ||
+			!(w->moves = calloc(DATAGEN_MAX_PLIES, sizeof(*w->moves))) ||
+			!(w->keys = calloc(DATAGEN_MAX_PLIES + 1, sizeof(*w->keys)))) {
+		perror("calloc failed");
+		return false;
+	}
+
+	/* distinct random streams per thread, never zero */
+	w->rng = c->seed ^ (0x9e3779b97f4a7c15ULL * ((uint64_t)t + 1));
+	if (!w->rng) {
+		w->rng = 1;
+	}
+	w->book = c->book;
+	w->book.rng = w->rng ^ 0xd1b54a32d192ed03ULL;
+	return true;
+}
+
+
+static void datagen_usage(const char *prog)
+{
+	printf("Usage: %s [-j threads] [-g games] [-n nodes] [-r plies] [-b book] "
+			"[-s score] [-a score] [-H kb] [-S seed] [-c] -o file\n\n", prog);
+	printf("Play self-play games and write their quiet positions as training data.\n\n");
+	printf("  -j threads	number of games played at once (default: all cores)\n");
+	printf("  -g games	number of games (default: 100)\n");
+	printf("  -n nodes	nodes searched per move (default: %d)\n", DATAGEN_NODES);
+	printf("  -r plies	random moves after the book moves (default: %d)\n", DATAGEN_RANDOM);
+	printf("  -b book	start games with weighted moves of a Polyglot book\n");
+	printf("  -s score	skip positions scored beyond score (default: %d)\n", DATAGEN_SCORE_LIMIT);
+	printf("  -a score	adjudicate a win beyond score (default: %d)\n", DATAGEN_ADJ_SCORE);
+	printf("  -H kb		transposition table per thread (default: %d)\n", DATAGEN_TT_KB);
+	printf("  -S seed	seed of the random openings (default: time)\n");
+	printf("  -c		chain the positions of a game in the training data\n");
+	printf("  -o file	training data file to write\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	static struct datagen c;
+	struct datagen_worker *w;
+	struct timeval start, end;
+	char fen[] = INITIAL_FEN;
+	const char *out = NULL, *book = NULL;
+	uint64_t games = 0, positions = 0, plies = 0, nodes = 0, wins = 0, draws = 0, losses = 0;
+	unsigned flags = 0;
+	int opt, threads = 1;
+	double secs;
+	bool ok = true;
+#ifdef HAVE_PTHREAD_H
+	pthread_t tid[DATAGEN_MAX_THREADS];
+	int started = 0;
+#endif
+
+#if defined HAVE_SYSCONF && defined _SC_NPROCESSORS_ONLN
+	threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	c.games = 100;
+	c.limits.nodes = DATAGEN_NODES;
+	c.random_plies = DATAGEN_RANDOM;
+	c.score_limit = DATAGEN_SCORE_LIMIT;
+	c.adj_score = DATAGEN_ADJ_SCORE;
+	c.tt_kb = DATAGEN_TT_KB;
+	c.seed = (uint64_t)time(NULL);
+
+	while ((opt = getopt(argc, argv, "j:g:n:r:b:s:a:H:S:co:h")) != -1) {
+		switch (opt) {
+			case 'j': threads = atoi(optarg); break;
+			case 'g': c.games = atoi(optarg); break;
+			case 'n': c.limits.nodes = strtoull(optarg, NULL, 10); break;
+			case 'r': c.random_plies = atoi(optarg); break;
+			case 'b': book = optarg; break;
+			case 's': c.score_limit = atoi(optarg); break;
+			case 'a': c.adj_score = atoi(optarg); break;
+			case 'H': c.tt_kb = strtoull(optarg, NULL, 10); break;
+			case 'S': c.seed = strtoull(optarg, NULL, 10); break;
+			case 'c': flags = TRAIN_CHAIN; break;
+			case 'o': out = optarg; break;
+			case 'h': datagen_usage(argv[0]); return EXIT_SUCCESS;
+			default:  datagen_usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+
+	if (!out || optind != argc || threads < 1 || c.games < 0 || !c.limits.nodes ||
+			c.random_plies < 0 || c.random_plies > DATAGEN_MAX_PLIES / 2 || c.adj_score <= 0) {
+		datagen_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads > DATAGEN_MAX_THREADS) {
+		threads = DATAGEN_MAX_THREADS;
+	}
+
+	init_leaper_attacks();
+	init_magic_numbers();
+	init_slider_attacks();
+	init_zobrist_keys();
+
+	if (!init_board(fen, &c.start, AI, AI)) {
+		return EXIT_FAILURE;
+	}
+	if (book) {
+		if (!book_open(&c.book, book)) {
+			return EXIT_FAILURE;
+		}
+		c.use_book = true;
+	}
+	if (!train_create(&c.out, out, flags)) {
+		return EXIT_FAILURE;
+	}
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_init(&c.out_lock, NULL);
+#endif
+
+	if (!(w = calloc((size_t)threads, sizeof(*w)))) {
+		perror("calloc failed");
+		return EXIT_FAILURE;
+	}
+	for (int t = 0; t < threads; t++) {
+		w[t].c = &c;
+		if (!datagen_alloc(&w[t], t)) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	gettimeofday(&start, NULL);
+#ifdef HAVE_PTHREAD_H
+	for (int t = 1; t < threads; t++) {
+		if (pthread_create(&tid[started], NULL, datagen_worker, &w[t]) == 0) {
+			started++;
+		}
+	}
+	datagen_worker(&w[0]);
+	for (int t = 0; t < started; t++) {
+		pthread_join(tid[t], NULL);
+	}
+#else
+	datagen_worker(&w[0]);
+#endif
+	gettimeofday(&end, NULL);
+
+	secs = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1e6;
+	if (secs <= 0) {
+		secs = 1e-6;
+	}
+
+	for (int t = 0; t < threads; t++) {
+		games += w[t].games;
+		positions += w[t].positions;
+		plies += w[t].plies;
+		nodes += w[t].nodes;
+		wins += w[t].wins;
+		draws += w[t].draws;
+		losses += w[t].losses;
+		if (w[t].failed) {
+			ok = false;
+		}
+		tt_free(&w[t].tt);
+		free(w[t].pos);
+		free(w[t].ply);
+		free(w[t].moves);
+		free(w[t].keys);
+	}
+	free(w);
+
+	if (!train_finish(&c.out)) {
+		ok = false;
+	}
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_destroy(&c.out_lock);
+#endif
+	if (c.use_book) {
+		book_close(&c.book);
+	}
+
+	printf("%llu games (+%llu =%llu -%llu), %llu positions of %llu searched, %llu nodes\n",
+			(unsigned long long)games, (unsigned long long)wins, (unsigned long long)draws,
+			(unsigned long long)losses, (unsigned long long)positions,
+			(unsigned long long)plies, (unsigned long long)nodes);
+	printf("%.2f seconds, %.0f positions/s, %.0f positions/s/core, %.0f nps with %d threads\n",
+			secs, (double)positions / secs, (double)positions / secs / threads,
+			(double)nodes / secs, threads);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
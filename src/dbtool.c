@@ -0,0 +1,1119 @@
+/* @file:	tezdhar/src/dbtool.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/dbtool.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	tezdhar-db, builds a position database from PGN files and
+ * 		answers opening explorer queries on it.
+ *
+ *
+ *			----------------
+ *			Parallel Build
+ *			----------------
+ *
+ * The build reads the PGN files in chunks with worker threads, the same
+ * way tezdhar-book does. Every worker replays its games into private
+ * arrays of games, move bytes, tags and index entries, numbering games
+ * from zero. At the end the arrays are concatenated: the game numbers and
+ * section offsets of worker t are shifted by the totals of the workers
+ * before it, and all index entries are sorted once.
+ *
+ * A query maps the database, sets up the position from a FEN and moves,
+ * and reads the run of index entries of its key. The run is contiguous,
+ * so a query costs one binary search plus a sequential read proportional
+ * to the number of games found, however large the database is. With -B
+ * the positions of random games are queried to measure the latency.
+ *
+ * A pattern scan (-s) replays every game of the moves section, split in
+ * blocks of games among the threads, and tests every position against the
+ * bitboard predicates of the pattern. Material filters end a game early:
+ * once a game has too few pieces for the pattern, none of its later
+ * positions can match.
+ *
+ * A similarity index (-X) holds the bitboards of every distinct position
+ * of the database index, and -i lists the positions nearest to a given one
+ * by weighted Hamming distance, see sim.h.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "pattern.h"
+#include "pgn.h"
+#include "posdb.h"
+#include "sim.h"
+
+#include <stdio.h>	// for printf, fprintf, fopen, fwrite
+#include <stdlib.h>	// for malloc, calloc, realloc, free, qsort, atoi
+#include <string.h>	// for memcpy, strcpy, strlen
+
+#ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>	// for gettimeofday
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for getopt, sysconf
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>	// for madvise
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create
+#endif
+
+#define DBTOOL_CHUNK		(4LL << 20)	// bytes of PGN per work unit
+#define DBTOOL_MAX_FILES	1024
+#define DBTOOL_MAX_THREADS	256
+#define DBTOOL_MAX_PLY		40		// default indexed plies
+#define DBTOOL_TAG_LEN		256		// longer tag values are cut
+#define DBTOOL_LIST		10		// default games listed by a query
+#define DBTOOL_SCAN_BLOCK	1024		// games per work unit of a scan
+#define DBTOOL_NEAREST		10		// default positions listed by -i
+
+struct dbtool {
+	char **files;
+	struct pgn_file pgn[DBTOOL_MAX_FILES];
+	int nfiles;
+	int max_ply;
+	int64_t chunks;			// total number of chunks
+	int64_t next;			// next chunk to be taken
+};
+
+/* Games read by a worker, numbered from zero */
+struct dbtool_worker {
+	struct dbtool *d;
+	struct posdb_game *games;
+	size_t ngames, games_cap;
+	uint8_t *moves;
+	size_t moves_len, moves_cap;
+	char *tags;
+	size_t tags_len, tags_cap;
+	struct posdb_entry *entries;
+	size_t nentries, entries_cap;
+	uint64_t errors;
+	bool failed;			// out of memory
+};
+
+/* Pattern scan over all the games of a database */
+struct dbtool_scan {
+	const struct posdb *db;
+	const struct pattern *pt;
+	struct board initial;		// start of games without a FEN
+	uint64_t next;			// next block of games to be taken
+};
+
+/* First matching position of a game */
+struct dbtool_match {
+	uint32_t game;
+	uint16_t ply;
+};
+
+struct dbtool_scanner {
+	struct dbtool_scan *s;
+	struct dbtool_match *matches;
+	size_t nmatches, matches_cap;
+	uint64_t positions;		// positions tested
+	uint64_t exhausted;		// games left for lack of material
+	bool failed;			// out of memory
+};
+
+
+/* Make room for n more elements of an array */
+static bool dbtool_reserve(void **buf, size_t *cap, const size_t used, const size_t n, const size_t size)
+{
+	size_t want = *cap ? *cap : 4096;
+	void *p;
+
+	if (used + n <= *cap) {
+		return true;
+	}
+	while (want < used + n) {
+		want *= 2;
+	}
+	if (!(p = realloc(*buf, want * size))) {
+		perror("realloc failed");
+		return false;
+	}
+	*buf = p;
+	*cap = want;
+	return true;
+}
+
+
+static bool dbtool_add_entry(struct dbtool_worker *w, const struct board *brd, const int ply,
+		const int next, const enum posdb_result result)
+{
+	struct posdb_entry *e;
+
+	if (!dbtool_reserve((void **)&w->entries, &w->entries_cap, w->nentries, 1, sizeof(*e))) {
+		return false;
+	}
+	e = &w->entries[w->nentries++];
+	e->key = zobrist_key(brd);
+	e->game = (uint32_t)w->ngames;
+	e->ply = (uint16_t)ply;
+	e->next = (uint8_t)next;
+	e->result = (uint8_t)result;
+	return true;
+}
+
+
+/* Append the stored tags of a game */
+static bool dbtool_add_tags(struct dbtool_worker *w, const struct pgn_game *gm)
+{
+	char value[DBTOOL_TAG_LEN];
+	size_t len;
+
+	for (int t = 0; t < POSDB_TAGS; t++) {
+		if (!pgn_span_copy(pgn_tag(gm, posdb_tag_names[t]), value, sizeof(value))) {
+			value[0] = '\0';
+		}
+		len = strlen(value) + 1;
+		if (!dbtool_reserve((void **)&w->tags, &w->tags_cap, w->tags_len, len, 1)) {
+			return false;
+		}
+		memcpy(w->tags + w->tags_len, value, len);
+		w->tags_len += len;
+	}
+	return true;
+}
+
+
+/* Replay a game, store its moves and tags and index its first plies.
+ * Games with an illegal move are dropped */
+static void dbtool_replay(struct dbtool_worker *w, const struct pgn_game *gm)
+{
+	const struct pgn_span *tag = pgn_tag(gm, "Result");
+	const size_t moves_len = w->moves_len, tags_len = w->tags_len, nentries = w->nentries;
+	char fen[MAX_FEN_LEN], buf[MAX_MOVE_LEN];
+	enum posdb_result result = POSDB_UNKNOWN;
+	struct move_list legal;
+	struct pgn_lexer lx;
+	struct pgn_token tok;
+	struct posdb_game *g;
+	struct board brd;
+	struct move mv;
+	struct undo u;
+	int depth = 0, ply = 0, code;
+	move_t m;
+
+	if (pgn_span_eq(tag, "1-0")) {
+		result = POSDB_WHITE_WINS;
+	} else if (pgn_span_eq(tag, "0-1")) {
+		result = POSDB_BLACK_WINS;
+	} else if (pgn_span_eq(tag, "1/2-1/2")) {
+		result = POSDB_DRAW;
+	}
+
+	if (!pgn_span_copy(pgn_tag(gm, "FEN"), fen, sizeof(fen))) {
+		strcpy(fen, INITIAL_FEN);
+	}
+	if (!init_board(fen, &brd, AI, AI)) {
+		w->errors++;
+		return;
+	}
+
+	pgn_lexer_init(&lx, &gm->movetext);
+	while (pgn_next_token(&lx, &tok) != PGN_TOKEN_END) {
+		if (tok.type == PGN_TOKEN_OPEN) {
+			depth++;
+		} else if (tok.type == PGN_TOKEN_CLOSE) {
+			depth -= depth ? 1 : 0;
+		}
+		if (tok.type != PGN_TOKEN_MOVE || depth) {
+			continue;	// variations are not stored
+		}
+
+		if (tok.text.len >= MAX_MOVE_LEN || ply == UINT16_MAX) {
+			goto drop;
+		}
+		memcpy(buf, tok.text.ptr, tok.text.len);
+		buf[tok.text.len] = '\0';
+
+		mv = parse_input_move(buf);
+		if ((m = resolve_move(&brd, &mv)) == MOVE_NONE) {
+			goto drop;
+		}
+		gen_legal_moves(&brd, &legal);
+		for (code = 0; code < legal.count && legal.moves[code] != m; code++)
+			;
+		if (code >= POSDB_NO_MOVE) {
+			goto drop;
+		}
+
+		if ((ply <= w->d->max_ply && !dbtool_add_entry(w, &brd, ply, code, result)) ||
+				!dbtool_reserve((void **)&w->moves, &w->moves_cap, w->moves_len, 1, 1)) {
+			w->failed = true;
+			return;
+		}
+		w->moves[w->moves_len++] = (uint8_t)code;
+		make_move(&brd, m, &u);
+		ply++;
+	}
+
+	if ((ply <= w->d->max_ply && !dbtool_add_entry(w, &brd, ply, POSDB_NO_MOVE, result)) ||
+			!dbtool_add_tags(w, gm) ||
+			!dbtool_reserve((void **)&w->games, &w->games_cap, w->ngames, 1, sizeof(*g))) {
+		w->failed = true;
+		return;
+	}
+
+	g = &w->games[w->ngames++];
+	g->moves = moves_len;
+	g->tags = tags_len;
+	g->nmoves = (uint16_t)ply;
+	g->result = (uint8_t)result;
+	return;
+
+drop:
+	w->moves_len = moves_len;
+	w->tags_len = tags_len;
+	w->nentries = nentries;
+	w->errors++;
+}
+
+
+static void *dbtool_worker(void *arg)
+{
+	struct dbtool_worker *w = arg;
+	struct dbtool *d = w->d;
+	struct pgn_reader r;
+	struct pgn_game gm;
+	int64_t chunk, begin;
+	int f;
+
+	while (!w->failed && (chunk = __atomic_fetch_add(&d->next, 1, __ATOMIC_RELAXED)) < d->chunks) {
+		/* find file and offset of the chunk */
+		for (f = 0; f < d->nfiles; f++) {
+			const int64_t n = ((int64_t)d->pgn[f].size + DBTOOL_CHUNK - 1) / DBTOOL_CHUNK;
+			if (chunk < n) {
+				break;
+			}
+			chunk -= n;
+		}
+		begin = chunk * DBTOOL_CHUNK;
+
+		pgn_reader_init(&r, &d->pgn[f], (uint64_t)begin, (uint64_t)(begin + DBTOOL_CHUNK), PGN_FULL);
+		while (!w->failed && pgn_next_game(&r, &gm)) {
+			dbtool_replay(w, &gm);
+		}
+	}
+
+	return NULL;
+}
+
+
+/* Order by key, game and ply */
+static int dbtool_cmp_entry(const void *a, const void *b)
+{
+	const struct posdb_entry *x = a, *y = b;
+
+	if (x->key != y->key) {
+		return x->key < y->key ? -1 : 1;
+	}
+	if (x->game != y->game) {
+		return x->game < y->game ? -1 : 1;
+	}
+	return (x->ply > y->ply) - (x->ply < y->ply);
+}
+
+
+/* Concatenate the workers' games and write the database */
+static bool dbtool_write(const char *file, const struct dbtool *d, struct dbtool_worker *w, const int threads)
+{
+	uint8_t header[POSDB_HEADER_SIZE], rec[POSDB_GAME_SIZE];
+	uint64_t games = 0, moves = 0, tags = 0, entries = 0, n = 0;
+	uint32_t base = 0;
+	struct posdb_entry *all;
+	struct posdb_game g;
+	char tmp[4096];
+	FILE *fp;
+
+	for (int t = 0; t < threads; t++) {
+		games += w[t].ngames;
+		moves += w[t].moves_len;
+		tags += w[t].tags_len;
+		entries += w[t].nentries;
+	}
+	if (games > UINT32_MAX) {
+		fprintf(stderr, "Too many games: %llu\n", (unsigned long long)games);
+		return false;
+	}
+
+	/* number the games of all workers in one sequence, which fits the 32
+	 * bit game field of the index as there are at most UINT32_MAX games */
+	if (!(all = malloc((size_t)(entries ? entries : 1) * sizeof(*all)))) {
+		perror("malloc failed");
+		return false;
+	}
+	for (int t = 0; t < threads; t++) {
+		for (size_t i = 0; i < w[t].nentries; i++) {
+			all[n] = w[t].entries[i];
+			all[n++].game += base;
+		}
+		base += (uint32_t)w[t].ngames;
+		free(w[t].entries);
+		w[t].entries = NULL;
+	}
+	qsort(all, (size_t)n, sizeof(*all), dbtool_cmp_entry);
+
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", file) >= (int)sizeof(tmp) || !(fp = fopen(tmp, "wb"))) {
+		perror(file);
+		free(all);
+		return false;
+	}
+
+	posdb_put_header(header, d->max_ply, games, entries, moves, tags);
+	fwrite(header, sizeof(header), 1, fp);
+
+	moves = tags = 0;
+	for (int t = 0; t < threads; t++) {
+		for (size_t i = 0; i < w[t].ngames; i++) {
+			g = w[t].games[i];
+			g.moves += moves;
+			g.tags += tags;
+			posdb_put_game(rec, &g);
+			fwrite(rec, sizeof(rec), 1, fp);
+		}
+		moves += w[t].moves_len;
+		tags += w[t].tags_len;
+	}
+	for (int t = 0; t < threads; t++) {
+		fwrite(w[t].moves, 1, w[t].moves_len, fp);
+	}
+	for (int t = 0; t < threads; t++) {
+		fwrite(w[t].tags, 1, w[t].tags_len, fp);
+	}
+	for (uint64_t i = 0; i < n; i++) {
+		uint8_t buf[POSDB_ENTRY_SIZE];
+
+		posdb_put_entry(buf, &all[i]);
+		fwrite(buf, sizeof(buf), 1, fp);
+	}
+	free(all);
+
+	if (ferror(fp) | fclose(fp) || rename(tmp, file)) {
+		perror(file);
+		remove(tmp);
+		return false;
+	}
+
+	printf("Wrote %llu games, %llu moves and %llu index entries to %s\n",
+			(unsigned long long)games, (unsigned long long)moves,
+			(unsigned long long)entries, file);
+	return true;
+}
+
+
+static int dbtool_build(const char *out, const int max_ply, int threads, char **files, const int nfiles)
+{
+	static struct dbtool d;
+	struct dbtool_worker *w;
+	struct timeval start, end;
+	uint64_t errors = 0;
+	bool ok = true;
+#ifdef HAVE_PTHREAD_H
+	pthread_t tid[DBTOOL_MAX_THREADS];
+	int started = 0;
+#endif
+
+	d.files = files;
+	d.nfiles = nfiles;
+	d.max_ply = max_ply;
+	for (int f = 0; f < d.nfiles; f++) {
+		if (!pgn_open(&d.pgn[f], d.files[f])) {
+			return EXIT_FAILURE;
+		}
+		d.chunks += ((int64_t)d.pgn[f].size + DBTOOL_CHUNK - 1) / DBTOOL_CHUNK;
+	}
+
+	if (!(w = calloc((size_t)threads, sizeof(*w)))) {
+		perror("calloc failed");
+		return EXIT_FAILURE;
+	}
+	for (int t = 0; t < threads; t++) {
+		w[t].d = &d;
+	}
+
+	gettimeofday(&start, NULL);
+#ifdef HAVE_PTHREAD_H
+	for (int t = 1; t < threads; t++) {
+		if (pthread_create(&tid[started], NULL, dbtool_worker, &w[t]) == 0) {
+			started++;
+		}
+	}
+	dbtool_worker(&w[0]);
+	for (int t = 0; t < started; t++) {
+		pthread_join(tid[t], NULL);
+	}
+#else
+	dbtool_worker(&w[0]);
+#endif
+
+	for (int t = 0; t < threads; t++) {
+		errors += w[t].errors;
+		ok = ok && !w[t].failed;
+	}
+	ok = ok && dbtool_write(out, &d, w, threads);
+	gettimeofday(&end, NULL);
+
+	if (ok) {
+		printf("%llu games with errors dropped, %.2f seconds with %d threads\n",
+				(unsigned long long)errors, (double)(end.tv_sec - start.tv_sec) +
+				(double)(end.tv_usec - start.tv_usec) / 1e6, threads);
+	}
+
+	for (int t = 0; t < threads; t++) {
+		free(w[t].games);
+		free(w[t].moves);
+		free(w[t].tags);
+		free(w[t].entries);
+	}
+	for (int f = 0; f < d.nfiles; f++) {
+		pgn_close(&d.pgn[f]);
+	}
+	free(w);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static double dbtool_percent(const uint64_t n, const uint64_t total)
+{
+	return total ? 100.0 * (double)n / (double)total : 0.0;
+}
+
+
+/* Print the players, event and result of a game */
+static void dbtool_print_game(const struct posdb *db, const uint32_t id, const unsigned ply)
+{
+	struct posdb_game g;
+
+	posdb_get_game(db, id, &g);
+	printf("#%-9u %s (%s) - %s (%s), %s, %s, %s, ply %u\n", id,
+			posdb_game_tag(db, &g, POSDB_WHITE), posdb_game_tag(db, &g, POSDB_WHITE_ELO),
+			posdb_game_tag(db, &g, POSDB_BLACK), posdb_game_tag(db, &g, POSDB_BLACK_ELO),
+			posdb_game_tag(db, &g, POSDB_EVENT), posdb_game_tag(db, &g, POSDB_DATE),
+			posdb_game_tag(db, &g, POSDB_RESULT), ply);
+}
+
+
+/* Print the statistics of a position and the first games reaching it */
+static void dbtool_print(const struct posdb *db, struct board *brd, const struct posdb_stats *st, const int list)
+{
+	const uint64_t *r = st->results;
+	struct posdb_entry e;
+	char san[MAX_MOVE_LEN];
+	uint32_t last = UINT32_MAX;
+	int listed = 0;
+
+	printf("%llu games: white wins %.1f%%, draws %.1f%%, black wins %.1f%%\n\n",
+			(unsigned long long)st->games, dbtool_percent(r[POSDB_WHITE_WINS], st->games),
+			dbtool_percent(r[POSDB_DRAW], st->games), dbtool_percent(r[POSDB_BLACK_WINS], st->games));
+
+	if (st->nmoves) {
+		printf("%-8s %10s %7s %7s %7s\n", "move", "games", "white", "draw", "black");
+	}
+	for (int i = 0; i < st->nmoves; i++) {
+		const struct posdb_move_stat *ms = &st->moves[i];
+
+		move_to_san(brd, ms->move, san);
+		printf("%-8s %10llu %6.1f%% %6.1f%% %6.1f%%\n", san, (unsigned long long)ms->games,
+				dbtool_percent(ms->results[POSDB_WHITE_WINS], ms->games),
+				dbtool_percent(ms->results[POSDB_DRAW], ms->games),
+				dbtool_percent(ms->results[POSDB_BLACK_WINS], ms->games));
+	}
+
+	for (uint64_t i = st->first; i < db->entries && listed < list; i++) {
+		posdb_get_entry(db, i, &e);
+		if (e.key != zobrist_key(brd)) {
+			break;
+		}
+		if (e.game == last) {
+			continue;
+		}
+		last = e.game;
+		printf("%s", listed++ ? "" : "\n");
+		dbtool_print_game(db, e.game, e.ply);
+	}
+}
+
+
+/* Set up a position from a FEN and the moves played from it */
+static bool dbtool_setup(const char *fen, char **moves, const int nmoves, struct board *brd)
+{
+	char buf[MAX_FEN_LEN], san[MAX_MOVE_LEN];
+	struct move mv;
+	struct undo u;
+	move_t m;
+
+	if (strlen(fen) >= sizeof(buf)) {
+		fprintf(stderr, "Invalid FEN: %s\n", fen);
+		return false;
+	}
+	strcpy(buf, fen);
+	if (!init_board(buf, brd, AI, AI)) {
+		fprintf(stderr, "Invalid FEN: %s\n", fen);
+		return false;
+	}
+	for (int i = 0; i < nmoves; i++) {
+		if (strlen(moves[i]) >= sizeof(san)) {
+			fprintf(stderr, "Illegal move: %s\n", moves[i]);
+			return false;
+		}
+		strcpy(san, moves[i]);
+		mv = parse_input_move(san);
+		if ((m = resolve_move(brd, &mv)) == MOVE_NONE) {
+			fprintf(stderr, "Illegal move: %s\n", moves[i]);
+			return false;
+		}
+		make_move(brd, m, &u);
+	}
+	return true;
+}
+
+
+static int dbtool_query(const char *path, const char *fen, const int list, char **moves, const int nmoves)
+{
+	struct timeval start, end;
+	struct posdb_stats st;
+	struct posdb db;
+	struct board brd;
+
+	if (!dbtool_setup(fen, moves, nmoves, &brd) || !posdb_open(&db, path)) {
+		return EXIT_FAILURE;
+	}
+
+	gettimeofday(&start, NULL);
+	posdb_stats(&db, &brd, &st);
+	gettimeofday(&end, NULL);
+
+	dbtool_print(&db, &brd, &st, list);
+	printf("\n%llu games searched in %.3f ms\n", (unsigned long long)db.games,
+			(double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_usec - start.tv_usec) / 1e3);
+
+	posdb_close(&db);
+	return EXIT_SUCCESS;
+}
+
+
+/*			----------------
+ *			Similarity Index
+ *			----------------
+ *
+ * The index has a record for the first game and ply of every distinct
+ * position of the database index, found at the start of each run of
+ * equal keys. The records are set up by replaying each game once up to
+ * its last record, and are written in material key order.
+ */
+
+/* A position of the similarity index being built */
+struct dbtool_sim {
+	uint64_t material;
+	uint64_t ref;			// game << 16 | ply, then game | ply << 32
+	uint64_t sig[SIM_WORDS];
+};
+
+
+static int dbtool_cmp_u64(const void *a, const void *b)
+{
+	const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+
+/* Order by material key, game and ply */
+static int dbtool_cmp_sim(const void *a, const void *b)
+{
+	const struct dbtool_sim *x = *(const struct dbtool_sim * const *)a;
+	const struct dbtool_sim *y = *(const struct dbtool_sim * const *)b;
+
+	if (x->material != y->material) {
+		return x->material < y->material ? -1 : 1;
+	}
+	return (x->ref > y->ref) - (x->ref < y->ref);
+}
+
+
+static bool dbtool_sim_write(const char *file, struct dbtool_sim **order, const uint64_t n)
+{
+	uint64_t block[SIM_WORDS * SIM_BLOCK];
+	uint8_t header[SIM_HEADER_SIZE], pad[64] = {0};
+	char tmp[4096];
+	FILE *fp;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", file) >= (int)sizeof(tmp) || !(fp = fopen(tmp, "wb"))) {
+		perror(file);
+		return false;
+	}
+
+	sim_put_header(header, n);
+	fwrite(header, sizeof(header), 1, fp);
+	for (uint64_t i = 0; i < n; i++) {
+		fwrite(&order[i]->material, sizeof(uint64_t), 1, fp);
+	}
+	for (uint64_t i = 0; i < n; i++) {
+		fwrite(&order[i]->ref, sizeof(uint64_t), 1, fp);
+	}
+	fwrite(pad, 1, (size_t)(sim_blocks_offset(n) - SIM_HEADER_SIZE - n * 16), fp);
+
+	/* the padding records of the last block are empty boards */
+	for (uint64_t b = 0; b * SIM_BLOCK < n; b++) {
+		for (int w = 0; w < SIM_WORDS; w++) {
+			for (int j = 0; j < SIM_BLOCK; j++) {
+				const uint64_t i = b * SIM_BLOCK + (uint64_t)j;
+
+				block[w * SIM_BLOCK + j] = i < n ? order[i]->sig[w] : 0;
+			}
+		}
+		fwrite(block, sizeof(block), 1, fp);
+	}
+
+	if (ferror(fp) | fclose(fp) || rename(tmp, file)) {
+		perror(file);
+		remove(tmp);
+		return false;
+	}
+	return true;
+}
+
+
+static int dbtool_sim_build(const char *path, const char *out)
+{
+	struct dbtool_sim *recs = NULL, **order = NULL;
+	struct posdb_entry e;
+	struct posdb_game g;
+	struct posdb db;
+	struct board brd;
+	struct undo u;
+	uint64_t n = 0, key = 0;
+	bool ok = false;
+	int ply = 0;
+
+	if (!posdb_open(&db, path)) {
+		return EXIT_FAILURE;
+	}
+	if (!(recs = malloc((size_t)(db.entries ? db.entries : 1) * sizeof(*recs)))) {
+		perror("malloc failed");
+		goto out;
+	}
+
+	/* first game and ply of every distinct position */
+	for (uint64_t i = 0; i < db.entries; i++) {
+		posdb_get_entry(&db, i, &e);
+		if (!i || e.key != key) {
+			recs[n++].ref = (uint64_t)e.game << 16 | e.ply;
+			key = e.key;
+		}
+	}
+	qsort(recs, (size_t)n, sizeof(*recs), dbtool_cmp_u64);
+
+	for (uint64_t i = 0; i < n; i++) {
+		const uint32_t game = (uint32_t)(recs[i].ref >> 16);
+		const int want = (int)(recs[i].ref & 0xffff);
+
+		if (!i || game != (uint32_t)(recs[i - 1].ref >> 16)) {
+			posdb_get_game(&db, game, &g);
+			if (!posdb_game_board(&db, &g, 0, &brd)) {
+				fprintf(stderr, "Corrupt game #%u in %s\n", game, path);
+				goto out;
+			}
+			ply = 0;
+		}
+		for (; ply < want; ply++) {
+			if (posdb_make_move(&brd, db.moves[g.moves + (uint64_t)ply], &u) == MOVE_NONE) {
+				fprintf(stderr, "Corrupt game #%u in %s\n", game, path);
+				goto out;
+			}
+		}
+		recs[i].material = sim_material(&brd);
+		recs[i].ref = game | (uint64_t)want << 32;
+		sim_signature(&brd, recs[i].sig);
+	}
+
+	if (!(order = malloc((size_t)(n ? n : 1) * sizeof(*order)))) {
+		perror("malloc failed");
+		goto out;
+	}
+	for (uint64_t i = 0; i < n; i++) {
+		order[i] = &recs[i];
+	}
+	qsort(order, (size_t)n, sizeof(*order), dbtool_cmp_sim);
+
+	if ((ok = dbtool_sim_write(out, order, n))) {
+		printf("Wrote %llu positions to %s\n", (unsigned long long)n, out);
+	}
+
+out:
+	free(order);
+	free(recs);
+	posdb_close(&db);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/* List the positions of the index nearest to a position */
+static int dbtool_similar(const char *path, const char *index, const char *fen, char **moves, const int nmoves,
+		const int k, const bool same_material)
+{
+	struct sim_hit hits[SIM_MAX_HITS];
+	uint64_t query[SIM_WORDS], first = 0, count;
+	struct timeval start, end;
+	struct posdb_game g;
+	struct posdb db;
+	struct board brd;
+	struct sim s;
+	char buf[MAX_FEN_LEN];
+	uint32_t game;
+	uint16_t ply;
+	int found;
+
+	if (!dbtool_setup(fen, moves, nmoves, &brd) || !posdb_open(&db, path)) {
+		return EXIT_FAILURE;
+	}
+	if (!sim_open(&s, index)) {
+		posdb_close(&db);
+		return EXIT_FAILURE;
+	}
+
+	sim_signature(&brd, query);
+	gettimeofday(&start, NULL);
+	count = same_material ? sim_material_range(&s, sim_material(&brd), &first) : s.count;
+	found = sim_nearest(&s, query, first, count, k, hits);
+	gettimeofday(&end, NULL);
+
+	for (int i = 0; i < found; i++) {
+		sim_ref(&s, hits[i].index, &game, &ply);
+		posdb_get_game(&db, game, &g);
+		if (game < db.games && posdb_game_board(&db, &g, ply, &brd)) {
+			board_to_fen(&brd, buf);
+			printf("%4u  ", hits[i].dist);
+			dbtool_print_game(&db, game, ply);
+			printf("      %s\n", buf);
+		}
+	}
+
+	printf("%s%llu of %llu positions compared in %.3f ms with %s\n", found ? "\n" : "",
+			(unsigned long long)count, (unsigned long long)s.count,
+			(double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_usec - start.tv_usec) / 1e3,
+			s.kernel_name);
+
+	sim_close(&s);
+	posdb_close(&db);
+	return EXIT_SUCCESS;
+}
+
+
+/* Query the positions of random games at random plies, and check that
+ * every one of them is found */
+static int dbtool_bench(const char *path, const int count)
+{
+	struct timeval start, end;
+	struct posdb_stats st;
+	struct posdb_game g;
+	struct posdb db;
+	struct board brd;
+	uint64_t rng = 0x74657a6468617221ULL, games = 0;
+	double ms = 0, worst = 0, t;
+	int missing = 0;
+
+	if (!posdb_open(&db, path)) {
+		return EXIT_FAILURE;
+	}
+	if (!db.games) {
+		fprintf(stderr, "Empty database: %s\n", path);
+		posdb_close(&db);
+		return EXIT_FAILURE;
+	}
+
+	for (int i = 0; i < count; i++) {
+		int ply;
+
+		rng ^= rng << 13;
+		rng ^= rng >> 7;
+		rng ^= rng << 17;
+		posdb_get_game(&db, (uint32_t)(rng % db.games), &g);
+		ply = (int)((rng >> 32) % (uint64_t)((g.nmoves < db.max_ply ? g.nmoves : db.max_ply) + 1));
+		if (!posdb_game_board(&db, &g, ply, &brd)) {
+			missing++;
+			continue;
+		}
+
+		gettimeofday(&start, NULL);
+		posdb_stats(&db, &brd, &st);
+		gettimeofday(&end, NULL);
+
+		t = (double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_usec - start.tv_usec) / 1e3;
+		ms += t;
+		worst = t > worst ? t : worst;
+		games += st.games;
+		if (!st.games) {
+			missing++;
+		}
+	}
+
+	printf("%d queries over %llu games: %.3f ms average, %.3f ms worst, %.1f games per query, %d not found\n",
+			count, (unsigned long long)db.games, ms / count, worst, (double)games / count, missing);
+	posdb_close(&db);
+	return missing ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/* Scan the games from block to block, and keep the first position of each
+ * game which matches the pattern. A game is left as soon as its material
+ * can no more match, which is tested only after captures and promotions */
+static void *dbtool_scanner(void *arg)
+{
+	struct dbtool_scanner *w = arg;
+	const struct dbtool_scan *s = w->s;
+	const struct posdb *db = s->db;
+	struct posdb_game g;
+	struct board brd;
+	struct undo u;
+	uint64_t block, end;
+	move_t m = MOVE_NONE;
+
+	while (!w->failed && (block = __atomic_fetch_add(&w->s->next, 1, __ATOMIC_RELAXED)) * DBTOOL_SCAN_BLOCK < db->games) {
+		end = (block + 1) * DBTOOL_SCAN_BLOCK < db->games ? (block + 1) * DBTOOL_SCAN_BLOCK : db->games;
+
+		for (uint64_t id = block * DBTOOL_SCAN_BLOCK; id < end; id++) {
+			posdb_get_game(db, (uint32_t)id, &g);
+			if (!*posdb_game_tag(db, &g, POSDB_FEN)) {
+				brd = s->initial;
+			} else if (!posdb_game_board(db, &g, 0, &brd)) {
+				continue;
+			}
+
+			for (int ply = 0; ; ply++) {
+				if ((!ply || MOVE_CAPTURED(m) || MOVE_PROMOTED(m)) && pattern_exhausted(s->pt, &brd)) {
+					w->exhausted++;
+					break;
+				}
+				w->positions++;
+				if (pattern_match(s->pt, &brd)) {
+					if (!dbtool_reserve((void **)&w->matches, &w->matches_cap, w->nmatches, 1,
+								sizeof(*w->matches))) {
+						w->failed = true;
+					} else {
+						w->matches[w->nmatches].game = (uint32_t)id;
+						w->matches[w->nmatches++].ply = (uint16_t)ply;
+					}
+					break;
+				}
+				if (ply == g.nmoves || g.moves + (uint64_t)ply >= db->moves_size ||
+						(m = posdb_make_move(&brd, db->moves[g.moves + (uint64_t)ply], &u)) == MOVE_NONE) {
+					break;
+				}
+			}
+		}
+	}
+
+	return NULL;
+}
+
+
+/* Order by game */
+static int dbtool_cmp_match(const void *a, const void *b)
+{
+	const struct dbtool_match *x = a, *y = b;
+
+	return (x->game > y->game) - (x->game < y->game);
+}
+
+
+static int dbtool_scan(const char *path, const char *text, int list, const int threads)
+{
+	static struct dbtool_scan s;
+	struct dbtool_scanner *w;
+	struct dbtool_match *all = NULL;
+	struct timeval start, end;
+	struct pattern pt;
+	struct posdb db;
+	char fen[MAX_FEN_LEN] = INITIAL_FEN;
+	uint64_t positions = 0, exhausted = 0, n = 0;
+	bool ok = true;
+	double secs;
+#ifdef HAVE_PTHREAD_H
+	pthread_t tid[DBTOOL_MAX_THREADS];
+	int started = 0;
+#endif
+
+	if (!pattern_parse(&pt, text) || !posdb_open(&db, path)) {
+		return EXIT_FAILURE;
+	}
+	if (!(w = calloc((size_t)threads, sizeof(*w)))) {
+		perror("calloc failed");
+		posdb_close(&db);
+		return EXIT_FAILURE;
+	}
+#ifdef HAVE_MADVISE
+	/* the games are read in order, unlike the index of a query */
+	madvise((void *)(uintptr_t)db.map, db.size, MADV_SEQUENTIAL);
+#endif
+
+	s.db = &db;
+	s.pt = &pt;
+	init_board(fen, &s.initial, AI, AI);
+	for (int t = 0; t < threads; t++) {
+		w[t].s = &s;
+	}
+
+	gettimeofday(&start, NULL);
+#ifdef HAVE_PTHREAD_H
+	for (int t = 1; t < threads; t++) {
+		if (pthread_create(&tid[started], NULL, dbtool_scanner, &w[t]) == 0) {
+			started++;
+		}
+	}
+	dbtool_scanner(&w[0]);
+	for (int t = 0; t < started; t++) {
+		pthread_join(tid[t], NULL);
+	}
+#else
+	dbtool_scanner(&w[0]);
+#endif
+	gettimeofday(&end, NULL);
+
+	for (int t = 0; t < threads; t++) {
+		positions += w[t].positions;
+		exhausted += w[t].exhausted;
+		n += w[t].nmatches;
+		ok = ok && !w[t].failed;
+	}
+	if (ok && n && !(all = malloc((size_t)n * sizeof(*all)))) {
+		perror("malloc failed");
+		ok = false;
+	}
+
+	if (ok) {
+		n = 0;
+		for (int t = 0; t < threads; t++) {
+			memcpy(all + n, w[t].matches, w[t].nmatches * sizeof(*all));
+			n += w[t].nmatches;
+		}
+		qsort(all, (size_t)n, sizeof(*all), dbtool_cmp_match);
+
+		list = list < 0 || (uint64_t)list > n ? (int)n : list;
+		for (int i = 0; i < list; i++) {
+			struct posdb_game g;
+			struct board brd;
+
+			posdb_get_game(&db, all[i].game, &g);
+			if (posdb_game_board(&db, &g, all[i].ply, &brd)) {
+				board_to_fen(&brd, fen);
+				dbtool_print_game(&db, all[i].game, all[i].ply);
+				printf("           %s\n", fen);
+			}
+		}
+
+		secs = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1e6;
+		printf("%s%llu of %llu games match, %llu positions tested, %llu games left early\n",
+				list ? "\n" : "", (unsigned long long)n, (unsigned long long)db.games,
+				(unsigned long long)positions, (unsigned long long)exhausted);
+		printf("%.2f seconds with %d threads, %.0f positions per second per thread\n",
+				secs, threads, secs > 0 ? (double)positions / secs / threads : 0.0);
+	}
+
+	for (int t = 0; t < threads; t++) {
+		free(w[t].matches);
+	}
+	free(all);
+	free(w);
+	posdb_close(&db);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static void dbtool_usage(const char *prog)
+{
+	printf("Usage: %s [-j threads] [-p plies] -o file.db PGN ...\n", prog);
+	printf("       %s -q file.db [-f fen] [-n games] [move ...]\n", prog);
+	printf("       %s -q file.db [-j threads] [-n games] -s pattern\n", prog);
+	printf("       %s -q file.db -X file.sim\n", prog);
+	printf("       %s -q file.db -i file.sim [-k positions] [-M] [-f fen] [move ...]\n", prog);
+	printf("       %s -q file.db -B queries\n\n", prog);
+	printf("Build a position database of PGN games, look up the games reaching a\n");
+	printf("position with their results and the moves played next, or find the\n");
+	printf("games passing through positions which match a pattern of terms like\n");
+	printf("\"P@d !P@c,e Q=1 q=1 w\" (see src/pattern.h), or the positions most like\n");
+	printf("a position.\n\n");
+	printf("  -j threads	number of worker threads (default: all cores)\n");
+	printf("  -p plies	index the first plies of each game (default: %d)\n", DBTOOL_MAX_PLY);
+	printf("  -o file	database to build\n");
+	printf("  -q file	database to query\n");
+	printf("  -f fen	position to start the moves from (default: initial position)\n");
+	printf("  -n games	list at most so many games (default: %d, all for -s)\n", DBTOOL_LIST);
+	printf("  -s pattern	list the games matching the pattern, at their first match\n");
+	printf("  -X file	build the similarity index of the database\n");
+	printf("  -i file	list the nearest positions of the similarity index\n");
+	printf("  -k positions	number of nearest positions (default: %d)\n", DBTOOL_NEAREST);
+	printf("  -M		compare with positions of the same material only\n");
+	printf("  -B queries	query the positions of random games and report the latency\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	const char *out = NULL, *db = NULL, *fen = INITIAL_FEN, *pattern = NULL, *export = NULL, *index = NULL;
+	int opt, threads = 1, max_ply = DBTOOL_MAX_PLY, list = -1, bench = 0, nearest = DBTOOL_NEAREST;
+	bool same_material = false;
+
+#if defined HAVE_SYSCONF && defined _SC_NPROCESSORS_ONLN
+	threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	while ((opt = getopt(argc, argv, "j:p:o:q:f:n:s:X:i:k:MB:h")) != -1) {
+		switch (opt) {
+			case 'j': threads = atoi(optarg); break;
+			case 'p': max_ply = atoi(optarg); break;
+			case 'o': out = optarg; break;
+			case 'q': db = optarg; break;
+			case 'f': fen = optarg; break;
+			case 'n': list = atoi(optarg); break;
+			case 's': pattern = optarg; break;
+			case 'X': export = optarg; break;
+			case 'i': index = optarg; break;
+			case 'k': nearest = atoi(optarg); break;
+			case 'M': same_material = true; break;
+			case 'B': bench = atoi(optarg); break;
+			case 'h': dbtool_usage(argv[0]); return EXIT_SUCCESS;
+			default:  dbtool_usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+
+	if (!out == !db || threads < 1 || max_ply < 0 || max_ply >= UINT16_MAX || list < -1 || bench < 0 ||
+			nearest < 1 || nearest > SIM_MAX_HITS ||
+			(out && (optind == argc || argc - optind > DBTOOL_MAX_FILES))) {
+		dbtool_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads > DBTOOL_MAX_THREADS) {
+		threads = DBTOOL_MAX_THREADS;
+	}
+
+	init_leaper_attacks();
+	init_magic_numbers();
+	init_slider_attacks();
+	init_zobrist_keys();
+
+	if (out) {
+		return dbtool_build(out, max_ply, threads, &argv[optind], argc - optind);
+	}
+	if (bench) {
+		return dbtool_bench(db, bench);
+	}
+	if (pattern) {
+		return dbtool_scan(db, pattern, list, threads);
+	}
+	if (export) {
+		return dbtool_sim_build(db, export);
+	}
+	if (index) {
+		return dbtool_similar(db, index, fen, &argv[optind], argc - optind, nearest, same_material);
+	}
+	return dbtool_query(db, fen, list < 0 ? DBTOOL_LIST : list, &argv[optind], argc - optind);
+}
@@ -0,0 +1,200 @@
+/* @file:	tezdhar/src/epd.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/epd.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Parse EPD records into a board, an id and the moves of the
+ * 		bm and am opcodes.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "epd.h"
+
+#include <stdio.h>	// for fprintf, snprintf
+#include <stdlib.h>	// for atoi
+#include <string.h>	// for memcpy, memset, strcmp, strlen
+
+
+static bool epd_is_space(const char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+
+static const char *epd_skip_space(const char *p)
+{
+	while (epd_is_space(*p)) {
+		p++;
+	}
+	return p;
+}
+
+
+/* Copy the next operand, unquoting strings. Returns the end of the
+ * operand, or NULL at the end of the operation */
+static const char *epd_operand(const char *p, char *buf, const size_t len)
+{
+	size_t n = 0;
+
+	p = epd_skip_space(p);
+	if (!*p || *p == ';') {
+		return NULL;
+	}
+
+	if (*p == '"') {
+		for (p++; *p && *p != '"'; p++) {
+			if (n + 1 < len) {
+				buf[n++] = *p;
+			}
+		}
+		if (*p) {
+			p++;
+		}
+	} else {
+		for (; *p && *p != ';' && !epd_is_space(*p); p++) {
+			if (n + 1 < len) {
+				buf[n++] = *p;
+			}
+		}
+	}
+
+	buf[n] = '\0';
+	return p;
+}
+
+
+/* Skip past the ';' ending an operation, ignoring ';' inside strings */
+static const char *epd_end_op(const char *p)
+{
+	bool quoted = false;
+
+	for (; *p && (quoted || *p != ';'); p++) {
+		if (*p == '"') {
+			quoted = !quoted;
+		}
+	}
+	return *p ? p + 1 : p;
+}
+
+
+/* Copy the four FEN fields of a record. Returns the operations after
+ * them, or NULL if the fields are missing or too long */
+static const char *epd_fen_fields(const char *line, char *fen)
+{
+	const char *p = epd_skip_space(line), *q = p;
+	size_t len;
+
+	for (int field = 0; field < 4; field++) {
+		q = epd_skip_space(q);
+		if (!*q) {
+			return NULL;
+		}
+		while (*q && !epd_is_space(*q)) {
+			q++;
+		}
+	}
+
+	if ((len = (size_t)(q - p)) >= MAX_FEN_LEN) {
+		return NULL;
+	}
+	memcpy(fen, p, len);
+	fen[len] = '\0';
+	return q;
+}
+
+
+/* Resolve the SAN operands of a bm or am operation */
+static bool epd_moves(const char *p, struct epd *e, move_t *moves, int *n)
+{
+	char san[MAX_MOVE_LEN];
+	struct move mv;
+	move_t m;
+
+	while ((p = epd_operand(p, san, sizeof(san)))) {
+		mv = parse_input_move(san);
+		if ((m = resolve_move(&e->brd, &mv)) == MOVE_NONE) {
+			fprintf(stderr, "Illegal move %s in EPD record: %s\n", san, e->fen);
+			return false;
+		}
+		if (*n < EPD_MAX_MOVES) {
+			moves[(*n)++] = m;
+		}
+	}
+
+	return true;
+}
+
+
+/* Parse an EPD record. Returns false, after telling why, if the position
+ * or a move of it is not valid */
+bool epd_parse(const char *line, struct epd *e)
+{
+	char fen[MAX_FEN_LEN + 32], opcode[16], operand[16];
+	const char *ops, *p, *q;
+	int hmvc = 0, fmvn = 1;
+
+	memset(e, 0, sizeof(*e));
+	if (!(ops = epd_fen_fields(line, e->fen))) {
+		fprintf(stderr, "Invalid EPD record: %s\n", line);
+		return false;
+	}
+
+	/* the move counters are needed before the board is set up */
+	for (p = ops; (q = epd_operand(p, opcode, sizeof(opcode))); p = epd_end_op(q)) {
+		if (!strcmp(opcode, "hmvc") && epd_operand(q, operand, sizeof(operand))) {
+			hmvc = atoi(operand);
+		} else if (!strcmp(opcode, "fmvn") && epd_operand(q, operand, sizeof(operand))) {
+			fmvn = atoi(operand);
+		}
+	}
+
+	snprintf(fen, sizeof(fen), "%s %d %d", e->fen, hmvc, fmvn);
+	if (strlen(fen) >= MAX_FEN_LEN || !init_board(fen, &e->brd, AI, AI)) {
+		fprintf(stderr, "Invalid FEN in EPD record: %s\n", e->fen);
+		return false;
+	}
+
+	for (p = ops; (q = epd_operand(p, opcode, sizeof(opcode))); p = epd_end_op(q)) {
+		if (!strcmp(opcode, "bm") && !epd_moves(q, e, e->bm, &e->nbm)) {
+			return false;
+		}
+		if (!strcmp(opcode, "am") && !epd_moves(q, e, e->am, &e->nam)) {
+			return false;
+		}
+		if (!strcmp(opcode, "id")) {
+			epd_operand(q, e->id, sizeof(e->id));
+		}
+	}
+
+	return true;
+}
+
+
+/* Does the record tell good moves from bad ones, by bm or am */
+bool epd_is_scored(const struct epd *e)
+{
+	return e->nbm || e->nam;
+}
+
+
+/* Is m a best move, and not a move to avoid. No move solves a record
+ * without bm and am */
+bool epd_is_solution(const struct epd *e, const move_t m)
+{
+	bool best = !e->nbm && e->nam;
+
+	for (int i = 0; i < e->nbm; i++) {
+		best = best || e->bm[i] == m;
+	}
+	for (int i = 0; i < e->nam; i++) {
+		if (e->am[i] == m) {
+			return false;
+		}
+	}
+
+	return best;
+}
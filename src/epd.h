@@ -0,0 +1,48 @@
+/* @file:	tezdhar/src/epd.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/epd.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Extended Position Description (EPD) records.
+ *
+ *
+ *			----------
+ *			EPD Format
+ *			----------
+ *
+ * An EPD record is the first four fields of a FEN followed by operations,
+ * each an opcode, its operands and a semicolon:
+ *
+ *	r1b1k2r/ppppnppp/2n2q2/2b5/3NP3/2P1B3/PP3PPP/RN1QKB1R w KQkq - bm Nxc6; id "WAC.016";
+ *
+ * The operands of "bm" (best moves) and "am" (avoid moves) are SAN moves,
+ * which are resolved against the position when the record is read. The
+ * move counters come from the "hmvc" and "fmvn" opcodes, if given. Other
+ * opcodes are skipped.
+ */
+
+#ifndef __EPD_H__
+#define __EPD_H__	1
+
+#include "chess.h"
+
+#define EPD_MAX_MOVES	8		// moves of a bm or am operation
+#define EPD_ID_LEN	64
+
+struct epd {
+	struct board brd;
+	char fen[MAX_FEN_LEN];
+	char id[EPD_ID_LEN];
+	move_t bm[EPD_MAX_MOVES];	// best moves
+	move_t am[EPD_MAX_MOVES];	// moves to avoid
+	int nbm, nam;
+};
+
+
+/* Function prototypes */
+bool epd_parse(const char *line, struct epd *e);
+bool epd_is_scored(const struct epd *e);
+bool epd_is_solution(const struct epd *e, move_t m);
+
+
+#endif	/* __EPD_H__ */
@@ -0,0 +1,425 @@
+/* @file:	tezdhar/src/epdrun.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/epdrun.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	tezdhar-epd, runs EPD test suites in parallel.
+ *
+ *
+ *			-----------------
+ *			Time to Solution
+ *			-----------------
+ *
+ * Every position is searched with the same node, time or depth limit on
+ * its own struct search. Worker threads take the next position from a
+ * shared atomic counter, so a slow position does not hold up the others.
+ *
+ * A position is solved if the best move of the last completed iteration
+ * is one of its "bm" moves and none of its "am" moves. Records with
+ * neither are skipped with a note, and are not counted. The time to
+ * solution is taken at the iteration from which on the best move stayed
+ * correct, not at the first iteration which happened to find it, so a
+ * move found by chance at depth 3 and dropped at depth 4 does not count.
+ *
+ * Results are kept in input order and written as CSV or JSON after all
+ * positions are done, so the output does not depend on the number of
+ * threads. The summary gives the solved positions per CPU-second, which
+ * compares versions of the engine independently of the machine load.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "epd.h"
+#include "search.h"
+
+#include <stdio.h>	// for printf, fprintf, getline
+#include <stdlib.h>	// for calloc, realloc, free, atoi
+#include <string.h>	// for strcat, strcmp, strlen
+
+#ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>	// for gettimeofday
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for getopt, sysconf
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create
+#endif
+
+#define EPDRUN_MAX_THREADS	256
+#define EPDRUN_MOVETIME		1000	// default milliseconds per position
+
+/* Outcome of one position */
+struct epdrun_result {
+	move_t best;			// best move of the last iteration
+	int score, depth;
+	uint64_t nodes;
+	long ms;
+	bool solved;
+	int solve_depth;		// iteration from which on it was solved
+	uint64_t solve_nodes;
+	long solve_ms;
+};
+
+struct epdrun {
+	struct epd *pos;
+	struct epdrun_result *res;
+	int npos;
+	int unscored;			// records without bm and am, skipped
+	struct search_limits limits;
+	int next;			// next position to be taken
+};
+
+/* Search of a worker, with the position it is solving */
+struct epdrun_worker {
+	struct search s;
+	struct epdrun *r;
+	const struct epd *e;
+	struct epdrun_result *res;
+};
+
+
+/* Iteration callback, tracks since when the best move is correct */
+static void epdrun_report(const struct search *s, const int depth)
+{
+	struct epdrun_worker *w = s->report_arg;
+	struct epdrun_result *res = w->res;
+
+	res->depth = depth;
+	if (!epd_is_solution(w->e, s->best_move)) {
+		res->solve_depth = 0;
+	} else if (!res->solve_depth) {
+		res->solve_depth = depth;
+		res->solve_nodes = s->stats.nodes;
+		res->solve_ms = search_elapsed(s);
+	}
+}
+
+
+static void *epdrun_worker(void *arg)
+{
+	struct epdrun_worker *w = arg;
+	struct epdrun *r = w->r;
+	struct epdrun_result *res;
+	int i;
+
+	while ((i = __atomic_fetch_add(&r->next, 1, __ATOMIC_RELAXED)) < r->npos) {
+		w->e = &r->pos[i];
+		w->res = res = &r->res[i];
+
+		search_init(&w->s, &w->e->brd, &r->limits);
+		w->s.report = epdrun_report;
+		w->s.report_arg = w;
+
+		res->best = search_position(&w->s);
+		res->ms = search_elapsed(&w->s);
+		res->nodes = w->s.stats.nodes;
+		res->score = w->s.best_score;
+		res->solved = res->best != MOVE_NONE && epd_is_solution(w->e, res->best);
+		if (!res->solved) {
+			res->solve_depth = 0;
+		}
+	}
+
+	return NULL;
+}
+
+
+/* Read all records of an EPD file, skipping empty and comment lines */
+static bool epdrun_load(struct epdrun *r, const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	char *line = NULL;
+	size_t cap = 0, lines = 0;
+	struct epd *pos;
+	int alloc = r->npos;
+	bool ok = true;
+
+	if (!fp) {
+		perror(path);
+		return false;
+	}
+
+	while (ok && getline(&line, &cap, fp) >= 0) {
+		const char *p = line;
+
+		lines++;
+		while (*p == ' ' || *p == '\t') {
+			p++;
+		}
+		if (!*p || *p == '\n' || *p == '\r' || *p == '#') {
+			continue;
+		}
+
+		if (r->npos == alloc) {
+			alloc = alloc ? 2 * alloc : 256;
+			if (!(pos = realloc(r->pos, (size_t)alloc * sizeof(*pos)))) {
+				perror("realloc failed");
+				ok = false;
+				break;
+			}
+			r->pos = pos;
+		}
+
+		if (!epd_parse(p, &r->pos[r->npos])) {
+			fprintf(stderr, "%s:%zu: record skipped\n", path, lines);
+		} else if (!epd_is_scored(&r->pos[r->npos])) {
+			fprintf(stderr, "%s:%zu: record without bm or am skipped\n", path, lines);
+			r->unscored++;
+		} else {
+			r->npos++;
+		}
+	}
+
+	free(line);
+	fclose(fp);
+	return ok;
+}
+
+
+/* Print a string as a quoted CSV field */
+static void epdrun_csv_str(FILE *fp, const char *s)
+{
+	fputc('"', fp);
+	for (; *s; s++) {
+		if (*s == '"') {
+			fputc('"', fp);
+		}
+		fputc(*s, fp);
+	}
+	fputc('"', fp);
+}
+
+
+/* Print a string as a JSON string */
+static void epdrun_json_str(FILE *fp, const char *s)
+{
+	fputc('"', fp);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			fputc('\\', fp);
+		}
+		fputc(*s, fp);
+	}
+	fputc('"', fp);
+}
+
+
+/* Space separated UCI moves */
+static void epdrun_moves(const move_t *moves, const int n, char *buf)
+{
+	buf[0] = '\0';
+	for (int i = 0; i < n; i++) {
+		if (i) {
+			strcat(buf, " ");
+		}
+		move_to_uci(moves[i], buf + strlen(buf));
+	}
+}
+
+
+static void epdrun_write(const struct epdrun *r, FILE *fp, const bool json)
+{
+	char bm[EPD_MAX_MOVES * MAX_UCI_LEN], am[EPD_MAX_MOVES * MAX_UCI_LEN], best[MAX_UCI_LEN];
+
+	if (json) {
+		fprintf(fp, "[\n");
+	} else {
+		fprintf(fp, "id,fen,bm,am,move,solved,score,depth,nodes,ms,solve_depth,solve_nodes,solve_ms\n");
+	}
+
+	for (int i = 0; i < r->npos; i++) {
+		const struct epd *e = &r->pos[i];
+		const struct epdrun_result *res = &r->res[i];
+
+		epdrun_moves(e->bm, e->nbm, bm);
+		epdrun_moves(e->am, e->nam, am);
+		epdrun_moves(&res->best, res->best != MOVE_NONE, best);
+
+		if (json) {
+			fprintf(fp, "  {\"id\": ");
+			epdrun_json_str(fp, e->id);
+			fprintf(fp, ", \"fen\": ");
+			epdrun_json_str(fp, e->fen);
+			fprintf(fp, ", \"bm\": \"%s\", \"am\": \"%s\", \"move\": \"%s\", \"solved\": %s, "
+					"\"score\": %d, \"depth\": %d, \"nodes\": %llu, \"ms\": %ld",
+					bm, am, best, res->solved ? "true" : "false", res->score, res->depth,
+					(unsigned long long)res->nodes, res->ms);
+			if (res->solved) {
+				fprintf(fp, ", \"solve_depth\": %d, \"solve_nodes\": %llu, \"solve_ms\": %ld",
+						res->solve_depth, (unsigned long long)res->solve_nodes, res->solve_ms);
+			}
+			fprintf(fp, "}%s\n", i + 1 < r->npos ? "," : "");
+		} else {
+			epdrun_csv_str(fp, e->id);
+			fputc(',', fp);
+			epdrun_csv_str(fp, e->fen);
+			fprintf(fp, ",%s,%s,%s,%d,%d,%d,%llu,%ld,", bm, am, best, res->solved,
+					res->score, res->depth, (unsigned long long)res->nodes, res->ms);
+			if (res->solved) {
+				fprintf(fp, "%d,%llu,%ld\n", res->solve_depth,
+						(unsigned long long)res->solve_nodes, res->solve_ms);
+			} else {
+				fprintf(fp, ",,\n");
+			}
+		}
+	}
+
+	if (json) {
+		fprintf(fp, "]\n");
+	}
+}
+
+
+static void epdrun_usage(const char *prog)
+{
+	printf("Usage: %s [-j threads] [-n nodes] [-m ms] [-d depth] [-f csv|json] [-o file] EPD ...\n\n", prog);
+	printf("Search every position of EPD test suites and count the solved ones.\n\n");
+	printf("  -j threads	number of worker threads (default: all cores)\n");
+	printf("  -n nodes	nodes per position\n");
+	printf("  -m ms		milliseconds per position (default: %d without -n and -d)\n", EPDRUN_MOVETIME);
+	printf("  -d depth	depth per position\n");
+	printf("  -f format	format of the results, csv or json (default: csv)\n");
+	printf("  -o file	write the results of every position to file\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	static struct epdrun r;
+	struct epdrun_worker *w;
+	struct timeval start, end;
+	const char *out = NULL;
+	uint64_t nodes = 0, solve_nodes = 0;
+	long ms = 0, solve_ms = 0;
+	int opt, threads = 1, solved = 0;
+	bool json = false;
+	double secs;
+	FILE *fp;
+#ifdef HAVE_PTHREAD_H
+	pthread_t tid[EPDRUN_MAX_THREADS];
+	int started = 0;
+#endif
+
+#if defined HAVE_SYSCONF && defined _SC_NPROCESSORS_ONLN
+	threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	while ((opt = getopt(argc, argv, "j:n:m:d:f:o:h")) != -1) {
+		switch (opt) {
+			case 'j': threads = atoi(optarg); break;
+			case 'n': r.limits.nodes = strtoull(optarg, NULL, 10); break;
+			case 'm': r.limits.movetime = atol(optarg); break;
+			case 'd': r.limits.depth = atoi(optarg); break;
+			case 'f': json = !strcmp(optarg, "json"); break;
+			case 'o': out = optarg; break;
+			case 'h': epdrun_usage(argv[0]); return EXIT_SUCCESS;
+			default:  epdrun_usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+
+	if (optind == argc || threads < 1) {
+		epdrun_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads > EPDRUN_MAX_THREADS) {
+		threads = EPDRUN_MAX_THREADS;
+	}
+	if (!r.limits.nodes && !r.limits.movetime && !r.limits.depth) {
+		r.limits.movetime = EPDRUN_MOVETIME;
+	}
+
+	init_leaper_attacks();
+	init_magic_numbers();
+	init_slider_attacks();
+	init_zobrist_keys();
+
+	for (int f = optind; f < argc; f++) {
+		if (!epdrun_load(&r, argv[f])) {
+			return EXIT_FAILURE;
+		}
+	}
+	if (threads > r.npos) {
+		threads = r.npos ? r.npos : 1;
+	}
+
+	if (!(r.res = calloc((size_t)(r.npos ? r.npos : 1), sizeof(*r.res))) ||
+			!(w = calloc((size_t)threads, sizeof(*w)))) {
+		perror("calloc failed");
+		return EXIT_FAILURE;
+	}
+	for (int t = 0; t < threads; t++) {
+		w[t].r = &r;
+	}
+
+	gettimeofday(&start, NULL);
+#ifdef HAVE_PTHREAD_H
+	for (int t = 1; t < threads; t++) {
+		if (pthread_create(&tid[started], NULL, epdrun_worker, &w[t]) == 0) {
+			started++;
+		}
+	}
+	epdrun_worker(&w[0]);
+	for (int t = 0; t < started; t++) {
+		pthread_join(tid[t], NULL);
+	}
+#else
+	epdrun_worker(&w[0]);
+#endif
+	gettimeofday(&end, NULL);
+
+	secs = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1e6;
+
+	if (out) {
+		if (!(fp = fopen(out, "w"))) {
+			perror(out);
+		} else {
+			epdrun_write(&r, fp, json);
+			fclose(fp);
+		}
+	}
+
+	printf("\n");
+	for (int i = 0; i < r.npos; i++) {
+		const struct epdrun_result *res = &r.res[i];
+		char best[MAX_MOVE_LEN] = "-";
+
+		if (res->best != MOVE_NONE) {
+			move_to_san(&r.pos[i].brd, res->best, best);
+		}
+		printf("%-20s %-8s %s\n", r.pos[i].id[0] ? r.pos[i].id : r.pos[i].fen,
+				best, res->solved ? "solved" : "");
+
+		nodes += res->nodes;
+		ms += res->ms;
+		if (res->solved) {
+			solved++;
+			solve_nodes += res->solve_nodes;
+			solve_ms += res->solve_ms;
+		}
+	}
+
+	printf("\n%d of %d positions solved\n", solved, r.npos);
+	if (r.unscored) {
+		printf("%d positions without bm or am not searched\n", r.unscored);
+	}
+	printf("%llu nodes in %.2f CPU seconds, %.2f seconds with %d threads\n",
+			(unsigned long long)nodes, (double)ms / 1000, secs, threads);
+	if (ms) {
+		printf("%.2f solved per CPU second\n", solved * 1000.0 / (double)ms);
+	}
+	if (solved) {
+		printf("average time to solution %.0f ms, %.0f nodes\n",
+				(double)solve_ms / solved, (double)solve_nodes / solved);
+	}
+
+	free(r.pos);
+	free(r.res);
+	free(w);
+	return EXIT_SUCCESS;
+}
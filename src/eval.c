@@ -0,0 +1,147 @@
+/* @file:	tezdhar/src/eval.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/eval.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Static evaluation of a board position with material values
+ * 		and piece-square tables.
+ *
+ * The piece-square tables are written the way the board is printed, i.e.
+ * rank 8 first, from White's point of view. With LERF square mapping the
+ * entry of a white piece is found at (sq ^ 56), and black pieces use the
+ * same table vertically mirrored at (sq).
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "bitboard.h"
+#include "cpu.h"
+
+
+/* material value of each chessman in centipawns, indexed by enum chessmen */
+static const int piece_value[EMPTY] = {0, 900, 320, 330, 500, 100};
+
+static const int8_t pawn_pst[64] = {
+	 0,   0,   0,   0,   0,   0,   0,   0,
+	50,  50,  50,  50,  50,  50,  50,  50,
+	10,  10,  20,  30,  30,  20,  10,  10,
+	 5,   5,  10,  25,  25,  10,   5,   5,
+	 0,   0,   0,  20,  20,   0,   0,   0,
+	 5,  -5, -10,   0,   0, -10,  -5,   5,
+	 5,  10,  10, -20, -20,  10,  10,   5,
+	 0,   0,   0,   0,   0,   0,   0,   0
+};
+
+static const int8_t knight_pst[64] = {
+	-50, -40, -30, -30, -30, -30, -40, -50,
+	-40, -20,   0,   0,   0,   0, -20, -40,
+	-30,   0,  10,  15,  15,  10,   0, -30,
+	-30,   5,  15,  20,  20,  15,   5, -30,
+	-30,   0,  15,  20,  20,  15,   0, -30,
+	-30,   5,  10,  15,  15,  10,   5, -30,
+	-40, -20,   0,   5,   5,   0, -20, -40,
+	-50, -40, -30, -30, -30, -30, -40, -50
+};
+
+static const int8_t bishop_pst[64] = {
+	-20, -10, -10, -10, -10, -10, -10, -20,
+	-10,   0,   0,   0,   0,   0,   0, -10,
+	-10,   0,   5,  10,  10,   5,   0, -10,
+	-10,   5,   5,  10,  10,   5,   5, -10,
+	-10,   0,  10,  10,  10,  10,   0, -10,
+	-10,  10,  10,  10,  10,  10,  10, -10,
+	-10,   5,   0,   0,   0,   0,   5, -10,
+	-20, -10, -10, -10, -10, -10, -10, -20
+};
+
+static const int8_t rook_pst[64] = {
+	 0,   0,   0,   0,   0,   0,   0,   0,
+	 5,  10,  10,  10,  10,  10,  10,   5,
+	-5,   0,   0,   0,   0,   0,   0,  -5,
+	-5,   0,   0,   0,   0,   0,   0,  -5,
+	-5,   0,   0,   0,   0,   0,   0,  -5,
+	-5,   0,   0,   0,   0,   0,   0,  -5,
+	-5,   0,   0,   0,   0,   0,   0,  -5,
+	 0,   0,   0,   5,   5,   0,   0,   0
+};
+
+static const int8_t queen_pst[64] = {
+	-20, -10, -10,  -5,  -5, -10, -10, -20,
+	-10,   0,   0,   0,   0,   0,   0, -10,
+	-10,   0,   5,   5,   5,   5,   0, -10,
+	 -5,   0,   5,   5,   5,   5,   0,  -5,
+	  0,   0,   5,   5,   5,   5,   0,  -5,
+	-10,   5,   5,   5,   5,   5,   0, -10,
+	-10,   0,   5,   0,   0,   0,   0, -10,
+	-20, -10, -10,  -5,  -5, -10, -10, -20
+};
+
+/* king shelter in the middle game, centralization in the endgame */
+static const int8_t king_mg_pst[64] = {
+	-30, -40, -40, -50, -50, -40, -40, -30,
+	-30, -40, -40, -50, -50, -40, -40, -30,
+	-30, -40, -40, -50, -50, -40, -40, -30,
+	-30, -40, -40, -50, -50, -40, -40, -30,
+	-20, -30, -30, -40, -40, -30, -30, -20,
+	-10, -20, -20, -20, -20, -20, -20, -10,
+	 20,  20,   0,   0,   0,   0,  20,  20,
+	 20,  30,  10,   0,   0,  10,  30,  20
+};
+
+static const int8_t king_eg_pst[64] = {
+	-50, -40, -30, -20, -20, -30, -40, -50,
+	-30, -20, -10,   0,   0, -10, -20, -30,
+	-30, -10,  20,  30,  30,  20, -10, -30,
+	-30, -10,  30,  40,  40,  30, -10, -30,
+	-30, -10,  30,  40,  40,  30, -10, -30,
+	-30, -10,  20,  30,  30,  20, -10, -30,
+	-30, -30,   0,   0,   0,   0, -30, -30,
+	-50, -30, -30, -30, -30, -30, -30, -50
+};
+
+
+/* sum of piece-square values of all pieces in bitboard */
+static int pst_sum(uint64_t bb, const int8_t *pst, const enum color c)
+{
+	int sum = 0;
+
+	for (; bb; POP_LSB(bb)) {
+		sum += pst[c == WHITE ? LSB(bb) ^ 56 : LSB(bb)];
+	}
+
+	return sum;
+}
+
+
+/* material and placement of one side */
+static int eval_side(const struct bitboards * const bb, const enum color c, const bool endgame)
+{
+	const uint64_t *p = (const uint64_t *)bb;	// white and black interleaved
+	const int king = c == WHITE ? 0 : 1;
+
+	return piece_value[QUEEN] * BITS(p[2 + king]) + pst_sum(p[2 + king], queen_pst, c) +
+		piece_value[BISHOP] * BITS(p[4 + king]) + pst_sum(p[4 + king], bishop_pst, c) +
+		piece_value[KNIGHT] * BITS(p[6 + king]) + pst_sum(p[6 + king], knight_pst, c) +
+		piece_value[ROOK] * BITS(p[8 + king]) + pst_sum(p[8 + king], rook_pst, c) +
+		piece_value[PAWN] * BITS(p[10 + king]) + pst_sum(p[10 + king], pawn_pst, c) +
+		pst_sum(p[king], endgame ? king_eg_pst : king_mg_pst, c);
+}
+
+
+/* Evaluate position in centipawns from the point of view of the side to
+ * move. The endgame starts when both queens are gone or when each side
+ * has at most one rook or minor piece left */
+CPU_CLONES int evaluate(const struct board * const brd)
+{
+	const struct bitboards *bb = &brd->bb;
+	const uint64_t minors_w = bb->wKnight | bb->wBishop | bb->wRook;
+	const uint64_t minors_b = bb->bKnight | bb->bBishop | bb->bRook;
+	const bool endgame = (!bb->wQueen && !bb->bQueen) ||
+		(BITS(minors_w) <= 1 && BITS(minors_b) <= 1);
+	int score = eval_side(bb, WHITE, endgame) - eval_side(bb, BLACK, endgame);
+
+	return brd->turn == WHITE ? score : -score;
+}
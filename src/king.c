@@ -10,10 +10,6 @@
 #include "bitboard.h"
 #include "chess.h"
 
-/* king attacks lookup table */
-static uint_fast64_t king_attacks_lut[64];
-
-
 /* We rely on the compass rose to identify ray-directions with
  * following increments to neighbored squares to generate king attacks.
  *
@@ -39,16 +35,16 @@ static uint64_t mask_king_attacks(const enum square sq)
 void init_king_attacks(void)
 {
 	for (enum square sq = A1; sq <= H8; sq++) {
-		king_attacks_lut[sq] = mask_king_attacks(sq);
+		attack_tables->king[sq] = mask_king_attacks(sq);
 #ifdef DEBUG
 		//printf("Attack map for king at [%s]", sqr_to_coords[sq]);
-		//print_bitboard(king_attacks_lut[sq]);
+		//print_bitboard(attack_tables->king[sq]);
 #endif
 	}
 }
 
 uint64_t get_king_attacks(const enum square sq)
 {
-	return king_attacks_lut[sq];
+	return attack_tables->king[sq];
 }
 
@@ -10,10 +10,6 @@
 #include "bitboard.h"
 #include "chess.h"
 
-/* knight attacks lookup table */
-static uint_fast64_t knight_attacks_lut[64];
-
-
 /* The Knight attacks the target squares independently from other pieces
  * around. The compass rose of all eight attacking directions associated
  * with the to - from square differences from an 8x8 board:
@@ -43,16 +39,16 @@ static uint64_t mask_knight_attacks(const enum square sq)
 void init_knight_attacks(void)
 {
 	for (enum square sq = A1; sq <= H8; sq++) {
-		knight_attacks_lut[sq] = mask_knight_attacks(sq);
+		attack_tables->knight[sq] = mask_knight_attacks(sq);
 #ifdef DEBUG
 		//printf("Attack map for knight at [%s]", sqr_to_coords[sq]);
-		//print_bitboard(knight_attacks_lut[sq]);
+		//print_bitboard(attack_tables->knight[sq]);
 #endif
 	}
 }
 
 uint64_t get_knight_attacks(const enum square sq)
 {
-	return knight_attacks_lut[sq];
+	return attack_tables->knight[sq];
 }
 
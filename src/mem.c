@@ -0,0 +1,152 @@
+/* @file:	tezdhar/src/mem.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/mem.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Allocation of large tables in huge pages, falling back to
+ * 		transparent huge pages and to normal pages. See mem.h.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "mem.h"
+
+#include <stdint.h>	// for uintptr_t
+#include <stdio.h>	// for fopen, fgets, perror
+#include <stdlib.h>	// for calloc, free
+#include <string.h>	// for strstr
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>	// for mmap, munmap, madvise, MAP_HUGETLB
+#endif
+
+/* try huge pages for the tables allocated from now on */
+bool mem_large_pages = true;
+
+
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+
+/* Map size bytes, a multiple of MEM_HUGE_PAGE, at an address aligned to
+ * MEM_HUGE_PAGE by mapping more and trimming both ends */
+static void *mem_map_aligned(const size_t size)
+{
+	uint8_t *p, *q;
+	size_t head;
+
+	p = mmap(NULL, size + MEM_HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		return NULL;
+	}
+
+	q = (uint8_t *)(((uintptr_t)p + MEM_HUGE_PAGE - 1) & ~(uintptr_t)(MEM_HUGE_PAGE - 1));
+	head = (size_t)(q - p);
+	if (head) {
+		munmap(p, head);
+	}
+	munmap(q + size, MEM_HUGE_PAGE - head);
+	return q;
+}
+
+
+/* madvise(MADV_HUGEPAGE) succeeds even if transparent huge pages are
+ * disabled, which only sysfs tells */
+static bool mem_thp_enabled(void)
+{
+	char buf[64] = "";
+	FILE *fp;
+
+	if (!(fp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r"))) {
+		return true;
+	}
+	if (!fgets(buf, sizeof(buf), fp)) {
+		buf[0] = '\0';
+	}
+	fclose(fp);
+	return !strstr(buf, "[never]");
+}
+
+#endif
+
+
+/* Allocate size bytes of zeroed memory, in huge pages if possible, and
+ * tell which pages it got. Returns NULL if out of memory */
+void *mem_alloc(size_t size, enum mem_pages *pages)
+{
+	void *p;
+
+	*pages = MEM_PAGES_NORMAL;
+	if (size < MEM_HUGE_PAGE) {
+		if (!(p = calloc(1, size))) {
+			perror("calloc failed");
+		}
+		return p;
+	}
+
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	size = (size + MEM_HUGE_PAGE - 1) & ~(MEM_HUGE_PAGE - 1);
+
+#ifdef MAP_HUGETLB
+	if (mem_large_pages) {
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+
+#ifdef MAP_HUGE_SHIFT
+		/* 2 MiB pages even where the default huge page is larger */
+		flags |= 21 << MAP_HUGE_SHIFT;
+#endif
+		if ((p = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0)) != MAP_FAILED) {
+			*pages = MEM_PAGES_HUGETLB;
+			return p;
+		}
+	}
+#endif
+
+	if (!(p = mem_map_aligned(size))) {
+		perror("mmap failed");
+		return NULL;
+	}
+#if defined HAVE_MADVISE && defined MADV_HUGEPAGE
+	if (mem_large_pages && !madvise(p, size, MADV_HUGEPAGE) && mem_thp_enabled()) {
+		*pages = MEM_PAGES_TRANSPARENT;
+	} else if (!mem_large_pages) {
+		/* normal pages even if the kernel uses huge pages by default */
+		madvise(p, size, MADV_NOHUGEPAGE);
+	}
+#endif
+	return p;
+#else
+	if (!(p = calloc(1, size))) {
+		perror("calloc failed");
+	}
+	return p;
+#endif
+}
+
+
+/* Free memory of size bytes from mem_alloc() */
+void mem_free(void *p, size_t size)
+{
+	if (!p) {
+		return;
+	}
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	if (size >= MEM_HUGE_PAGE) {
+		munmap(p, (size + MEM_HUGE_PAGE - 1) & ~(MEM_HUGE_PAGE - 1));
+		return;
+	}
+#endif
+	(void)size;
+	free(p);
+}
+
+
+const char *mem_pages_name(const enum mem_pages pages)
+{
+	switch (pages) {
+		case MEM_PAGES_HUGETLB: return "huge";
+		case MEM_PAGES_TRANSPARENT: return "transparent huge";
+		default: return "normal";
+	}
+}
@@ -0,0 +1,54 @@
+/* @file:	tezdhar/src/mem.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/mem.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Allocation of large tables in huge pages.
+ *
+ *
+ *			-----------
+ *			Large Pages
+ *			-----------
+ *
+ * The transposition table and the slider attack tables are read at random
+ * addresses, so with 4 KiB pages nearly every probe misses the TLB. Tables
+ * of 2 MiB or more are allocated in 2 MiB pages if the host allows it,
+ * trying in turn
+ *
+ *	mmap() with MAP_HUGETLB, from the pages reserved in
+ *	/proc/sys/vm/nr_hugepages
+ *	mmap() aligned to 2 MiB with madvise(MADV_HUGEPAGE), for transparent
+ *	huge pages, unless they are disabled in
+ *	/sys/kernel/mm/transparent_hugepage/enabled
+ *	normal pages
+ *
+ * and the caller is told which one succeeded. Sizes are rounded up to
+ * 2 MiB, so that the whole table is in huge pages. Smaller tables, and
+ * all tables if mem_large_pages is cleared, get normal pages.
+ */
+
+#ifndef __MEM_H__
+#define __MEM_H__	1
+
+#include "chess.h"
+
+#include <stddef.h>	// for size_t
+
+#define MEM_HUGE_PAGE	(2UL << 20)
+
+enum mem_pages {
+	MEM_PAGES_NORMAL,
+	MEM_PAGES_TRANSPARENT,		// madvise(MADV_HUGEPAGE)
+	MEM_PAGES_HUGETLB		// mmap(MAP_HUGETLB)
+};
+
+extern bool mem_large_pages;
+
+
+/* Function prototypes */
+void *mem_alloc(size_t size, enum mem_pages *pages);
+void mem_free(void *p, size_t size);
+const char *mem_pages_name(enum mem_pages pages);
+
+
+#endif	/* __MEM_H__ */
@@ -0,0 +1,597 @@
+/* @file:	tezdhar/src/movegen.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/movegen.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Pseudo-legal move generation with the attack lookup tables,
+ * 		make and unmake of moves on the board struct, and perft to
+ * 		verify both against known node counts.
+ *
+ * Moves are generated pseudo-legal, i.e. they may leave the own king in
+ * check. make_move() rejects such moves after playing them, which is
+ * cheaper than checking pins up front since most moves are legal anyway.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "bitboard.h"
+#include "cpu.h"
+
+#include <stdlib.h>	// for abs
+#include <string.h>	// for strcpy, strlen
+
+
+/* bitboard of a piece within struct bitboards */
+uint64_t *piece_bitboard(struct bitboards * const bb, const enum pieces p)
+{
+	switch (p) {
+		case WHITE_KING:	return &bb->wKing;
+		case BLACK_KING:	return &bb->bKing;
+		case WHITE_QUEEN:	return &bb->wQueen;
+		case BLACK_QUEEN:	return &bb->bQueen;
+		case WHITE_BISHOP:	return &bb->wBishop;
+		case BLACK_BISHOP:	return &bb->bBishop;
+		case WHITE_KNIGHT:	return &bb->wKnight;
+		case BLACK_KNIGHT:	return &bb->bKnight;
+		case WHITE_ROOK:	return &bb->wRook;
+		case BLACK_ROOK:	return &bb->bRook;
+		case WHITE_PAWN:	return &bb->wPawn;
+		case BLACK_PAWN:	return &bb->bPawn;
+		case EMPTY_SQR:
+		default:		return NULL;
+	}
+}
+
+
+/* Is square attacked by any piece of color 'by'. Attacks are looked up
+ * from the square itself, as if it held a piece of the attacked side */
+bool is_square_attacked(const struct board * const brd, const enum square sq, const enum color by)
+{
+	const struct bitboards *bb = &brd->bb;
+	const uint64_t occ = get_all_pieces(bb);
+
+	if (by == WHITE) {
+		return (get_pawn_attacks(BLACK, sq) & bb->wPawn) ||
+			(get_knight_attacks(sq) & bb->wKnight) ||
+			(get_king_attacks(sq) & bb->wKing) ||
+			(get_bishop_attacks(sq, occ) & (bb->wBishop | bb->wQueen)) ||
+			(get_rook_attacks(sq, occ) & (bb->wRook | bb->wQueen));
+	}
+
+	return (get_pawn_attacks(WHITE, sq) & bb->bPawn) ||
+		(get_knight_attacks(sq) & bb->bKnight) ||
+		(get_king_attacks(sq) & bb->bKing) ||
+		(get_bishop_attacks(sq, occ) & (bb->bBishop | bb->bQueen)) ||
+		(get_rook_attacks(sq, occ) & (bb->bRook | bb->bQueen));
+}
+
+
+/* Is the king of given side in check */
+bool in_check(const struct board * const brd, const enum color side)
+{
+	const uint64_t king = side == WHITE ? brd->bb.wKing : brd->bb.bKing;
+	enum square sq;
+
+	if (!king) {
+		return false;
+	}
+	sq = LSB(king);
+	return is_square_attacked(brd, sq, !side);
+}
+
+
+/* Pieces of given side which stand alone between their king and a slider
+ * of the other side. The king must not be in check */
+CPU_CLONES uint64_t pinned_pieces(const struct board * const brd, const enum color side)
+{
+	const struct bitboards *bb = &brd->bb;
+	const uint64_t occ = get_all_pieces(bb);
+	const uint64_t king = side == WHITE ? bb->wKing : bb->bKing;
+	const uint64_t own = side == WHITE ?
+		bb->wKing | bb->wQueen | bb->wRook | bb->wBishop | bb->wKnight | bb->wPawn :
+		bb->bKing | bb->bQueen | bb->bRook | bb->bBishop | bb->bKnight | bb->bPawn;
+	const uint64_t rooks = side == WHITE ? bb->bRook | bb->bQueen : bb->wRook | bb->wQueen;
+	const uint64_t bishops = side == WHITE ? bb->bBishop | bb->bQueen : bb->wBishop | bb->wQueen;
+	uint64_t cand, pinned = 0;
+	enum square ksq, sq;
+
+	if (!king) {
+		return 0;
+	}
+	ksq = LSB(king);
+
+	/* with the king out of check, a slider seen through a piece next to
+	 * the king on its line is seen along that line only */
+	cand = get_rook_attacks(ksq, occ) & own;
+	while (cand) {
+		sq = LSB(cand);
+		cand &= cand - 1;
+		if (get_rook_attacks(ksq, occ ^ BIT(sq)) & rooks) {
+			pinned |= BIT(sq);
+		}
+	}
+
+	cand = get_bishop_attacks(ksq, occ) & own;
+	while (cand) {
+		sq = LSB(cand);
+		cand &= cand - 1;
+		if (get_bishop_attacks(ksq, occ ^ BIT(sq)) & bishops) {
+			pinned |= BIT(sq);
+		}
+	}
+
+	return pinned;
+}
+
+
+static inline enum pieces piece_at(const struct board * const brd, const int sq)
+{
+	return brd->sqr[sq >> 3][sq & 7];
+}
+
+
+static inline void add_move(struct move_list * const list, const move_t m)
+{
+	list->moves[list->count++] = m;
+}
+
+
+/* Add moves of a piece from 'from' to every square in targets */
+static void add_piece_moves(const struct board * const brd, struct move_list * const list,
+		const enum pieces pc, const int from, uint64_t targets)
+{
+	for (; targets; POP_LSB(targets)) {
+		int to = LSB(targets);
+		add_move(list, encode_move(from, to, pc, piece_at(brd, to), EMPTY_SQR, 0));
+	}
+}
+
+
+/* Add pawn moves to every square in targets, expanding promotions */
+static void add_pawn_moves(const struct board * const brd, struct move_list * const list,
+		const enum color side, const int from, uint64_t targets, const bool captures_only)
+{
+	const enum pieces pc = make_piece(PAWN, side);
+	static const enum chessmen promos[] = {QUEEN, KNIGHT, ROOK, BISHOP};
+
+	for (; targets; POP_LSB(targets)) {
+		int to = LSB(targets);
+		enum pieces cap = piece_at(brd, to);
+
+		if ((to >> 3) == RANK_8 || (to >> 3) == RANK_1) {
+			/* under-promotions are quiet in the quiescence search */
+			for (int i = 0; i < (captures_only ? 1 : 4); i++) {
+				add_move(list, encode_move(from, to, pc, cap,
+							make_piece(promos[i], side), 0));
+			}
+		} else {
+			add_move(list, encode_move(from, to, pc, cap, EMPTY_SQR,
+						abs(to - from) == 16 ? MOVE_DOUBLE_PUSH : 0));
+		}
+	}
+}
+
+
+static void gen_pawn_moves(const struct board * const brd, struct move_list * const list,
+		const enum color side, const uint64_t occ, const uint64_t opp, const bool captures_only)
+{
+	const uint64_t last = side == WHITE ? BB_RANK_8 : BB_RANK_1;
+	const int up = side == WHITE ? 8 : -8;
+	uint64_t pawns = side == WHITE ? brd->bb.wPawn : brd->bb.bPawn;
+
+	for (; pawns; POP_LSB(pawns)) {
+		int from = LSB(pawns);
+		uint64_t push = BIT(from + up) & ~occ, caps;
+
+		if (push && (from >> 3) == (side == WHITE ? RANK_2 : RANK_7)) {
+			push |= BIT(from + 2 * up) & ~occ;
+		}
+		if (captures_only) {
+			push &= last;
+		}
+
+		caps = get_pawn_attacks(side, (enum square)from) & opp;
+		add_pawn_moves(brd, list, side, from, push | caps, captures_only);
+
+		if (brd->enpassant >= 0 &&
+				(get_pawn_attacks(side, (enum square)from) & BIT(brd->enpassant))) {
+			add_move(list, encode_move(from, brd->enpassant, make_piece(PAWN, side),
+						make_piece(PAWN, !side), EMPTY_SQR, MOVE_EP));
+		}
+	}
+}
+
+
+/* Castling needs the squares between king and rook empty, and the king
+ * must not be in check or pass over an attacked square */
+static void gen_castling(const struct board * const brd, struct move_list * const list,
+		const enum color side, const uint64_t occ)
+{
+	const int ks = side == WHITE ? WHITE_KS : BLACK_KS;
+	const int qs = side == WHITE ? WHITE_QS : BLACK_QS;
+	const int e = side == WHITE ? E1 : E8;
+	const enum pieces king = make_piece(KING, side);
+
+	if (!brd->castling[ks] && !brd->castling[qs]) {
+		return;
+	}
+
+	if (piece_at(brd, e) != king || is_square_attacked(brd, (enum square)e, !side)) {
+		return;
+	}
+
+	if (brd->castling[ks] && !(occ & (BIT(e + 1) | BIT(e + 2))) &&
+			piece_at(brd, e + 3) == make_piece(ROOK, side) &&
+			!is_square_attacked(brd, (enum square)(e + 1), !side) &&
+			!is_square_attacked(brd, (enum square)(e + 2), !side)) {
+		add_move(list, encode_move(e, e + 2, king, EMPTY_SQR, EMPTY_SQR, MOVE_CASTLING));
+	}
+
+	if (brd->castling[qs] && !(occ & (BIT(e - 1) | BIT(e - 2) | BIT(e - 3))) &&
+			piece_at(brd, e - 4) == make_piece(ROOK, side) &&
+			!is_square_attacked(brd, (enum square)(e - 1), !side) &&
+			!is_square_attacked(brd, (enum square)(e - 2), !side)) {
+		add_move(list, encode_move(e, e - 2, king, EMPTY_SQR, EMPTY_SQR, MOVE_CASTLING));
+	}
+}
+
+
+/* Generate pseudo-legal moves of the side to move. With captures_only
+ * only captures and queen promotions are generated */
+CPU_CLONES void gen_moves(const struct board * const brd, struct move_list * const list, const bool captures_only)
+{
+	const struct bitboards *bb = &brd->bb;
+	const enum color side = brd->turn;
+	const uint64_t own = side == WHITE ? get_white_pieces(bb) : get_black_pieces(bb);
+	const uint64_t opp = side == WHITE ? get_black_pieces(bb) : get_white_pieces(bb);
+	const uint64_t occ = own | opp;
+	const uint64_t targets = captures_only ? opp : ~own;
+	uint64_t pieces;
+
+	list->count = 0;
+	gen_pawn_moves(brd, list, side, occ, opp, captures_only);
+
+	for (pieces = own & ~(bb->wPawn | bb->bPawn); pieces; POP_LSB(pieces)) {
+		int from = LSB(pieces);
+		enum pieces pc = piece_at(brd, from);
+		uint64_t att;
+
+		switch (piece_type(pc)) {
+			case KNIGHT:	att = get_knight_attacks((enum square)from); break;
+			case BISHOP:	att = get_bishop_attacks((enum square)from, occ); break;
+			case ROOK:	att = get_rook_attacks((enum square)from, occ); break;
+			case QUEEN:	att = get_queen_attacks((enum square)from, occ); break;
+			case KING:	att = get_king_attacks((enum square)from); break;
+			case PAWN:
+			case EMPTY:
+			default:	att = 0ULL;
+		}
+		add_piece_moves(brd, list, pc, from, att & targets);
+	}
+
+	if (!captures_only) {
+		gen_castling(brd, list, side, occ);
+	}
+}
+
+
+static inline void put_piece(struct board * const brd, const enum pieces p, const int sq)
+{
+	uint64_t *bb = piece_bitboard(&brd->bb, p);
+
+	brd->sqr[sq >> 3][sq & 7] = p;
+	brd->key ^= zobrist_pieces[p][sq];
+	if (bb) {
+		*bb |= BIT(sq);
+	}
+}
+
+
+static inline void remove_piece(struct board * const brd, const enum pieces p, const int sq)
+{
+	uint64_t *bb = piece_bitboard(&brd->bb, p);
+
+	brd->sqr[sq >> 3][sq & 7] = EMPTY_SQR;
+	brd->key ^= zobrist_pieces[p][sq];
+	if (bb) {
+		*bb &= ~BIT(sq);
+	}
+}
+
+
+/* rook squares of a castling move, given the king's destination */
+static void castling_rook(const int to, int * const rfrom, int * const rto)
+{
+	*rfrom = (to & 7) == G_FILE ? to + 1 : to - 2;
+	*rto = (to & 7) == G_FILE ? to - 1 : to + 1;
+}
+
+
+/* Castling rights lost when a move touches one of these squares */
+static void update_castling_rights(struct board * const brd, const int sq)
+{
+	switch (sq) {
+		case E1: brd->castling[WHITE_KS] = brd->castling[WHITE_QS] = false; break;
+		case H1: brd->castling[WHITE_KS] = false; break;
+		case A1: brd->castling[WHITE_QS] = false; break;
+		case E8: brd->castling[BLACK_KS] = brd->castling[BLACK_QS] = false; break;
+		case H8: brd->castling[BLACK_KS] = false; break;
+		case A8: brd->castling[BLACK_QS] = false; break;
+		default: break;
+	}
+}
+
+
+/* Play a pseudo-legal move on board. Returns false, with the board left
+ * unchanged, if the move leaves the own king in check */
+bool make_move(struct board * const brd, const move_t m, struct undo * const u)
+{
+	const int from = MOVE_FROM(m), to = MOVE_TO(m);
+	const enum pieces pc = MOVE_PIECE(m), cap = MOVE_CAPTURED(m), promo = MOVE_PROMOTED(m);
+	const enum color side = brd->turn;
+	int rfrom, rto;
+
+	for (int i = 0; i < 4; i++) {
+		u->castling[i] = brd->castling[i];
+	}
+	u->enpassant = brd->enpassant;
+	u->halfMoves = brd->halfMoves;
+	u->fullMoves = brd->fullMoves;
+	u->key = brd->key;
+
+	/* the pieces are hashed as they move, the rest of the key here */
+	brd->key ^= zobrist_state(brd);
+	remove_piece(brd, pc, from);
+	if (m & MOVE_EP) {
+		remove_piece(brd, cap, side == WHITE ? to - 8 : to + 8);
+	} else if (cap != EMPTY_SQR) {
+		remove_piece(brd, cap, to);
+	}
+	put_piece(brd, promo != EMPTY_SQR ? promo : pc, to);
+
+	if (m & MOVE_CASTLING) {
+		castling_rook(to, &rfrom, &rto);
+		remove_piece(brd, make_piece(ROOK, side), rfrom);
+		put_piece(brd, make_piece(ROOK, side), rto);
+	}
+
+	update_castling_rights(brd, from);
+	update_castling_rights(brd, to);
+
+	brd->enpassant = (m & MOVE_DOUBLE_PUSH) ? (int8_t)((from + to) / 2) : -1;
+	brd->halfMoves = (piece_type(pc) == PAWN || cap != EMPTY_SQR) ? 0 :
+		(uint16_t)(brd->halfMoves + 1);
+	if (side == BLACK) {
+		brd->fullMoves++;
+	}
+	brd->turn = !side;
+	brd->key ^= zobrist_state(brd);
+
+	if (in_check(brd, side)) {
+		unmake_move(brd, m, u);
+		return false;
+	}
+
+	return true;
+}
+
+
+/* Take back a move played by make_move() */
+void unmake_move(struct board * const brd, const move_t m, const struct undo * const u)
+{
+	const int from = MOVE_FROM(m), to = MOVE_TO(m);
+	const enum pieces pc = MOVE_PIECE(m), cap = MOVE_CAPTURED(m), promo = MOVE_PROMOTED(m);
+	const enum color side = !brd->turn;
+	int rfrom, rto;
+
+	brd->turn = side;
+
+	if (m & MOVE_CASTLING) {
+		castling_rook(to, &rfrom, &rto);
+		remove_piece(brd, make_piece(ROOK, side), rto);
+		put_piece(brd, make_piece(ROOK, side), rfrom);
+	}
+
+	remove_piece(brd, promo != EMPTY_SQR ? promo : pc, to);
+	if (m & MOVE_EP) {
+		put_piece(brd, cap, side == WHITE ? to - 8 : to + 8);
+	} else if (cap != EMPTY_SQR) {
+		put_piece(brd, cap, to);
+	}
+	put_piece(brd, pc, from);
+
+	for (int i = 0; i < 4; i++) {
+		brd->castling[i] = u->castling[i];
+	}
+	brd->enpassant = u->enpassant;
+	brd->halfMoves = u->halfMoves;
+	brd->fullMoves = u->fullMoves;
+	brd->key = u->key;
+}
+
+
+/* Generate only the legal moves of the side to move */
+int gen_legal_moves(struct board * const brd, struct move_list * const list)
+{
+	const bool check = in_check(brd, brd->turn);
+	const uint64_t pinned = check ? 0 : pinned_pieces(brd, brd->turn);
+	struct move_list pseudo;
+	struct undo u;
+	move_t m;
+
+	gen_moves(brd, &pseudo, false);
+	list->count = 0;
+
+	for (int i = 0; i < pseudo.count; i++) {
+		m = pseudo.moves[i];
+
+		/* out of check, only king moves, en-passant captures and moves
+		 * of pinned pieces can expose the king */
+		if (!check && !(pinned & BIT(MOVE_FROM(m))) && !(m & MOVE_EP) &&
+				piece_type(MOVE_PIECE(m)) != KING) {
+			add_move(list, m);
+		} else if (make_move(brd, m, &u)) {
+			unmake_move(brd, m, &u);
+			add_move(list, m);
+		}
+	}
+
+	return list->count;
+}
+
+
+/* Convert move into UCI long algebraic notation like "e2e4" or "a7a8q" */
+void move_to_uci(const move_t m, char * const buf)
+{
+	static const char promo[] = " qnbr";	// indexed by enum chessmen
+
+	if (m == MOVE_NONE) {
+		strcpy(buf, "0000");
+		return;
+	}
+
+	buf[0] = sqr_to_coords[MOVE_FROM(m)][0];
+	buf[1] = sqr_to_coords[MOVE_FROM(m)][1];
+	buf[2] = sqr_to_coords[MOVE_TO(m)][0];
+	buf[3] = sqr_to_coords[MOVE_TO(m)][1];
+	buf[4] = MOVE_PROMOTED(m) != EMPTY_SQR ? promo[piece_type(MOVE_PROMOTED(m))] : '\0';
+	buf[5] = '\0';
+}
+
+
+/* Write a legal move in Standard Algebraic Notation, like Nbd7, exd6,
+ * e8=Q+ or O-O#. The buffer must hold MAX_MOVE_LEN characters */
+void move_to_san(struct board * const brd, const move_t m, char * const buf)
+{
+	static const char letter[] = "KQNBR";	// indexed by enum chessmen
+	const enum chessmen pc = piece_type(MOVE_PIECE(m));
+	const int from = MOVE_FROM(m), to = MOVE_TO(m);
+	bool same_file = false, same_rank = false, other = false;
+	struct move_list list;
+	struct undo u;
+	char *p = buf;
+
+	if (m & MOVE_CASTLING) {
+		strcpy(p, (to & 7) == 6 ? "O-O" : "O-O-O");
+		p += strlen(p);
+	} else {
+		if (pc != PAWN) {
+			*p++ = letter[pc];
+
+			/* other pieces of the same kind reaching the square */
+			gen_legal_moves(brd, &list);
+			for (int i = 0; i < list.count; i++) {
+				const move_t o = list.moves[i];
+				const int of = (int)MOVE_FROM(o);
+
+				if (o != m && MOVE_TO(o) == (enum square)to && MOVE_PIECE(o) == MOVE_PIECE(m)) {
+					other = true;
+					same_file = same_file || (of & 7) == (from & 7);
+					same_rank = same_rank || (of >> 3) == (from >> 3);
+				}
+			}
+			if (other && (!same_file || same_rank)) {
+				*p++ = sqr_to_coords[from][0];
+			}
+			if (other && same_file) {
+				*p++ = sqr_to_coords[from][1];
+			}
+		} else if (MOVE_CAPTURED(m) != EMPTY_SQR || (m & MOVE_EP)) {
+			*p++ = sqr_to_coords[from][0];
+		}
+
+		if (MOVE_CAPTURED(m) != EMPTY_SQR || (m & MOVE_EP)) {
+			*p++ = 'x';
+		}
+		*p++ = sqr_to_coords[to][0];
+		*p++ = sqr_to_coords[to][1];
+
+		if (MOVE_PROMOTED(m) != EMPTY_SQR) {
+			*p++ = '=';
+			*p++ = letter[piece_type(MOVE_PROMOTED(m))];
+		}
+	}
+
+	if (make_move(brd, m, &u)) {
+		if (in_check(brd, brd->turn)) {
+			*p++ = gen_legal_moves(brd, &list) ? '+' : '#';
+		}
+		unmake_move(brd, m, &u);
+	}
+	*p = '\0';
+}
+
+
+/* Does a generated move fit the parsed move text. Squares, files and
+ * ranks which were not given in the move text are 8 */
+static bool move_matches(const move_t m, const struct move * const mv)
+{
+	const int from = MOVE_FROM(m), to = MOVE_TO(m);
+
+	if (mv->castle_ks || mv->castle_qs) {
+		return (m & MOVE_CASTLING) && (to & 7) == (mv->castle_ks ? 6 : 2);
+	}
+
+	if ((mv->chessman != EMPTY && piece_type(MOVE_PIECE(m)) != mv->chessman) ||
+			mv->to_file != (to & 7) || mv->to_rank != (to >> 3) ||
+			(mv->from_file < 8 && mv->from_file != (from & 7)) ||
+			(mv->from_rank < 8 && mv->from_rank != (from >> 3))) {
+		return false;
+	}
+
+	return piece_type(MOVE_PROMOTED(m)) == mv->promoted;
+}
+
+
+/* Find the legal move described by a move parsed from SAN or UCI move
+ * text. Returns MOVE_NONE if no legal move or more than one fits */
+move_t resolve_move(struct board * const brd, const struct move * const mv)
+{
+	struct move_list list;
+	move_t found = MOVE_NONE;
+	struct undo u;
+
+	if (mv->invalid || mv->null) {
+		return MOVE_NONE;
+	}
+
+	gen_moves(brd, &list, false);
+	for (int i = 0; i < list.count; i++) {
+		if (!move_matches(list.moves[i], mv) || !make_move(brd, list.moves[i], &u)) {
+			continue;
+		}
+		unmake_move(brd, list.moves[i], &u);
+		if (found != MOVE_NONE) {
+			return MOVE_NONE;	// ambiguous
+		}
+		found = list.moves[i];
+	}
+
+	return found;
+}
+
+
+/* Count leaf nodes of the legal move tree up to given depth */
+uint64_t perft(struct board * const brd, const int depth)
+{
+	struct move_list list;
+	struct undo u;
+	uint64_t nodes = 0;
+
+	if (depth == 0) {
+		return 1;
+	}
+
+	gen_moves(brd, &list, false);
+	for (int i = 0; i < list.count; i++) {
+		if (make_move(brd, list.moves[i], &u)) {
+			nodes += perft(brd, depth - 1);
+			unmake_move(brd, list.moves[i], &u);
+		}
+	}
+
+	return nodes;
+}
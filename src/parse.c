@@ -12,10 +12,9 @@
 #endif
 
 #include "chess.h"	// for struct board
-#include <stdio.h>	// for printf, fprintf
+#include <stdio.h>	// for printf, sprintf, sscanf
 #include <ctype.h>	// for isdigit, isspace
-#include <string.h>	// for strcpy, strlen
-#include <stdlib.h>	// for free
+#include <string.h>	// for strlen
 
 
 static enum chessmen get_chessman(const char pos)
@@ -107,7 +106,6 @@ static char *parse_pieces_from_fen(char *fen, struct board * const board)
 	bool valid = fen ? true : false;
 
 	if (!valid) {
-		fprintf(stderr, "Error parsing FEN string as it is NULL\n");
 		return NULL;
 	}
 
@@ -139,7 +137,6 @@ static char *parse_pieces_from_fen(char *fen, struct board * const board)
 			}
 			j++;
 		}
-		valid ? true : fprintf(stderr, "Invalid character in FEN record: %c\n", *fen);
 		fen++;
 	}
 
@@ -173,6 +170,7 @@ static char *parse_fen_flags(char *fen, struct board *board)
 				   * is used to assign en-passant square. */
 				  if (turn) {
 					  board->status = BLACK_TURN;
+					  board->turn = BLACK;
 				  } else {
 					  file = B_FILE;
 				  }
@@ -181,6 +179,7 @@ static char *parse_fen_flags(char *fen, struct board *board)
 
 			case 'w': case 'W':
 				  board->status = WHITE_TURN;
+				  board->turn = WHITE;
 				  turn = false;
 				  break;
 
@@ -200,7 +199,6 @@ static char *parse_fen_flags(char *fen, struct board *board)
 
 			default: valid = false;
 		}
-		valid ? true : fprintf(stderr, "Invalid character in FEN record: %c\n", *fen);
 		fen++;
 	}
 
@@ -219,13 +217,11 @@ static bool str_has_digits_only(char *fen)
 			if (isspace(*fen) || isdigit(*fen)) {
 				fen++;
 			} else {
-				fprintf(stderr, "Invalid character in FEN: %c\n", *fen);
 				return false;
 			}
 		}
 		return true;
 	} else {
-		fprintf(stderr, "Error parsing FEN string as it is NULL\n");
 		return false;
 	}
 }
@@ -238,12 +234,13 @@ static bool parse_move_cnt(char *fen, struct board *b)
 		dbg_print("hm = %d, fm = %d\n", b->halfMoves, b->fullMoves);
 		return true;
 	} else {
-		fprintf(stderr, "FEN contains non-numeric move count: %s\n", fen);
 		return false;
 	}
 }
 
 
+/* Parse a FEN into the board. Nothing is printed if it is not valid, the
+ * callers report it */
 bool parse_fen_record(char *fen, struct board *board)
 {
 	fen = parse_pieces_from_fen(fen, board);
@@ -258,1090 +255,477 @@ void print_fen_str(struct board *board)
 }
 
 
-/* strip substring from a string, and return success if substring is found */
-static bool strip_text(char * const str, const char * const delim[], int len)
+/* Write the FEN of the current position into fen, which must hold
+ * MAX_FEN_LEN chars. brd->fen is the FEN the board was set up from */
+void board_to_fen(const struct board * const brd, char * const fen)
 {
-	char *match;
-	size_t len_match, len_delim;
+	static const char letters[] = " rnbqkpRNBQKP";	// indexed by enum pieces
+	static const char rights[] = "KQkq";		// indexed by castling_rights
+	char *p = fen;
+	int empty;
 
-	if (!str || !delim) {
-		return false;
-	}
-
-	for (int i = 0; i < len; i++) {
-#ifdef HAVE_STRCASESTR
-		match = strcasestr(str, delim[i]);
-#else
-		match = strstr(str, delim[i]);
-#endif
-		len_delim = strlen(delim[i]);
-		if (match && len_delim) {
-			len_match = strlen(match);
-			if (len_match >= len_delim) {
-				dbg_print("Stripping [%s] from [%s]\n",
-						delim[i], str);
-				memmove(match, match+len_delim,
-						len_match - len_delim + 1);
-				dbg_print("Stripped Movetext = %s\n", str);
-				return true;
+	for (int rank = RANK_8; rank >= RANK_1; rank--) {
+		empty = 0;
+		for (int file = A_FILE; file < MAX_FILE; file++) {
+			if (brd->sqr[rank][file] == EMPTY_SQR) {
+				empty++;
+				continue;
 			}
-		}
-	}
-
-	return false;
-}
-
-
-/* According to UCI protocol specifications, a "nullmove" from the Engine to
- * the GUI should be sent as 0000. A null move just passes the turn to the
- * other side (and possibly forfeits en-passant capturing). Several
- * possibilities present themselves as to what the SAN notation can be,
- * but none claim to be the official standard specification for SAN.
- */
-static bool is_null_move(char * const movetext, struct move * const move)
-{
-	const char * const delim[] = {
-		"(null)",
-		"00-00",
-		"null",		// Stockfish SAN
-		"0000",
-		"pass",
-		"@@@@",		// WinBoard protocol
-		"any",
-		"Z0",		// ChessAssistant, Aquarium
-		"<>",
-		"--",		// PGN SAN, Fritz, Chessbase, SCID
-		"$0"		// NAG (Numeric Annotation Glyph)
-	};
-	int len = sizeof(delim)/sizeof(delim[0]);
-
-	if (!movetext) {
-		return false;
-	}
-
-	if (strip_text(movetext, delim, len)) {
-		move->null = true;
-		return true;
-	} else {
-		return false;
-	}
-}
-
-
-/* FIXME: Some annotations which use Unicode symbols are not compared here
- * for the sake of brevity. Fixing this issue would also mean inputting the
- * user move in wchar_t format and also reading the PGN file in wchar_t format.
- */
-static void strip_evaluation_annotation_symbols(char * const movetext)
-{
-	/* since the function returns after first match,
-	 * the strings are listed in descending length order */
-	const char * const annotations[] = {
-		"????",			// absurdly bad blunder
-		"!!!!",			// extraordinarily brilliant move
-		"\?\?!",		// peculiar move
-		"!!?", "?!?", "!?!",	// particularly unusual move
-		"(?)",			// inferior move
-		"(!)",			// objectively good move
-		"!!!",			// exceptionally brilliant move
-		"???",			// exceptionally bad blunder
-
-		"+/=",			// slight plus position for white
-		"=/+",			// slight plus position for black
-		"+/-",			// clear plus for white
-		"-/+",			// clear plus for black
-
-		"+-",			// decisive advantage for white
-		"-+",			// decisive advantage for black
-
-		"??",			// blunder
-		"?!",			// dubious move
-		"!?",			// interesting move
-		"!!",			// brilliant move
-		"TN",			// theoretical novelty
-
-		"?",			// mistake
-		"!",			// good move
-	};
-	int len = sizeof(annotations)/sizeof(annotations[0]);
-
-	if (movetext) {
-		strip_text(movetext, annotations, len);
-	}
-}
-
-
-/* strip equal position annnotation symbols at the end */
-static void strip_eq_pos_annotation(char * const movetext)
-{
-	if (movetext) {
-		char *p = strrchr(movetext, '=');
-
-		/* the following check is necessary to distinguish between
-		 * equal position annotation and pawn promotion notation */
-		if (p) {
-			if ((*(p+1) == '\0') || (*(p+1) == ' ')) {
-				*p = '\0';
+			if (empty) {
+				*p++ = (char)('0' + empty);
+				empty = 0;
 			}
+			*p++ = letters[brd->sqr[rank][file]];
 		}
-	}
-}
-
-
-/* strip end-of-game annotation symbols */
-static void strip_eog_indicators(char * const movetext)
-{
-	const char * const indicators[] = {
-		"White Resigns",
-		"Black Resigns",
-		"1-0", "0-1",
-		"+/-", "-/+",
-		"+/+", "-/-"
-	};
-	int len = sizeof(indicators)/sizeof(indicators[0]);
-
-	if (movetext) {
-		strip_text(movetext, indicators, len);
-	}
-}
-
-
-/* FIDE specifies draw offers to be recorded by an equals sign
- * with parentheses "(=)" after the move on the score sheet.
- */
-static void strip_draw_offered_flag(char * const movetext, struct move * const move)
-{
-	const char * const indicators[] = {"(=)"};
-	int len = sizeof(indicators)/sizeof(indicators[0]);
-
-	if (movetext) {
-		if (strip_text(movetext, indicators, len)) {
-			move->draw_offered = true;
+		if (empty) {
+			*p++ = (char)('0' + empty);
 		}
+		*p++ = rank == RANK_1 ? ' ' : '/';
 	}
-}
-
 
-/* strip check to king annotation indicators */
-static void strip_check_indicators(char * const movetext, struct move * const move)
-{
-	const char * const indicators[] = {
-		"dis. ch.",		// discovered check
-		"dbl. ch.",		// double check
-		"ch.", "ch",		// check
-		"++",			// double check
-		"+"			// check
-	};
-	int len = sizeof(indicators)/sizeof(indicators[0]);
-
-	if (movetext) {
-		if (strip_text(movetext, indicators, len)) {
-			move->check = true;
+	*p++ = brd->turn == WHITE ? 'w' : 'b';
+	*p++ = ' ';
+	empty = 1;
+	for (int i = WHITE_KS; i <= BLACK_QS; i++) {
+		if (brd->castling[i]) {
+			*p++ = rights[i];
+			empty = 0;
 		}
 	}
-}
-
-
-/* strip checkmate annotations */
-static void strip_checkmate_indicators(char * const movetext, struct move * const move)
-{
-	const char * const indicators[] = {"mate", "++", "#"};
-	int len = sizeof(indicators)/sizeof(indicators[0]);
-
-	if (movetext) {
-		if (strip_text(movetext, indicators, len)) {
-			move->checkmate = true;
-		}
-	}
-}
-
-
-/* check for king side castling sequence */
-static bool is_ks_castling_seq(char * const movetext, struct move * const move)
-{
-	const char * const seq[] = {
-		"0-0",		// digit zero format (FIDE standard)
-		"O-O"		// uppercase letter O (PGN specification)
-	};
-	int len = sizeof(seq)/sizeof(seq[0]);
-
-	if (!movetext) {
-		return false;
-	}
-
-	dbg_print("movetext = %s\n", movetext);
-
-	/* QS castling move string "0-0-0" or "O-O-O" must be checked before the
-	 * KS castling, otherwise "0-0" will be stripped from "0-0-0" leaving
-	 * behind "-0" with false positives about KS castling */
-	if ((strcmp(movetext, "0-0-0")==0) || (strcmp(movetext, "O-O-O"))==0) {
-		return false;
-	}
-
-	if (strip_text(movetext, seq, len)) {
-		move->chessman = KING;
-		move->castle_ks = true;
-		return true;
-	} else {
-		return false;
-	}
-}
-
-
-/* check for queen side castling sequence */
-static bool is_qs_castling_seq(char * const movetext, struct move * const move)
-{
-	const char * const seq[] = {
-		"0-0-0",	// digit zero format (FIDE standard)
-		"O-O-O"		// uppercase letter O (PGN specification)
-	};
-	int len = sizeof(seq)/sizeof(seq[0]);
-
-	if (!movetext) {
-		return false;
+	if (empty) {
+		*p++ = '-';
 	}
+	*p++ = ' ';
 
-	dbg_print("movetext = %s\n", movetext);
-
-	if (strip_text(movetext, seq, len)) {
-		move->chessman = KING;
-		move->castle_qs = true;
-		return true;
+	if (brd->enpassant >= 0) {
+		*p++ = sqr_to_coords[brd->enpassant][0];
+		*p++ = sqr_to_coords[brd->enpassant][1];
 	} else {
-		return false;
+		*p++ = '-';
 	}
+	sprintf(p, " %u %u", brd->halfMoves, brd->fullMoves);
 }
 
 
-/* When a pawn promotes, the piece promoted to is indicated at the end of the
- * move notation, for example: e8Q (promoting to queen). In standard FIDE
- * notation, no punctuation is used; in Portable Game Notation (PGN) and many
- * publications, pawn promotion is indicated by the equals sign (e8=Q). Other
- * formulations used in chess literature include parentheses (e.g. e8(Q)) and
- * a forward slash (e.g. e8/Q).
+/*			------------------------
+ *			Single Pass Move Parser
+ *			------------------------
+ *
+ * Move text is read once from left to right. Every character is looked up
+ * in san_class[], which tells whether it is a piece letter, a file, a rank,
+ * a capture mark and so on, and the move struct is filled as the text is
+ * read. The files and ranks are collected in order, and after the last one
+ * the final file and rank are the destination square and anything before
+ * them is the from-square or its disambiguation:
+ *
+ *	e4		Nf3		exd5		Nbd7		R1e2
+ *	Qh4xe1		e2e4		e7e8q		d3-d7		e8=Q
+ *
+ * Whatever follows the move, like check and mate indicators, annotations
+ * and NAGs, is matched against san_suffixes[]. Castling and null moves are
+ * recognized by their own short checks, null moves only after a text fails
+ * to parse as a move, so that they cost nothing for ordinary moves.
  */
-static bool is_pawn_promotion(char * const movetext, struct move * const move)
-{
-	char *p = NULL;
-	bool flag = false;
-	const char * const delim[] = {
-		"8=", "8(", "8/", "8",		// white side pawn promotion
-		"1=", "1(", "1/", "1"};		// black side pawn promotion
-	int len = sizeof(delim)/sizeof(delim[0]);
-
-	if (!movetext) {
-		return false;
-	}
-
-	for (int i = 0; i < len; i++) {
-		p = strstr(movetext, delim[i]);
-		if (p) {
-			if (*(p+1)) {
-				/* FIDE notation without punctuation */
-				switch (*(p+1)) {
-					/* UCI protocol allows for use of
-					 * lowercase letters for piece
-					 * promotion, for example e7e8q */
-					case 'Q': case 'q':
-					case 'R': case 'r':
-					case 'N': case 'n':
-					case 'B': move->promoted = \
-						  get_chessman(*(p+1));
-						  flag = true;
-						  break;
-					case 'b': /* check for special moves
-						     like f8b4, a8b8, a1a5,
-						     c8b7, a1b1, Qc8b8, etc. */
-						  if (strlen(p+1) == 1) {
-							  move->promoted = BISHOP;
-							  flag = true;
-						  } break;
-					default:  break;
-				}
-				if (flag) {
-					*(p+1) = '\0';
-					move->chessman = PAWN;
-					return true;
-				} else {
-					/* PGN and other formulations */
-					switch (*(p+1)) {
-						case '=':
-						case '/':
-						case '(': flag = true; break;
-						default:  break;
-					}
-				}
-			}
-		}
-		if (flag) {
-			break;
-		}
-	}
 
-	if (flag) {
-		if (strlen(p) > 2) {
-			move->promoted = get_chessman(*(p+2));
-			if (move->promoted != EMPTY) {
-				*(p+1) = '\0';
-				move->chessman = PAWN;
-				return true;
-			}
-		}
-	}
+enum san_class {
+	SAN_OTHER,		// not part of a move, starts the suffix
+	SAN_PIECE,		// K Q R B N P
+	SAN_FILE,		// a .. h
+	SAN_FILE_WORD,		// c d e, which also start "ch", "dis. ch." and "e.p."
+	SAN_RANK,		// 1 .. 8
+	SAN_CAPTURE,		// x or :
+	SAN_SEP,		// '-' between from-square and to-square
+	SAN_PROMO,		// = / ( before a promoted piece
+	SAN_UCI_PROMO		// q r n, lowercase promoted piece of UCI moves
+};
+
+static const uint8_t san_class[256] = {
+	['K'] = SAN_PIECE, ['Q'] = SAN_PIECE, ['R'] = SAN_PIECE,
+	['B'] = SAN_PIECE, ['N'] = SAN_PIECE, ['P'] = SAN_PIECE,
+
+	['a'] = SAN_FILE, ['b'] = SAN_FILE, ['c'] = SAN_FILE_WORD, ['d'] = SAN_FILE_WORD,
+	['e'] = SAN_FILE_WORD, ['f'] = SAN_FILE, ['g'] = SAN_FILE, ['h'] = SAN_FILE,
+
+	['1'] = SAN_RANK, ['2'] = SAN_RANK, ['3'] = SAN_RANK, ['4'] = SAN_RANK,
+	['5'] = SAN_RANK, ['6'] = SAN_RANK, ['7'] = SAN_RANK, ['8'] = SAN_RANK,
+
+	['x'] = SAN_CAPTURE, [':'] = SAN_CAPTURE, ['-'] = SAN_SEP,
+	['='] = SAN_PROMO, ['/'] = SAN_PROMO, ['('] = SAN_PROMO,
+	['q'] = SAN_UCI_PROMO, ['r'] = SAN_UCI_PROMO, ['n'] = SAN_UCI_PROMO
+};
+
+enum san_effect {
+	SAN_NONE,		// annotation without meaning for the move
+	SAN_CHECK,
+	SAN_MATE,
+	SAN_EP,
+	SAN_DRAW		// draw offered
+};
+
+struct san_suffix {
+	const char *text;
+	enum san_effect effect;
+};
+
+/* Suffixes which may follow a move. At every point of the text the first
+ * suffix after which the rest still parses is taken, so longer suffixes are
+ * listed before their prefixes: "!!" is one annotation, not two, while
+ * "++/-" falls back to "+" and "+/-". Words are matched ignoring case.
+ *
+ * FIXME: Some annotations which use Unicode symbols are not compared here
+ * for the sake of brevity. Fixing this issue would also mean inputting the
+ * user move in wchar_t format and also reading the PGN file in wchar_t
+ * format.
+ */
+static const struct san_suffix san_suffixes[] = {
+	{"White Resigns", SAN_NONE},	{"Black Resigns", SAN_NONE},
+	{"dis. ch.", SAN_CHECK},	// discovered check
+	{"dbl. ch.", SAN_CHECK},	// double check
+	{"e.p.", SAN_EP},		{"ep.", SAN_EP},	{"ep", SAN_EP},
+	{"ch.", SAN_CHECK},		{"ch", SAN_CHECK},
+	{"mate", SAN_MATE},
+
+	{"????", SAN_NONE},		// absurdly bad blunder
+	{"!!!!", SAN_NONE},		// extraordinarily brilliant move
+	{"\?\?!", SAN_NONE},		// peculiar move
+	{"!!?", SAN_NONE}, {"?!?", SAN_NONE}, {"!?!", SAN_NONE},
+	{"!!!", SAN_NONE},		// exceptionally brilliant move
+	{"???", SAN_NONE},		// exceptionally bad blunder
+	{"(?)", SAN_NONE},		// inferior move
+	{"(!)", SAN_NONE},		// objectively good move
+	{"(=)", SAN_DRAW},		// FIDE records draw offers as "(=)"
+
+	{"+/=", SAN_NONE},		// slight plus position for white
+	{"=/+", SAN_NONE},		// slight plus position for black
+	{"+/-", SAN_NONE},		// clear plus for white
+	{"-/+", SAN_NONE},		// clear plus for black
+	{"+/+", SAN_NONE}, {"-/-", SAN_NONE},
+	{"1/2-1/2", SAN_NONE}, {"1-0", SAN_NONE}, {"0-1", SAN_NONE},
+	{"+-", SAN_NONE},		// decisive advantage for white
+	{"-+", SAN_NONE},		// decisive advantage for black
+
+	{"??", SAN_NONE},		// blunder
+	{"?!", SAN_NONE},		// dubious move
+	{"!?", SAN_NONE},		// interesting move
+	{"!!", SAN_NONE},		// brilliant move
+	{"TN", SAN_NONE},		// theoretical novelty
+	{"++", SAN_CHECK},		// double check
+	{"?", SAN_NONE},		// mistake
+	{"!", SAN_NONE},		// good move
+	{"+", SAN_CHECK},
+	{"#", SAN_MATE},
+	{"=", SAN_NONE}			// equal position
+};
 
-	return false;
-}
+/* According to UCI protocol specifications, a "nullmove" from the Engine to
+ * the GUI should be sent as 0000. A null move just passes the turn to the
+ * other side (and possibly forfeits en-passant capturing). Several
+ * possibilities present themselves as to what the SAN notation can be,
+ * but none claim to be the official standard specification for SAN.
+ */
+static const char * const san_null_moves[] = {
+	"(null)",
+	"00-00",
+	"null",		// Stockfish SAN
+	"0000",
+	"pass",
+	"@@@@",		// WinBoard protocol
+	"any",
+	"Z0",		// ChessAssistant, Aquarium
+	"<>",
+	"--",		// PGN SAN, Fritz, Chessbase, SCID
+	"$0"		// NAG (Numeric Annotation Glyph)
+};
 
 
-static bool is_pawn_move(const char * const movetext, struct move * const move)
+static char san_lower(const char c)
 {
-	const char delim[] = "KQBNR";
-
-	if (!movetext) {
-		return false;
-	}
-
-	if (strpbrk(movetext, delim)) {
-		move->invalid = true;
-		return false;
-	} else {
-		move->chessman = PAWN;
-		return true;
-	}
+	return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
 }
 
 
-static bool strip_ep_suffix(char * const movetext, struct move * const move)
+/* Length of word at the start of text, ignoring case, 0 if it is not */
+static size_t san_prefix(const char *text, const char *word)
 {
-	const char * const suffix[] = {"e.p.","ep.", "ep"};
-	int len = sizeof(suffix)/sizeof(suffix[0]);
+	size_t n = 0;
 
-	if (!movetext) {
-		return false;
+	while (word[n] && san_lower(text[n]) == san_lower(word[n])) {
+		n++;
 	}
 
-	if (strip_text(movetext, suffix, len)) {
-		move->ep = true;
-		return true;
-	} else {
-		return false;
-	}
+	return word[n] ? 0 : n;
 }
 
 
-static int get_moving_piece_count(const char * const movetext)
+/* Match a suffix at text, from san_suffixes[*from] on, and return its
+ * length or 0 if none matches. *from is left at the suffix matched. A
+ * word followed by a rank, like the "ch" of "Rch8", is part of the move */
+static size_t san_match_suffix(const char *text, size_t *from, enum san_effect *effect)
 {
-	int count = 0;
+	const size_t count = sizeof(san_suffixes) / sizeof(san_suffixes[0]);
+	size_t n;
 
-	if (movetext) {
-		for (size_t i=0; i<strlen(movetext); i++) {
-			if (get_chessman(movetext[i]) != EMPTY) {
-				count++;
-			}
-		}
-	}
-
-	return count;
-}
+	for (size_t i = *from; i < count; i++) {
+		const struct san_suffix *s = &san_suffixes[i];
 
-
-static int get_x_symbol_count(const char * const movetext)
-{
-	int count = 0;
-
-	if (movetext) {
-		for (size_t i=0; i<strlen(movetext); i++) {
-			if (movetext[i] == 'x') {
-				count++;
-			}
+		if (san_lower(*text) != san_lower(*s->text) || !(n = san_prefix(text, s->text))) {
+			continue;
 		}
-	}
-
-	return count;
-}
-
-
-static bool move_has_valid_chars(const char * const movetext, struct move *move)
-{
-	const char charset[] = "KQBNRabcdefghx12345678";
-	size_t span = strspn(movetext, charset);
-
-	if (!movetext) {
-		return false;
-	}
-
-	if (strlen(movetext) != span) {
-		move->invalid = true;
-		dbg_print("Move: %s contains invalid character: '%c'\n",
-				move->movetext, movetext[span]);
-		return false;
-	}
-
-	/* each valid move should have only one moving piece */
-	if (get_moving_piece_count(movetext) > 1) {
-		move->invalid = true;
-		dbg_print("Invalid: Move has multiple moving pieces: %s\n",
-				move->movetext);
-		return false;
-	}
-
-	/* each valid move should make only one capture, if any */
-	if (get_x_symbol_count(movetext) > 1) {
-		move->invalid = true;
-		dbg_print("Invalid: Move has multiple captures: %s\n",
-				move->movetext);
-		return false;
-	}
-
-	return true;
-}
-
-
-static bool strip_char_from_string(char * const movetext, const char ch)
-{
-	char *match = NULL;
-
-	if (!movetext) {
-		return false;
-	}
-
-	match = strchr(movetext, ch);
-	if (match) {
-		size_t len = strlen(match);
-		if (!len) {
-			return false;
+		if (san_class[(unsigned char)s->text[0]] == SAN_FILE_WORD &&
+				san_class[(unsigned char)text[n]] == SAN_RANK) {
+			continue;
 		}
-
-		dbg_print("Stripping first [%c] from [%s]\n", ch, movetext);
-		memmove(match, match+1, len);
-		dbg_print("Stripped Movetext = %s\n", movetext);
-		return true;
+		*from = i;
+		*effect = s->effect;
+		return n;
 	}
 
-	return false;
-}
-
-
-static void strip_non_essential_symbols(char * const movetext)
-{
-	if (movetext) {
-		strip_char_from_string(movetext, 'P');
-		strip_char_from_string(movetext, '-');
-		//strip_char_from_string(movetext, 'O');
-	}
+	return 0;
 }
 
 
-/* UCI move format using from-to square notation, for example,
- * d3d7 or d3-d7 or d3xd7 are all equivalent moves */
-static bool is_uci_move_format(char * const movetext)
+/* Parse the suffixes at text + at for parse_move_suffix(). failed has the
+ * bit of every offset already known to leave unknown text behind, so that
+ * each offset is tried once and the search stays linear */
+static bool parse_suffix_at(const char *text, size_t at, struct move * const move, uint32_t * const failed)
 {
-	size_t len;
-	char *buf;
-	const char charset[] = "abcdefgh12345678";
+	const char *p = text + at;
+	enum san_effect effect;
+	struct move m;
+	size_t n;
 
-	if (!movetext) {
-		return false;
-	}
-
-	/* Since '-' symbol has been stripped earlier, we need to strip only
-	 * the symbol 'x', if present. Note that we are stripping the duplicate
-	 * move text instead of the original, so that the original is retained
-	 * unstripped, in case if this is not UCI format */
-	buf = strdup(movetext);
-	strip_char_from_string(buf, 'x');
-	len = strlen(buf);
-
-	/* note that the promoted piece, if any, has been
-	 * stripped earlier, so the max lenght is 4 only */
-	if ((len != 4) || (strspn(buf, charset) != len)) {
-		return false;
-	}
-
-	if ((islower(buf[0]) == 0) || (islower(buf[2]) == 0)) {
-		return false;
-	}
-
-	if ((isdigit(buf[1]) == 0) || (isdigit(buf[3]) == 0)) {
-		return false;
-	}
-
-	free(buf);
-	return true;
-}
-
-
-static void parse_stripped_uci_move(char *movetext, struct move *move)
-{
-	int8_t i = 0, *p[] = {
-		&move->from_file,
-		&move->from_rank,
-		&move->to_file,
-		&move->to_rank
-	};
-	size_t len = strlen(movetext);
-
-	if (len > 4) {
-		if (strip_char_from_string(movetext, 'x')) {
-			move->capture = true;
-		}
-		len = strlen(movetext);
-	}
-
-	if ((movetext) && (len == 4)) {
-		while (*movetext) {
-			if (i%2) {
-				*p[i] = get_rank_index(movetext[0]);
-			} else {
-				*p[i] = get_file_index(movetext[0]);
+	while (*p == ' ' || *p == '\t' || (*p == '$' && p[1] >= '0' && p[1] <= '9')) {
+		/* NAG like $1 */
+		if (*p == '$') {
+			for (p++; *p >= '0' && *p <= '9'; p++) {
+				;
 			}
-			movetext++;
-			i++;
-		}
-	}
-}
-
-
-/* parse 2 symbols of non-capture SAN move */
-static bool parse_2_sym_nc_san(const char *movetext, struct move * const move)
-{
-	if ((!movetext) || (!move)) {
-		return false;
-	} else {
-		if (strlen(movetext) != 2) {
-			return false;
-		}
-	}
-
-	if (islower(movetext[0])) {
-		move->chessman = PAWN;
-		move->to_file = get_file_index(movetext[0]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	if (isdigit(movetext[1])) {
-		move->to_rank = get_rank_index(movetext[1]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	return true;
-}
-
-
-/* parse 3 symbols of non-capture SAN move */
-static bool parse_3_sym_nc_san(const char *movetext, struct move * const move)
-{
-	if ((!movetext) || (!move)) {
-		return false;
-	} else {
-		if (strlen(movetext) != 3) {
-			return false;
-		}
-	}
-
-	if (isupper(movetext[0])) {
-		move->chessman = get_chessman(movetext[0]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	if (islower(movetext[1])) {
-		move->to_file = get_file_index(movetext[1]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	if (isdigit(movetext[2])) {
-		move->to_rank = get_rank_index(movetext[2]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	return true;
-}
-
-
-/* parse 4 symbols of non-capture SAN moves like Nbd7, Rae1, Rac8, Nge4, etc. */
-static bool parse_4_sym_nc_san(const char *movetext, struct move * const move)
-{
-	if ((!movetext) || (!move)) {
-		return false;
-	} else {
-		if (strlen(movetext) != 4) {
-			return false;
-		}
-	}
-
-	if (isupper(movetext[0])) {
-		move->chessman = get_chessman(movetext[0]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	if (islower(movetext[1])) {
-		move->from_file = get_file_index(movetext[1]);
-	} else {
-		if (isdigit(movetext[1])) {
-			move->from_rank = get_rank_index(movetext[1]);
 		} else {
-			move->invalid = true;
-			return false;
+			p++;
 		}
 	}
-
-	if (islower(movetext[2])) {
-		move->to_file = get_file_index(movetext[2]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	if (isdigit(movetext[3])) {
-		move->to_rank = get_rank_index(movetext[3]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	return true;
-}
-
-
-/* parse 5 symbols of non-capture SAN move like Qh4e1, etc. */
-static bool parse_5_sym_nc_san(const char *movetext, struct move * const move)
-{
-	if ((!movetext) || (!move)) {
-		return false;
-	} else {
-		if (strlen(movetext) != 5) {
-			return false;
-		}
-	}
-
-	if (isupper(movetext[0])) {
-		move->chessman = get_chessman(movetext[0]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	if (islower(movetext[1])) {
-		move->from_file = get_file_index(movetext[1]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	if (isdigit(movetext[2])) {
-		move->from_rank = get_rank_index(movetext[2]);
-	} else {
-		move->invalid = true;
-		return false;
-	}
-
-	if (islower(movetext[3])) {
-		move->to_file = get_file_index(movetext[3]);
-	} else {
-		move->invalid = true;
-		return false;
+	if (!*p) {
+		return true;
 	}
-
-	if (isdigit(movetext[4])) {
-		move->to_rank = get_rank_index(movetext[4]);
-	} else {
-		move->invalid = true;
+	at = (size_t)(p - text);
+	if (at < 32 && (*failed >> at & 1)) {
 		return false;
 	}
 
-	return true;
-}
-
-
-static void parse_non_capture_san_move(char *movetext, struct move *move)
-{
-	if (!parse_2_sym_nc_san(movetext, move)) {
-		if (!parse_3_sym_nc_san(movetext, move)) {
-			if (!parse_4_sym_nc_san(movetext, move)) {
-				parse_5_sym_nc_san(movetext, move);
-			}
+	for (size_t i = 0; (n = san_match_suffix(p, &i, &effect)); i++) {
+		m = *move;
+		switch (effect) {
+			case SAN_CHECK:	m.check = true; break;
+			case SAN_MATE:	m.checkmate = true; break;
+			case SAN_EP:	m.ep = true; break;
+			case SAN_DRAW:	m.draw_offered = true; break;
+			case SAN_NONE:
+			default:	break;
 		}
-	}
-}
-
-
-/* parse single length from-token of SAN capture moves
- * like bxa8, gxf5, Rxb7, Nxe5, Qxf7+, etc. */
-static bool parse_1_sym_from_token(const char *tok, struct move * const m)
-{
-	if ((!tok) || (!m)) {
-		return false;
-	} else {
-		if (strlen(tok) != 1) {
-			return false;
-		}
-	}
-
-	if (isupper(tok[0])) {
-		m->chessman = get_chessman(tok[0]);
-		return true;
-	} else {
-		if (islower(tok[0])) {
-			m->chessman = PAWN;
-			m->from_file = get_file_index(tok[0]);
+		if (parse_suffix_at(text, at + n, &m, failed)) {
+			*move = m;
 			return true;
-		} else {
-			m->invalid = true;
-			dbg_print("Illegal from-token: %c in move: %s\n",
-					tok[0], m->movetext);
-			return false;
 		}
 	}
 
+	if (at < 32) {
+		*failed |= 1U << at;
+	}
 	return false;
 }
 
 
-/* parse double length from-token of SAN capture moves
- * like Qgxf7, R7xd5, b4xc5, b7xa8Q, Rdxe5, etc. */
-static bool parse_2_sym_from_token(const char *tok, struct move * const m)
+/* Parse everything after the move itself. Returns false on unknown text.
+ * A suffix which leaves unknown text behind gives way to a shorter one,
+ * so that "++/-" is a check and "+/-", not a double check and "/-" */
+static bool parse_move_suffix(const char *p, struct move * const move)
 {
-	if ((!tok) || (!m)) {
-		return false;
-	} else {
-		if (strlen(tok) != 2) {
-			return false;
-		}
-	}
-
-	/* Parse and process first symbol */
-	if (isupper(tok[0])) {
-		m->chessman = get_chessman(tok[0]);
-	} else {
-		if (islower(tok[0])) {
-			m->chessman = PAWN;
-			m->from_file = get_file_index(tok[0]);
-		} else {
-			m->invalid = true;
-			dbg_print("Illegal from-token: %c in move: %s\n",
-					tok[0], m->movetext);
-			return false;
-		}
-	}
+	uint32_t failed = 0;
 
-	/* Parse and process second symbol */
-	if (isupper(tok[1])) {
-		m->invalid = true;
-		dbg_print("Illegal from-token: %c in move: %s\n",
-				tok[1], m->movetext);
-		return false;
-	} else {
-		if (islower(tok[1])) {
-			m->from_file = get_file_index(tok[1]);
-			return true;
-		} else {
-			if (isdigit(tok[1])) {
-				if (m->chessman == EMPTY) {
-					m->chessman = PAWN;
-				}
-				m->from_rank = get_rank_index(tok[1]);
-				return true;
-			} else {
-				m->invalid = true;
-				dbg_print("Illegal from-token: %c in move: %s\n",
-						tok[1], m->movetext);
-				return false;
-			}
-		}
-	}
+	return parse_suffix_at(p, 0, move, &failed);
 }
 
 
-/* parse triple length from-token of SAN capture moves like Qh4xe1, etc. */
-static bool parse_3_sym_from_token(const char *tok, struct move * const m)
+/* Castling as "O-O", "0-0" or "O-O-O". Returns the text after it, or NULL
+ * if the move is not castling */
+static const char *parse_castling(const char *p, struct move * const move)
 {
-	if ((!tok) || (!m)) {
-		return false;
-	} else {
-		if (strlen(tok) != 3) {
-			return false;
-		}
-	}
-
-	/* Parse and process first symbol */
-	if (isupper(tok[0])) {
-		m->chessman = get_chessman(tok[0]);
-	} else {
-		m->invalid = true;
-		dbg_print("Illegal from-token: %c in move: %s\n",
-				tok[0], m->movetext);
-		return false;
-	}
-
-	/* Parse and process second symbol */
-	if (islower(tok[1])) {
-		m->from_file = get_file_index(tok[1]);
-	} else {
-		m->invalid = true;
-		dbg_print("Illegal from-token: %c in move: %s\n",
-				tok[1], m->movetext);
-		return false;
-	}
-
-	/* Parse and process third symbol */
-	if (isdigit(tok[2])) {
-		m->from_rank = get_rank_index(tok[2]);
-	} else {
-		m->invalid = true;
-		dbg_print("Illegal from-token: %c in move: %s\n",
-				tok[2], m->movetext);
-		return false;
-	}
-
-	return true;
-}
-
+	int count = 0;
 
-/* Parse single length to-square token of SAN capture move */
-static bool parse_1_sym_to_sqr_tok(char * const tok, struct move * const m)
-{
-	if ((!tok) || (!m)) {
-		return false;
-	} else {
-		if (strlen(tok) != 1) {
-			return false;
+	while (*p == 'O' || *p == 'o' || *p == '0') {
+		p++;
+		if (++count == 3 || *p != '-' || (p[1] != 'O' && p[1] != 'o' && p[1] != '0')) {
+			break;
 		}
+		p++;
 	}
 
-	if (islower(tok[0])) {
-		m->to_file = get_file_index(tok[0]);
-		return true;
-	} else {
-		m->invalid = true;
-		dbg_print("Illegal to-square token: %c in move: %s\n",
-				tok[0], m->movetext);
-		return false;
+	if (count < 2) {
+		return NULL;
 	}
+
+	move->chessman = KING;
+	move->castle_ks = count == 2;
+	move->castle_qs = count == 3;
+	return p;
 }
 
 
-/* Parse double length to-square token of SAN capture move */
-static bool parse_2_sym_to_sqr_tok(char * const tok, struct move * const m)
+/* Promoted piece of a promotion letter like 'Q' or 'q', EMPTY if none */
+static enum chessmen san_promo_piece(const char c)
 {
-	char *sym = NULL;
-
-	if ((!tok) || (!m)) {
-		return false;
-	} else {
-		if (strlen(tok) != 2) {
-			return false;
-		}
-	}
-
-#ifdef HAVE_STRNDUP
-	sym = strndup(tok, 1);
-#elif defined HAVE_STRDUP
-	sym = strdup(tok);
-#endif
-
-	if (sym) {
-		sym[1] = '\0';
-	} else {
-		perror("str[n]dup failed");
-		return false;
-	}
-
-	if (parse_1_sym_to_sqr_tok(sym, m)) {
-		if (isdigit(tok[1])) {
-			m->to_rank = get_rank_index(tok[1]);
-			return true;
-		} else {
-			m->invalid = true;
-			dbg_print("Illegal to-square token: %c in move: %s\n",
-					tok[1], m->movetext);
-		}
+	switch (c) {
+		case 'Q': case 'q': return QUEEN;
+		case 'R': case 'r': return ROOK;
+		case 'B': case 'b': return BISHOP;
+		case 'N': case 'n': return KNIGHT;
+		default:  return EMPTY;
 	}
-
-	free(sym);
-	return false;
 }
 
 
-static bool parse_san_capture_move(char * const movetext, struct move *move)
+/* Parse piece, squares, capture and promotion of SAN and UCI moves. Returns
+ * the text after them, or NULL if the move is invalid */
+static const char *parse_move_body(const char *text, struct move * const move)
 {
-	char *saveptr, *token;
-
-	/* Step 1: find if it's a capture move, if yes, then seperate the
-	 * move into from-square and to-square tokens, then process each
-	 * token seperately */
-	if ((!movetext) || (!move)) {
-		return false;
-	}
-
-	token = strtok_r(movetext, "x", &saveptr);
+	const unsigned char *p = (const unsigned char *)text;
+	int8_t sym[4];		// files and ranks in order of appearance
+	bool rank[4];		// is the symbol a rank
+	int n = 0, captures = 0;
+	enum san_effect effect;
+	size_t from = 0;
+	bool more = true;
 
-	if (!token) {
-		return false;
+	if (san_class[*p] == SAN_PIECE) {
+		move->chessman = get_chessman((char)*p++);
 	}
 
-	if (!parse_1_sym_from_token(token, move)) {
-		if (!parse_2_sym_from_token(token, move)) {
-			if (!parse_3_sym_from_token(token, move)) {
-				dbg_print("Invalid from-token: %s in move: %s\n",
-						token, move->movetext);
-				return false;
-			}
-		}
-	}
+	while (more) {
+		switch (san_class[*p]) {
+			case SAN_FILE_WORD:
+				/* only look for "ch", "dis. ch.", "dbl. ch."
+				 * and "e.p." if the next letter can be theirs */
+				if ((p[1] == 'h' || p[1] == 'i' || p[1] == 'b' || p[1] == 'p' || p[1] == '.') &&
+						san_match_suffix((const char *)p, &from, &effect)) {
+					more = false;
+					break;
+				}
+				/* fall through */
+			case SAN_FILE:
+				/* lowercase 'b' after a square is the bishop of
+				 * UCI promotion, unless it is a file as in a7b8 */
+				if (*p == 'b' && n >= 2 && rank[n - 1] && san_class[p[1]] != SAN_RANK) {
+					move->promoted = BISHOP;
+					p++;
+					more = false;
+				} else if (n == 4) {
+					return NULL;
+				} else {
+					sym[n] = (int8_t)(*p++ - 'a');
+					rank[n++] = false;
+				}
+				break;
 
-	token = strtok_r(NULL, "x", &saveptr);
+			case SAN_RANK:
+				if (n == 4) {
+					return NULL;
+				}
+				sym[n] = (int8_t)(*p++ - '1');
+				rank[n++] = true;
+				break;
 
-	if (!token) {
-		move->invalid = true;
-		return false;
-	} else {
-		move->capture = true;
-	}
+			case SAN_CAPTURE:
+				if (captures++) {
+					return NULL;
+				}
+				p++;
+				break;
 
-	if (!parse_2_sym_to_sqr_tok(token, move)) {
-		if (!parse_1_sym_to_sqr_tok(token, move)) {
-			dbg_print("Invalid to-token: %s in move: %s\n",
-					token, move->movetext);
-			return false;
-		}
-	}
+			case SAN_SEP:
+				p++;
+				break;
 
-	return true;
-}
+			case SAN_PIECE:
+			case SAN_UCI_PROMO:
+				/* a piece after the to-square is the promoted
+				 * one, as in e8Q or e7e8q, otherwise it is an
+				 * error like NBf3 */
+				if (!n || !rank[n - 1] || (move->promoted = san_promo_piece((char)*p)) == EMPTY) {
+					return san_class[*p] == SAN_PIECE ? NULL : (const char *)p;
+				}
+				p++;
+				more = false;
+				break;
 
+			case SAN_PROMO:
+				/* e8=Q, e8/Q and e8(Q), but not annotations
+				 * like (=) or (?) */
+				if (n && rank[n - 1] && san_promo_piece((char)p[1]) != EMPTY) {
+					move->promoted = san_promo_piece((char)p[1]);
+					p += p[0] == '(' && p[2] == ')' ? 3 : 2;
+				}
+				more = false;
+				break;
 
-static void parse_stripped_san_move(char *movetext, struct move *move)
-{
-	if (movetext) {
-		if (strchr(movetext, 'x')) {
-			parse_san_capture_move(movetext, move);
-		} else {
-			parse_non_capture_san_move(movetext, move);
+			case SAN_OTHER:
+			default:
+				more = false;
+				break;
 		}
 	}
-}
-
-
-static void strip_annotations(char * const movetext, struct move * const move)
-{
-	if (movetext) {
-		/* Step 2: first get rid of annotations at the end */
-		strip_evaluation_annotation_symbols(movetext);
-		strip_eq_pos_annotation(movetext);
-		strip_eog_indicators(movetext);
-
-		/* Step 2.5: check if player has offered draw */
-		strip_draw_offered_flag(movetext, move);
-
-		/* Step 3: strip check and checkmate suffix indicators */
-		strip_check_indicators(movetext, move);
-		strip_checkmate_indicators(movetext, move);
-	}
-}
-
 
-/* TODO: Check for UCI castling moves (e1g1) */
-static bool is_castling_move(char * const movetext, struct move * const move)
-{
-	/* Step 3.5: check for castling move */
-	if (!movetext) {
-		return false;
+	/* the last file and rank make the to-square, anything before them
+	 * disambiguates the from-square */
+	if (n < 2 || rank[n - 2] || !rank[n - 1]) {
+		return NULL;
 	}
+	move->to_file = sym[n - 2];
+	move->to_rank = sym[n - 1];
 
-	dbg_print("movetext = %s\n", movetext);
-
-	if (is_qs_castling_seq(movetext, move) ||
-			is_ks_castling_seq(movetext, move))
-	{
-		dbg_print("movetext = %s\n", movetext);
-		if (strlen(movetext)) {
-			move->invalid = true;
-			dbg_print("Invalid chars in castling move: %s\n",
-					move->movetext);
-		}
-		return true;
-	} else {
-		return false;
+	switch (n) {
+		case 4:
+			if (rank[0] || !rank[1]) {
+				return NULL;
+			}
+			move->from_file = sym[0];
+			move->from_rank = sym[1];
+			break;
+		case 3:
+			if (rank[0]) {
+				move->from_rank = sym[0];
+			} else {
+				move->from_file = sym[0];
+			}
+			break;
+		default:
+			break;
 	}
-}
 
-
-static bool is_special_move(char * const movetext, struct move * const move)
-{
-	if (movetext) {
-		if (is_castling_move(movetext, move)) {
-			return true;
-		} else {
-			if (is_pawn_promotion(movetext, move) ||
-					strip_ep_suffix(movetext, move)) {
-				if (is_pawn_move(movetext, move)) {
-					return true;
-				}
-			}
+	/* without a piece letter it is a pawn move, except for UCI moves
+	 * which give the from-square and fit any piece. Pawn captures
+	 * name the file the pawn comes from */
+	if (move->chessman == EMPTY && n < 4) {
+		if (captures && n == 2) {
+			return NULL;
 		}
+		move->chessman = PAWN;
 	}
-
-	return false;
+	move->capture = captures > 0;
+	return (const char *)p;
 }
 
 
-static bool extra_checks_for_legality(const char * const movetext, struct move *move)
-{
-	/* The king cannot give check to another king i.e. it's not
-	 * possible to give check or checkmate with a king's move */
-
-	/* The promoted piece cannot be a pawn or a king */
-
-	/* The bishop cannot move to the same file or rank, for example,
-	 * the bishop on 'd' file cannot move to any squares on the 'd'
-	 * file. Similarly, the bishop on rank '6' cannot move to any
-	 * squares present on the same rank. */
-
-	/* The rook can move either in it's own file or in it's own rank */
-	return true;
-}
-
-/* clean up the move string. This gets rid of any extra
- * annotations and things like 'x', '+', '=' and so forth. */
-static bool clean_move(char * const movetext, struct move *move)
+static bool parse_null_move(const char *p, struct move * const move)
 {
+	const size_t count = sizeof(san_null_moves) / sizeof(san_null_moves[0]);
+	size_t n;
 
-	/* Step 1: check for null move */
-	if (is_null_move(movetext, move)) {
-		return true;
-	}
-	dbg_print("After is_null_move(): movetext = %s\n", movetext);
-
-	strip_annotations(movetext, move);
-	dbg_print("After strip_annotations(): movetext = %s\n", movetext);
-
-	if (is_special_move(movetext, move)) {
-		if (move->invalid) {
+	for (size_t i = 0; i < count; i++) {
+		if ((n = san_prefix(p, san_null_moves[i])) && parse_move_suffix(p + n, move)) {
+			move->null = true;
 			return true;
 		}
 	}
-	dbg_print("After is_special_move(): movetext = %s\n", movetext);
-
-	/* Step 5.5: Now, since all annnotations are stripped
-	 * check that move text contains only valid chars */
-	strip_non_essential_symbols(movetext);
-	if (!move_has_valid_chars(movetext, move)) {
-		dbg_print("movetext = %s\n", movetext);
-		return true;
-	}
-	dbg_print("After move_has_valid_chars(): movetext = %s\n", movetext);
 
 	return false;
 }
@@ -1353,39 +737,47 @@ static bool clean_move(char * const movetext, struct move *move)
  * to the longer UCI notation "b2c3". The function handles both the short and
  * long notation formats interchangeably.
  */
-struct move parse_input_move(char * const movetext)
+struct move parse_input_move(const char * const movetext)
 {
 	struct move move;
+	const char *p;
 
-	/* Step 0: setup move struct */
 	if (movetext == NULL) {
 		dbg_print("Invalid: Move string is empty");
 		setup_move_struct("", &move);
 		move.invalid = true;
 		return move;
-	} else {
-		setup_move_struct(movetext, &move);
 	}
 
-	if (clean_move(movetext, &move)) {
+	setup_move_struct(movetext, &move);
+
+	/* no move is this long, and the text would not fit in the struct */
+	if (strlen(movetext) >= MAX_MOVE_LEN) {
+		move.invalid = true;
 		return move;
 	}
 
-	/* Step 6: check for UCI from/to square move format */
-	if (is_uci_move_format(movetext)) {
-		/* Step 7: parse UCI move */
-		dbg_print("movetext = %s\n", movetext);
-		parse_stripped_uci_move(movetext, &move);
-	} else {
-		/* Step 8: parse SAN move */
-		dbg_print("movetext = %s\n", movetext);
-		parse_stripped_san_move(movetext, &move);
+	if (!(p = parse_castling(movetext, &move))) {
+		p = parse_move_body(movetext, &move);
 	}
 
-	if (extra_checks_for_legality(movetext, &move)) {
-		move.invalid = true;
+	if (!p || !parse_move_suffix(p, &move)) {
+		setup_move_struct(movetext, &move);
+		if (!parse_null_move(movetext, &move)) {
+			move.invalid = true;
+			dbg_print("Invalid move: %s\n", movetext);
+		}
+		return move;
+	}
+
+	/* only pawns promote or capture en-passant */
+	if (move.promoted != EMPTY || move.ep) {
+		if (move.chessman == EMPTY) {
+			move.chessman = PAWN;
+		} else if (move.chessman != PAWN) {
+			move.invalid = true;
+		}
 	}
 
 	return move;
 }
-
@@ -0,0 +1,20 @@
+/* @file:	tezdhar/src/parse_legacy.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/parse_legacy.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Reference move parser for the differential check of the
+ * 		move parser, see parse_legacy.c and "tezdhar-pgn -d".
+ */
+
+#ifndef __PARSE_LEGACY_H__
+#define __PARSE_LEGACY_H__	1
+
+#include "chess.h"
+
+
+/* Function prototypes */
+struct move parse_legacy_move(char * const movetext);
+
+
+#endif	/* __PARSE_LEGACY_H__ */
@@ -0,0 +1,240 @@
+/* @file:	tezdhar/src/pattern.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/pattern.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Compile position patterns and match positions against them.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "bitboard.h"
+#include "pattern.h"
+
+#include <stdio.h>	// for fprintf
+#include <stdlib.h>	// for strtoull
+#include <string.h>	// for memset, strchr, strcspn, strncmp, strspn
+
+#define PATTERN_MAX_COUNT	64
+
+static const char pattern_letters[] = ".rnbqkpRNBQKP";	// indexed by enum pieces
+
+
+/* The 13 bitboards of a position, indexed by enum pieces */
+static void pattern_bitboards(const struct bitboards *bb, uint64_t *out)
+{
+	out[BLACK_ROOK] = bb->bRook;
+	out[BLACK_KNIGHT] = bb->bKnight;
+	out[BLACK_BISHOP] = bb->bBishop;
+	out[BLACK_QUEEN] = bb->bQueen;
+	out[BLACK_KING] = bb->bKing;
+	out[BLACK_PAWN] = bb->bPawn;
+	out[WHITE_ROOK] = bb->wRook;
+	out[WHITE_KNIGHT] = bb->wKnight;
+	out[WHITE_BISHOP] = bb->wBishop;
+	out[WHITE_QUEEN] = bb->wQueen;
+	out[WHITE_KING] = bb->wKing;
+	out[WHITE_PAWN] = bb->wPawn;
+	out[EMPTY_SQR] = ~(bb->wKing | bb->wQueen | bb->wRook | bb->wBishop | bb->wKnight | bb->wPawn |
+			bb->bKing | bb->bQueen | bb->bRook | bb->bBishop | bb->bKnight | bb->bPawn);
+}
+
+
+/* Parse a comma separated list of squares, files, ranks and hexadecimal
+ * bitboards ending at end */
+static bool pattern_squares(const char *p, const char *end, uint64_t *squares)
+{
+	char *next;
+
+	*squares = 0;
+	while (p < end) {
+		if (p[0] == '0' && p[1] == 'x') {
+			*squares |= strtoull(p, &next, 16);
+			p = next;
+		} else if (*p >= 'a' && *p <= 'h' && p[1] >= '1' && p[1] <= '8') {
+			*squares |= BIT((p[1] - '1') * 8 + (*p - 'a'));
+			p += 2;
+		} else if (*p >= 'a' && *p <= 'h') {
+			*squares |= 0x0101010101010101ULL << (*p - 'a');
+			p++;
+		} else if (*p >= '1' && *p <= '8') {
+			*squares |= 0xffULL << ((*p - '1') * 8);
+			p++;
+		} else {
+			return false;
+		}
+
+		if (p < end && *p++ != ',') {
+			return false;
+		}
+	}
+	return p == end && *squares;
+}
+
+
+/* Parse a count range like "=1" or ">=6" */
+static bool pattern_count(const char *p, const char *end, uint8_t *min, uint8_t *max)
+{
+	const size_t op = strspn(p, "=<>");
+	char *next;
+	unsigned long long n;
+
+	if (!op || op > 2 || p[op] < '0' || p[op] > '9') {
+		return false;
+	}
+	n = strtoull(p + op, &next, 10);
+	if (next != end || n > PATTERN_MAX_COUNT) {
+		return false;
+	}
+
+	if (op == 1 && *p == '=') {
+		*min = *max = (uint8_t)n;
+	} else if (op == 2 && !strncmp(p, ">=", 2)) {
+		*min = (uint8_t)n;
+	} else if (op == 2 && !strncmp(p, "<=", 2)) {
+		*max = (uint8_t)n;
+	} else if (op == 1 && *p == '>' && n < PATTERN_MAX_COUNT) {
+		*min = (uint8_t)(n + 1);
+	} else if (op == 1 && *p == '<' && n > 0) {
+		*max = (uint8_t)(n - 1);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+
+/* Compile the terms of a pattern, see pattern.h */
+bool pattern_parse(struct pattern *pt, const char *text)
+{
+	const char *p = text, *term, *end, *letter;
+	bool negate;
+	uint64_t squares;
+	int piece;
+
+	memset(pt, 0, sizeof(*pt));
+	memset(pt->max, PATTERN_MAX_COUNT, sizeof(pt->max));
+	pt->side = -1;
+
+	for (;; p = end) {
+		p += strspn(p, " \t");
+		if (!*p) {
+			break;
+		}
+		term = p;
+		end = p + strcspn(p, " \t");
+
+		if (end - p == 1 && (*p == 'w' || *p == 'b')) {
+			pt->side = *p == 'w' ? WHITE : BLACK;
+			continue;
+		}
+		if (end - p == 5 && !strncmp(p, "check", 5)) {
+			pt->check = true;
+			continue;
+		}
+
+		negate = *p == '!';
+		letter = p[negate] ? strchr(pattern_letters, p[negate]) : NULL;
+		if (!letter || end - p < negate + 2) {
+			goto invalid;
+		}
+		piece = (int)(letter - pattern_letters);
+		p += negate + 1;
+
+		if (*p == '@') {
+			if (!pattern_squares(p + 1, end, &squares)) {
+				goto invalid;
+			}
+			if (negate) {
+				pt->none[piece] |= squares;
+			} else if (pt->nany < PATTERN_MAX_TERMS) {
+				pt->any[pt->nany].squares = squares;
+				pt->any[pt->nany++].piece = (uint8_t)piece;
+			} else {
+				fprintf(stderr, "Too many terms in pattern: %s\n", text);
+				return false;
+			}
+		} else if (negate || !pattern_count(p, end, &pt->min[piece], &pt->max[piece])) {
+			goto invalid;
+		} else {
+			pt->counts = true;
+		}
+	}
+	return true;
+
+invalid:
+	fprintf(stderr, "Invalid pattern term: %.*s\n", (int)(end - term), term);
+	return false;
+}
+
+
+/* Does a position match a pattern. The piece counts are tested first as
+ * they reject most positions of most games */
+bool pattern_match(const struct pattern *pt, const struct board *brd)
+{
+	uint64_t bb[PATTERN_PIECES];
+
+	if (pt->side >= 0 && (int)brd->turn != pt->side) {
+		return false;
+	}
+
+	pattern_bitboards(&brd->bb, bb);
+	if (pt->counts) {
+		for (int p = 0; p < PATTERN_PIECES; p++) {
+			const int n = BITS(bb[p]);
+
+			if (n < pt->min[p] || n > pt->max[p]) {
+				return false;
+			}
+		}
+	}
+
+	for (int p = 0; p < PATTERN_PIECES; p++) {
+		if (bb[p] & pt->none[p]) {
+			return false;
+		}
+	}
+	for (int i = 0; i < pt->nany; i++) {
+		if (!(bb[pt->any[i].piece] & pt->any[i].squares)) {
+			return false;
+		}
+	}
+
+	return !pt->check || in_check(brd, brd->turn);
+}
+
+
+/* Can no later position of the game match the counts of the pattern.
+ * Material is only lost, except that a pawn may become another piece, so
+ * a piece can not come back once it and its pawns are fewer than needed,
+ * and empty squares can not become fewer */
+bool pattern_exhausted(const struct pattern *pt, const struct board *brd)
+{
+	uint64_t bb[PATTERN_PIECES];
+	int n;
+
+	if (!pt->counts) {
+		return false;
+	}
+
+	pattern_bitboards(&brd->bb, bb);
+	if (BITS(bb[EMPTY_SQR]) > pt->max[EMPTY_SQR]) {
+		return true;
+	}
+	for (int p = BLACK_ROOK; p <= WHITE_PAWN; p++) {
+		if (!pt->min[p]) {
+			continue;
+		}
+		n = BITS(bb[p]);
+		if (piece_type((enum pieces)p) != PAWN && piece_type((enum pieces)p) != KING) {
+			n += BITS(bb[make_piece(PAWN, piece_color((enum pieces)p))]);
+		}
+		if (n < pt->min[p]) {
+			return true;
+		}
+	}
+	return false;
+}
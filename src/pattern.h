@@ -0,0 +1,65 @@
+/* @file:	tezdhar/src/pattern.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/pattern.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Position patterns made of bitboard predicates, for searching
+ * 		game databases.
+ *
+ *
+ *			--------------
+ *			Pattern Syntax
+ *			--------------
+ *
+ * A pattern is a list of terms separated by spaces, all of which must hold.
+ * A piece is a FEN letter, or '.' for an empty square:
+ *
+ *	P@d4		a white pawn on d4
+ *	n@c6,d7,f6	a black knight on at least one of the squares
+ *	P@d		a white pawn on the d-file, a rank is given by its digit
+ *	!P@c,e		no white pawn on the c or e-file
+ *	p@0x00ff...	a black pawn on a square of a hexadecimal bitboard
+ *	Q=1 q>=1	counts of a piece, with = < <= > >=
+ *	w b		side to move
+ *	check		side to move is in check
+ *
+ * So "P@d !P@c,e Q=1 q=1" finds positions where white has an isolated
+ * queen pawn with queens on the board. The terms are compiled to a mask of
+ * forbidden squares and a count range per piece and a short list of square
+ * sets which need a piece, and are tested from the cheapest to the most
+ * expensive.
+ */
+
+#ifndef __PATTERN_H__
+#define __PATTERN_H__	1
+
+#include "chess.h"
+
+#define PATTERN_PIECES		13		// enum pieces, EMPTY_SQR is '.'
+#define PATTERN_MAX_TERMS	32		// square sets which need a piece
+
+/* A square set which needs the piece on one of its squares */
+struct pattern_term {
+	uint64_t squares;
+	uint8_t piece;				// enum pieces
+};
+
+struct pattern {
+	uint64_t none[PATTERN_PIECES];		// squares which must not hold the piece
+	uint8_t min[PATTERN_PIECES];		// count range of each piece
+	uint8_t max[PATTERN_PIECES];
+	struct pattern_term any[PATTERN_MAX_TERMS];
+	int nany;
+	int side;				// enum color, -1 for either
+	bool check;
+	bool counts;				// any count range is narrower than 0..64
+};
+
+
+/* Function prototypes */
+bool pattern_parse(struct pattern *pt, const char *text);
+bool pattern_match(const struct pattern *pt, const struct board *brd);
+bool pattern_exhausted(const struct pattern *pt, const struct board *brd);
+
+
+#endif	/* __PATTERN_H__ */
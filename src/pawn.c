@@ -10,10 +10,6 @@
 #include "chess.h"
 #include "bitboard.h"
 
-/* pawn attacks lookup table for white and black pawns */
-static uint_fast64_t pawn_attacks_lut[2][64];
-
-
 static uint64_t mask_pawn_attacks(const enum color turn, const enum square sq)
 {
 	const uint64_t bb = BIT(sq);	// current pawn bitboard
@@ -28,19 +24,19 @@ static uint64_t mask_pawn_attacks(const enum color turn, const enum square sq)
 void init_pawn_attacks(void)
 {
 	for (enum square sq = A1; sq <= H8; sq++) {
-		pawn_attacks_lut[WHITE][sq] = mask_pawn_attacks(WHITE, sq);
-		pawn_attacks_lut[BLACK][sq] = mask_pawn_attacks(BLACK, sq);
+		attack_tables->pawn[WHITE][sq] = mask_pawn_attacks(WHITE, sq);
+		attack_tables->pawn[BLACK][sq] = mask_pawn_attacks(BLACK, sq);
 #ifdef DEBUG
 		//printf("\nAttack map for white pawn at [%s]", sqr_to_coords[sq]);
-		//print_bitboard(pawn_attacks_lut[WHITE][sq]);
+		//print_bitboard(attack_tables->pawn[WHITE][sq]);
 		//printf("\nAttack map for black pawn at [%s]", sqr_to_coords[sq]);
-		//print_bitboard(pawn_attacks_lut[BLACK][sq]);
+		//print_bitboard(attack_tables->pawn[BLACK][sq]);
 #endif
 	}
 }
 
 uint64_t get_pawn_attacks(const enum color turn, const enum square sq)
 {
-	return pawn_attacks_lut[turn][sq];
+	return attack_tables->pawn[turn][sq];
 }
 
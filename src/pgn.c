@@ -0,0 +1,414 @@
+/* @file:	tezdhar/src/pgn.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/pgn.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Zero-copy PGN reader. Files are mapped with mmap(), and games,
+ * 		tags and movetext tokens are returned as spans into the map.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "pgn.h"
+
+#include <stdio.h>	// for perror
+#include <stdlib.h>	// for malloc, free
+#include <string.h>	// for memchr, memcmp, memset
+
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>	// for open
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for close, read
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>	// for fstat
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>	// for mmap, madvise
+#endif
+
+
+/* Characters ending a move token */
+static bool pgn_is_delim(const char c)
+{
+	switch (c) {
+		case ' ': case '\t': case '\r': case '\n':
+		case '{': case '}': case '(': case ')': case ';': case '$':
+			return true;
+		default:
+			return false;
+	}
+}
+
+
+static bool pgn_is_digit(const char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+
+/* Map a PGN file into memory. Without mmap() the file is read instead */
+bool pgn_open(struct pgn_file *f, const char *path)
+{
+	struct stat st;
+	void *map;
+	int fd;
+
+	memset(f, 0, sizeof(*f));
+	if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st)) {
+		perror(path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+
+	f->size = (size_t)st.st_size;
+	if (!f->size) {
+		close(fd);
+		return true;
+	}
+
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	map = mmap(NULL, f->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror("mmap failed");
+		return false;
+	}
+#ifdef HAVE_MADVISE
+	/* games are read front to back, so let the kernel read ahead */
+	madvise(map, f->size, MADV_SEQUENTIAL);
+#endif
+	f->mapped = true;
+#else
+	if ((map = malloc(f->size))) {
+		size_t done = 0;
+		ssize_t n;
+
+		while (done < f->size && (n = read(fd, (char *)map + done, f->size - done)) > 0) {
+			done += (size_t)n;
+		}
+		if (done < f->size) {
+			perror(path);
+			free(map);
+			map = NULL;
+		}
+	} else {
+		perror("malloc failed");
+	}
+	close(fd);
+	if (!map) {
+		return false;
+	}
+#endif
+
+	f->map = map;
+	return true;
+}
+
+
+void pgn_close(struct pgn_file *f)
+{
+	if (f->map) {
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+		if (f->mapped) {
+			munmap((void *)(uintptr_t)f->map, f->size);
+		}
+#else
+		free((void *)(uintptr_t)f->map);
+#endif
+	}
+	memset(f, 0, sizeof(*f));
+}
+
+
+/* Does the game start at p, the beginning of a line. It does if the line
+ * is a tag and the previous line is not */
+static bool pgn_is_game_start(const char *base, const char *p, const char *end)
+{
+	const char *prev;
+
+	if (p >= end || *p != '[') {
+		return false;
+	}
+	if (p == base) {
+		return true;
+	}
+
+	/* p[-1] is the newline ending the previous line */
+	for (prev = p - 1; prev > base && prev[-1] != '\n'; prev--) {
+		;
+	}
+	return *prev != '[';
+}
+
+
+/* First game starting at or after p */
+static const char *pgn_find_game(const char *base, const char *p, const char *end)
+{
+	if (p > base && p < end && p[-1] != '\n') {
+		p = memchr(p, '\n', (size_t)(end - p));
+		p = p ? p + 1 : end;
+	}
+
+	while (p < end && !pgn_is_game_start(base, p, end)) {
+		p = memchr(p, '\n', (size_t)(end - p));
+		p = p ? p + 1 : end;
+	}
+
+	return p;
+}
+
+
+/* End of a game whose movetext starts at p. Comments are honoured only in
+ * full mode, headers mode just looks for the next tag line */
+static const char *pgn_game_end(const char *base, const char *p, const char *end, const enum pgn_mode mode)
+{
+	bool line_start = true;
+
+	if (mode == PGN_HEADERS) {
+		return pgn_find_game(base, p, end);
+	}
+
+	for (; p < end; p++) {
+		if (line_start && pgn_is_game_start(base, p, end)) {
+			return p;
+		}
+		line_start = false;
+
+		switch (*p) {
+			case '\n':
+				line_start = true;
+				break;
+			case '{':
+				p = memchr(p, '}', (size_t)(end - p));
+				if (!p) {
+					return end;
+				}
+				break;
+			case ';':
+				p = memchr(p, '\n', (size_t)(end - p));
+				if (!p) {
+					return end;
+				}
+				line_start = true;
+				break;
+			default:
+				break;
+		}
+	}
+
+	return end;
+}
+
+
+/* Read the games which start in [begin, end) of a file. The last game is
+ * read completely even if it runs past end */
+void pgn_reader_init(struct pgn_reader *r, const struct pgn_file *f, const uint64_t begin,
+		const uint64_t end, const enum pgn_mode mode)
+{
+	r->base = f->map;
+	r->end = f->map + f->size;
+	r->limit = f->map + (end < f->size ? end : f->size);
+	r->pos = pgn_find_game(r->base, f->map + (begin < f->size ? begin : f->size), r->end);
+	r->mode = mode;
+}
+
+
+/* Split a tag line like [White "Tal, Mikhail"] into name and value */
+static void pgn_parse_tag(const char *p, const char *eol, struct pgn_tag *tag)
+{
+	const char *q;
+
+	for (q = ++p; q < eol && *q != ' ' && *q != '\t' && *q != '"' && *q != ']'; q++) {
+		;
+	}
+	tag->name.ptr = p;
+	tag->name.len = (size_t)(q - p);
+
+	while (q < eol && *q != '"') {
+		q++;
+	}
+	p = q < eol ? q + 1 : eol;
+	for (q = p; q < eol && *q != '"'; q++) {
+		if (*q == '\\' && q + 1 < eol) {
+			q++;
+		}
+	}
+	tag->value.ptr = p;
+	tag->value.len = (size_t)(q - p);
+}
+
+
+/* Read the next game, false if there is none left */
+bool pgn_next_game(struct pgn_reader *r, struct pgn_game *g)
+{
+	const char *p = r->pos, *eol, *end;
+
+	if (p >= r->limit || p >= r->end) {
+		return false;
+	}
+
+	g->text.ptr = p;
+	g->offset = (uint64_t)(p - r->base);
+	g->ntags = 0;
+
+	/* tag pair section */
+	while (p < r->end && *p == '[') {
+		eol = memchr(p, '\n', (size_t)(r->end - p));
+		eol = eol ? eol : r->end;
+		if (g->ntags < PGN_MAX_TAGS) {
+			pgn_parse_tag(p, eol, &g->tags[g->ntags++]);
+		}
+		p = eol < r->end ? eol + 1 : eol;
+	}
+
+	end = pgn_game_end(r->base, p, r->end, r->mode);
+
+	g->movetext.ptr = p;
+	g->movetext.len = r->mode == PGN_FULL ? (size_t)(end - p) : 0;
+	g->text.len = (size_t)(end - g->text.ptr);
+	r->pos = end;
+	return true;
+}
+
+
+/* Value of a tag, NULL if the game does not have it */
+const struct pgn_span *pgn_tag(const struct pgn_game *g, const char *name)
+{
+	for (int i = 0; i < g->ntags; i++) {
+		if (pgn_span_eq(&g->tags[i].name, name)) {
+			return &g->tags[i].value;
+		}
+	}
+
+	return NULL;
+}
+
+
+bool pgn_span_eq(const struct pgn_span *s, const char *str)
+{
+	const size_t len = strlen(str);
+
+	return s && s->len == len && !memcmp(s->ptr, str, len);
+}
+
+
+/* Copy span into a Null terminated buffer, resolving \" and \\ escapes.
+ * Returns the length copied, which is truncated to fit the buffer */
+size_t pgn_span_copy(const struct pgn_span *s, char *buf, const size_t len)
+{
+	size_t n = 0;
+
+	if (!len) {
+		return 0;
+	}
+
+	for (size_t i = 0; s && i < s->len && n + 1 < len; i++) {
+		if (s->ptr[i] == '\\' && i + 1 < s->len) {
+			i++;
+		}
+		buf[n++] = s->ptr[i];
+	}
+	buf[n] = '\0';
+	return n;
+}
+
+
+void pgn_lexer_init(struct pgn_lexer *lx, const struct pgn_span *movetext)
+{
+	lx->pos = movetext->ptr;
+	lx->end = movetext->ptr + movetext->len;
+}
+
+
+static enum pgn_token_type pgn_token(struct pgn_lexer *lx, struct pgn_token *tok,
+		const enum pgn_token_type type, const char *begin, const char *end, const char *next)
+{
+	tok->type = type;
+	tok->text.ptr = begin;
+	tok->text.len = (size_t)(end - begin);
+	lx->pos = next;
+	return type;
+}
+
+
+/* Read the next token of a movetext */
+enum pgn_token_type pgn_next_token(struct pgn_lexer *lx, struct pgn_token *tok)
+{
+	const char *p = lx->pos, *end = lx->end, *q;
+
+	for (;;) {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+			p++;
+		}
+		if (p >= end) {
+			return pgn_token(lx, tok, PGN_TOKEN_END, end, end, end);
+		}
+
+		/* escape lines starting with '%' are ignored */
+		if (*p == '%' && (p == lx->pos || p[-1] == '\n')) {
+			q = memchr(p, '\n', (size_t)(end - p));
+			p = q ? q : end;
+			continue;
+		}
+		break;
+	}
+
+	switch (*p) {
+		case '{':
+			q = memchr(p, '}', (size_t)(end - p));
+			return pgn_token(lx, tok, PGN_TOKEN_COMMENT, p + 1, q ? q : end, q ? q + 1 : end);
+		case ';':
+			q = memchr(p, '\n', (size_t)(end - p));
+			return pgn_token(lx, tok, PGN_TOKEN_COMMENT, p + 1, q ? q : end, q ? q : end);
+		case '(':
+			return pgn_token(lx, tok, PGN_TOKEN_OPEN, p, p + 1, p + 1);
+		case ')':
+			return pgn_token(lx, tok, PGN_TOKEN_CLOSE, p, p + 1, p + 1);
+		case '*':
+			return pgn_token(lx, tok, PGN_TOKEN_RESULT, p, p + 1, p + 1);
+		case '$':
+			for (q = p + 1; q < end && pgn_is_digit(*q); q++) {
+				;
+			}
+			return pgn_token(lx, tok, PGN_TOKEN_NAG, p, q, q);
+		default:
+			break;
+	}
+
+	for (q = p; q < end && !pgn_is_delim(*q); q++) {
+		;
+	}
+
+	if (pgn_is_digit(*p)) {
+		const size_t len = (size_t)(q - p);
+		const char *d = p;
+
+		if ((len == 3 && (!memcmp(p, "1-0", 3) || !memcmp(p, "0-1", 3))) ||
+				(len == 7 && !memcmp(p, "1/2-1/2", 7))) {
+			return pgn_token(lx, tok, PGN_TOKEN_RESULT, p, q, q);
+		}
+
+		/* move number, possibly glued to the move as in "1.e4" */
+		while (d < q && pgn_is_digit(*d)) {
+			d++;
+		}
+		if (d < q && *d == '.') {
+			while (d < q && *d == '.') {
+				d++;
+			}
+			return pgn_token(lx, tok, PGN_TOKEN_NUMBER, p, d, d);
+		}
+	}
+
+	return pgn_token(lx, tok, PGN_TOKEN_MOVE, p, q, q);
+}
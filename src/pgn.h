@@ -0,0 +1,114 @@
+/* @file:	tezdhar/src/pgn.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/pgn.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Zero-copy reader of Portable Game Notation (PGN) files.
+ *
+ *
+ *			---------------
+ *			Spans and Modes
+ *			---------------
+ *
+ * A PGN file is mapped into memory once, and games, tags and movetext
+ * tokens are handed out as spans, i.e. pointer and length into the
+ * mapping. Nothing is copied and nothing is Null terminated, so a span is
+ * only valid until the file is closed.
+ *
+ * A game starts at a line beginning with '[' which does not follow another
+ * tag line. This makes it possible to start reading at any offset of a
+ * file, which is how large files are split between threads: a game
+ * belongs to the part of the file in which it starts.
+ *
+ * In PGN_HEADERS mode the end of a game is found with memchr() alone, the
+ * movetext is never looked at. In PGN_FULL mode the movetext is scanned
+ * for comments, so that a comment line starting with '[' does not split
+ * the game, and its tokens can then be read with pgn_next_token().
+ */
+
+#ifndef __PGN_H__
+#define __PGN_H__	1
+
+#include "chess.h"
+
+#include <stddef.h>	// for size_t
+
+#define PGN_MAX_TAGS	32	// further tags of a game are ignored
+
+/* A piece of text inside the mapped file */
+struct pgn_span {
+	const char *ptr;
+	size_t len;
+};
+
+struct pgn_tag {
+	struct pgn_span name;
+	struct pgn_span value;		// without quotes, escapes not resolved
+};
+
+enum pgn_mode {
+	PGN_HEADERS,			// tags only, movetext is skipped
+	PGN_FULL			// tags and movetext
+};
+
+/* One game of the file */
+struct pgn_game {
+	struct pgn_span text;		// complete game
+	struct pgn_span movetext;	// empty in PGN_HEADERS mode
+	struct pgn_tag tags[PGN_MAX_TAGS];
+	int ntags;
+	uint64_t offset;		// of the game in the file
+};
+
+/* A mapped PGN file */
+struct pgn_file {
+	const char *map;
+	size_t size;
+	bool mapped;			// false if read without mmap()
+};
+
+/* Reads the games which start within a part of a file */
+struct pgn_reader {
+	const char *base;		// start of file
+	const char *pos;		// start of next game
+	const char *limit;		// games starting here belong to others
+	const char *end;		// end of file
+	enum pgn_mode mode;
+};
+
+enum pgn_token_type {
+	PGN_TOKEN_END,			// end of movetext
+	PGN_TOKEN_MOVE,			// SAN move, with any !? suffix
+	PGN_TOKEN_NUMBER,		// move number like "12." or "12..."
+	PGN_TOKEN_NAG,			// numeric annotation glyph like "$1"
+	PGN_TOKEN_COMMENT,		// {comment} or ;comment, without delimiters
+	PGN_TOKEN_OPEN,			// start of variation
+	PGN_TOKEN_CLOSE,		// end of variation
+	PGN_TOKEN_RESULT		// game termination marker
+};
+
+struct pgn_token {
+	enum pgn_token_type type;
+	struct pgn_span text;
+};
+
+/* Tokenizer state of a movetext */
+struct pgn_lexer {
+	const char *pos;
+	const char *end;
+};
+
+
+/* Function prototypes */
+bool pgn_open(struct pgn_file *f, const char *path);
+void pgn_close(struct pgn_file *f);
+void pgn_reader_init(struct pgn_reader *r, const struct pgn_file *f, uint64_t begin, uint64_t end, enum pgn_mode mode);
+bool pgn_next_game(struct pgn_reader *r, struct pgn_game *g);
+const struct pgn_span *pgn_tag(const struct pgn_game *g, const char *name);
+bool pgn_span_eq(const struct pgn_span *s, const char *str);
+size_t pgn_span_copy(const struct pgn_span *s, char *buf, size_t len);
+void pgn_lexer_init(struct pgn_lexer *lx, const struct pgn_span *movetext);
+enum pgn_token_type pgn_next_token(struct pgn_lexer *lx, struct pgn_token *tok);
+
+
+#endif	/* __PGN_H__ */
@@ -0,0 +1,718 @@
+/* @file:	tezdhar/src/pgncheck.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/pgncheck.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	tezdhar-pgn, validates the games of PGN files in parallel.
+ *
+ *
+ *			-------------------
+ *			Validation Pipeline
+ *			-------------------
+ *
+ * The PGN files are mapped into memory and cut into chunks of
+ * PGNCHECK_CHUNK bytes, and worker threads take the next chunk from a
+ * shared atomic counter, like tezdhar-book does. A game belongs to the
+ * chunk in which it starts, so no game is read twice or missed.
+ *
+ * Every move of a game is parsed, resolved against the legal moves of the
+ * position and played with make_move(). At the end of the game the moves
+ * are taken back with unmake_move() and the position must be the starting
+ * one again. A game is reported if
+ *
+ *	- its FEN tag is not a valid position
+ *	- a move is not legal, ambiguous or cannot be parsed
+ *	- its Result tag differs from the termination marker of the movetext,
+ *	  or does not agree with a final checkmate or stalemate
+ *	- unmaking its moves does not restore the starting position
+ *
+ * With -s the move parser is checked against the move generator as well.
+ * Every move played is written in SAN, with one of several annotations,
+ * attached or after a space (so that a check runs into "+/-"), and in UCI
+ * notation, and each text must parse back to the same move with
+ * the right capture, check, mate and promotion flags. With -b only the
+ * tokenizer and the move parser run, to measure their throughput alone.
+ *
+ * With -d every move token, in variations too, is parsed by
+ * parse_input_move() and by the parser it replaced (see parse_legacy.c),
+ * and every token for which the two disagree on a field of struct move is
+ * reported. "make check" runs it on tests/parser.pgn. Where the new parser
+ * deliberately differs, accepting UCI promotions like e7e8q, NAGs attached
+ * to the move and annotations after a space, the corpus has no tokens.
+ *
+ * With -o the positions of every valid game with a result are written as
+ * training data (see train.h), with the move played as best move and a
+ * score of 0. Workers replay a game once more under a lock to write it, so
+ * the positions of a game stay together and can be chained with -c.
+ *
+ * Workers keep their counts and reports private. Reports are sorted by
+ * file and offset at the end, so the output does not depend on the number
+ * of threads.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "bitboard.h"
+#include "chess.h"
+#include "parse_legacy.h"
+#include "pgn.h"
+#include "train.h"
+
+#include <stdio.h>	// for printf, fprintf
+#include <stdlib.h>	// for calloc, realloc, free, qsort
+#include <string.h>	// for memcpy, strcpy, strlen
+
+#ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>	// for gettimeofday
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for getopt, sysconf
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create
+#endif
+
+#define PGNCHECK_CHUNK		(4LL << 20)	// bytes of PGN per work unit
+#define PGNCHECK_MAX_FILES	1024
+#define PGNCHECK_MAX_THREADS	256
+
+enum pgncheck_kind {
+	PGNCHECK_BAD_FEN,
+	PGNCHECK_ILLEGAL_MOVE,
+	PGNCHECK_BAD_RESULT,
+	PGNCHECK_UNMAKE,
+	PGNCHECK_PARSER,
+	PGNCHECK_LEGACY,		// only with -d
+	PGNCHECK_KINDS
+};
+
+static const char * const pgncheck_kind_name[PGNCHECK_KINDS] = {
+	"bad FEN", "illegal move", "result mismatch", "unmake mismatch", "parser mismatch",
+	"legacy mismatch"
+};
+
+/* annotations appended to generated SAN moves by the parser check */
+static const char * const pgncheck_suffix[] = {
+	"", "!", "?", "!?", "?!", "!!", "??", " $1", " +/-", "(=)", "$1", "+/-"
+};
+
+/* A problem found in a game */
+struct pgncheck_error {
+	int file;
+	uint64_t offset;		// of the game in the file
+	int ply;			// of the move, 0 if not about a move
+	enum pgncheck_kind kind;
+	char text[MAX_MOVE_LEN];	// offending move or result
+};
+
+struct pgncheck;
+
+struct pgncheck_worker {
+	struct pgncheck *c;
+	move_t *moves;			// moves of the game being replayed
+	struct undo *undo;
+	size_t cap;
+	struct pgncheck_error *err;
+	size_t nerr, err_cap;
+	uint64_t games, moves_played, bytes;
+	uint64_t tokens, invalid;	// move tokens parsed with -b or -d
+	uint64_t count[PGNCHECK_KINDS];
+	bool failed;			// out of memory
+};
+
+struct pgncheck {
+	char **files;
+	struct pgn_file pgn[PGNCHECK_MAX_FILES];	// mapped files
+	int nfiles;
+	bool bench;			// only tokenize and parse moves
+	bool parser;			// check the move parser
+	bool legacy;			// compare it with the legacy parser
+	bool train;			// write training data to out
+	struct train_writer out;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t out_lock;
+#endif
+	int64_t chunks;			// total number of chunks
+	int64_t next;			// next chunk to be taken
+};
+
+
+static void pgncheck_report(struct pgncheck_worker *w, const int file, const struct pgn_game *gm,
+		const int ply, const enum pgncheck_kind kind, const struct pgn_span *text)
+{
+	struct pgncheck_error *e;
+
+	w->count[kind]++;
+	if (w->nerr == w->err_cap) {
+		size_t cap = w->err_cap ? 2 * w->err_cap : 64;
+
+		if (!(e = realloc(w->err, cap * sizeof(*e)))) {
+			perror("realloc failed");
+			w->failed = true;
+			return;
+		}
+		w->err = e;
+		w->err_cap = cap;
+	}
+
+	e = &w->err[w->nerr++];
+	e->file = file;
+	e->offset = gm->offset;
+	e->ply = ply;
+	e->kind = kind;
+	pgn_span_copy(text, e->text, sizeof(e->text));
+}
+
+
+/* Make room for one more move of the game being replayed */
+static bool pgncheck_reserve(struct pgncheck_worker *w, const size_t n)
+{
+	const size_t cap = w->cap ? 2 * w->cap : 512;
+	struct undo *undo;
+	move_t *moves;
+
+	if (n < w->cap) {
+		return true;
+	}
+
+	if ((moves = realloc(w->moves, cap * sizeof(*moves)))) {
+		w->moves = moves;
+	}
+	if ((undo = realloc(w->undo, cap * sizeof(*undo)))) {
+		w->undo = undo;
+	}
+	if (!moves || !undo) {
+		perror("realloc failed");
+		w->failed = true;
+		return false;
+	}
+
+	w->cap = cap;
+	return true;
+}
+
+
+/* Does a move parsed from text resolve to m, with the flags of its SAN */
+static bool pgncheck_parse(struct board *brd, const move_t m, const char *text, const char *san)
+{
+	const struct move mv = parse_input_move(text);
+	const size_t len = strlen(san);
+	const bool mate = len && san[len - 1] == '#';
+	const bool check = len && san[len - 1] == '+';
+
+	if (resolve_move(brd, &mv) != m) {
+		return false;
+	}
+	if (text[0] != san[0] || text[1] != san[1]) {
+		return true;	// UCI move, without flags
+	}
+
+	return mv.capture == (MOVE_CAPTURED(m) != EMPTY_SQR || (m & MOVE_EP)) &&
+		mv.checkmate == mate && mv.check == check &&
+		mv.promoted == piece_type(MOVE_PROMOTED(m));
+}
+
+
+/* Check the move parser with SAN and UCI texts of move m */
+static void pgncheck_parser(struct pgncheck_worker *w, const int file, const struct pgn_game *gm,
+		const int ply, struct board *brd, const move_t m)
+{
+	const size_t n = sizeof(pgncheck_suffix) / sizeof(pgncheck_suffix[0]);
+	char san[MAX_MOVE_LEN], text[3][2 * MAX_MOVE_LEN];
+	struct pgn_span span;
+
+	move_to_san(brd, m, san);
+	snprintf(text[0], sizeof(text[0]), "%s", san);
+	snprintf(text[1], sizeof(text[1]), "%s%s", san, (m & MOVE_EP) ? "e.p." : pgncheck_suffix[(size_t)ply % n]);
+	move_to_uci(m, text[2]);
+
+	for (int i = 0; i < 3; i++) {
+		if (!pgncheck_parse(brd, m, text[i], san)) {
+			span.ptr = text[i];
+			span.len = strlen(text[i]);
+			pgncheck_report(w, file, gm, ply, PGNCHECK_PARSER, &span);
+			return;
+		}
+	}
+}
+
+
+/* Tokenize a game and parse its moves, without playing them */
+static void pgncheck_bench(struct pgncheck_worker *w, const struct pgn_game *gm)
+{
+	char buf[MAX_MOVE_LEN];
+	struct pgn_lexer lx;
+	struct pgn_token tok;
+	struct move mv;
+
+	w->games++;
+	w->bytes += gm->text.len;
+
+	pgn_lexer_init(&lx, &gm->movetext);
+	while (pgn_next_token(&lx, &tok) != PGN_TOKEN_END) {
+		if (tok.type != PGN_TOKEN_MOVE || tok.text.len >= MAX_MOVE_LEN) {
+			continue;
+		}
+		memcpy(buf, tok.text.ptr, tok.text.len);
+		buf[tok.text.len] = '\0';
+
+		mv = parse_input_move(buf);
+		w->tokens++;
+		if (mv.invalid) {
+			w->invalid++;
+		}
+	}
+}
+
+
+/* Do two parses of a move agree. Moves which both parsers reject agree,
+ * whatever else they filled in */
+static bool pgncheck_same(const struct move *a, const struct move *b)
+{
+	if (a->invalid || b->invalid) {
+		return a->invalid == b->invalid;
+	}
+
+	return a->chessman == b->chessman && a->promoted == b->promoted &&
+		a->from_file == b->from_file && a->from_rank == b->from_rank &&
+		a->to_file == b->to_file && a->to_rank == b->to_rank &&
+		a->castle_ks == b->castle_ks && a->castle_qs == b->castle_qs &&
+		a->null == b->null && a->draw_offered == b->draw_offered &&
+		a->ep == b->ep && a->capture == b->capture &&
+		a->check == b->check && a->checkmate == b->checkmate;
+}
+
+
+/* Parse every move token of a game with both parsers, and report those
+ * they disagree on */
+static void pgncheck_legacy(struct pgncheck_worker *w, const int file, const struct pgn_game *gm)
+{
+	char buf[MAX_MOVE_LEN], copy[MAX_MOVE_LEN];
+	struct move mv, old;
+	struct pgn_lexer lx;
+	struct pgn_token tok;
+	int n = 0;
+
+	w->games++;
+	w->bytes += gm->text.len;
+
+	pgn_lexer_init(&lx, &gm->movetext);
+	while (pgn_next_token(&lx, &tok) != PGN_TOKEN_END) {
+		if (tok.type != PGN_TOKEN_MOVE) {
+			continue;
+		}
+		n++;
+		if (tok.text.len >= MAX_MOVE_LEN) {
+			continue;	// no struct move holds it
+		}
+		memcpy(buf, tok.text.ptr, tok.text.len);
+		buf[tok.text.len] = '\0';
+		strcpy(copy, buf);
+
+		mv = parse_input_move(buf);
+		old = parse_legacy_move(copy);
+		w->tokens++;
+		if (!pgncheck_same(&mv, &old)) {
+			pgncheck_report(w, file, gm, n, PGNCHECK_LEGACY, &tok.text);
+		}
+	}
+}
+
+
+/* Write the positions of a replayed game as training data */
+static void pgncheck_train(struct pgncheck_worker *w, const struct board *start, const size_t plies,
+		const struct pgn_span *result)
+{
+	struct pgncheck *c = w->c;
+	struct train_pos p;
+	struct undo u;
+
+	if (pgn_span_eq(result, "1-0")) {
+		p.result = 1;
+	} else if (pgn_span_eq(result, "0-1")) {
+		p.result = -1;
+	} else if (pgn_span_eq(result, "1/2-1/2")) {
+		p.result = 0;
+	} else {
+		return;
+	}
+	p.brd = *start;
+	p.score = 0;
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&c->out_lock);
+#endif
+	for (size_t i = 0; i < plies && c->out.ok; i++) {
+		p.best = w->moves[i];
+		train_write(&c->out, &p, i ? w->moves[i - 1] : MOVE_NONE);
+		make_move(&p.brd, w->moves[i], &u);
+	}
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&c->out_lock);
+#endif
+}
+
+
+/* Replay a game and report its problems */
+static void pgncheck_game(struct pgncheck_worker *w, const int file, const struct pgn_game *gm)
+{
+	const struct pgn_span *result = pgn_tag(gm, "Result");
+	const struct pgn_span *fen_tag = pgn_tag(gm, "FEN");
+	struct pgn_span marker = {NULL, 0};
+	char fen[MAX_FEN_LEN], buf[MAX_MOVE_LEN];
+	struct move_list legal;
+	struct pgn_lexer lx;
+	struct pgn_token tok;
+	struct board brd, start;
+	struct move mv;
+	uint64_t key;
+	const size_t nerr = w->nerr;
+	size_t ply = 0;
+	int depth = 0;
+	move_t m;
+
+	w->games++;
+	w->bytes += gm->text.len;
+
+	if (!pgn_span_copy(fen_tag, fen, sizeof(fen))) {
+		strcpy(fen, INITIAL_FEN);
+	}
+	if (!init_board(fen, &brd, AI, AI)) {
+		pgncheck_report(w, file, gm, 0, PGNCHECK_BAD_FEN, fen_tag);
+		return;
+	}
+	key = zobrist_key(&brd);
+	start = brd;
+
+	pgn_lexer_init(&lx, &gm->movetext);
+	while (pgn_next_token(&lx, &tok) != PGN_TOKEN_END) {
+		if (tok.type == PGN_TOKEN_OPEN) {
+			depth++;
+		} else if (tok.type == PGN_TOKEN_CLOSE) {
+			depth -= depth ? 1 : 0;
+		} else if (tok.type == PGN_TOKEN_RESULT && !depth) {
+			marker = tok.text;
+		}
+		if (tok.type != PGN_TOKEN_MOVE || depth) {
+			continue;	// variations are not played
+		}
+
+		if (tok.text.len >= MAX_MOVE_LEN) {
+			pgncheck_report(w, file, gm, (int)ply + 1, PGNCHECK_ILLEGAL_MOVE, &tok.text);
+			break;
+		}
+		memcpy(buf, tok.text.ptr, tok.text.len);
+		buf[tok.text.len] = '\0';
+
+		mv = parse_input_move(buf);
+		if ((m = resolve_move(&brd, &mv)) == MOVE_NONE) {
+			pgncheck_report(w, file, gm, (int)ply + 1, PGNCHECK_ILLEGAL_MOVE, &tok.text);
+			break;
+		}
+		if (w->c->parser) {
+			pgncheck_parser(w, file, gm, (int)ply + 1, &brd, m);
+		}
+		if (!pgncheck_reserve(w, ply)) {
+			return;
+		}
+		w->moves[ply] = m;
+		make_move(&brd, m, &w->undo[ply++]);
+		w->moves_played++;
+	}
+
+	/* the result must agree with the termination marker and the final
+	 * position, if the game was replayed completely */
+	if (tok.type == PGN_TOKEN_END) {
+		const bool mated = !gen_legal_moves(&brd, &legal);
+		const bool checked = in_check(&brd, brd.turn);
+
+		if (!result || (marker.ptr && (marker.len != result->len ||
+					memcmp(marker.ptr, result->ptr, marker.len)))) {
+			pgncheck_report(w, file, gm, 0, PGNCHECK_BAD_RESULT, result ? result : &marker);
+		} else if (mated && checked && !pgn_span_eq(result, brd.turn == WHITE ? "0-1" : "1-0")) {
+			pgncheck_report(w, file, gm, (int)ply, PGNCHECK_BAD_RESULT, result);
+		} else if (mated && !checked && !pgn_span_eq(result, "1/2-1/2")) {
+			pgncheck_report(w, file, gm, (int)ply, PGNCHECK_BAD_RESULT, result);
+		}
+	}
+
+	if (w->c->train && tok.type == PGN_TOKEN_END && w->nerr == nerr) {
+		pgncheck_train(w, &start, ply, result);
+	}
+
+	while (ply) {
+		ply--;
+		unmake_move(&brd, w->moves[ply], &w->undo[ply]);
+	}
+	if (zobrist_key(&brd) != key) {
+		pgncheck_report(w, file, gm, 0, PGNCHECK_UNMAKE, NULL);
+	}
+}
+
+
+static void *pgncheck_worker(void *arg)
+{
+	struct pgncheck_worker *w = arg;
+	struct pgncheck *c = w->c;
+	struct pgn_reader r;
+	struct pgn_game gm;
+	int64_t chunk, begin;
+	int f;
+
+	while (!w->failed && (chunk = __atomic_fetch_add(&c->next, 1, __ATOMIC_RELAXED)) < c->chunks) {
+		/* find file and offset of the chunk */
+		for (f = 0; f < c->nfiles; f++) {
+			const int64_t n = ((int64_t)c->pgn[f].size + PGNCHECK_CHUNK - 1) / PGNCHECK_CHUNK;
+			if (chunk < n) {
+				break;
+			}
+			chunk -= n;
+		}
+		begin = chunk * PGNCHECK_CHUNK;
+
+		pgn_reader_init(&r, &c->pgn[f], (uint64_t)begin, (uint64_t)(begin + PGNCHECK_CHUNK), PGN_FULL);
+		while (!w->failed && pgn_next_game(&r, &gm)) {
+			if (c->legacy) {
+				pgncheck_legacy(w, f, &gm);
+			} else if (c->bench) {
+				pgncheck_bench(w, &gm);
+			} else {
+				pgncheck_game(w, f, &gm);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+
+/* Order by file, then by offset */
+static int pgncheck_cmp_error(const void *a, const void *b)
+{
+	const struct pgncheck_error *x = a, *y = b;
+
+	if (x->file != y->file) {
+		return x->file - y->file;
+	}
+	if (x->offset != y->offset) {
+		return x->offset < y->offset ? -1 : 1;
+	}
+	return x->ply - y->ply;
+}
+
+
+/* Print the first max reports of all workers, in file order */
+static bool pgncheck_print(const struct pgncheck *c, const struct pgncheck_worker *w, const int threads, const size_t max)
+{
+	struct pgncheck_error *all;
+	size_t n = 0;
+
+	for (int t = 0; t < threads; t++) {
+		n += w[t].nerr;
+	}
+	if (!(all = malloc((n ? n : 1) * sizeof(*all)))) {
+		perror("malloc failed");
+		return false;
+	}
+
+	n = 0;
+	for (int t = 0; t < threads; t++) {
+		memcpy(all + n, w[t].err, w[t].nerr * sizeof(*all));
+		n += w[t].nerr;
+	}
+	qsort(all, n, sizeof(*all), pgncheck_cmp_error);
+
+	for (size_t i = 0; i < n && i < max; i++) {
+		printf("%s:%llu: %s", c->files[all[i].file], (unsigned long long)all[i].offset,
+				pgncheck_kind_name[all[i].kind]);
+		if (all[i].ply) {
+			printf(" at ply %d", all[i].ply);
+		}
+		printf(all[i].text[0] ? " \"%s\"\n" : "\n", all[i].text);
+	}
+	if (n > max) {
+		printf("... %zu more\n", n - max);
+	}
+
+	free(all);
+	return true;
+}
+
+
+static void pgncheck_usage(const char *prog)
+{
+	printf("Usage: %s [-j threads] [-e errors] [-s] [-b] [-d] [-o file [-c]] PGN ...\n\n", prog);
+	printf("Replay and validate every game of PGN files.\n\n");
+	printf("  -j threads	number of worker threads (default: all cores)\n");
+	printf("  -e errors	print at most so many problems (default: 20)\n");
+	printf("  -s		check the move parser against generated SAN and UCI moves\n");
+	printf("  -b		only tokenize and parse the moves, and report tokens/s\n");
+	printf("  -d		compare the move parser with the legacy one on every move token\n");
+	printf("  -o file	write the positions of valid games as training data\n");
+	printf("  -c		chain the positions of a game in the training data\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	static struct pgncheck c;
+	struct pgncheck_worker *w;
+	struct timeval start, end;
+	uint64_t games = 0, moves = 0, bytes = 0, bad = 0, tokens = 0, invalid = 0;
+	uint64_t count[PGNCHECK_KINDS] = {0};
+	int opt, threads = 1, max_errors = 20;
+	const char *train_path = NULL;
+	unsigned train_flags = 0;
+	double secs;
+	bool ok = true;
+#ifdef HAVE_PTHREAD_H
+	pthread_t tid[PGNCHECK_MAX_THREADS];
+	int started = 0;
+#endif
+
+#if defined HAVE_SYSCONF && defined _SC_NPROCESSORS_ONLN
+	threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	while ((opt = getopt(argc, argv, "j:e:sbdo:ch")) != -1) {
+		switch (opt) {
+			case 'j': threads = atoi(optarg); break;
+			case 'e': max_errors = atoi(optarg); break;
+			case 's': c.parser = true; break;
+			case 'b': c.bench = true; break;
+			case 'd': c.legacy = true; break;
+			case 'o': train_path = optarg; break;
+			case 'c': train_flags = TRAIN_CHAIN; break;
+			case 'h': pgncheck_usage(argv[0]); return EXIT_SUCCESS;
+			default:  pgncheck_usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+
+	if (optind == argc || argc - optind > PGNCHECK_MAX_FILES || threads < 1 || max_errors < 0) {
+		pgncheck_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads > PGNCHECK_MAX_THREADS) {
+		threads = PGNCHECK_MAX_THREADS;
+	}
+
+	c.files = &argv[optind];
+	c.nfiles = argc - optind;
+	for (int f = 0; f < c.nfiles; f++) {
+		if (!pgn_open(&c.pgn[f], c.files[f])) {
+			return EXIT_FAILURE;
+		}
+		c.chunks += ((int64_t)c.pgn[f].size + PGNCHECK_CHUNK - 1) / PGNCHECK_CHUNK;
+	}
+
+	if (train_path && !c.bench && !c.legacy) {
+		if (!train_create(&c.out, train_path, train_flags)) {
+			return EXIT_FAILURE;
+		}
+		c.train = true;
+#ifdef HAVE_PTHREAD_H
+		pthread_mutex_init(&c.out_lock, NULL);
+#endif
+	}
+
+	if (!(w = calloc((size_t)threads, sizeof(*w)))) {
+		perror("calloc failed");
+		return EXIT_FAILURE;
+	}
+
+	init_leaper_attacks();
+	init_magic_numbers();
+	init_slider_attacks();
+	init_zobrist_keys();
+
+	for (int t = 0; t < threads; t++) {
+		w[t].c = &c;
+	}
+
+	gettimeofday(&start, NULL);
+#ifdef HAVE_PTHREAD_H
+	for (int t = 1; t < threads; t++) {
+		if (pthread_create(&tid[started], NULL, pgncheck_worker, &w[t]) == 0) {
+			started++;
+		}
+	}
+	pgncheck_worker(&w[0]);
+	for (int t = 0; t < started; t++) {
+		pthread_join(tid[t], NULL);
+	}
+#else
+	pgncheck_worker(&w[0]);
+#endif
+	gettimeofday(&end, NULL);
+
+	secs = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1e6;
+	if (secs <= 0) {
+		secs = 1e-6;
+	}
+
+	for (int t = 0; t < threads; t++) {
+		games += w[t].games;
+		moves += w[t].moves_played;
+		bytes += w[t].bytes;
+		tokens += w[t].tokens;
+		invalid += w[t].invalid;
+		for (int k = 0; k < PGNCHECK_KINDS; k++) {
+			count[k] += w[t].count[k];
+			bad += w[t].count[k];
+		}
+		if (w[t].failed) {
+			ok = false;
+		}
+	}
+
+	if (ok && c.bench && !c.legacy) {
+		printf("\n%llu games, %llu move tokens, %llu not parsed\n", (unsigned long long)games,
+				(unsigned long long)tokens, (unsigned long long)invalid);
+		printf("%.2f seconds, %.0f tokens/s, %.1f MB/s with %d threads\n", secs,
+				(double)tokens / secs, (double)bytes / secs / 1e6, threads);
+	} else if (ok) {
+		printf("\n");
+		ok = pgncheck_print(&c, w, threads, (size_t)max_errors);
+	}
+
+	if (c.legacy) {
+		printf("\n%llu games, %llu move tokens, %llu legacy mismatches\n", (unsigned long long)games,
+				(unsigned long long)tokens, (unsigned long long)bad);
+	} else if (!c.bench) {
+		printf("\n%llu games, %llu moves, %llu problems\n", (unsigned long long)games,
+				(unsigned long long)moves, (unsigned long long)bad);
+		for (int k = 0; k < PGNCHECK_LEGACY; k++) {
+			printf("  %-16s %llu\n", pgncheck_kind_name[k], (unsigned long long)count[k]);
+		}
+		printf("%.2f seconds, %.0f games/s, %.0f moves/s, %.1f MB/s with %d threads\n", secs,
+				(double)games / secs, (double)moves / secs, (double)bytes / secs / 1e6, threads);
+	}
+
+	if (c.train) {
+		const uint64_t written = c.out.positions;
+
+		if (train_finish(&c.out)) {
+			printf("%llu positions written to %s\n", (unsigned long long)written, train_path);
+		} else {
+			ok = false;
+		}
+#ifdef HAVE_PTHREAD_H
+		pthread_mutex_destroy(&c.out_lock);
+#endif
+	}
+
+	for (int t = 0; t < threads; t++) {
+		free(w[t].moves);
+		free(w[t].undo);
+		free(w[t].err);
+	}
+	for (int f = 0; f < c.nfiles; f++) {
+		pgn_close(&c.pgn[f]);
+	}
+	free(w);
+	return ok && !bad ? EXIT_SUCCESS : EXIT_FAILURE;
+}
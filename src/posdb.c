@@ -0,0 +1,337 @@
+/* @file:	tezdhar/src/posdb.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/posdb.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Map a game database into memory and look up positions in its
+ * 		index.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "posdb.h"
+
+#include <stdio.h>	// for fprintf, perror
+#include <stdlib.h>	// for qsort
+#include <string.h>	// for memchr, memcmp, memcpy, memset, strcpy, strlen
+
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>	// for open
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for close
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>	// for fstat
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>	// for mmap, madvise
+#endif
+
+const char *const posdb_tag_names[POSDB_TAGS] = {
+	"Event", "Site", "Date", "Round", "White", "Black", "Result",
+	"WhiteElo", "BlackElo", "ECO", "FEN"
+};
+
+static const uint8_t posdb_magic[4] = {'T', 'Z', 'D', 'B'};
+
+
+static uint64_t read_le(const uint8_t *p, const size_t bytes)
+{
+	uint64_t v = 0;
+
+	for (size_t i = bytes; i-- > 0; ) {
+		v = (v << 8) | p[i];
+	}
+
+	return v;
+}
+
+
+static void write_le(uint8_t *p, uint64_t v, const int bytes)
+{
+	for (int i = 0; i < bytes; i++) {
+		p[i] = (uint8_t)v;
+		v >>= 8;
+	}
+}
+
+
+void posdb_get_game(const struct posdb *db, const uint32_t id, struct posdb_game *g)
+{
+	const uint8_t *p = db->game + (size_t)id * POSDB_GAME_SIZE;
+
+	g->moves = read_le(p, 8);
+	g->tags = read_le(p + 8, 8);
+	g->nmoves = (uint16_t)read_le(p + 16, 2);
+	g->result = p[18];
+}
+
+
+void posdb_put_game(uint8_t *buf, const struct posdb_game *g)
+{
+	memset(buf, 0, POSDB_GAME_SIZE);
+	write_le(buf, g->moves, 8);
+	write_le(buf + 8, g->tags, 8);
+	write_le(buf + 16, g->nmoves, 2);
+	buf[18] = g->result;
+}
+
+
+void posdb_get_entry(const struct posdb *db, const uint64_t i, struct posdb_entry *e)
+{
+	const uint8_t *p = db->index + i * POSDB_ENTRY_SIZE;
+
+	e->key = read_le(p, 8);
+	e->game = (uint32_t)read_le(p + 8, 4);
+	e->ply = (uint16_t)read_le(p + 12, 2);
+	e->next = p[14];
+	e->result = p[15];
+}
+
+
+void posdb_put_entry(uint8_t *buf, const struct posdb_entry *e)
+{
+	write_le(buf, e->key, 8);
+	write_le(buf + 8, e->game, 4);
+	write_le(buf + 12, e->ply, 2);
+	buf[14] = e->next;
+	buf[15] = e->result;
+}
+
+
+/* File header of a database, the sections follow in order */
+void posdb_put_header(uint8_t *buf, const int max_ply, const uint64_t games, const uint64_t entries,
+		const uint64_t moves_size, const uint64_t tags_size)
+{
+	const uint64_t game_off = POSDB_HEADER_SIZE;
+	const uint64_t moves_off = game_off + games * POSDB_GAME_SIZE;
+
+	memset(buf, 0, POSDB_HEADER_SIZE);
+	memcpy(buf, posdb_magic, sizeof(posdb_magic));
+	write_le(buf + 4, POSDB_VERSION, 2);
+	write_le(buf + 6, (uint64_t)max_ply, 2);
+	write_le(buf + 8, games, 8);
+	write_le(buf + 16, entries, 8);
+	write_le(buf + 24, game_off, 8);
+	write_le(buf + 32, moves_off, 8);
+	write_le(buf + 40, moves_off + moves_size, 8);
+	write_le(buf + 48, moves_off + moves_size + tags_size, 8);
+}
+
+
+/* Map a database into memory and check that its sections fit the file */
+bool posdb_open(struct posdb *db, const char *path)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	uint64_t game_off, moves_off, tags_off, index_off;
+	struct stat st;
+	const uint8_t *h;
+	void *map;
+	int fd;
+
+	memset(db, 0, sizeof(*db));
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		perror(path);
+		return false;
+	}
+	if (fstat(fd, &st) || st.st_size < POSDB_HEADER_SIZE) {
+		fprintf(stderr, "Not a position database: %s\n", path);
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror("mmap failed");
+		return false;
+	}
+	db->map = h = map;
+	db->size = (size_t)st.st_size;
+
+	db->max_ply = (int)read_le(h + 6, 2);
+	db->games = read_le(h + 8, 8);
+	db->entries = read_le(h + 16, 8);
+	game_off = read_le(h + 24, 8);
+	moves_off = read_le(h + 32, 8);
+	tags_off = read_le(h + 40, 8);
+	index_off = read_le(h + 48, 8);
+
+	if (memcmp(h, posdb_magic, sizeof(posdb_magic)) || read_le(h + 4, 2) != POSDB_VERSION ||
+			game_off != POSDB_HEADER_SIZE || moves_off != game_off + db->games * POSDB_GAME_SIZE ||
+			tags_off < moves_off || index_off < tags_off ||
+			index_off + db->entries * POSDB_ENTRY_SIZE != db->size) {
+		fprintf(stderr, "Not a position database: %s\n", path);
+		posdb_close(db);
+		return false;
+	}
+
+	db->game = h + game_off;
+	db->moves = h + moves_off;
+	db->tags = h + tags_off;
+	db->index = h + index_off;
+	db->moves_size = (size_t)(tags_off - moves_off);
+	db->tags_size = (size_t)(index_off - tags_off);
+
+#ifdef HAVE_MADVISE
+	/* a query touches the few pages of its binary search and its run */
+	madvise(map, db->size, MADV_RANDOM);
+#endif
+	return true;
+#else
+	memset(db, 0, sizeof(*db));
+	fprintf(stderr, "Position databases need mmap(): %s\n", path);
+	return false;
+#endif
+}
+
+
+void posdb_close(struct posdb *db)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	if (db->map) {
+		munmap((void *)(uintptr_t)db->map, db->size);
+	}
+#endif
+	memset(db, 0, sizeof(*db));
+}
+
+
+/* Value of a tag of a game, "" if it is missing */
+const char *posdb_game_tag(const struct posdb *db, const struct posdb_game *g, const enum posdb_tag tag)
+{
+	const char *p = (const char *)db->tags + g->tags;
+	const char *end = (const char *)db->tags + db->tags_size;
+
+	if (g->tags >= db->tags_size) {
+		return "";
+	}
+	for (int t = 0; t < (int)tag; t++) {
+		const char *nul = memchr(p, '\0', (size_t)(end - p));
+
+		if (!nul) {
+			return "";
+		}
+		p = nul + 1;
+	}
+	return p < end && memchr(p, '\0', (size_t)(end - p)) ? p : "";
+}
+
+
+/* Play the move of a move byte, MOVE_NONE if there is no such move */
+move_t posdb_make_move(struct board *brd, const uint8_t code, struct undo *u)
+{
+	struct move_list legal;
+
+	if (code >= gen_legal_moves(brd, &legal)) {
+		return MOVE_NONE;
+	}
+	make_move(brd, legal.moves[code], u);
+	return legal.moves[code];
+}
+
+
+/* Set up the position of a game after so many plies, false if the game
+ * is corrupt */
+bool posdb_game_board(const struct posdb *db, const struct posdb_game *g, const int ply, struct board *brd)
+{
+	const char *fen = posdb_game_tag(db, g, POSDB_FEN);
+	char buf[MAX_FEN_LEN];
+	struct undo u;
+
+	if (strlen(fen) >= sizeof(buf)) {
+		return false;
+	}
+	strcpy(buf, *fen ? fen : INITIAL_FEN);
+	if (!init_board(buf, brd, AI, AI) || ply > g->nmoves || g->moves + (uint64_t)ply > db->moves_size) {
+		return false;
+	}
+
+	for (int i = 0; i < ply; i++) {
+		if (posdb_make_move(brd, db->moves[g->moves + (uint64_t)i], &u) == MOVE_NONE) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/* Find the index entries of a position. Returns their number, and the
+ * first of them in first */
+uint64_t posdb_lookup(const struct posdb *db, const uint64_t key, uint64_t *first)
+{
+	uint64_t lo = 0, hi = db->entries, mid, end;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (read_le(db->index + mid * POSDB_ENTRY_SIZE, 8) < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	*first = end = lo;
+	while (end < db->entries && read_le(db->index + end * POSDB_ENTRY_SIZE, 8) == key) {
+		end++;
+	}
+	return end - lo;
+}
+
+
+/* Order by decreasing number of games */
+static int posdb_cmp_move(const void *a, const void *b)
+{
+	const struct posdb_move_stat *x = a, *y = b;
+
+	return (x->games < y->games) - (x->games > y->games);
+}
+
+
+/* Count the games reaching a position, by result and by next move. A game
+ * passing the position twice counts only once */
+void posdb_stats(const struct posdb *db, struct board *brd, struct posdb_stats *st)
+{
+	uint64_t counts[POSDB_NO_MOVE + 1][POSDB_RESULTS];
+	struct move_list legal;
+	struct posdb_entry e;
+	uint64_t n, last = UINT64_MAX;
+
+	memset(st, 0, sizeof(*st));
+	memset(counts, 0, sizeof(counts));
+
+	n = posdb_lookup(db, zobrist_key(brd), &st->first);
+	for (uint64_t i = st->first; i < st->first + n; i++) {
+		posdb_get_entry(db, i, &e);
+		if (e.game == last || e.result >= POSDB_RESULTS) {
+			continue;
+		}
+		last = e.game;
+		st->games++;
+		st->results[e.result]++;
+		counts[e.next][e.result]++;
+	}
+
+	gen_legal_moves(brd, &legal);
+	for (int i = 0; i < legal.count && i < POSDB_NO_MOVE; i++) {
+		struct posdb_move_stat *ms = &st->moves[st->nmoves];
+
+		for (int r = 0; r < POSDB_RESULTS; r++) {
+			ms->games += counts[i][r];
+			ms->results[r] = counts[i][r];
+		}
+		if (ms->games) {
+			ms->move = legal.moves[i];
+			st->nmoves++;
+		}
+	}
+
+	qsort(st->moves, (size_t)st->nmoves, sizeof(st->moves[0]), posdb_cmp_move);
+}
@@ -0,0 +1,138 @@
+/* @file:	tezdhar/src/posdb.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/posdb.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Game database with a position index, for looking up the games
+ * 		reaching a position, their results and the moves played next.
+ *
+ *
+ *			-----------
+ *			File Layout
+ *			-----------
+ *
+ * A database is one file, mapped into memory with mmap(), all numbers
+ * little-endian:
+ *
+ *	header	64 bytes: magic "TZDB", version and indexed plies, both 16
+ *		bits, then the number of games and index entries and the
+ *		offsets of the four sections below, all 64 bits
+ *	games	24 bytes per game: offsets of its moves and its tags, 64
+ *		bits each, number of moves (16 bits), result (8 bits)
+ *	moves	one byte per move: its index in the list of legal moves made
+ *		by gen_legal_moves(), so a game is decoded by replaying it
+ *	tags	POSDB_TAGS Null terminated values per game, empty if the
+ *		tag was missing
+ *	index	16 bytes per position of a game up to the indexed plies: key
+ *		(64 bits), game (32 bits), ply (16 bits), the move played
+ *		next (8 bits, POSDB_NO_MOVE at the end of the game) and the
+ *		result of the game (8 bits)
+ *
+ * The index is sorted by key, game and ply, so the games reaching a
+ * position are one binary search away, and the results and next moves of
+ * a position are counted from its run of entries without reading a game.
+ * Positions with the same key have the same legal moves, so the move
+ * bytes of a run can be counted before they are decoded.
+ */
+
+#ifndef __POSDB_H__
+#define __POSDB_H__	1
+
+#include "chess.h"
+
+#include <stddef.h>	// for size_t
+
+#define POSDB_HEADER_SIZE	64
+#define POSDB_GAME_SIZE		24
+#define POSDB_ENTRY_SIZE	16
+#define POSDB_VERSION		1
+#define POSDB_NO_MOVE		0xff		// game ended in the position
+
+/* Stored tags of a game, in file order */
+enum posdb_tag {
+	POSDB_EVENT,
+	POSDB_SITE,
+	POSDB_DATE,
+	POSDB_ROUND,
+	POSDB_WHITE,
+	POSDB_BLACK,
+	POSDB_RESULT,
+	POSDB_WHITE_ELO,
+	POSDB_BLACK_ELO,
+	POSDB_ECO,
+	POSDB_FEN,
+	POSDB_TAGS
+};
+
+/* Result of a game */
+enum posdb_result {
+	POSDB_BLACK_WINS,
+	POSDB_DRAW,
+	POSDB_WHITE_WINS,
+	POSDB_UNKNOWN,
+	POSDB_RESULTS
+};
+
+struct posdb_game {
+	uint64_t moves;			// offset into the moves section
+	uint64_t tags;			// offset into the tags section
+	uint16_t nmoves;
+	uint8_t result;			// enum posdb_result
+};
+
+struct posdb_entry {
+	uint64_t key;
+	uint32_t game;
+	uint16_t ply;
+	uint8_t next;			// index of the next move
+	uint8_t result;			// enum posdb_result
+};
+
+/* A mapped database */
+struct posdb {
+	const uint8_t *map;
+	size_t size;
+	int max_ply;			// plies indexed per game
+	uint64_t games, entries;
+	const uint8_t *game, *moves, *tags, *index;
+	size_t moves_size, tags_size;
+};
+
+/* Games and results of one move of a position */
+struct posdb_move_stat {
+	move_t move;
+	uint64_t games;
+	uint64_t results[POSDB_RESULTS];
+};
+
+/* Games reaching a position, their results and the moves played next */
+struct posdb_stats {
+	uint64_t first;			// first index entry of the position
+	uint64_t games;
+	uint64_t results[POSDB_RESULTS];
+	int nmoves;			// by decreasing number of games
+	struct posdb_move_stat moves[MAX_MOVES];
+};
+
+
+/* PGN names of the stored tags */
+extern const char *const posdb_tag_names[POSDB_TAGS];
+
+
+/* Function prototypes */
+bool posdb_open(struct posdb *db, const char *path);
+void posdb_close(struct posdb *db);
+void posdb_get_game(const struct posdb *db, uint32_t id, struct posdb_game *g);
+void posdb_put_game(uint8_t *buf, const struct posdb_game *g);
+void posdb_get_entry(const struct posdb *db, uint64_t i, struct posdb_entry *e);
+void posdb_put_entry(uint8_t *buf, const struct posdb_entry *e);
+void posdb_put_header(uint8_t *buf, int max_ply, uint64_t games, uint64_t entries,
+		uint64_t moves_size, uint64_t tags_size);
+const char *posdb_game_tag(const struct posdb *db, const struct posdb_game *g, enum posdb_tag tag);
+move_t posdb_make_move(struct board *brd, uint8_t code, struct undo *u);
+bool posdb_game_board(const struct posdb *db, const struct posdb_game *g, int ply, struct board *brd);
+uint64_t posdb_lookup(const struct posdb *db, uint64_t key, uint64_t *first);
+void posdb_stats(const struct posdb *db, struct board *brd, struct posdb_stats *st);
+
+
+#endif	/* __POSDB_H__ */
@@ -0,0 +1,546 @@
+/* @file:	tezdhar/src/puzzle.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/puzzle.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	tezdhar-puzzle, mines the games of a position database for
+ * 		tactics where exactly one move wins, and writes them as EPD.
+ *
+ *
+ *			--------------
+ *			Puzzle Mining
+ *			--------------
+ *
+ * A position is a puzzle if one move of the side to move wins at least
+ * the win threshold and every other move scores at most the alternative
+ * threshold, while the position is not won already. Almost no position of
+ * a game is one, so the tests go from the cheapest to the dearest and
+ * most positions are rejected by the first two:
+ *
+ *	quiet		the quiescence score must be below the win threshold
+ *			both ways, else the win is a plain capture or the
+ *			game is decided already
+ *	shallow		a search of a few plies must find a winning move
+ *	verify		a MultiPV search of 2 lines with the full node count
+ *			must find exactly one winning move
+ *	line		the solution is played out: the opponent answers
+ *			with its best move, and every following move of the
+ *			solver must again be the only winning one, until the
+ *			solver mates or is ahead by the win threshold even
+ *			after the captures of the opponent. A line which does
+ *			not end so within the maximum number of moves is
+ *			rejected
+ *
+ * The games are taken in blocks by the worker threads, each with its own
+ * transposition table which is cleared between games. The puzzles are
+ * written in game order, each position once, as
+ *
+ *	<position> bm <move>; pv <line>; ce <score>; hmvc <n>; fmvn <n>; id "<game>.<ply>";
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "posdb.h"
+#include "search.h"
+#include "tt.h"
+
+#include <stdio.h>	// for printf, snprintf, perror, fopen, fprintf
+#include <stdlib.h>	// for calloc, malloc, realloc, free, qsort, atoi
+#include <string.h>	// for memcpy, strchr, strlen
+
+#ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>	// for gettimeofday
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for getopt, sysconf
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create, pthread_join
+#endif
+
+#define PUZZLE_MAX_THREADS	256
+#define PUZZLE_BLOCK		64		// games taken at once by a thread
+#define PUZZLE_WIN		300		// default score of a winning move
+#define PUZZLE_ALT		100		// default best score of the other moves
+#define PUZZLE_DEPTH		3		// default depth of the shallow search
+#define PUZZLE_NODES		100000		// default nodes of a verification
+#define PUZZLE_MOVES		5		// default longest solution, solver moves
+#define PUZZLE_MIN_PLY		10		// default first ply tested
+#define PUZZLE_TT_KB		16384		// default table per thread
+#define PUZZLE_MAX_MOVES	16
+#define PUZZLE_LINE_LEN		(MAX_FEN_LEN + PUZZLE_MAX_MOVES * 2 * MAX_MOVE_LEN + 128)
+
+/* Stages of the filter, in order */
+enum puzzle_stage {
+	PUZZLE_QUIET,
+	PUZZLE_SHALLOW,
+	PUZZLE_VERIFY,
+	PUZZLE_LINE,
+	PUZZLE_FOUND,
+	PUZZLE_STAGES
+};
+
+static const char *const puzzle_stage_names[PUZZLE_STAGES] = {
+	"rejected as not quiet", "rejected by the shallow search", "rejected by verification",
+	"rejected on the solution line", "puzzles"
+};
+
+struct puzzle_options {
+	int win, alt;			// thresholds in centipawns
+	int depth;			// of the shallow search
+	uint64_t nodes;			// of a verification
+	int moves;			// most solver moves of a solution
+	int min_ply;
+	size_t tt_kb;
+};
+
+struct puzzle_miner {
+	const struct posdb *db;
+	struct puzzle_options opt;
+	struct board initial;		// start of games without a FEN
+	uint64_t next;			// next block of games to be taken
+};
+
+/* A puzzle found, its EPD record and where it comes from */
+struct puzzle {
+	uint64_t key;
+	uint32_t game;
+	uint16_t ply;
+	char epd[PUZZLE_LINE_LEN];
+};
+
+struct puzzle_worker {
+	struct puzzle_miner *m;
+	struct search s;
+	struct tt tt;
+	struct puzzle *found;
+	size_t nfound, cap;
+	uint64_t stages[PUZZLE_STAGES];	// positions leaving at each stage
+	uint64_t nodes;
+	bool failed;			// out of memory
+};
+
+
+/* Iteration callback, the search prints nothing */
+static void puzzle_report(const struct search *s, const int depth)
+{
+	(void)s;
+	(void)depth;
+}
+
+
+/* Search a position with the given limits */
+static void puzzle_search(struct puzzle_worker *w, const struct board *brd, const int depth,
+		const uint64_t nodes, const int multipv)
+{
+	const struct search_limits limits = {depth, 0, nodes, 0, multipv};
+
+	search_init(&w->s, brd, &limits);
+	w->s.report = puzzle_report;
+	w->s.tt = &w->tt;
+	search_position(&w->s);
+	w->nodes += w->s.stats.nodes;
+}
+
+
+/* Quiescence score of a position */
+static int puzzle_quiesce(struct puzzle_worker *w, const struct board *brd)
+{
+	const struct search_limits limits = {0, 0, 0, 0, 0};
+	int score;
+
+	search_init(&w->s, brd, &limits);
+	score = search_quiesce(&w->s);
+	w->nodes += w->s.stats.nodes;
+	return score;
+}
+
+
+/* Is there exactly one winning move, found by a verification search. A
+ * forced move is the only one */
+static bool puzzle_unique(struct puzzle_worker *w, const struct board *brd)
+{
+	const struct puzzle_options *o = &w->m->opt;
+
+	puzzle_search(w, brd, 0, o->nodes, 2);
+	return w->s.nlines && w->s.lines[0].score >= o->win &&
+		(w->s.nlines == 1 || w->s.lines[1].score <= o->alt);
+}
+
+
+/* Play out the solution from the first winning move, checking that every
+ * move of the solver is the only winning one. Returns the number of moves
+ * of the line, or 0 if it is rejected */
+static int puzzle_line(struct puzzle_worker *w, const struct board *start, move_t *line)
+{
+	const struct puzzle_options *o = &w->m->opt;
+	struct move_list legal;
+	struct board brd = *start;
+	struct undo u;
+	size_t n = 0;
+
+	line[n++] = w->s.lines[0].pv[0];
+	for (int moves = 1; ; moves++) {
+		make_move(&brd, line[n - 1], &u);
+
+		/* the solver mated, or is ahead whatever the opponent takes */
+		if (!gen_legal_moves(&brd, &legal)) {
+			return in_check(&brd, brd.turn) ? (int)n : 0;
+		}
+		if (-puzzle_quiesce(w, &brd) >= o->win) {
+			return (int)n;
+		}
+		if (moves == o->moves || n + 2 > PUZZLE_MAX_MOVES) {
+			return 0;
+		}
+
+		/* best answer of the opponent, then the only winning move */
+		puzzle_search(w, &brd, 0, o->nodes, 1);
+		if (!w->s.nlines) {
+			return 0;
+		}
+		line[n++] = w->s.lines[0].pv[0];
+		make_move(&brd, line[n - 1], &u);
+		if (!gen_legal_moves(&brd, &legal) || !puzzle_unique(w, &brd)) {
+			return 0;
+		}
+		line[n++] = w->s.lines[0].pv[0];
+	}
+}
+
+
+/* Format the EPD record of a puzzle */
+static void puzzle_epd(struct puzzle *p, const struct board *start, const move_t *line, const int n,
+		const int score)
+{
+	char fen[MAX_FEN_LEN], san[MAX_MOVE_LEN], *f = fen;
+	struct board brd = *start;
+	struct undo u;
+	size_t len;
+
+	/* the first four fields of the FEN */
+	board_to_fen(start, fen);
+	for (int i = 0; i < 4 && f; i++) {
+		f = strchr(f + 1, ' ');
+	}
+	if (f) {
+		*f = '\0';
+	}
+
+	move_to_san(&brd, line[0], san);
+	len = (size_t)snprintf(p->epd, sizeof(p->epd), "%s bm %s; pv", fen, san);
+	for (int i = 0; i < n && len < sizeof(p->epd); i++) {
+		move_to_san(&brd, line[i], san);
+		len += (size_t)snprintf(p->epd + len, sizeof(p->epd) - len, " %s", san);
+		make_move(&brd, line[i], &u);
+	}
+	if (len < sizeof(p->epd)) {
+		snprintf(p->epd + len, sizeof(p->epd) - len, "; ce %d; hmvc %u; fmvn %u; id \"%u.%u\";",
+				score, start->halfMoves, start->fullMoves, p->game, p->ply);
+	}
+}
+
+
+/* Run a position through the stages of the filter */
+static enum puzzle_stage puzzle_test(struct puzzle_worker *w, struct board *brd, const uint32_t game,
+		const int ply)
+{
+	const struct puzzle_options *o = &w->m->opt;
+	move_t line[PUZZLE_MAX_MOVES];
+	struct move_list legal;
+	struct puzzle *p;
+	int q, n, score;
+
+	q = puzzle_quiesce(w, brd);
+	if (q >= o->win || q <= -o->win) {
+		return PUZZLE_QUIET;
+	}
+
+	if (gen_legal_moves(brd, &legal) < 2) {
+		return PUZZLE_SHALLOW;
+	}
+	puzzle_search(w, brd, o->depth, o->nodes, 1);
+	if (w->s.best_score < o->win) {
+		return PUZZLE_SHALLOW;
+	}
+
+	if (!puzzle_unique(w, brd)) {
+		return PUZZLE_VERIFY;
+	}
+	score = w->s.lines[0].score;
+
+	if (!(n = puzzle_line(w, brd, line))) {
+		return PUZZLE_LINE;
+	}
+
+	if (w->nfound == w->cap) {
+		const size_t cap = w->cap ? w->cap * 2 : 64;
+
+		if (!(p = realloc(w->found, cap * sizeof(*p)))) {
+			perror("realloc failed");
+			w->failed = true;
+			return PUZZLE_LINE;
+		}
+		w->found = p;
+		w->cap = cap;
+	}
+	p = &w->found[w->nfound++];
+	p->key = zobrist_key(brd);
+	p->game = game;
+	p->ply = (uint16_t)ply;
+	puzzle_epd(p, brd, line, n, score);
+	return PUZZLE_FOUND;
+}
+
+
+static void *puzzle_worker(void *arg)
+{
+	struct puzzle_worker *w = arg;
+	const struct puzzle_miner *m = w->m;
+	const struct posdb *db = m->db;
+	struct posdb_game g;
+	struct board brd;
+	struct undo u;
+	uint64_t block, end;
+
+	while (!w->failed && (block = __atomic_fetch_add(&w->m->next, 1, __ATOMIC_RELAXED)) * PUZZLE_BLOCK < db->games) {
+		end = (block + 1) * PUZZLE_BLOCK < db->games ? (block + 1) * PUZZLE_BLOCK : db->games;
+
+		for (uint64_t id = block * PUZZLE_BLOCK; id < end && !w->failed; id++) {
+			posdb_get_game(db, (uint32_t)id, &g);
+			if (!*posdb_game_tag(db, &g, POSDB_FEN)) {
+				brd = m->initial;
+			} else if (!posdb_game_board(db, &g, 0, &brd)) {
+				continue;
+			}
+
+			tt_clear(&w->tt);
+			for (int ply = 0; ; ply++) {
+				if (ply >= m->opt.min_ply) {
+					w->stages[puzzle_test(w, &brd, (uint32_t)id, ply)]++;
+				}
+				if (ply == g.nmoves || g.moves + (uint64_t)ply >= db->moves_size ||
+						posdb_make_move(&brd, db->moves[g.moves + (uint64_t)ply], &u) == MOVE_NONE) {
+					break;
+				}
+			}
+		}
+	}
+
+	return NULL;
+}
+
+
+/* Order by key, then by game and ply, to drop repeated positions */
+static int puzzle_cmp_key(const void *a, const void *b)
+{
+	const struct puzzle *x = a, *y = b;
+
+	if (x->key != y->key) {
+		return (x->key > y->key) - (x->key < y->key);
+	}
+	if (x->game != y->game) {
+		return (x->game > y->game) - (x->game < y->game);
+	}
+	return (x->ply > y->ply) - (x->ply < y->ply);
+}
+
+
+/* Order by game and ply */
+static int puzzle_cmp_game(const void *a, const void *b)
+{
+	const struct puzzle *x = a, *y = b;
+
+	if (x->game != y->game) {
+		return (x->game > y->game) - (x->game < y->game);
+	}
+	return (x->ply > y->ply) - (x->ply < y->ply);
+}
+
+
+static void puzzle_usage(const char *prog)
+{
+	printf("Usage: %s [-j threads] [-w cp] [-a cp] [-d depth] [-n nodes] [-l moves] [-p ply] [-H kb]\n", prog);
+	printf("       -o file database\n\n");
+	printf("Find the positions of the games of a database where exactly one move wins,\n");
+	printf("and write them as EPD with the solution line.\n\n");
+	printf("  -j threads	number of threads (default: all cores)\n");
+	printf("  -w cp		score of a winning move in centipawns (default: %d)\n", PUZZLE_WIN);
+	printf("  -a cp		best score of the other moves (default: %d)\n", PUZZLE_ALT);
+	printf("  -d depth	depth of the shallow search (default: %d)\n", PUZZLE_DEPTH);
+	printf("  -n nodes	nodes of a verification search (default: %d)\n", PUZZLE_NODES);
+	printf("  -l moves	longest solution in moves of the solver (default: %d)\n", PUZZLE_MOVES);
+	printf("  -p ply	first ply of a game tested (default: %d)\n", PUZZLE_MIN_PLY);
+	printf("  -H kb		transposition table per thread (default: %d)\n", PUZZLE_TT_KB);
+	printf("  -o file	EPD file to write\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	static struct puzzle_miner m;
+	struct puzzle_worker *w;
+	struct puzzle *all = NULL;
+	struct timeval start, end;
+	struct posdb db;
+	char fen[MAX_FEN_LEN] = INITIAL_FEN;
+	const char *out = NULL;
+	uint64_t stages[PUZZLE_STAGES] = {0}, positions = 0, nodes = 0;
+	size_t n = 0, kept = 0;
+	int opt, threads = 1;
+	double secs;
+	bool ok = true;
+	FILE *fp;
+#ifdef HAVE_PTHREAD_H
+	pthread_t tid[PUZZLE_MAX_THREADS];
+	int started = 0;
+#endif
+
+#if defined HAVE_SYSCONF && defined _SC_NPROCESSORS_ONLN
+	threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	m.opt.win = PUZZLE_WIN;
+	m.opt.alt = PUZZLE_ALT;
+	m.opt.depth = PUZZLE_DEPTH;
+	m.opt.nodes = PUZZLE_NODES;
+	m.opt.moves = PUZZLE_MOVES;
+	m.opt.min_ply = PUZZLE_MIN_PLY;
+	m.opt.tt_kb = PUZZLE_TT_KB;
+
+	while ((opt = getopt(argc, argv, "j:w:a:d:n:l:p:H:o:h")) != -1) {
+		switch (opt) {
+			case 'j': threads = atoi(optarg); break;
+			case 'w': m.opt.win = atoi(optarg); break;
+			case 'a': m.opt.alt = atoi(optarg); break;
+			case 'd': m.opt.depth = atoi(optarg); break;
+			case 'n': m.opt.nodes = strtoull(optarg, NULL, 10); break;
+			case 'l': m.opt.moves = atoi(optarg); break;
+			case 'p': m.opt.min_ply = atoi(optarg); break;
+			case 'H': m.opt.tt_kb = strtoull(optarg, NULL, 10); break;
+			case 'o': out = optarg; break;
+			case 'h': puzzle_usage(argv[0]); return EXIT_SUCCESS;
+			default:  puzzle_usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+
+	if (!out || optind != argc - 1 || threads < 1 || m.opt.alt >= m.opt.win || m.opt.depth < 1 ||
+			m.opt.depth >= MAX_PLY || !m.opt.nodes || m.opt.moves < 1 ||
+			m.opt.moves > PUZZLE_MAX_MOVES / 2 || m.opt.min_ply < 0) {
+		puzzle_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads > PUZZLE_MAX_THREADS) {
+		threads = PUZZLE_MAX_THREADS;
+	}
+
+	init_leaper_attacks();
+	init_magic_numbers();
+	init_slider_attacks();
+	init_zobrist_keys();
+
+	if (!posdb_open(&db, argv[optind])) {
+		return EXIT_FAILURE;
+	}
+	m.db = &db;
+	init_board(fen, &m.initial, AI, AI);
+
+	if (!(w = calloc((size_t)threads, sizeof(*w)))) {
+		perror("calloc failed");
+		return EXIT_FAILURE;
+	}
+	for (int t = 0; t < threads; t++) {
+		w[t].m = &m;
+		if (!tt_init(&w[t].tt, m.opt.tt_kb)) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	gettimeofday(&start, NULL);
+#ifdef HAVE_PTHREAD_H
+	for (int t = 1; t < threads; t++) {
+		if (pthread_create(&tid[started], NULL, puzzle_worker, &w[t]) == 0) {
+			started++;
+		}
+	}
+	puzzle_worker(&w[0]);
+	for (int t = 0; t < started; t++) {
+		pthread_join(tid[t], NULL);
+	}
+#else
+	puzzle_worker(&w[0]);
+#endif
+	gettimeofday(&end, NULL);
+
+	secs = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1e6;
+	if (secs <= 0) {
+		secs = 1e-6;
+	}
+
+	for (int t = 0; t < threads; t++) {
+		for (int i = 0; i < PUZZLE_STAGES; i++) {
+			stages[i] += w[t].stages[i];
+			positions += w[t].stages[i];
+		}
+		nodes += w[t].nodes;
+		n += w[t].nfound;
+		ok = ok && !w[t].failed;
+	}
+	if (ok && n && !(all = malloc(n * sizeof(*all)))) {
+		perror("malloc failed");
+		ok = false;
+	}
+
+	if (ok) {
+		n = 0;
+		for (int t = 0; t < threads; t++) {
+			memcpy(all + n, w[t].found, w[t].nfound * sizeof(*all));
+			n += w[t].nfound;
+		}
+
+		/* keep the first game of a position */
+		qsort(all, n, sizeof(*all), puzzle_cmp_key);
+		for (size_t i = 0; i < n; i++) {
+			if (!kept || all[i].key != all[kept - 1].key) {
+				all[kept++] = all[i];
+			}
+		}
+		qsort(all, kept, sizeof(*all), puzzle_cmp_game);
+
+		if (!(fp = fopen(out, "w"))) {
+			perror(out);
+			ok = false;
+		} else {
+			for (size_t i = 0; i < kept; i++) {
+				fprintf(fp, "%s\n", all[i].epd);
+			}
+			if (ferror(fp) | fclose(fp)) {
+				perror(out);
+				ok = false;
+			}
+		}
+	}
+
+	printf("%llu positions of %llu games, %llu nodes in %.2f seconds with %d threads\n",
+			(unsigned long long)positions, (unsigned long long)db.games,
+			(unsigned long long)nodes, secs, threads);
+	for (int i = 0; i < PUZZLE_STAGES; i++) {
+		printf("%12llu %s\n", (unsigned long long)stages[i], puzzle_stage_names[i]);
+	}
+	printf("%12llu puzzles written, %.1f positions per second\n", (unsigned long long)kept,
+			(double)positions / secs);
+
+	for (int t = 0; t < threads; t++) {
+		tt_free(&w[t].tt);
+		free(w[t].found);
+	}
+	free(w);
+	free(all);
+	posdb_close(&db);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
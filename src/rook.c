@@ -11,12 +11,6 @@
 #include "bitboard.h"
 #include "chess.h"
 
-/* Rook lookup table for magic index */
-static struct magic_lut R_lut[64];
-
-/* Rook attacks table [square][blocker_occupancy_variation] */
-static uint64_t Rattacks[64][4096];	// 2048 KiB (32 KiB for each square)
-
 
 /* mask relevant rook occupancy bits excluding edges */
 static uint64_t rook_occu_mask(const enum square sq)
@@ -108,32 +102,37 @@ bool init_rook_magic(const bool use_pre_calc_magic)
 	enum square sq;
 	for (sq = A1; sq <= H8; sq++) {
 		/* rook attack mask excluding edges */
-		R_lut[sq].mask = rook_occu_mask(sq);
+		attack_tables->rook_lut[sq].mask = rook_occu_mask(sq);
 
 		/* rook relevant occupancy bits count */
-		R_lut[sq].obits = count_bits(R_lut[sq].mask);
+		attack_tables->rook_lut[sq].obits = count_bits(attack_tables->rook_lut[sq].mask);
 
 		if (use_pre_calc_magic) {
-			R_lut[sq].magic = rook_magic_numbers[sq];
+			attack_tables->rook_lut[sq].magic = rook_magic_numbers[sq];
 		} else {
-			R_lut[sq].magic = find_magic_number(ROOK, sq, R_lut[sq].mask, R_lut[sq].obits);
+			attack_tables->rook_lut[sq].magic = find_magic_number(ROOK, sq, attack_tables->rook_lut[sq].mask, attack_tables->rook_lut[sq].obits);
 		}
 
-		if (!R_lut[sq].magic) {
+		if (!attack_tables->rook_lut[sq].magic) {
 			dbg_print("Failed to get rook magic no. for sq %s\n", sqr_to_coords[sq]);
 			return false;
 		}
-		printf("\rGenerating magic numbers for Rook: %.2f %%", ((double)sq / 0.63));
-		fflush(stdout);
+		/* only a search for new magics takes long enough to show */
+		if (!use_pre_calc_magic) {
+			printf("\rGenerating magic numbers for Rook: %.2f %%", ((double)sq / 0.63));
+			fflush(stdout);
+		}
+	}
+	if (!use_pre_calc_magic) {
+		printf("\n");
 	}
-	printf("\n");
 
 #ifdef DEBUG
 	for (sq = A1; sq <= H8; sq++) {
 		//printf("Occupancy mask for rook at [%s]", sqr_to_coords[sq]);
-		//print_bitboard(R_lut[sq].mask);
-		//printf("Rook occupancy mask relevant bits at [%s] = %d\n", sqr_to_coords[sq], R_lut[sq].obits);
-		//printf("Rook magic number[%s] = 0x%llx\n", sqr_to_coords[sq], R_lut[sq].magic);
+		//print_bitboard(attack_tables->rook_lut[sq].mask);
+		//printf("Rook occupancy mask relevant bits at [%s] = %d\n", sqr_to_coords[sq], attack_tables->rook_lut[sq].obits);
+		//printf("Rook magic number[%s] = 0x%llx\n", sqr_to_coords[sq], attack_tables->rook_lut[sq].magic);
 	}
 #endif
 	return true;
@@ -149,17 +148,17 @@ void init_rook_attacks(void)
 
 	for (sq = A1; sq <= H8; sq++) {
 		//printf("\n\n\n <<<<================= [ %d ] =================>>>>\n\n", sq);
-		for (i = 0; i < (1 << R_lut[sq].obits); i++) {
-			occu = set_occupancy(i, R_lut[sq].obits, R_lut[sq].mask);
+		for (i = 0; i < (1 << attack_tables->rook_lut[sq].obits); i++) {
+			occu = set_occupancy(i, attack_tables->rook_lut[sq].obits, attack_tables->rook_lut[sq].mask);
 
-			magic_idx = (int)((occu * R_lut[sq].magic) >> (64 - R_lut[sq].obits));
+			magic_idx = (int)((occu * attack_tables->rook_lut[sq].magic) >> (64 - attack_tables->rook_lut[sq].obits));
 
-			Rattacks[sq][magic_idx] = rook_attacks_on_the_fly(sq, occu);
+			attack_tables->rook[sq][magic_idx] = rook_attacks_on_the_fly(sq, occu);
 #if DEBUG
 			//printf("Rook Occu variation [%2d][%4d] = 0x%-16llx\t", sq, i, occu);
-			//printf("Relv bits: %2d\tMagic[%2d]: 0x%-16llx\t", R_lut[sq].obits, sq, R_lut[sq].magic);
+			//printf("Relv bits: %2d\tMagic[%2d]: 0x%-16llx\t", attack_tables->rook_lut[sq].obits, sq, attack_tables->rook_lut[sq].magic);
 			//printf("Magic index: %4d\t", magic_idx);
-			//printf("Rattacks[%2d][%4d] = 0x%llx\n", sq, magic_idx, Rattacks[sq][magic_idx]);
+			//printf("Rattacks[%2d][%4d] = 0x%llx\n", sq, magic_idx, attack_tables->rook[sq][magic_idx]);
 #endif
 		}
 	}
@@ -169,10 +168,12 @@ void init_rook_attacks(void)
 /* Return rook attacks for a particular blocker occupancy */
 uint64_t get_rook_attacks(const enum square sq, uint64_t occu)
 {
-	occu &= R_lut[sq].mask;
-	occu *= R_lut[sq].magic;
-	occu >>= 64 - R_lut[sq].obits;
+	const struct magic_lut *lut = &attack_tables->rook_lut[sq];
+
+	occu &= lut->mask;
+	occu *= lut->magic;
+	occu >>= 64 - lut->obits;
 
-	return Rattacks[sq][occu];
+	return attack_tables->rook[sq][occu];
 }
 
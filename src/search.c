@@ -0,0 +1,662 @@
+/* @file:	tezdhar/src/search.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/search.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Iterative deepening alpha-beta search with quiescence search
+ * 		and endgame tablebase probing.
+ *
+ *
+ *			---------------------------
+ *			Tablebase Probes in Search
+ *			---------------------------
+ *
+ * A WDL probe decompresses a block of a memory mapped file, which is far
+ * more expensive than a node of the search. So interior nodes are probed
+ * only right after a capture or a pawn move: only these moves change the
+ * material or the pawn structure, so every other position of a subtree
+ * has already been probed through its zeroing ancestor. A successful probe
+ * ends the subtree with an exact score.
+ *
+ * At the root the DTM tables are probed for every move instead, and only
+ * the moves with the best distance to mate are searched. This lets the
+ * search make progress in won endgames, where many moves keep the win
+ * but only some of them bring the mate nearer.
+ *
+ *
+ *			--------------------
+ *			Transposition Table
+ *			--------------------
+ *
+ * If the search has a table, interior nodes store their score, bound and
+ * best move under the Zobrist key of the position. A stored result of at
+ * least the remaining depth ends the node if its bound allows, and the
+ * stored move is searched first otherwise. Mate and tablebase scores are
+ * stored relative to the node rather than to the root, so that they stay
+ * right when the position is reached at another ply.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "bitboard.h"
+#include "search.h"
+#include "tb.h"
+#include "tt.h"
+
+#include <stdio.h>	// for printf, snprintf
+#include <string.h>	// for memcpy, memset
+
+#define CHECK_NODES	2047	// poll time and stop flag every so many nodes
+
+
+/* move ordering values, indexed by enum chessmen */
+static const int order_value[EMPTY + 1] = {10, 9, 3, 3, 5, 1, 0};
+
+
+long search_elapsed(const struct search *s)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - s->start.tv_sec) * 1000L +
+		(now.tv_usec - s->start.tv_usec) / 1000L;
+}
+
+
+/* Ask a running search to return as soon as possible, may be called from
+ * another thread */
+void search_stop(struct search *s)
+{
+	__atomic_store_n(&s->stop, true, __ATOMIC_RELAXED);
+}
+
+
+static bool search_should_stop(struct search *s)
+{
+	if ((s->stats.nodes & CHECK_NODES) == 0) {
+		/* movetime may be set by another thread, e.g. on UCI ponderhit */
+		const long movetime = __atomic_load_n(&s->limits.movetime, __ATOMIC_RELAXED);
+
+		if ((movetime && search_elapsed(s) >= movetime) ||
+				(s->limits.nodes && s->stats.nodes >= s->limits.nodes)) {
+			search_stop(s);
+		}
+	}
+
+	return __atomic_load_n(&s->stop, __ATOMIC_RELAXED);
+}
+
+
+/* Captures of valuable pieces by cheap ones first (MVV-LVA), then
+ * promotions and quiet moves. Selection sort, as cutoffs usually happen
+ * after the first few moves */
+static int move_order_score(const move_t m)
+{
+	int score = 0;
+
+	if (MOVE_CAPTURED(m) != EMPTY_SQR) {
+		score += 100 + 10 * order_value[piece_type(MOVE_CAPTURED(m))] -
+			order_value[piece_type(MOVE_PIECE(m))];
+	}
+	if (MOVE_PROMOTED(m) != EMPTY_SQR) {
+		score += 50 + order_value[piece_type(MOVE_PROMOTED(m))];
+	}
+
+	return score;
+}
+
+
+static void pick_move(struct move_list * const list, const int from)
+{
+	int best = from, best_score = move_order_score(list->moves[from]);
+	move_t tmp;
+
+	for (int i = from + 1; i < list->count; i++) {
+		int score = move_order_score(list->moves[i]);
+		if (score > best_score) {
+			best = i;
+			best_score = score;
+		}
+	}
+
+	tmp = list->moves[from];
+	list->moves[from] = list->moves[best];
+	list->moves[best] = tmp;
+}
+
+
+static int piece_count(const struct board * const brd)
+{
+	return BITS(get_all_pieces(&brd->bb));
+}
+
+
+/* Probe WDL tables for an exact score of the current node */
+static bool probe_wdl(struct search *s, int *score)
+{
+	enum tb_wdl wdl;
+
+	if (!s->limits.tb_probe_limit || piece_count(&s->brd) > s->limits.tb_probe_limit ||
+			!tb_probe_wdl(&s->brd, &wdl)) {
+		return false;
+	}
+
+	s->stats.tbhits++;
+	switch (wdl) {
+		case TB_WIN:	*score = SCORE_TB_WIN - s->ply; break;
+		case TB_LOSS:	*score = -SCORE_TB_WIN + s->ply; break;
+		case TB_DRAW:
+		default:	*score = 0; break;
+	}
+
+	return true;
+}
+
+
+/* Mate and tablebase scores in the table count plies from the node */
+static int score_to_tt(const int score, const int ply)
+{
+	if (score > SCORE_TB_WIN - MAX_PLY) {
+		return score + ply;
+	}
+	if (score < -SCORE_TB_WIN + MAX_PLY) {
+		return score - ply;
+	}
+	return score;
+}
+
+
+static int score_from_tt(const int score, const int ply)
+{
+	if (score > SCORE_TB_WIN - MAX_PLY) {
+		return score - ply;
+	}
+	if (score < -SCORE_TB_WIN + MAX_PLY) {
+		return score + ply;
+	}
+	return score;
+}
+
+
+/* Move m to the front of the list, if it is there */
+static bool hoist_move(struct move_list * const list, const move_t m)
+{
+	for (int i = 0; i < list->count; i++) {
+		if (list->moves[i] == m) {
+			list->moves[i] = list->moves[0];
+			list->moves[0] = m;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+static void update_pv(struct search *s, const move_t m)
+{
+	const int ply = s->ply;
+
+	s->pv[ply][ply] = m;
+	for (int i = ply + 1; i < s->pv_len[ply + 1]; i++) {
+		s->pv[ply][i] = s->pv[ply + 1][i];
+	}
+	s->pv_len[ply] = s->pv_len[ply + 1];
+}
+
+
+/* Search captures only until the position is quiet, so that the static
+ * evaluation is not taken in the middle of an exchange */
+static int quiescence(struct search *s, int alpha, const int beta)
+{
+	struct move_list list;
+	struct undo u;
+	int score;
+
+	s->pv_len[s->ply] = s->ply;
+	s->stats.nodes++;
+	if (s->ply > s->stats.seldepth) {
+		s->stats.seldepth = s->ply;
+	}
+
+	if (search_should_stop(s)) {
+		return 0;
+	}
+
+	score = evaluate(&s->brd);
+	if (s->ply >= MAX_PLY || score >= beta) {
+		return score;
+	}
+	if (score > alpha) {
+		alpha = score;
+	}
+
+	gen_moves(&s->brd, &list, true);
+	for (int i = 0; i < list.count; i++) {
+		pick_move(&list, i);
+		if (!make_move(&s->brd, list.moves[i], &u)) {
+			continue;
+		}
+
+		s->ply++;
+		score = -quiescence(s, -beta, -alpha);
+		s->ply--;
+		unmake_move(&s->brd, list.moves[i], &u);
+
+		if (s->stop) {
+			return 0;
+		}
+		if (score > alpha) {
+			alpha = score;
+			update_pv(s, list.moves[i]);
+			if (score >= beta) {
+				break;
+			}
+		}
+	}
+
+	return alpha;
+}
+
+
+/* Quiescence score of the position from the side to move's point of view,
+ * a cheap estimate which resolves the pending captures only */
+int search_quiesce(struct search *s)
+{
+	gettimeofday(&s->start, NULL);
+	s->ply = 0;
+	return quiescence(s, -SCORE_INF, SCORE_INF);
+}
+
+
+/* Fail-hard negamax alpha-beta search. 'zeroing' is set when the move
+ * leading to this node was a capture or a pawn move */
+static int alpha_beta(struct search *s, int alpha, const int beta, int depth, const bool zeroing)
+{
+	const int old_alpha = alpha;
+	struct move_list list;
+	struct tt_entry e;
+	struct undo u;
+	uint64_t key = 0;
+	move_t tt_move = MOVE_NONE;
+	bool check, hoisted;
+	int score, legal = 0;
+
+	s->pv_len[s->ply] = s->ply;
+
+	if (s->brd.halfMoves >= 100) {
+		return 0;
+	}
+
+	if (zeroing && probe_wdl(s, &score)) {
+		return score;
+	}
+
+	check = in_check(&s->brd, s->brd.turn);
+	if (check) {
+		depth++;	// check extension
+	}
+
+	if (depth <= 0 || s->ply >= MAX_PLY) {
+		return quiescence(s, alpha, beta);
+	}
+
+	s->stats.nodes++;
+	if (search_should_stop(s)) {
+		return 0;
+	}
+
+	if (s->tt) {
+		key = s->brd.key;
+		if (tt_probe(s->tt, key, &e)) {
+			tt_move = e.move;
+			score = score_from_tt(e.score, s->ply);
+			if (e.depth >= depth && (e.bound == TT_EXACT ||
+						(e.bound == TT_LOWER && score >= beta) ||
+						(e.bound == TT_UPPER && score <= alpha))) {
+				return score >= beta ? beta : score <= alpha ? alpha : score;
+			}
+		}
+	}
+
+	gen_moves(&s->brd, &list, false);
+	hoisted = tt_move != MOVE_NONE && hoist_move(&list, tt_move);
+	for (int i = 0; i < list.count; i++) {
+		if (i || !hoisted) {
+			pick_move(&list, i);
+		}
+		if (!make_move(&s->brd, list.moves[i], &u)) {
+			continue;
+		}
+		legal++;
+
+		s->ply++;
+		score = -alpha_beta(s, -beta, -alpha, depth - 1,
+				MOVE_CAPTURED(list.moves[i]) != EMPTY_SQR ||
+				piece_type(MOVE_PIECE(list.moves[i])) == PAWN);
+		s->ply--;
+		unmake_move(&s->brd, list.moves[i], &u);
+
+		if (s->stop) {
+			return 0;
+		}
+		if (score > alpha) {
+			alpha = score;
+			update_pv(s, list.moves[i]);
+			if (score >= beta) {
+				if (s->tt) {
+					tt_store(s->tt, key, list.moves[i], score_to_tt(beta, s->ply),
+							depth, TT_LOWER);
+				}
+				return beta;
+			}
+		}
+	}
+
+	if (!legal) {
+		return check ? -SCORE_MATE + s->ply : 0;
+	}
+
+	if (s->tt) {
+		tt_store(s->tt, key, alpha > old_alpha ? s->pv[s->ply][s->ply] : MOVE_NONE,
+				score_to_tt(alpha, s->ply), depth, alpha > old_alpha ? TT_EXACT : TT_UPPER);
+	}
+	return alpha;
+}
+
+
+/* Search all root moves, the best move of the last iteration first */
+static int search_root(struct search *s, const int depth)
+{
+	int alpha = -SCORE_INF, score;
+	struct undo u;
+
+	s->pv_len[0] = 0;
+
+	for (int i = 0; i < s->root.count; i++) {
+		const move_t m = s->root.moves[i];
+
+		make_move(&s->brd, m, &u);
+		s->ply++;
+		score = -alpha_beta(s, -SCORE_INF, -alpha, depth - 1,
+				MOVE_CAPTURED(m) != EMPTY_SQR || piece_type(MOVE_PIECE(m)) == PAWN);
+		s->ply--;
+		unmake_move(&s->brd, m, &u);
+
+		if (s->stop) {
+			break;
+		}
+		if (score > alpha) {
+			alpha = score;
+			update_pv(s, m);
+			/* keep the best move at the front for the next iteration */
+			for (int j = i; j > 0; j--) {
+				s->root.moves[j] = s->root.moves[j - 1];
+			}
+			s->root.moves[0] = m;
+		}
+	}
+
+	return alpha;
+}
+
+
+/* Search all root moves keeping the multipv best ones with exact scores.
+ * A move is searched with the score of the worst kept line as alpha, so
+ * only moves which may enter the kept lines are searched exactly. The
+ * lines are sorted by score and their moves lead the root moves of the
+ * next iteration */
+static int search_root_multipv(struct search *s, const int depth)
+{
+	const int want = s->limits.multipv < MAX_MULTIPV ? s->limits.multipv : MAX_MULTIPV;
+	const int k = want < s->root.count ? want : s->root.count;
+	struct search_line lines[MAX_MULTIPV];
+	int n = 0, pos, alpha, score, j;
+	struct undo u;
+
+	for (int i = 0; i < s->root.count; i++) {
+		const move_t m = s->root.moves[i];
+
+		alpha = n < k ? -SCORE_INF : lines[k - 1].score;
+		make_move(&s->brd, m, &u);
+		s->ply++;
+		score = -alpha_beta(s, -SCORE_INF, -alpha, depth - 1,
+				MOVE_CAPTURED(m) != EMPTY_SQR || piece_type(MOVE_PIECE(m)) == PAWN);
+		s->ply--;
+		unmake_move(&s->brd, m, &u);
+
+		if (s->stop) {
+			break;
+		}
+		if (n == k && score <= alpha) {
+			continue;
+		}
+
+		/* insert into the kept lines, dropping the worst */
+		pos = n < k ? n++ : k - 1;
+		while (pos > 0 && lines[pos - 1].score < score) {
+			lines[pos] = lines[pos - 1];
+			pos--;
+		}
+		lines[pos].score = score;
+		lines[pos].pv[0] = m;
+		lines[pos].pv_len = s->pv_len[1] > 1 ? s->pv_len[1] : 1;
+		memcpy(&lines[pos].pv[1], &s->pv[1][1], sizeof(move_t) * (size_t)(lines[pos].pv_len - 1));
+	}
+
+	if (!n) {
+		s->pv_len[0] = 0;
+		return -SCORE_INF;
+	}
+
+	/* kept moves first, in line order, for the next iteration */
+	for (int i = 0; i < n; i++) {
+		for (j = i; j < s->root.count && s->root.moves[j] != lines[i].pv[0]; j++)
+			;
+		for (; j > i; j--) {
+			s->root.moves[j] = s->root.moves[j - 1];
+		}
+		s->root.moves[i] = lines[i].pv[0];
+	}
+
+	memcpy(s->pv[0], lines[0].pv, sizeof(move_t) * (size_t)lines[0].pv_len);
+	s->pv_len[0] = lines[0].pv_len;
+	if (!s->stop) {
+		memcpy(s->lines, lines, sizeof(lines[0]) * (size_t)n);
+		s->nlines = n;
+	}
+	return lines[0].score;
+}
+
+
+/* Distance to mate of a root move from the mover's point of view: a win
+ * in n moves ranks 1000 - n, a loss in n moves -1000 + n, a draw 0 */
+static bool root_move_dtm(struct search *s, const move_t m, int *rank)
+{
+	struct move_list replies;
+	struct undo u;
+	bool ok = true;
+	int dtm;
+
+	make_move(&s->brd, m, &u);
+	if (!gen_legal_moves(&s->brd, &replies)) {
+		*rank = in_check(&s->brd, s->brd.turn) ? 1000 - 1 : 0;
+	} else if ((ok = tb_probe_dtm(&s->brd, &dtm))) {
+		s->stats.tbhits++;
+		*rank = dtm < 0 ? 1000 - (1 - dtm) : dtm > 0 ? -1000 + dtm : 0;
+	}
+	unmake_move(&s->brd, m, &u);
+
+	return ok;
+}
+
+
+/* Keep only root moves with the best distance to mate. Moves which can
+ * not be probed (e.g. allowing en-passant) are kept unless a win exists.
+ * The distance to mate also becomes the reported root score */
+static void filter_root_moves(struct search *s)
+{
+	int rank[MAX_MOVES], best = -1001, n = 0;
+	bool known[MAX_MOVES], all_known = true;
+	int dtm;
+
+	if (!s->limits.tb_probe_limit || piece_count(&s->brd) > s->limits.tb_probe_limit ||
+			!tb_probe_dtm(&s->brd, &dtm)) {
+		return;
+	}
+
+	for (int i = 0; i < s->root.count; i++) {
+		known[i] = root_move_dtm(s, s->root.moves[i], &rank[i]);
+		if (!known[i]) {
+			all_known = false;
+		}
+		if (known[i] && rank[i] > best) {
+			best = rank[i];
+		}
+	}
+
+	for (int i = 0; i < s->root.count; i++) {
+		if ((known[i] && rank[i] == best) || (!known[i] && best <= 0)) {
+			s->root.moves[n++] = s->root.moves[i];
+		}
+	}
+
+	s->root.count = n;
+
+	/* a win is exact even if some moves were not probed */
+	if (best > 0 || all_known) {
+		s->tb_root = true;
+		s->tb_score = best > 0 ? SCORE_MATE - 2 * (1000 - best) + 1 :
+			best < 0 ? -SCORE_MATE + 2 * (best + 1000) : 0;
+	}
+}
+
+
+void search_init(struct search *s, const struct board *brd, const struct search_limits *limits)
+{
+	memset(s, 0, sizeof(*s));
+	memcpy(&s->brd, brd, sizeof(*brd));
+	s->brd.key = zobrist_key(&s->brd);	// boards may be set up before the keys
+	s->limits = *limits;
+}
+
+
+/* Format UCI style info line of a completed iteration, without newline.
+ * The line is truncated at a move boundary if buf is too small */
+void format_search_info(const struct search *s, const int depth, char *buf, const size_t len)
+{
+	const long ms = search_elapsed(s);
+	const int score = s->best_score;
+	char uci[MAX_UCI_LEN];
+	size_t n;
+	int k;
+
+	if (score > SCORE_MATE - MAX_PLY) {
+		k = snprintf(buf, len, "info depth %d seldepth %d score mate %d", depth,
+				s->stats.seldepth, (SCORE_MATE - score + 1) / 2);
+	} else if (score < -SCORE_MATE + MAX_PLY) {
+		k = snprintf(buf, len, "info depth %d seldepth %d score mate %d", depth,
+				s->stats.seldepth, -(SCORE_MATE + score) / 2);
+	} else {
+		k = snprintf(buf, len, "info depth %d seldepth %d score cp %d", depth,
+				s->stats.seldepth, score);
+	}
+	n = k > 0 ? (size_t)k : 0;
+
+	k = snprintf(buf + (n < len ? n : len), n < len ? len - n : 0,
+			" nodes %llu nps %llu tbhits %llu time %ld pv",
+			(unsigned long long)s->stats.nodes,
+			(unsigned long long)(s->stats.nodes * 1000 / (uint64_t)(ms > 0 ? ms : 1)),
+			(unsigned long long)s->stats.tbhits, ms);
+	n += k > 0 ? (size_t)k : 0;
+
+	for (int i = 0; i < s->pv_len[0] && n + MAX_UCI_LEN + 1 < len; i++) {
+		move_to_uci(s->pv[0][i], uci);
+		n += (size_t)snprintf(buf + n, len - n, " %s", uci);
+	}
+}
+
+
+/* Print UCI style info line of a completed iteration */
+void print_search_info(const struct search *s, const int depth)
+{
+	char line[SEARCH_INFO_LEN];
+
+	format_search_info(s, depth, line, sizeof(line));
+	printf("%s\n", line);
+	fflush(stdout);
+}
+
+
+/* Search the position with iterative deepening until a limit is reached.
+ * Returns the best move, or MOVE_NONE if there is no legal move */
+move_t search_position(struct search *s)
+{
+	const int max_depth = s->limits.depth > 0 && s->limits.depth < MAX_PLY ?
+		s->limits.depth : MAX_PLY;
+	move_t pv[MAX_PLY + 1];
+	int pv_len = 0, score;
+
+	gettimeofday(&s->start, NULL);
+	if (!gen_legal_moves(&s->brd, &s->root)) {
+		return MOVE_NONE;
+	}
+
+	/* restrict the root to the given moves, e.g. UCI searchmoves */
+	if (s->searchmoves.count) {
+		int n = 0;
+
+		for (int i = 0; i < s->root.count; i++) {
+			for (int j = 0; j < s->searchmoves.count; j++) {
+				if (s->root.moves[i] == s->searchmoves.moves[j]) {
+					s->root.moves[n++] = s->root.moves[i];
+					break;
+				}
+			}
+		}
+		if (n) {
+			s->root.count = n;
+		}
+	}
+
+	filter_root_moves(s);
+	s->best_move = s->root.moves[0];
+
+	for (int depth = 1; depth <= max_depth; depth++) {
+		score = s->limits.multipv > 1 ? search_root_multipv(s, depth) : search_root(s, depth);
+		if (s->stop && depth > 1) {
+			break;
+		}
+
+		s->best_move = s->root.moves[0];
+		s->best_score = s->tb_root ? s->tb_score : score;
+		pv_len = s->pv_len[0];
+		memcpy(pv, s->pv[0], sizeof(move_t) * (size_t)pv_len);
+		if (s->limits.multipv <= 1) {
+			s->lines[0].score = s->best_score;
+			s->lines[0].pv_len = pv_len;
+			memcpy(s->lines[0].pv, pv, sizeof(move_t) * (size_t)pv_len);
+			s->nlines = 1;
+		}
+
+		if (s->report) {
+			s->report(s, depth);
+		} else {
+			print_search_info(s, depth);
+		}
+
+		/* a forced move or a mate needs no deeper search */
+		if (s->stop || (s->root.count == 1 && !s->limits.depth) ||
+				(IS_MATE_SCORE(score) && SCORE_MATE - (score > 0 ? score : -score) < depth)) {
+			break;
+		}
+	}
+
+	/* restore PV of the last completed iteration */
+	memcpy(s->pv[0], pv, sizeof(move_t) * (size_t)pv_len);
+	s->pv_len[0] = pv_len;
+
+	return s->best_move;
+}
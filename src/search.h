@@ -0,0 +1,96 @@
+/* @file:	tezdhar/src/search.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/search.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Search state, limits and statistics. All state of a search is
+ * 		kept in struct search, so that several searches can run side
+ * 		by side on their own board copies.
+ */
+
+#ifndef __SEARCH_H__
+#define __SEARCH_H__	1
+
+#include "chess.h"
+
+#ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>	// for struct timeval
+#endif
+
+#define MAX_PLY		128		// deepest ply searched
+#define MAX_MULTIPV	16		// most lines of a MultiPV search
+#define SEARCH_INFO_LEN	(128 + MAX_PLY * MAX_UCI_LEN)	// info line with full PV
+
+/* Scores are in centipawns from the point of view of the side to move.
+ * Tablebase wins rank below any mate found by the search itself */
+#define SCORE_INF	32000
+#define SCORE_MATE	31000		// mate at root, minus distance in plies
+#define SCORE_TB_WIN	30000		// tablebase win, minus distance in plies
+#define IS_MATE_SCORE(s)	((s) > SCORE_MATE - MAX_PLY || (s) < -SCORE_MATE + MAX_PLY)
+
+
+/* Limits of a search, zero means unlimited */
+struct search_limits {
+	int depth;			// iterative deepening depth
+	long movetime;			// time to search in milliseconds
+	uint64_t nodes;			// number of nodes to search
+	int tb_probe_limit;		// probe tablebases up to so many pieces
+	int multipv;			// best root moves scored exactly, 0 for one
+};
+
+/* Statistics of a running search */
+struct search_stats {
+	uint64_t nodes;			// nodes visited, quiescence included
+	uint64_t tbhits;		// successful tablebase probes
+	int seldepth;			// deepest ply reached
+};
+
+/* A root move with its exact score and principal variation */
+struct search_line {
+	move_t pv[MAX_PLY + 1];
+	int pv_len;
+	int score;
+};
+
+struct search;
+struct tt;
+
+/* Called after every completed iteration, e.g. to print a UCI info line */
+typedef void (*search_report_fn)(const struct search *s, int depth);
+
+struct search {
+	struct board brd;		// private copy of the position
+	struct search_limits limits;
+	struct search_stats stats;
+	struct timeval start;		// time when the search started
+	search_report_fn report;	// iteration callback, NULL to print
+	void *report_arg;		// context of the callback
+	struct tt *tt;			// transposition table, NULL for none
+	bool stop;			// set to abort the search
+	bool tb_root;			// root score is known from DTM tables
+	int tb_score;			// and its value
+	int ply;			// distance from root
+
+	struct move_list root;		// moves searched at the root
+	struct move_list searchmoves;	// restrict root to these, if any
+	move_t pv[MAX_PLY + 1][MAX_PLY + 1];	// triangular PV table
+	int pv_len[MAX_PLY + 1];
+
+	move_t best_move;		// best move of last completed iteration
+	int best_score;			// and its score
+	struct search_line lines[MAX_MULTIPV];	// best lines of last iteration
+	int nlines;
+};
+
+
+/* Function prototypes */
+void search_init(struct search *s, const struct board *brd, const struct search_limits *limits);
+move_t search_position(struct search *s);
+int search_quiesce(struct search *s);
+void search_stop(struct search *s);
+long search_elapsed(const struct search *s);
+void format_search_info(const struct search *s, int depth, char *buf, size_t len);
+void print_search_info(const struct search *s, int depth);
+
+
+#endif	/* __SEARCH_H__ */
@@ -0,0 +1,1665 @@
+/* @file:	tezdhar/src/serve.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/serve.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Analysis server over a Unix or localhost TCP socket, with a
+ * 		request queue and a pool of pinned worker threads. See
+ * 		serve.h for the protocol.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "search.h"
+#include "serve.h"
+#include "tt.h"
+
+#include <errno.h>	// for errno, EINTR
+#include <stdarg.h>	// for va_list
+#include <stdio.h>	// for printf, fprintf, perror, vsnprintf
+#include <stdlib.h>	// for calloc, realloc, free, strtoll
+#include <string.h>	// for memcpy, memmove, memchr, strchr, strcmp, strlen
+
+#ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>	// for gettimeofday, struct timeval
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for read, close, unlink, sysconf, fork, pipe
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>	// for lstat, S_ISSOCK
+#endif
+
+#ifdef HAVE_SYS_SOCKET_H
+#  include <sys/socket.h>	// for socket, bind, listen, accept, send
+#endif
+
+#ifdef HAVE_SYS_UN_H
+#  include <sys/un.h>	// for struct sockaddr_un
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#  include <netinet/in.h>	// for struct sockaddr_in, INADDR_LOOPBACK
+#endif
+
+#ifdef HAVE_POLL_H
+#  include <poll.h>	// for poll
+#endif
+
+#ifdef HAVE_SIGNAL_H
+#  include <signal.h>	// for sigaction, kill
+#endif
+
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>	// for fcntl, O_NONBLOCK
+#endif
+
+#ifdef HAVE_SYS_WAIT_H
+#  include <sys/wait.h>	// for waitpid, WIFSIGNALED
+#endif
+
+#ifdef HAVE_SYS_PRCTL_H
+#  include <sys/prctl.h>	// for prctl, PR_SET_PDEATHSIG
+#endif
+
+#ifdef HAVE_SEMAPHORE_H
+#  include <semaphore.h>	// for sem_init, sem_post, sem_wait
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create, pthread_mutex_lock
+#endif
+
+#ifdef HAVE_SCHED_H
+#  include <sched.h>	// for cpu_set_t, CPU_SET
+#endif
+
+enum serve_cmd {
+	SERVE_ANALYSE,
+	SERVE_EVALUATE
+};
+
+struct serve_job;
+
+/* A connected client. The input thread owns buf; the fields below are
+ * shared with the workers answering its requests. send is held while
+ * writing to fd, and may be held for SERVE_SEND_TIMEOUT seconds; lock is
+ * only held briefly, and taken after send by those holding both */
+struct serve_client {
+	int fd;
+	char *buf;			// request line being read
+	size_t len, cap;
+
+	pthread_mutex_t send;
+	bool closed;			// do not write any more, atomic
+
+	pthread_mutex_t lock;
+	struct serve_job *jobs;		// queued or running requests
+	char *pending;			// errors of the input thread to write
+	size_t npending;
+	int refs;			// input thread and jobs
+};
+
+/* A request waiting in the queue or running */
+struct serve_job {
+	struct serve_client *c;
+	struct serve_job *prev, *next;	// in the list of the client
+	enum serve_cmd cmd;
+	char id[SERVE_MAX_ID];		// as in the request, "" if none
+	struct board brd;		// position to analyse
+	struct search_limits limits;
+	long deadline;			// milliseconds of serve_now(), 0 if none
+	bool info;			// send info lines
+	char **fens;			// positions to evaluate
+	size_t nfens;
+
+	bool cancelled;			// under the client lock
+	struct search *s;		// running search, under the client lock
+};
+
+/* Bounded lock-free multi-producer multi-consumer queue. A cell is free
+ * for the push of position pos when its sequence number is pos, and full
+ * for the pop of pos when it is pos + 1 */
+struct serve_cell {
+	size_t seq;
+	struct serve_job *job;
+};
+
+struct serve_queue {
+	struct serve_cell cells[SERVE_QUEUE_LEN];
+	size_t head;			// next push
+	char pad[64 - sizeof(size_t)];	// pushes and pops on their own cache lines
+	size_t tail;			// next pop
+	sem_t items;			// jobs in the queue
+};
+
+/* Growing output line */
+struct serve_buf {
+	char *p;
+	size_t len, cap;
+};
+
+struct serve;
+
+struct serve_worker {
+	struct serve *srv;
+	struct search s;
+	struct tt tt;			// kept warm across requests
+	struct serve_job *job;		// request being run
+	int depth;			// last completed iteration
+	int cpu;			// pinned to, -1 for none
+	struct serve_buf out;
+	pthread_t tid;
+};
+
+struct serve {
+	struct serve_queue q;
+	struct serve_worker *workers;
+	int nworkers;
+	int tb_probe_limit;
+	bool quit;
+
+	int fd;				// listening socket, or -1
+	int notify;			// pipe to the fork server, or -1
+	struct serve_client *clients[SERVE_MAX_CLIENTS];
+	int nclients;
+	struct serve_buf out;		// errors of the input thread
+};
+
+/* Fields of a request. Strings point into the request line */
+struct serve_request {
+	const char *cmd;
+	char id[SERVE_MAX_ID];
+	char target[SERVE_MAX_ID];
+	const char *fen;
+	const char *moves;
+	const char *fens[SERVE_MAX_FENS];
+	size_t nfens;
+	long long depth, movetime, nodes, multipv, deadline;
+	bool info;
+};
+
+static volatile sig_atomic_t serve_signalled;
+
+
+/* Milliseconds of the wall clock */
+static long serve_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000L + tv.tv_usec / 1000L;
+}
+
+
+static void serve_on_signal(const int sig)
+{
+	(void)sig;
+	serve_signalled = 1;
+}
+
+
+/*
+ *	Queue
+ */
+
+static void serve_queue_init(struct serve_queue *q)
+{
+	for (size_t i = 0; i < SERVE_QUEUE_LEN; i++) {
+		q->cells[i].seq = i;
+	}
+	q->head = q->tail = 0;
+	sem_init(&q->items, 0, 0);
+}
+
+
+/* Returns false if the queue is full */
+static bool serve_queue_push(struct serve_queue *q, struct serve_job *job)
+{
+	size_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED), seq;
+	struct serve_cell *cell;
+	long diff;
+
+	for (;;) {
+		cell = &q->cells[pos & (SERVE_QUEUE_LEN - 1)];
+		seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		diff = (long)(seq - pos);
+
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, true,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+		}
+	}
+
+	cell->job = job;
+	__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+	sem_post(&q->items);
+	return true;
+}
+
+
+/* Returns NULL if the queue is empty */
+static struct serve_job *serve_queue_pop(struct serve_queue *q)
+{
+	size_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED), seq;
+	struct serve_cell *cell;
+	struct serve_job *job;
+	long diff;
+
+	for (;;) {
+		cell = &q->cells[pos & (SERVE_QUEUE_LEN - 1)];
+		seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		diff = (long)(seq - (pos + 1));
+
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, true,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return NULL;
+		} else {
+			pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	job = cell->job;
+	__atomic_store_n(&cell->seq, pos + SERVE_QUEUE_LEN, __ATOMIC_RELEASE);
+	return job;
+}
+
+
+/*
+ *	Output
+ */
+
+static void serve_printf(struct serve_buf *b, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* Append to the line, growing it if needed */
+static void serve_printf(struct serve_buf *b, const char *fmt, ...)
+{
+	va_list ap;
+	size_t need;
+	char *p;
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(b->p ? b->p + b->len : NULL, b->p ? b->cap - b->len : 0, fmt, ap);
+	va_end(ap);
+	if (n < 0) {
+		return;
+	}
+
+	need = b->len + (size_t)n + 1;
+	if (need > b->cap) {
+		if (!(p = realloc(b->p, need * 2))) {
+			perror("realloc failed");
+			return;
+		}
+		b->p = p;
+		b->cap = need * 2;
+		va_start(ap, fmt);
+		vsnprintf(b->p + b->len, b->cap - b->len, fmt, ap);
+		va_end(ap);
+	}
+	b->len += (size_t)n;
+}
+
+
+/* Start a response to a request with id, "" if it had none */
+static void serve_begin(struct serve_buf *b, const char *id, const char *type)
+{
+	b->len = 0;
+	if (*id) {
+		serve_printf(b, "{\"id\":%s,\"type\":\"%s\"", id, type);
+	} else {
+		serve_printf(b, "{\"type\":\"%s\"", type);
+	}
+}
+
+
+/* Stop writing to the client */
+static void serve_close(struct serve_client *c)
+{
+	if (!__atomic_exchange_n(&c->closed, true, __ATOMIC_ACQ_REL)) {
+		shutdown(c->fd, SHUT_RDWR);
+	}
+}
+
+
+/* Write to the client, under its send lock. A client which does not read
+ * for SERVE_SEND_TIMEOUT seconds is shut down, and with MSG_DONTWAIT in
+ * flags the write stops when the socket is full. Returns the bytes
+ * written */
+static size_t serve_write(struct serve_client *c, const char *p, const size_t len, const int flags)
+{
+	size_t done = 0;
+	ssize_t n;
+
+	while (done < len && !__atomic_load_n(&c->closed, __ATOMIC_ACQUIRE)) {
+		if ((n = send(c->fd, p + done, len - done, flags | MSG_NOSIGNAL)) > 0) {
+			done += (size_t)n;
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n < 0 && (flags & MSG_DONTWAIT) && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		} else {
+			serve_close(c);
+		}
+	}
+	return done;
+}
+
+
+/* Are errors of the input thread waiting to be written */
+static bool serve_pending(struct serve_client *c)
+{
+	bool pending;
+
+	pthread_mutex_lock(&c->lock);
+	pending = c->npending && !__atomic_load_n(&c->closed, __ATOMIC_ACQUIRE);
+	pthread_mutex_unlock(&c->lock);
+	return pending;
+}
+
+
+/* Write the errors queued by the input thread, under the send lock. Taken
+ * off the client for a blocking write, and written in place without
+ * blocking, keeping what the socket did not take */
+static void serve_flush(struct serve_client *c, const int flags)
+{
+	char *p;
+	size_t len, n;
+
+	pthread_mutex_lock(&c->lock);
+	if (!c->npending) {
+		pthread_mutex_unlock(&c->lock);
+		return;
+	}
+	if (flags & MSG_DONTWAIT) {
+		n = serve_write(c, c->pending, c->npending, flags);
+		memmove(c->pending, c->pending + n, c->npending - n);
+		c->npending -= n;
+		pthread_mutex_unlock(&c->lock);
+		return;
+	}
+	p = c->pending;
+	len = c->npending;
+	c->pending = NULL;
+	c->npending = 0;
+	pthread_mutex_unlock(&c->lock);
+
+	serve_write(c, p, len, flags);
+	free(p);
+}
+
+
+/* End the response of a worker and write it to the client, after the
+ * errors which the input thread queued */
+static void serve_send(struct serve_client *c, struct serve_buf *b)
+{
+	serve_printf(b, "}\n");
+
+	pthread_mutex_lock(&c->send);
+	serve_flush(c, 0);	// may end a line the input thread began
+	serve_write(c, b->p, b->len, 0);
+	pthread_mutex_unlock(&c->send);
+
+	/* errors queued while the input thread could not take the send lock */
+	while (serve_pending(c) && !pthread_mutex_trylock(&c->send)) {
+		serve_flush(c, 0);
+		pthread_mutex_unlock(&c->send);
+	}
+}
+
+
+/* Send an error from a worker */
+static void serve_error(struct serve_client *c, struct serve_buf *b, const char *id, const char *msg)
+{
+	serve_begin(b, id, "error");
+	serve_printf(b, ",\"error\":\"%s\"", msg);
+	serve_send(c, b);
+}
+
+
+/* Queue an error from the input thread, and write it at once if no worker
+ * is writing and the socket takes it. The input thread never blocks on a
+ * client, and one which lets SERVE_MAX_PENDING bytes of errors pile up is
+ * shut down */
+static void serve_reject(struct serve_client *c, struct serve_buf *b, const char *id, const char *msg)
+{
+	bool full = false;
+	char *p;
+
+	serve_begin(b, id, "error");
+	serve_printf(b, ",\"error\":\"%s\"}\n", msg);
+
+	pthread_mutex_lock(&c->lock);
+	if (c->npending + b->len > SERVE_MAX_PENDING) {
+		full = true;
+	} else if ((p = realloc(c->pending, c->npending + b->len))) {
+		memcpy(p + c->npending, b->p, b->len);
+		c->pending = p;
+		c->npending += b->len;
+	} else {
+		perror("realloc failed");
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	if (full) {
+		serve_close(c);
+	} else if (!pthread_mutex_trylock(&c->send)) {
+		serve_flush(c, MSG_DONTWAIT);
+		pthread_mutex_unlock(&c->send);
+	}
+}
+
+
+/* Append the score of a line as "cp" or "mate" */
+static void serve_score(struct serve_buf *b, const int score)
+{
+	if (score > SCORE_MATE - MAX_PLY) {
+		serve_printf(b, "\"mate\":%d", (SCORE_MATE - score + 1) / 2);
+	} else if (score < -SCORE_MATE + MAX_PLY) {
+		serve_printf(b, "\"mate\":%d", -(SCORE_MATE + score) / 2);
+	} else {
+		serve_printf(b, "\"cp\":%d", score);
+	}
+}
+
+
+static void serve_pv(struct serve_buf *b, const struct search_line *l)
+{
+	char uci[MAX_UCI_LEN];
+
+	serve_printf(b, "\"pv\":\"");
+	for (int i = 0; i < l->pv_len; i++) {
+		move_to_uci(l->pv[i], uci);
+		serve_printf(b, "%s%s", i ? " " : "", uci);
+	}
+	serve_printf(b, "\"");
+}
+
+
+/*
+ *	Clients
+ */
+
+static void serve_client_unref(struct serve_client *c)
+{
+	if (__atomic_sub_fetch(&c->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+		close(c->fd);
+		pthread_mutex_destroy(&c->send);
+		pthread_mutex_destroy(&c->lock);
+		free(c->pending);
+		free(c->buf);
+		free(c);
+	}
+}
+
+
+/* Stop writing to the client and cancel its requests. It is freed when
+ * the last of them is done */
+static void serve_disconnect(struct serve *srv, const int i)
+{
+	struct serve_client *c = srv->clients[i];
+
+	serve_close(c);
+	pthread_mutex_lock(&c->lock);
+	for (struct serve_job *job = c->jobs; job; job = job->next) {
+		job->cancelled = true;
+		if (job->s) {
+			search_stop(job->s);
+		}
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	srv->clients[i] = srv->clients[--srv->nclients];
+	serve_client_unref(c);
+}
+
+
+static void serve_accept(struct serve *srv)
+{
+	const struct timeval timeout = {SERVE_SEND_TIMEOUT, 0};
+	struct serve_client *c;
+	int fd;
+
+	if ((fd = accept(srv->fd, NULL, NULL)) < 0) {
+		/* idle children of the fork server race for every client */
+		if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+			perror("accept failed");
+		}
+		return;
+	}
+	if (srv->nclients == SERVE_MAX_CLIENTS) {
+		fprintf(stderr, "Refusing client, %d connected\n", srv->nclients);
+		close(fd);
+		return;
+	}
+	if (!(c = calloc(1, sizeof(*c)))) {
+		perror("calloc failed");
+		close(fd);
+		return;
+	}
+
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	c->fd = fd;
+	c->refs = 1;
+	pthread_mutex_init(&c->send, NULL);
+	pthread_mutex_init(&c->lock, NULL);
+	srv->clients[srv->nclients++] = c;
+
+	/* a child of the fork server serves one client only, and tells the
+	 * parent to fork another to take its place */
+	if (srv->notify >= 0) {
+		const pid_t pid = getpid();
+
+		close(srv->fd);
+		srv->fd = -1;
+		if (write(srv->notify, &pid, sizeof(pid)) != sizeof(pid)) {
+			perror("write failed");
+		}
+		close(srv->notify);
+		srv->notify = -1;
+	}
+}
+
+
+/*
+ *	Requests
+ */
+
+static char *serve_ws(char *p)
+{
+	while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+		p++;
+	}
+	return p;
+}
+
+
+/* Decode the JSON string at *p in place, and return it. Only ASCII is
+ * accepted, which is all that FENs and moves are made of */
+static char *serve_string(char **p)
+{
+	char *s = *p, *out, *str;
+	unsigned int u;
+
+	if (*s != '"') {
+		return NULL;
+	}
+	str = out = ++s;
+	while (*s != '"') {
+		if (*s == '\0' || (unsigned char)*s < 0x20) {
+			return NULL;
+		}
+		if (*s != '\\') {
+			*out++ = *s++;
+			continue;
+		}
+		switch (*++s) {
+			case '"': case '\\': case '/': *out++ = *s; break;
+			case 'b': *out++ = '\b'; break;
+			case 'f': *out++ = '\f'; break;
+			case 'n': *out++ = '\n'; break;
+			case 'r': *out++ = '\r'; break;
+			case 't': *out++ = '\t'; break;
+			case 'u':
+				if (sscanf(s + 1, "%4x", &u) != 1 || u == 0 || u > 0x7f) {
+					return NULL;
+				}
+				*out++ = (char)u;
+				s += 4;
+				break;
+			default:
+				return NULL;
+		}
+		s++;
+	}
+	*out = '\0';
+	*p = s + 1;
+	return str;
+}
+
+
+/* Skip any JSON value */
+static bool serve_skip(char **p)
+{
+	int depth = 0;
+	char *s = *p;
+
+	do {
+		s = serve_ws(s);
+		if (*s == '"') {
+			if (!serve_string(&s)) {
+				return false;
+			}
+		} else if (*s == '{' || *s == '[') {
+			depth++;
+			s++;
+		} else if (*s == '}' || *s == ']') {
+			depth--;
+			s++;
+		} else if (*s == ',' || *s == ':') {
+			s++;
+		} else if (*s == '\0') {
+			return false;
+		} else {
+			s += strcspn(s, ",:{}[] \t\r\n\"");
+		}
+	} while (depth > 0);
+
+	*p = s;
+	return true;
+}
+
+
+/* Skip the digits at s, returns NULL if there are none */
+static char *serve_digits(char *s)
+{
+	char *start = s;
+
+	while (*s >= '0' && *s <= '9') {
+		s++;
+	}
+	return s > start ? s : NULL;
+}
+
+
+/* End of the JSON number at s: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+ * Returns NULL if there is none, so that inf, nan, hex and "1." are not
+ * echoed */
+static char *serve_json_number(char *s)
+{
+	if (*s == '-') {
+		s++;
+	}
+	if (*s == '0') {
+		s++;
+	} else if (!(s = serve_digits(s))) {
+		return NULL;
+	}
+	if (*s == '.' && !(s = serve_digits(s + 1))) {
+		return NULL;
+	}
+	if (*s == 'e' || *s == 'E') {
+		s++;
+		if (*s == '+' || *s == '-') {
+			s++;
+		}
+		s = serve_digits(s);
+	}
+	return s;
+}
+
+
+/* End of the JSON string at s, after its closing quote. Returns NULL if
+ * it is not one, with control characters or unknown escapes */
+static char *serve_json_string(char *s)
+{
+	for (s++; *s != '"'; s++) {
+		if ((unsigned char)*s < 0x20) {
+			return NULL;
+		}
+		if (*s != '\\') {
+			continue;
+		}
+		if (*++s == 'u') {
+			for (int i = 0; i < 4; i++) {
+				if (!*++s || !strchr("0123456789abcdefABCDEF", *s)) {
+					return NULL;
+				}
+			}
+		} else if (!*s || !strchr("\"\\/bfnrt", *s)) {
+			return NULL;
+		}
+	}
+	return s + 1;
+}
+
+
+/* Copy a string or number value as it is written, to be echoed */
+static bool serve_raw(char **p, char *buf, const size_t len)
+{
+	char *s = **p == '"' ? serve_json_string(*p) : serve_json_number(*p);
+	size_t n;
+
+	if (!s) {
+		return false;
+	}
+
+	n = (size_t)(s - *p);
+	if (n >= len) {
+		return false;
+	}
+	memcpy(buf, *p, n);
+	buf[n] = '\0';
+	*p = s;
+	return true;
+}
+
+
+static bool serve_number(char **p, long long *v)
+{
+	char *end;
+
+	*v = strtoll(*p, &end, 10);
+	if (end == *p || *v < 0) {
+		return false;
+	}
+	*p = end;
+	return true;
+}
+
+
+static bool serve_bool(char **p, bool *v)
+{
+	if (!strncmp(*p, "true", 4)) {
+		*v = true;
+		*p += 4;
+	} else if (!strncmp(*p, "false", 5)) {
+		*v = false;
+		*p += 5;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+
+/* Array of FEN strings */
+static bool serve_fens(char **p, struct serve_request *r)
+{
+	char *s = *p;
+
+	if (*s++ != '[') {
+		return false;
+	}
+	for (s = serve_ws(s); *s != ']'; ) {
+		if (r->nfens == SERVE_MAX_FENS || !(r->fens[r->nfens++] = serve_string(&s))) {
+			return false;
+		}
+		s = serve_ws(s);
+		if (*s == ',') {
+			s = serve_ws(s + 1);
+		} else if (*s != ']') {
+			return false;
+		}
+	}
+	*p = s + 1;
+	return true;
+}
+
+
+/* Parse a request line, returning an error message or NULL */
+static const char *serve_parse(char *line, struct serve_request *r)
+{
+	char *p = serve_ws(line), *key;
+	bool ok;
+
+	memset(r, 0, sizeof(*r));
+	if (*p++ != '{') {
+		return "not a JSON object";
+	}
+
+	for (p = serve_ws(p); *p != '}'; p = serve_ws(p)) {
+		if (!(key = serve_string(&p))) {
+			return "bad key";
+		}
+		p = serve_ws(p);
+		if (*p++ != ':') {
+			return "missing colon";
+		}
+		p = serve_ws(p);
+
+		if (!strcmp(key, "id")) {
+			ok = serve_raw(&p, r->id, sizeof(r->id));
+		} else if (!strcmp(key, "target")) {
+			ok = serve_raw(&p, r->target, sizeof(r->target));
+		} else if (!strcmp(key, "cmd")) {
+			ok = (r->cmd = serve_string(&p)) != NULL;
+		} else if (!strcmp(key, "fen")) {
+			ok = (r->fen = serve_string(&p)) != NULL;
+		} else if (!strcmp(key, "moves")) {
+			ok = (r->moves = serve_string(&p)) != NULL;
+		} else if (!strcmp(key, "fens")) {
+			ok = serve_fens(&p, r);
+		} else if (!strcmp(key, "info")) {
+			ok = serve_bool(&p, &r->info);
+		} else if (!strcmp(key, "depth")) {
+			ok = serve_number(&p, &r->depth);
+		} else if (!strcmp(key, "movetime")) {
+			ok = serve_number(&p, &r->movetime);
+		} else if (!strcmp(key, "nodes")) {
+			ok = serve_number(&p, &r->nodes);
+		} else if (!strcmp(key, "multipv")) {
+			ok = serve_number(&p, &r->multipv);
+		} else if (!strcmp(key, "deadline")) {
+			ok = serve_number(&p, &r->deadline);
+		} else {
+			ok = serve_skip(&p);
+		}
+		if (!ok) {
+			return "bad value";
+		}
+
+		p = serve_ws(p);
+		if (*p == ',') {
+			p++;
+		} else if (*p != '}') {
+			return "missing comma";
+		}
+	}
+
+	return r->cmd ? NULL : "missing cmd";
+}
+
+
+/* Set up the position of an analysis from its FEN and moves */
+static bool serve_position(const struct serve_request *r, struct board *brd)
+{
+	char buf[MAX_FEN_LEN], uci[MAX_UCI_LEN];
+	const char *p = r->moves;
+	struct move mv;
+	struct undo u;
+	size_t n;
+	move_t m;
+
+	if (r->fen && strlen(r->fen) >= MAX_FEN_LEN) {
+		return false;
+	}
+	strcpy(buf, r->fen ? r->fen : INITIAL_FEN);
+	if (!init_board(buf, brd, AI, AI)) {
+		return false;
+	}
+
+	while (p && *(p += strspn(p, " ")) != '\0') {
+		if ((n = strcspn(p, " ")) >= sizeof(uci)) {
+			return false;
+		}
+		memcpy(uci, p, n);
+		uci[n] = '\0';
+		p += n;
+
+		mv = parse_input_move(uci);
+		if (mv.invalid || (m = resolve_move(brd, &mv)) == MOVE_NONE || !make_move(brd, m, &u)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/* Remove the job from the list of its client, under the client lock */
+static void serve_unlink(struct serve_job *job)
+{
+	if (job->prev) {
+		job->prev->next = job->next;
+	} else {
+		job->c->jobs = job->next;
+	}
+	if (job->next) {
+		job->next->prev = job->prev;
+	}
+}
+
+
+static void serve_job_free(struct serve_job *job)
+{
+	free(job->fens);
+	free(job);
+}
+
+
+/* Copy the positions to evaluate into one block after the pointers */
+static bool serve_copy_fens(struct serve_job *job, const struct serve_request *r)
+{
+	size_t size = r->nfens * sizeof(char *);
+	char *p;
+
+	for (size_t i = 0; i < r->nfens; i++) {
+		size += strlen(r->fens[i]) + 1;
+	}
+	if (!(job->fens = malloc(size ? size : 1))) {
+		perror("malloc failed");
+		return false;
+	}
+
+	p = (char *)(job->fens + r->nfens);
+	for (size_t i = 0; i < r->nfens; i++) {
+		job->fens[i] = p;
+		strcpy(p, r->fens[i]);
+		p += strlen(p) + 1;
+	}
+	job->nfens = r->nfens;
+	return true;
+}
+
+
+/* Cancel a request of the client, stopping its search if it runs */
+static void serve_cancel(struct serve *srv, struct serve_client *c, const struct serve_request *r)
+{
+	struct serve_job *job;
+
+	pthread_mutex_lock(&c->lock);
+	for (job = c->jobs; job && strcmp(job->id, r->target); job = job->next) {
+	}
+	if (job) {
+		job->cancelled = true;
+		if (job->s) {
+			search_stop(job->s);
+		}
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	if (!job) {
+		serve_reject(c, &srv->out, r->id, "no such request");
+	}
+}
+
+
+/* Handle a request line of a client on the input thread */
+static void serve_request(struct serve *srv, struct serve_client *c, char *line)
+{
+	struct serve_request *r;
+	struct serve_job *job;
+	const char *err;
+
+	if (!(r = malloc(sizeof(*r)))) {	// too large for the stack
+		perror("malloc failed");
+		return;
+	}
+	if ((err = serve_parse(line, r))) {
+		serve_reject(c, &srv->out, r->id, err);
+		goto out;
+	}
+	if (!strcmp(r->cmd, "cancel")) {
+		serve_cancel(srv, c, r);
+		goto out;
+	}
+	if (strcmp(r->cmd, "analyse") && strcmp(r->cmd, "evaluate")) {
+		serve_reject(c, &srv->out, r->id, "unknown cmd");
+		goto out;
+	}
+
+	if (!(job = calloc(1, sizeof(*job)))) {
+		perror("calloc failed");
+		serve_reject(c, &srv->out, r->id, "out of memory");
+		goto out;
+	}
+	job->c = c;
+	job->cmd = r->cmd[0] == 'a' ? SERVE_ANALYSE : SERVE_EVALUATE;
+	strcpy(job->id, r->id);
+	job->deadline = r->deadline ? serve_now() + (long)r->deadline : 0;
+	job->info = r->info;
+	job->limits.depth = (int)(r->depth < MAX_PLY ? r->depth : MAX_PLY);
+	job->limits.movetime = (long)r->movetime;
+	job->limits.nodes = (uint64_t)r->nodes;
+	job->limits.multipv = (int)(r->multipv < MAX_MULTIPV ? r->multipv : MAX_MULTIPV);
+	job->limits.tb_probe_limit = srv->tb_probe_limit;
+
+	if (job->cmd == SERVE_ANALYSE && !serve_position(r, &job->brd)) {
+		serve_reject(c, &srv->out, r->id, "bad position");
+		serve_job_free(job);
+		goto out;
+	}
+	if (job->cmd == SERVE_EVALUATE && !serve_copy_fens(job, r)) {
+		serve_reject(c, &srv->out, r->id, "out of memory");
+		serve_job_free(job);
+		goto out;
+	}
+
+	/* the job is listed before it is queued, so that it can be cancelled
+	 * as soon as a worker may take it */
+	pthread_mutex_lock(&c->lock);
+	job->next = c->jobs;
+	if (c->jobs) {
+		c->jobs->prev = job;
+	}
+	c->jobs = job;
+	pthread_mutex_unlock(&c->lock);
+	__atomic_add_fetch(&c->refs, 1, __ATOMIC_ACQ_REL);
+
+	if (!serve_queue_push(&srv->q, job)) {
+		pthread_mutex_lock(&c->lock);
+		serve_unlink(job);
+		pthread_mutex_unlock(&c->lock);
+		serve_reject(c, &srv->out, r->id, "queue full");
+		serve_job_free(job);
+		serve_client_unref(c);
+	}
+
+out:
+	free(r);
+}
+
+
+/* Read from a client and handle its complete lines. Returns false if it
+ * is gone */
+static bool serve_read(struct serve *srv, struct serve_client *c)
+{
+	char *nl, *p;
+	ssize_t n;
+
+	if (c->len == c->cap) {
+		if (c->cap == SERVE_MAX_REQUEST) {
+			serve_reject(c, &srv->out, "", "request too long");
+			return false;
+		}
+		if (!(p = realloc(c->buf, c->cap ? c->cap * 2 : 4096))) {
+			perror("realloc failed");
+			return false;
+		}
+		c->buf = p;
+		c->cap = c->cap ? c->cap * 2 : 4096;
+	}
+
+	if ((n = read(c->fd, c->buf + c->len, c->cap - c->len)) <= 0) {
+		return n < 0 && errno == EINTR;
+	}
+	c->len += (size_t)n;
+
+	for (p = c->buf; (nl = memchr(p, '\n', c->len - (size_t)(p - c->buf))); p = nl + 1) {
+		*nl = '\0';
+		if (*serve_ws(p)) {
+			serve_request(srv, c, p);
+		}
+	}
+	c->len -= (size_t)(p - c->buf);
+	memmove(c->buf, p, c->len);
+	return true;
+}
+
+
+/*
+ *	Workers
+ */
+
+/* Iteration callback of a worker's search */
+static void serve_report(const struct search *s, const int depth)
+{
+	struct serve_worker *w = s->report_arg;
+	struct serve_job *job = w->job;
+
+	w->depth = depth;
+	if (!job->info) {
+		return;
+	}
+
+	for (int i = 0; i < s->nlines; i++) {
+		const long ms = search_elapsed(s);
+
+		serve_begin(&w->out, job->id, "info");
+		serve_printf(&w->out, ",\"depth\":%d,\"seldepth\":%d,\"multipv\":%d,",
+				depth, s->stats.seldepth, i + 1);
+		serve_score(&w->out, s->lines[i].score);
+		serve_printf(&w->out, ",\"nodes\":%llu,\"nps\":%llu,\"time\":%ld,",
+				(unsigned long long)s->stats.nodes,
+				(unsigned long long)(s->stats.nodes * 1000 / (uint64_t)(ms > 0 ? ms : 1)), ms);
+		serve_pv(&w->out, &s->lines[i]);
+		serve_send(job->c, &w->out);
+	}
+}
+
+
+static void serve_analyse(struct serve_worker *w, struct serve_job *job, const long now)
+{
+	struct serve_client *c = job->c;
+	struct search_limits limits = job->limits;
+	struct search *s = &w->s;
+	bool by_deadline = false, cancelled;
+	char uci[MAX_UCI_LEN];
+	const char *stop;
+	move_t best;
+
+	if (job->deadline && (!limits.movetime || limits.movetime > job->deadline - now)) {
+		limits.movetime = job->deadline - now;
+		by_deadline = true;
+	}
+
+	search_init(s, &job->brd, &limits);
+	s->tt = w->tt.table ? &w->tt : NULL;
+	s->report = serve_report;
+	s->report_arg = w;
+	w->depth = 0;
+
+	/* a cancel from now on reaches the search, and one before it is seen
+	 * here, as search_init() has cleared the stop flag */
+	pthread_mutex_lock(&c->lock);
+	job->s = s;
+	if (job->cancelled) {
+		search_stop(s);
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	best = search_position(s);
+
+	pthread_mutex_lock(&c->lock);
+	job->s = NULL;
+	cancelled = job->cancelled;
+	pthread_mutex_unlock(&c->lock);
+
+	if (cancelled) {
+		stop = "cancel";
+	} else if (by_deadline && search_elapsed(s) >= limits.movetime) {
+		stop = "deadline";
+	} else {
+		stop = "limit";
+	}
+
+	serve_begin(&w->out, job->id, "bestmove");
+	if (best == MOVE_NONE) {
+		serve_printf(&w->out, ",\"bestmove\":null");
+	} else {
+		move_to_uci(best, uci);
+		serve_printf(&w->out, ",\"bestmove\":\"%s\"", uci);
+	}
+	serve_printf(&w->out, ",\"depth\":%d,\"nodes\":%llu,\"time\":%ld,\"stop\":\"%s\",\"lines\":[",
+			w->depth, (unsigned long long)s->stats.nodes, search_elapsed(s), stop);
+	for (int i = 0; i < s->nlines; i++) {
+		serve_printf(&w->out, "%s{", i ? "," : "");
+		serve_score(&w->out, s->lines[i].score);
+		serve_printf(&w->out, ",");
+		serve_pv(&w->out, &s->lines[i]);
+		serve_printf(&w->out, "}");
+	}
+	serve_printf(&w->out, "]");
+	serve_send(c, &w->out);
+}
+
+
+/* Quiescence scores of the positions, null for those which are not valid
+ * or were not reached before the request was cancelled or expired */
+static void serve_evaluate(struct serve_worker *w, struct serve_job *job)
+{
+	char buf[MAX_FEN_LEN];
+	const char *stop = "limit";
+	bool done = false;
+	struct board brd;
+	size_t i;
+
+	serve_begin(&w->out, job->id, "scores");
+	serve_printf(&w->out, ",\"scores\":[");
+	for (i = 0; i < job->nfens; i++) {
+		if (!done && __atomic_load_n(&job->cancelled, __ATOMIC_RELAXED)) {
+			stop = "cancel";
+			done = true;
+		} else if (!done && job->deadline && serve_now() >= job->deadline) {
+			stop = "deadline";
+			done = true;
+		}
+
+		if (done || strlen(job->fens[i]) >= MAX_FEN_LEN ||
+				!init_board(strcpy(buf, job->fens[i]), &brd, AI, AI)) {
+			serve_printf(&w->out, "%snull", i ? "," : "");
+			continue;
+		}
+		search_init(&w->s, &brd, &job->limits);
+		serve_printf(&w->out, "%s%d", i ? "," : "", search_quiesce(&w->s));
+	}
+	serve_printf(&w->out, "],\"stop\":\"%s\"", stop);
+	serve_send(job->c, &w->out);
+}
+
+
+/* Answer a request taken from the queue, and release it */
+static void serve_run(struct serve_worker *w, struct serve_job *job)
+{
+	struct serve_client *c = job->c;
+	const long now = serve_now();
+	bool cancelled;
+
+	pthread_mutex_lock(&c->lock);
+	cancelled = job->cancelled;
+	pthread_mutex_unlock(&c->lock);
+
+	w->job = job;
+	if (cancelled) {
+		serve_error(c, &w->out, job->id, "cancelled");
+	} else if (job->deadline && now >= job->deadline) {
+		serve_error(c, &w->out, job->id, "deadline expired");
+	} else if (job->cmd == SERVE_ANALYSE) {
+		serve_analyse(w, job, now);
+	} else {
+		serve_evaluate(w, job);
+	}
+	w->job = NULL;
+
+	pthread_mutex_lock(&c->lock);
+	serve_unlink(job);
+	pthread_mutex_unlock(&c->lock);
+
+	serve_job_free(job);
+	serve_client_unref(c);
+}
+
+
+static void *serve_worker_thread(void *arg)
+{
+	struct serve_worker *w = arg;
+	struct serve *srv = w->srv;
+	struct serve_job *job;
+
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+	if (w->cpu >= 0) {
+		cpu_set_t set;
+
+		CPU_ZERO(&set);
+		CPU_SET((size_t)w->cpu, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	}
+#endif
+
+	for (;;) {
+		while (sem_wait(&srv->q.items) && errno == EINTR) {
+		}
+		if (__atomic_load_n(&srv->quit, __ATOMIC_ACQUIRE)) {
+			break;
+		}
+		if ((job = serve_queue_pop(&srv->q))) {
+			serve_run(w, job);
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ *	Server
+ */
+
+/* Listen on ":PORT" of 127.0.0.1, or on a Unix socket at path */
+static int serve_listen(const char *addr)
+{
+	struct sockaddr_un un = {0};
+	struct sockaddr_in in = {0};
+	struct stat st;
+	const int one = 1;
+	int fd;
+
+	if (addr[0] == ':') {
+		in.sin_family = AF_INET;
+		in.sin_port = htons((uint16_t)atoi(addr + 1));
+		in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+			perror("socket failed");
+			return -1;
+		}
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		if (bind(fd, (struct sockaddr *)&in, sizeof(in)) || listen(fd, SOMAXCONN)) {
+			perror(addr);
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	if (strlen(addr) >= sizeof(un.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", addr);
+		return -1;
+	}
+	/* a socket left behind by an earlier server is replaced, anything
+	 * else at the path is not */
+	if (!lstat(addr, &st)) {
+		if (!S_ISSOCK(st.st_mode)) {
+			fprintf(stderr, "Not a socket: %s\n", addr);
+			return -1;
+		}
+		unlink(addr);
+	}
+
+	un.sun_family = AF_UNIX;
+	strcpy(un.sun_path, addr);
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		perror("socket failed");
+		return -1;
+	}
+	if (bind(fd, (struct sockaddr *)&un, sizeof(un)) || listen(fd, SOMAXCONN)) {
+		perror(addr);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+/* Poll the listening socket and the clients until SIGINT or SIGTERM, or
+ * until the last client leaves a server which no longer listens */
+static void serve_poll(struct serve *srv)
+{
+	struct pollfd fds[SERVE_MAX_CLIENTS + 1];
+	struct serve_client *polled[SERVE_MAX_CLIENTS];
+	int n;
+
+	while (!serve_signalled && (srv->fd >= 0 || srv->nclients)) {
+		fds[0].fd = srv->fd;
+		fds[0].events = POLLIN;
+		for (int i = 0; i < srv->nclients; i++) {
+			polled[i] = srv->clients[i];
+			fds[i + 1].fd = polled[i]->fd;
+			fds[i + 1].events = POLLIN | (serve_pending(polled[i]) ? POLLOUT : 0);
+		}
+		n = srv->nclients;
+
+		if (poll(fds, (nfds_t)n + 1, -1) < 0) {
+			if (errno != EINTR) {
+				perror("poll failed");
+				break;
+			}
+			continue;
+		}
+
+		/* clients are matched by pointer, as disconnects reorder them */
+		for (int i = 0; i < n; i++) {
+			if (!fds[i + 1].revents) {
+				continue;
+			}
+			/* queued errors, unless a worker is writing them */
+			if ((fds[i + 1].revents & POLLOUT) && !pthread_mutex_trylock(&polled[i]->send)) {
+				serve_flush(polled[i], MSG_DONTWAIT);
+				pthread_mutex_unlock(&polled[i]->send);
+			}
+			if (!(fds[i + 1].revents & ~POLLOUT)) {
+				continue;
+			}
+			for (int j = 0; j < srv->nclients; j++) {
+				if (srv->clients[j] == polled[i]) {
+					if (!serve_read(srv, polled[i])) {
+						serve_disconnect(srv, j);
+					}
+					break;
+				}
+			}
+		}
+		if (fds[0].revents & POLLIN) {
+			serve_accept(srv);
+		}
+	}
+}
+
+
+/* Handle SIGINT and SIGTERM by stopping serve_poll() */
+static void serve_signals(void)
+{
+	struct sigaction sa = {0};
+
+	/* no SA_RESTART, so that poll() returns on a signal */
+	sa.sa_handler = serve_on_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+}
+
+
+/* Start a server of threads workers, each with a hash table of hash_mb
+ * megabytes, pinned to the CPUs if pin is set. The caller sets fd */
+static struct serve *serve_create(const int threads, const size_t hash_mb,
+		const int tb_probe_limit, const bool pin)
+{
+	const long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	struct serve *srv;
+
+	if (!(srv = calloc(1, sizeof(*srv))) ||
+			!(srv->workers = calloc((size_t)threads, sizeof(*srv->workers)))) {
+		perror("calloc failed");
+		free(srv);
+		return NULL;
+	}
+
+	serve_queue_init(&srv->q);
+	srv->tb_probe_limit = tb_probe_limit;
+	srv->fd = -1;
+	srv->notify = -1;
+	for (int i = 0; i < threads; i++) {
+		struct serve_worker *w = &srv->workers[i];
+
+		w->srv = srv;
+		w->cpu = pin && ncpu > 0 ? (int)(i % ncpu) : -1;
+		if (hash_mb && !tt_init(&w->tt, hash_mb * 1024)) {
+			fprintf(stderr, "Worker %d searches without hash table\n", i);
+		}
+		if (pthread_create(&w->tid, NULL, serve_worker_thread, w)) {
+			perror("pthread_create failed");
+			tt_free(&w->tt);
+			break;
+		}
+		srv->nworkers++;
+	}
+	return srv;
+}
+
+
+/* Disconnect every client, cancelling its requests, stop the workers and
+ * free the server. The listening socket is left to the caller */
+static void serve_destroy(struct serve *srv)
+{
+	/* wake every worker to see quit and release the requests which no
+	 * worker took */
+	while (srv->nclients) {
+		serve_disconnect(srv, 0);
+	}
+	__atomic_store_n(&srv->quit, true, __ATOMIC_RELEASE);
+	for (int i = 0; i < srv->nworkers; i++) {
+		sem_post(&srv->q.items);
+	}
+	for (int i = 0; i < srv->nworkers; i++) {
+		pthread_join(srv->workers[i].tid, NULL);
+		tt_free(&srv->workers[i].tt);
+		free(srv->workers[i].out.p);
+	}
+	for (struct serve_job *job; (job = serve_queue_pop(&srv->q)); ) {
+		struct serve_client *c = job->c;
+
+		serve_job_free(job);
+		serve_client_unref(c);
+	}
+
+	sem_destroy(&srv->q.items);
+	free(srv->out.p);
+	free(srv->workers);
+	free(srv);
+}
+
+
+/* Serve analysis requests on addr with threads workers, each with a hash
+ * table of hash_mb megabytes, until SIGINT or SIGTERM */
+int serve_loop(const char *addr, int threads, const size_t hash_mb, const int tb_probe_limit)
+{
+	const long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	struct serve *srv;
+	int fd, started;
+
+	if (threads <= 0) {
+		threads = ncpu > 0 ? (int)ncpu : 1;
+	}
+	if ((fd = serve_listen(addr)) < 0) {
+		return EXIT_FAILURE;
+	}
+	serve_signals();
+
+	if ((srv = serve_create(threads, hash_mb, tb_probe_limit, true))) {
+		srv->fd = fd;
+		if ((started = srv->nworkers)) {
+			printf("info string serving on %s with %d workers, %zu MB hash each\n", addr, started, hash_mb);
+			fflush(stdout);
+			serve_poll(srv);
+		}
+		serve_destroy(srv);
+	} else {
+		started = 0;
+	}
+
+	close(fd);
+	if (addr[0] != ':') {
+		unlink(addr);
+	}
+	return started ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/* Wake the poll() of the fork server when a child exits */
+static void serve_on_child(const int sig)
+{
+	(void)sig;
+}
+
+
+/* A child of the fork server: wait with a ready worker for a client on the
+ * listening socket fd, serve it and exit */
+static void serve_child(const int fd, const int notify, const size_t hash_mb, const int tb_probe_limit)
+{
+	struct sigaction sa = {0};
+	struct serve *srv;
+
+	sa.sa_handler = SIG_DFL;
+	sigaction(SIGCHLD, &sa, NULL);
+#ifdef HAVE_SYS_PRCTL_H
+	/* idle children must not outlive a parent killed by SIGKILL */
+	prctl(PR_SET_PDEATHSIG, SIGTERM);
+	if (getppid() == 1) {
+		_exit(EXIT_FAILURE);
+	}
+#endif
+
+	if (!(srv = serve_create(1, hash_mb, tb_probe_limit, false))) {
+		_exit(EXIT_FAILURE);
+	}
+	if (srv->nworkers) {
+		srv->fd = fd;
+		srv->notify = notify;
+		serve_poll(srv);
+	}
+	if (srv->fd >= 0) {
+		close(srv->fd);
+	}
+	serve_destroy(srv);
+
+	/* _exit(), as stdio buffers copied from the parent are not ours */
+	_exit(EXIT_SUCCESS);
+}
+
+
+/* Fork a child waiting for a client. Returns its pid, or -1 */
+static pid_t serve_fork(const int fd, const int notify[2], const size_t hash_mb, const int tb_probe_limit)
+{
+	pid_t pid;
+
+	fflush(stdout);
+	fflush(stderr);
+	if ((pid = fork()) < 0) {
+		perror("fork failed");
+	} else if (!pid) {
+		close(notify[0]);
+		serve_child(fd, notify[1], hash_mb, tb_probe_limit);
+	}
+	return pid;
+}
+
+
+/* Serve every client on addr in a child of its own, forked from this fully
+ * initialised process, with a worker of a hash table of hash_mb megabytes.
+ * prefork children are kept waiting for clients, until SIGINT or SIGTERM */
+int serve_fork_loop(const char *addr, const int prefork, const size_t hash_mb, const int tb_probe_limit)
+{
+	pid_t pids[SERVE_MAX_CLIENTS];
+	bool idle[SERVE_MAX_CLIENTS];
+	struct sigaction sa = {0};
+	int fd, notify[2], status;
+	int nchildren = 0, nidle = 0;
+	struct pollfd pfd;
+	pid_t pid;
+
+	if ((fd = serve_listen(addr)) < 0) {
+		return EXIT_FAILURE;
+	}
+	/* children which lose the race for a client go back to poll() */
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) || pipe(notify)) {
+		perror(addr);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+	serve_signals();
+	sa.sa_handler = serve_on_child;
+	sigaction(SIGCHLD, &sa, NULL);
+
+	printf("info string forking on %s with %d children waiting, %zu MB hash each\n", addr, prefork, hash_mb);
+	fflush(stdout);
+
+	while (!serve_signalled) {
+		while (nidle < prefork && nchildren < SERVE_MAX_CLIENTS &&
+				(pid = serve_fork(fd, notify, hash_mb, tb_probe_limit)) > 0) {
+			pids[nchildren] = pid;
+			idle[nchildren++] = true;
+			nidle++;
+		}
+
+		/* the timeout covers a child which exits between waitpid() and
+		 * poll() */
+		pfd.fd = notify[0];
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, 1000) < 0 && errno != EINTR) {
+			perror("poll failed");
+			break;
+		}
+
+		/* children which took a client are no longer idle */
+		if (pfd.revents & POLLIN && read(notify[0], &pid, sizeof(pid)) == sizeof(pid)) {
+			for (int i = 0; i < nchildren; i++) {
+				if (pids[i] == pid && idle[i]) {
+					idle[i] = false;
+					nidle--;
+					break;
+				}
+			}
+		}
+
+		while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+			for (int i = 0; i < nchildren; i++) {
+				if (pids[i] != pid) {
+					continue;
+				}
+				if (WIFSIGNALED(status)) {
+					fprintf(stderr, "Child %d killed by signal %d\n", (int)pid, WTERMSIG(status));
+				}
+				if (idle[i]) {
+					nidle--;
+				}
+				nchildren--;
+				pids[i] = pids[nchildren];
+				idle[i] = idle[nchildren];
+				break;
+			}
+		}
+	}
+
+	/* busy children cancel their searches and disconnect their clients */
+	for (int i = 0; i < nchildren; i++) {
+		kill(pids[i], SIGTERM);
+	}
+	while (nchildren) {
+		if (wait(NULL) > 0) {
+			nchildren--;
+		} else if (errno != EINTR) {
+			break;
+		}
+	}
+
+	close(notify[0]);
+	close(notify[1]);
+	close(fd);
+	if (addr[0] != ':') {
+		unlink(addr);
+	}
+	return EXIT_SUCCESS;
+}
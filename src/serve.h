@@ -0,0 +1,101 @@
+/* @file:	tezdhar/src/serve.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/serve.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Analysis server, "tezdhar --serve", for many clients of one
+ * 		long running engine process.
+ *
+ *
+ *			--------
+ *			Protocol
+ *			--------
+ *
+ * The server listens on a Unix socket, or on a TCP port of 127.0.0.1 if
+ * the address is ":PORT". Requests and responses are JSON objects, one per
+ * line (NDJSON). A request has a "cmd" and an optional "id", a string or a
+ * number which is copied into every response to it:
+ *
+ *	{"id":1,"cmd":"analyse","fen":"...","moves":"e2e4 e7e5",
+ *	 "depth":20,"movetime":500,"nodes":1000000,"multipv":3,
+ *	 "deadline":800,"info":true}
+ *	{"id":2,"cmd":"evaluate","fens":["...","..."],"deadline":100}
+ *	{"id":3,"cmd":"cancel","target":1}
+ *
+ * Only "cmd" is needed: an analysis of the initial position without
+ * limits runs until it is cancelled. "deadline" is in milliseconds from
+ * the time the request was read, and bounds both the wait in the queue
+ * and the search. Responses are
+ *
+ *	{"id":1,"type":"info","depth":9,"seldepth":15,"multipv":1,"cp":31,
+ *	 "nodes":81234,"time":41,"pv":"e2e4 e7e5 g1f3"}
+ *	{"id":1,"type":"bestmove","bestmove":"e2e4","depth":12,"nodes":...,
+ *	 "time":...,"stop":"limit","lines":[{"cp":31,"pv":"e2e4 e7e5"}]}
+ *	{"id":2,"type":"scores","scores":[25,null]}
+ *	{"id":3,"type":"error","error":"..."}
+ *
+ * Scores are "cp", or "mate" in moves, negative if mated. "stop" tells
+ * why the search ended: "limit", "deadline" or "cancel". Info lines are
+ * only sent if asked for. A request cancelled or expired while waiting in
+ * the queue is answered with an error.
+ *
+ *
+ *			---------
+ *			Job Queue
+ *			---------
+ *
+ * The calling thread polls the sockets, parses requests and pushes them
+ * onto a bounded lock-free queue with one sequence number per cell, which
+ * any number of threads may push to and pop from at once. A full queue
+ * refuses the request with an error instead of blocking the clients.
+ * A semaphore counts the queued jobs, so that idle workers sleep.
+ *
+ * Every worker is pinned to a CPU and keeps its own search and hash
+ * table across requests, so the tables stay warm in its caches. Workers
+ * write their responses to the socket of the client themselves, a line at
+ * a time under the send lock of the client, which nothing else waits for
+ * while it is held. The errors of the calling thread are queued on the
+ * client instead and written without blocking, by the calling thread when
+ * the socket takes them or by the next worker writing to the client.
+ *
+ *
+ *			-----------
+ *			Fork Server
+ *			-----------
+ *
+ * "tezdhar --fork-server" speaks the same protocol, but serves every
+ * connection in a process of its own, so that a crash or a runaway job
+ * of one client can not take the others down. The parent initialises the
+ * attack tables, books and tablebases once and keeps a number of forked
+ * children waiting in accept() on its socket, each with its hash table
+ * allocated and its worker thread started. A short job thus costs neither
+ * an exec nor a table initialisation, and the children share the tables of
+ * the parent copy-on-write. A child which takes a client tells the parent
+ * through a pipe, which forks another in its place, and exits when its
+ * client disconnects.
+ */
+
+#ifndef __SERVE_H__
+#define __SERVE_H__	1
+
+#include "chess.h"
+
+#include <stddef.h>	// for size_t
+
+#define SERVE_QUEUE_LEN		1024		// jobs waiting, a power of two
+#define SERVE_MAX_CLIENTS	256
+#define SERVE_MAX_REQUEST	(1 << 20)	// longest request line
+#define SERVE_MAX_FENS		4096		// positions of one evaluate
+#define SERVE_MAX_ID		64		// longest request id
+#define SERVE_HASH_MB		32		// default hash table of a worker
+#define SERVE_SEND_TIMEOUT	5		// seconds a client may block a worker
+#define SERVE_MAX_PENDING	(1 << 16)	// queued errors of a client not reading
+#define SERVE_PREFORK		4		// default children waiting for clients
+
+
+/* Function prototypes */
+int serve_loop(const char *addr, int threads, size_t hash_mb, int tb_probe_limit);
+int serve_fork_loop(const char *addr, int prefork, size_t hash_mb, int tb_probe_limit);
+
+
+#endif	/* __SERVE_H__ */
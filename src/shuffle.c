@@ -0,0 +1,554 @@
+/* @file:	tezdhar/src/shuffle.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/shuffle.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	tezdhar-shuffle, removes duplicate positions from training
+ * 		data and shuffles it, for data sets larger than memory.
+ *
+ *
+ *			---------------------
+ *			Two Pass Shuffle
+ *			---------------------
+ *
+ * The partition pass reads the input files, one per worker thread, and
+ * appends every position packed to one of N bucket files, chosen by its
+ * Zobrist key. Equal positions thus meet in the same bucket. Workers fill
+ * a buffer per bucket and append it with a single write(2), so the disk
+ * sees large sequential writes only.
+ *
+ * The bucket pass then loads one bucket per worker thread, sorts its
+ * positions by key, keeps the first of every run of equal keys and puts
+ * the rest in random order, and appends the bucket to the output file.
+ *
+ * As Zobrist keys are random, a bucket is a random sample of the data,
+ * so random order within the buckets gives a random order of the whole
+ * output. N is chosen so that the buckets being sorted at once fit into
+ * the memory limit (-m); each position needs 32 bytes and 16 bytes of
+ * sort entry. Every byte is read and written twice, so the time is about
+ * twice that of copying the data, if the disks are the bottleneck.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "train.h"
+
+#include <stdio.h>	// for printf, fprintf, perror, snprintf
+#include <stdlib.h>	// for calloc, malloc, free, qsort, strtoull
+
+#ifdef HAVE_TIME_H
+#  include <time.h>	// for time
+#endif
+
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>	// for open
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>	// for stat, fstat
+#endif
+
+#ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>	// for gettimeofday
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for getopt, sysconf, read, write, unlink, getpid
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create, pthread_mutex_lock
+#endif
+
+#define SHUFFLE_MAX_THREADS	256
+#define SHUFFLE_MAX_BUCKETS	4096
+#define SHUFFLE_MEMORY		1024		// default memory limit in MB
+#define SHUFFLE_ENTRY		(TRAIN_POS_SIZE + sizeof(struct shuffle_key))
+#define SHUFFLE_BUF_MAX		(64 << 10)	// largest bucket buffer
+#define SHUFFLE_BUF_MIN		(4 << 10)	// smallest bucket buffer
+#define SHUFFLE_PATH_LEN	4096
+
+/* Sort entry of a position of a bucket */
+struct shuffle_key {
+	uint64_t key;
+	uint64_t index;			// position in the bucket
+};
+
+struct shuffle {
+	char **inputs;
+	int ninputs;
+	int next_input;			// next input file to be partitioned
+	const char *tmpdir;
+	long pid;			// makes bucket file names unique
+	int nbuckets;
+	int next_bucket;		// next bucket to be sorted
+	int *fd;			// bucket files
+	size_t buf_size;		// bucket buffer size of a worker
+	uint64_t seed;
+	struct train_writer out;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t *lock;		// one per bucket file
+	pthread_mutex_t out_lock;
+#endif
+};
+
+struct shuffle_worker {
+	struct shuffle *c;
+	uint8_t *buf;			// partition buffer of every bucket
+	size_t *fill;			// and its bytes
+	uint64_t rng;
+	uint64_t read, unique;		// positions read and written
+	bool failed;
+};
+
+
+static uint64_t shuffle_random(struct shuffle_worker *w)
+{
+	w->rng ^= w->rng << 13;
+	w->rng ^= w->rng >> 7;
+	w->rng ^= w->rng << 17;
+	return w->rng;
+}
+
+
+static void shuffle_bucket_path(const struct shuffle *c, const int b, char *path)
+{
+	snprintf(path, SHUFFLE_PATH_LEN, "%s/tezdhar-shuffle.%ld.%d", c->tmpdir, c->pid, b);
+}
+
+
+static bool shuffle_write_all(const int fd, const uint8_t *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len) {
+		if ((n = write(fd, buf, len)) <= 0) {
+			perror("write failed");
+			return false;
+		}
+		buf += n;
+		len -= (size_t)n;
+	}
+	return true;
+}
+
+
+static bool shuffle_read_all(const int fd, uint8_t *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len) {
+		if ((n = read(fd, buf, len)) <= 0) {
+			perror("read failed");
+			return false;
+		}
+		buf += n;
+		len -= (size_t)n;
+	}
+	return true;
+}
+
+
+/* Append the buffer of a bucket to its file */
+static bool shuffle_flush(struct shuffle_worker *w, const int b)
+{
+	struct shuffle *c = w->c;
+	bool ok;
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&c->lock[b]);
+#endif
+	ok = shuffle_write_all(c->fd[b], w->buf + (size_t)b * c->buf_size, w->fill[b]);
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&c->lock[b]);
+#endif
+
+	w->fill[b] = 0;
+	return ok;
+}
+
+
+/* Partition pass: spread the positions of input files over the buckets */
+static void *shuffle_partition(void *arg)
+{
+	struct shuffle_worker *w = arg;
+	struct shuffle *c = w->c;
+	struct train_reader r;
+	struct train_pos p;
+	int i, b;
+
+	while (!w->failed && (i = __atomic_fetch_add(&c->next_input, 1, __ATOMIC_RELAXED)) < c->ninputs) {
+		if (!train_open(&r, c->inputs[i])) {
+			w->failed = true;
+			break;
+		}
+
+		while (train_read(&r, &p)) {
+			b = (int)(zobrist_key(&p.brd) % (uint64_t)c->nbuckets);
+			if (!train_pack(&p, w->buf + (size_t)b * c->buf_size + w->fill[b])) {
+				continue;
+			}
+			w->read++;
+			if ((w->fill[b] += TRAIN_POS_SIZE) == c->buf_size && !shuffle_flush(w, b)) {
+				w->failed = true;
+				break;
+			}
+		}
+
+		if (!r.ok) {
+			fprintf(stderr, "Corrupt training data: %s\n", c->inputs[i]);
+			w->failed = true;
+		}
+		train_close(&r);
+	}
+
+	for (b = 0; b < c->nbuckets; b++) {
+		if (w->fill[b] && !shuffle_flush(w, b)) {
+			w->failed = true;
+		}
+	}
+
+	return NULL;
+}
+
+
+static int shuffle_cmp_key(const void *a, const void *b)
+{
+	const struct shuffle_key *x = a, *y = b;
+
+	if (x->key != y->key) {
+		return x->key < y->key ? -1 : 1;
+	}
+	return x->index < y->index ? -1 : x->index > y->index;
+}
+
+
+/* Load a bucket and remove its file. Returns the number of positions,
+ * or -1 on failure */
+static int64_t shuffle_load(struct shuffle *c, const int b, uint8_t **recs)
+{
+	char path[SHUFFLE_PATH_LEN];
+	struct stat st;
+	int fd;
+	bool ok;
+
+	*recs = NULL;
+	shuffle_bucket_path(c, b, path);
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		perror(path);
+		return -1;
+	}
+	if (fstat(fd, &st)) {
+		perror(path);
+		close(fd);
+		return -1;
+	}
+
+	*recs = malloc(st.st_size ? (size_t)st.st_size : 1);
+	ok = *recs && shuffle_read_all(fd, *recs, (size_t)st.st_size);
+	if (!*recs) {
+		perror("malloc failed");
+	}
+	close(fd);
+	unlink(path);
+
+	return ok ? (int64_t)(st.st_size / TRAIN_POS_SIZE) : -1;
+}
+
+
+/* Bucket pass: sort, deduplicate and shuffle buckets into the output */
+static void *shuffle_buckets(void *arg)
+{
+	struct shuffle_worker *w = arg;
+	struct shuffle *c = w->c;
+	struct shuffle_key *keys, tmp;
+	struct train_pos p;
+	uint8_t *recs;
+	int64_t n;
+	size_t m, j;
+	int b;
+
+	while (!w->failed && (b = __atomic_fetch_add(&c->next_bucket, 1, __ATOMIC_RELAXED)) < c->nbuckets) {
+		if ((n = shuffle_load(c, b, &recs)) < 0) {
+			free(recs);
+			w->failed = true;
+			break;
+		}
+		if (!(keys = malloc((size_t)(n ? n : 1) * sizeof(*keys)))) {
+			perror("malloc failed");
+			free(recs);
+			w->failed = true;
+			break;
+		}
+
+		for (int64_t i = 0; i < n; i++) {
+			train_unpack(recs + (size_t)i * TRAIN_POS_SIZE, &p);
+			keys[i].key = zobrist_key(&p.brd);
+			keys[i].index = (uint64_t)i;
+		}
+		qsort(keys, (size_t)n, sizeof(*keys), shuffle_cmp_key);
+
+		/* keep the first occurrence of every position */
+		for (m = 0, j = 0; j < (size_t)n; j++) {
+			if (!m || keys[j].key != keys[m - 1].key) {
+				keys[m++] = keys[j];
+			}
+		}
+
+		/* Fisher-Yates shuffle */
+		for (j = m; j > 1; j--) {
+			const size_t k = (size_t)(shuffle_random(w) % j);
+
+			tmp = keys[j - 1];
+			keys[j - 1] = keys[k];
+			keys[k] = tmp;
+		}
+
+#ifdef HAVE_PTHREAD_H
+		pthread_mutex_lock(&c->out_lock);
+#endif
+		for (j = 0; j < m && c->out.ok; j++) {
+			train_write_packed(&c->out, recs + keys[j].index * TRAIN_POS_SIZE);
+		}
+		if (!c->out.ok) {
+			w->failed = true;
+		}
+#ifdef HAVE_PTHREAD_H
+		pthread_mutex_unlock(&c->out_lock);
+#endif
+
+		w->unique += m;
+		free(keys);
+		free(recs);
+	}
+
+	return NULL;
+}
+
+
+/* Run a pass on all workers */
+static void shuffle_run(void *(*pass)(void *), struct shuffle_worker *w, const int threads)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_t tid[SHUFFLE_MAX_THREADS];
+	int started = 0;
+
+	for (int t = 1; t < threads; t++) {
+		if (pthread_create(&tid[started], NULL, pass, &w[t]) == 0) {
+			started++;
+		}
+	}
+	pass(&w[0]);
+	for (int t = 0; t < started; t++) {
+		pthread_join(tid[t], NULL);
+	}
+#else
+	(void)threads;
+	pass(&w[0]);
+#endif
+}
+
+
+/* Enough buckets that those being sorted at once fit into mem bytes. The
+ * positions of a chained file are estimated at 6 bytes each */
+static int shuffle_nbuckets(const struct shuffle *c, const uint64_t mem, const int threads, uint64_t *bytes)
+{
+	struct train_reader r;
+	struct stat st;
+	uint64_t positions = 0, n;
+
+	*bytes = 0;
+	for (int i = 0; i < c->ninputs; i++) {
+		if (stat(c->inputs[i], &st)) {
+			perror(c->inputs[i]);
+			return 0;
+		}
+		if (!train_open(&r, c->inputs[i])) {
+			return 0;
+		}
+		positions += (uint64_t)st.st_size / (r.flags & TRAIN_CHAIN ? TRAIN_LINK_SIZE : TRAIN_POS_SIZE);
+		*bytes += (uint64_t)st.st_size;
+		train_close(&r);
+	}
+
+	n = positions * SHUFFLE_ENTRY / (mem / (uint64_t)threads) + 1;
+	if (n < (uint64_t)threads) {
+		n = (uint64_t)threads;
+	}
+	return n > SHUFFLE_MAX_BUCKETS ? SHUFFLE_MAX_BUCKETS : (int)n;
+}
+
+
+static void shuffle_usage(const char *prog)
+{
+	printf("Usage: %s [-j threads] [-m MB] [-b buckets] [-t dir] [-S seed] -o file input ...\n\n", prog);
+	printf("Remove duplicate positions from training data and shuffle it.\n\n");
+	printf("  -j threads	number of worker threads (default: all cores)\n");
+	printf("  -m MB		memory used for sorting buckets (default: %d)\n", SHUFFLE_MEMORY);
+	printf("  -b buckets	number of bucket files (default: from -m and the input size)\n");
+	printf("  -t dir		directory of the bucket files (default: .)\n");
+	printf("  -S seed	seed of the shuffle (default: time)\n");
+	printf("  -o file	training data file to write\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	static struct shuffle c;
+	struct shuffle_worker *w;
+	struct timeval t0, t1, t2;
+	char path[SHUFFLE_PATH_LEN];
+	const char *out = NULL;
+	uint64_t mem = SHUFFLE_MEMORY, bytes, read = 0, unique = 0;
+	int opt, threads = 1, nbuckets = 0;
+	double part_secs, sort_secs;
+	bool ok = true;
+
+#if defined HAVE_SYSCONF && defined _SC_NPROCESSORS_ONLN
+	threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	c.tmpdir = ".";
+	c.seed = (uint64_t)time(NULL);
+
+	while ((opt = getopt(argc, argv, "j:m:b:t:S:o:h")) != -1) {
+		switch (opt) {
+			case 'j': threads = atoi(optarg); break;
+			case 'm': mem = strtoull(optarg, NULL, 10); break;
+			case 'b': nbuckets = atoi(optarg); break;
+			case 't': c.tmpdir = optarg; break;
+			case 'S': c.seed = strtoull(optarg, NULL, 10); break;
+			case 'o': out = optarg; break;
+			case 'h': shuffle_usage(argv[0]); return EXIT_SUCCESS;
+			default:  shuffle_usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+
+	if (!out || optind == argc || threads < 1 || !mem || nbuckets < 0 || nbuckets > SHUFFLE_MAX_BUCKETS) {
+		shuffle_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads > SHUFFLE_MAX_THREADS) {
+		threads = SHUFFLE_MAX_THREADS;
+	}
+
+	init_leaper_attacks();
+	init_magic_numbers();
+	init_slider_attacks();
+	init_zobrist_keys();
+
+	c.inputs = &argv[optind];
+	c.ninputs = argc - optind;
+	c.pid = (long)getpid();
+	mem <<= 20;
+	if (!(c.nbuckets = shuffle_nbuckets(&c, mem, threads, &bytes))) {
+		return EXIT_FAILURE;
+	}
+	if (nbuckets) {
+		c.nbuckets = nbuckets;
+	}
+
+	/* the partition buffers take at most half of the memory */
+	c.buf_size = mem / 2 / (uint64_t)threads / (uint64_t)c.nbuckets;
+	c.buf_size = c.buf_size > SHUFFLE_BUF_MAX ? SHUFFLE_BUF_MAX :
+		c.buf_size < SHUFFLE_BUF_MIN ? SHUFFLE_BUF_MIN : c.buf_size;
+	c.buf_size -= c.buf_size % TRAIN_POS_SIZE;
+
+	if (!(c.fd = calloc((size_t)c.nbuckets, sizeof(*c.fd))) ||
+			!(w = calloc((size_t)threads, sizeof(*w)))) {
+		perror("calloc failed");
+		return EXIT_FAILURE;
+	}
+#ifdef HAVE_PTHREAD_H
+	if (!(c.lock = calloc((size_t)c.nbuckets, sizeof(*c.lock)))) {
+		perror("calloc failed");
+		return EXIT_FAILURE;
+	}
+	pthread_mutex_init(&c.out_lock, NULL);
+#endif
+
+	for (int b = 0; b < c.nbuckets; b++) {
+		shuffle_bucket_path(&c, b, path);
+		if ((c.fd[b] = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600)) < 0) {
+			perror(path);
+			return EXIT_FAILURE;
+		}
+#ifdef HAVE_PTHREAD_H
+		pthread_mutex_init(&c.lock[b], NULL);
+#endif
+	}
+
+	for (int t = 0; t < threads; t++) {
+		w[t].c = &c;
+		w[t].rng = c.seed ^ (0x9e3779b97f4a7c15ULL * ((uint64_t)t + 1));
+		if (!w[t].rng) {
+			w[t].rng = 1;
+		}
+		if (!(w[t].buf = malloc((size_t)c.nbuckets * c.buf_size)) ||
+				!(w[t].fill = calloc((size_t)c.nbuckets, sizeof(*w[t].fill)))) {
+			perror("malloc failed");
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf("%d input files, %.1f MB, %d buckets of up to %.1f MB\n", c.ninputs, (double)bytes / 1e6,
+			c.nbuckets, (double)(mem / (uint64_t)threads) / 1e6);
+
+	gettimeofday(&t0, NULL);
+	shuffle_run(shuffle_partition, w, threads);
+	for (int b = 0; b < c.nbuckets; b++) {
+		close(c.fd[b]);
+	}
+	for (int t = 0; t < threads; t++) {
+		free(w[t].buf);
+		free(w[t].fill);
+		ok = ok && !w[t].failed;
+	}
+	gettimeofday(&t1, NULL);
+
+	if (ok && train_create(&c.out, out, 0)) {
+		shuffle_run(shuffle_buckets, w, threads);
+		ok = train_finish(&c.out);
+	} else {
+		ok = false;
+	}
+	gettimeofday(&t2, NULL);
+
+	/* remove the buckets left over by a failure */
+	for (int b = 0; b < c.nbuckets; b++) {
+		shuffle_bucket_path(&c, b, path);
+		unlink(path);
+	}
+
+	for (int t = 0; t < threads; t++) {
+		read += w[t].read;
+		unique += w[t].unique;
+		ok = ok && !w[t].failed;
+	}
+
+	part_secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_usec - t0.tv_usec) / 1e6;
+	sort_secs = (double)(t2.tv_sec - t1.tv_sec) + (double)(t2.tv_usec - t1.tv_usec) / 1e6;
+	part_secs = part_secs > 0 ? part_secs : 1e-6;
+	sort_secs = sort_secs > 0 ? sort_secs : 1e-6;
+
+	printf("%llu positions read, %llu written, %llu duplicates removed\n",
+			(unsigned long long)read, (unsigned long long)unique,
+			(unsigned long long)(read - unique));
+	printf("partition %.2f seconds, %.1f MB/s; sort %.2f seconds, %.1f MB/s with %d threads\n",
+			part_secs, (double)(read * TRAIN_POS_SIZE) / part_secs / 1e6,
+			sort_secs, (double)(read * TRAIN_POS_SIZE) / sort_secs / 1e6, threads);
+
+#ifdef HAVE_PTHREAD_H
+	for (int b = 0; b < c.nbuckets; b++) {
+		pthread_mutex_destroy(&c.lock[b]);
+	}
+	pthread_mutex_destroy(&c.out_lock);
+	free(c.lock);
+#endif
+	free(c.fd);
+	free(w);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
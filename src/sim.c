@@ -0,0 +1,332 @@
+/* @file:	tezdhar/src/sim.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/sim.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Signatures of positions, and the nearest neighbour search of the
+ * 		similarity index with vector popcount kernels.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "bitboard.h"
+#include "sim.h"
+
+#include <stdio.h>	// for fprintf, perror
+#include <string.h>	// for memcmp, memcpy, memset
+
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>	// for open
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for close
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>	// for fstat
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>	// for mmap
+#endif
+
+#if defined __GNUC__ && defined __x86_64__
+#  include <immintrin.h>	// for AVX2 and AVX-512 intrinsics
+#  define SIM_X86	1
+#endif
+
+#define SIM_CHUNK	256	// blocks per call of the kernel
+
+static const uint8_t sim_magic[4] = {'T', 'Z', 'S', 'M'};
+
+/* Weight of each bitboard of a signature, in the order of sim_signature() */
+static const uint32_t sim_weights[SIM_WORDS] = {
+	1, 2, 2, 2, 2, 3,	// white king, queens, rooks, bishops, knights, pawns
+	1, 2, 2, 2, 2, 3	// black
+};
+
+
+void sim_signature(const struct board *brd, uint64_t *sig)
+{
+	const struct bitboards *bb = &brd->bb;
+
+	sig[0] = bb->wKing;
+	sig[1] = bb->wQueen;
+	sig[2] = bb->wRook;
+	sig[3] = bb->wBishop;
+	sig[4] = bb->wKnight;
+	sig[5] = bb->wPawn;
+	sig[6] = bb->bKing;
+	sig[7] = bb->bQueen;
+	sig[8] = bb->bRook;
+	sig[9] = bb->bBishop;
+	sig[10] = bb->bKnight;
+	sig[11] = bb->bPawn;
+}
+
+
+/* Counts of the pieces other than kings, 4 bits each */
+uint64_t sim_material(const struct board *brd)
+{
+	uint64_t sig[SIM_WORDS], key = 0;
+
+	sim_signature(brd, sig);
+	for (int i = 0; i < SIM_WORDS; i++) {
+		if (i != 0 && i != 6) {
+			key = key << 4 | (uint64_t)(BITS(sig[i]) & 0xf);
+		}
+	}
+	return key;
+}
+
+
+/* Offset of the signature blocks in an index of count records */
+uint64_t sim_blocks_offset(const uint64_t count)
+{
+	return (SIM_HEADER_SIZE + count * 16 + 63) & ~(uint64_t)63;
+}
+
+
+void sim_put_header(uint8_t *buf, const uint64_t count)
+{
+	const uint16_t version = SIM_VERSION;
+
+	memset(buf, 0, SIM_HEADER_SIZE);
+	memcpy(buf, sim_magic, sizeof(sim_magic));
+	memcpy(buf + 4, &version, sizeof(version));
+	memcpy(buf + 8, &count, sizeof(count));
+}
+
+
+static void sim_distances(const uint64_t *blocks, const uint64_t *query, const size_t nblocks, uint32_t *dist)
+{
+	for (size_t b = 0; b < nblocks; b++, blocks += SIM_WORDS * SIM_BLOCK, dist += SIM_BLOCK) {
+		for (int j = 0; j < SIM_BLOCK; j++) {
+			dist[j] = 0;
+		}
+		for (int w = 0; w < SIM_WORDS; w++) {
+			for (int j = 0; j < SIM_BLOCK; j++) {
+				dist[j] += sim_weights[w] * (uint32_t)BITS(blocks[w * SIM_BLOCK + j] ^ query[w]);
+			}
+		}
+	}
+}
+
+
+#ifdef SIM_X86
+/* AVX2 has no popcount of its own: the bits of every nibble are looked up
+ * with a byte shuffle, and the bytes of each 64 bit lane are summed by
+ * sad against zero */
+__attribute__((target("avx2")))
+static void sim_distances_avx2(const uint64_t *blocks, const uint64_t *query, const size_t nblocks, uint32_t *dist)
+{
+	const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i lo, hi, x, q, w;
+
+	for (size_t b = 0; b < nblocks; b++, blocks += SIM_WORDS * SIM_BLOCK, dist += SIM_BLOCK) {
+		lo = hi = zero;
+		for (int i = 0; i < SIM_WORDS; i++) {
+			q = _mm256_set1_epi64x((long long)query[i]);
+			w = _mm256_set1_epi64x(sim_weights[i]);
+
+			x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(blocks + i * SIM_BLOCK)), q);
+			x = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, nibble)),
+					_mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble)));
+			lo = _mm256_add_epi64(lo, _mm256_mul_epu32(_mm256_sad_epu8(x, zero), w));
+
+			x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(blocks + i * SIM_BLOCK + 4)), q);
+			x = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, nibble)),
+					_mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble)));
+			hi = _mm256_add_epi64(hi, _mm256_mul_epu32(_mm256_sad_epu8(x, zero), w));
+		}
+
+		/* the low 32 bits of each lane hold its distance */
+		lo = _mm256_permutevar8x32_epi32(lo, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+		hi = _mm256_permutevar8x32_epi32(hi, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+		_mm_storeu_si128((__m128i *)dist, _mm256_castsi256_si128(lo));
+		_mm_storeu_si128((__m128i *)(dist + 4), _mm256_castsi256_si128(hi));
+	}
+}
+
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static void sim_distances_avx512(const uint64_t *blocks, const uint64_t *query, const size_t nblocks, uint32_t *dist)
+{
+	__m512i acc, x;
+
+	for (size_t b = 0; b < nblocks; b++, blocks += SIM_WORDS * SIM_BLOCK, dist += SIM_BLOCK) {
+		acc = _mm512_setzero_si512();
+		for (int i = 0; i < SIM_WORDS; i++) {
+			x = _mm512_xor_si512(_mm512_loadu_si512(blocks + i * SIM_BLOCK),
+					_mm512_set1_epi64((long long)query[i]));
+			acc = _mm512_add_epi64(acc, _mm512_maskz_mul_epu32(0xff, _mm512_popcnt_epi64(x),
+						_mm512_set1_epi64(sim_weights[i])));
+		}
+		/* the masked forms, as the plain ones trip -Wmaybe-uninitialized in GCC headers */
+		_mm256_storeu_si256((__m256i *)dist, _mm512_maskz_cvtepi64_epi32(0xff, acc));
+	}
+}
+#endif
+
+
+/* Pick the fastest kernel of the CPU */
+static void sim_select_kernel(struct sim *s)
+{
+	s->kernel = sim_distances;
+	s->kernel_name = "popcount";
+
+#ifdef SIM_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) {
+		s->kernel = sim_distances_avx512;
+		s->kernel_name = "AVX-512 VPOPCNTDQ";
+	} else if (__builtin_cpu_supports("avx2")) {
+		s->kernel = sim_distances_avx2;
+		s->kernel_name = "AVX2";
+	}
+#endif
+}
+
+
+/* Map an index into memory and check that its sections fit the file */
+bool sim_open(struct sim *s, const char *path)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	struct stat st;
+	uint64_t count;
+	uint16_t version;
+	void *map;
+	int fd;
+
+	memset(s, 0, sizeof(*s));
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		perror(path);
+		return false;
+	}
+	if (fstat(fd, &st) || st.st_size < SIM_HEADER_SIZE) {
+		fprintf(stderr, "Not a similarity index: %s\n", path);
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror("mmap failed");
+		return false;
+	}
+	s->map = map;
+	s->size = (size_t)st.st_size;
+
+	memcpy(&version, s->map + 4, sizeof(version));
+	memcpy(&count, s->map + 8, sizeof(count));
+	if (memcmp(s->map, sim_magic, sizeof(sim_magic)) || version != SIM_VERSION ||
+			sim_blocks_offset(count) + (count + SIM_BLOCK - 1) / SIM_BLOCK * SIM_BLOCK_SIZE != s->size) {
+		fprintf(stderr, "Not a similarity index: %s\n", path);
+		sim_close(s);
+		return false;
+	}
+
+	s->count = count;
+	s->material = (const uint64_t *)(const void *)(s->map + SIM_HEADER_SIZE);
+	s->refs = s->material + count;
+	s->blocks = (const uint64_t *)(const void *)(s->map + sim_blocks_offset(count));
+	sim_select_kernel(s);
+	return true;
+#else
+	memset(s, 0, sizeof(*s));
+	fprintf(stderr, "Similarity indexes need mmap(): %s\n", path);
+	return false;
+#endif
+}
+
+
+void sim_close(struct sim *s)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	if (s->map) {
+		munmap((void *)(uintptr_t)s->map, s->size);
+	}
+#endif
+	memset(s, 0, sizeof(*s));
+}
+
+
+void sim_ref(const struct sim *s, const uint64_t i, uint32_t *game, uint16_t *ply)
+{
+	*game = (uint32_t)s->refs[i];
+	*ply = (uint16_t)(s->refs[i] >> 32);
+}
+
+
+/* Find the records with a material key. Returns their number, and the
+ * first of them in first */
+uint64_t sim_material_range(const struct sim *s, const uint64_t material, uint64_t *first)
+{
+	uint64_t lo = 0, hi = s->count, mid, end;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (s->material[mid] < material) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	*first = end = lo;
+	while (end < s->count && s->material[end] == material) {
+		end++;
+	}
+	return end - lo;
+}
+
+
+/* Find the k records nearest to a query among count records from first.
+ * The hits are sorted by distance, and their number is returned */
+int sim_nearest(const struct sim *s, const uint64_t *query, const uint64_t first, const uint64_t count,
+		int k, struct sim_hit *hits)
+{
+	uint32_t dist[SIM_CHUNK * SIM_BLOCK];
+	const uint64_t end = first + count;
+	uint64_t b = first / SIM_BLOCK, i;
+	size_t n;
+	int found = 0, pos;
+
+	k = k < SIM_MAX_HITS ? k : SIM_MAX_HITS;
+	if (k <= 0 || end > s->count) {
+		return 0;
+	}
+
+	while (b * SIM_BLOCK < end) {
+		n = (size_t)((end - b * SIM_BLOCK + SIM_BLOCK - 1) / SIM_BLOCK);
+		n = n < SIM_CHUNK ? n : SIM_CHUNK;
+		s->kernel(s->blocks + b * SIM_WORDS * SIM_BLOCK, query, n, dist);
+
+		for (size_t j = 0; j < n * SIM_BLOCK; j++) {
+			i = b * SIM_BLOCK + j;
+			if (i < first || i >= end || (found == k && dist[j] >= hits[k - 1].dist)) {
+				continue;
+			}
+
+			/* insert into the sorted hits, dropping the farthest */
+			pos = found < k ? found++ : k - 1;
+			while (pos > 0 && hits[pos - 1].dist > dist[j]) {
+				hits[pos] = hits[pos - 1];
+				pos--;
+			}
+			hits[pos].index = i;
+			hits[pos].dist = dist[j];
+		}
+		b += n;
+	}
+
+	return found;
+}
@@ -0,0 +1,89 @@
+/* @file:	tezdhar/src/sim.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/sim.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Similarity index of the positions of a game database, for
+ * 		finding the positions nearest to a given one.
+ *
+ *
+ *			----------------
+ *			Similarity Index
+ *			----------------
+ *
+ * The signature of a position is its 12 piece bitboards, and the distance
+ * of two positions is the weighted Hamming distance of their signatures:
+ * the sum over the bitboards of the weight of the piece times the number
+ * of squares where the two differ. Pawns weigh most, as the pawn structure
+ * says most about the kind of position.
+ *
+ * An index file is built from a database, one record per distinct
+ * position of its index. It is mapped into memory and read on little-
+ * endian hosts only:
+ *
+ *	header		64 bytes: magic "TZSM", version (16 bits), then the
+ *			number of records (64 bits)
+ *	material	material key of each record (64 bits), sorted
+ *	refs		game (32 bits) and ply (16 bits) of each record, 64
+ *			bits per record
+ *	signatures	from the next multiple of 64 bytes, blocks of
+ *			SIM_BLOCK records stored bitboard by bitboard: the
+ *			first bitboard of the 8 records, then the second...
+ *
+ * The blocked layout lets the distance kernels compute the distances of a
+ * whole block with one vector of lanes per record, without summing across
+ * lanes. The kernel is chosen when the index is opened, from AVX-512 with
+ * VPOPCNTDQ, AVX2 and plain popcount. The records are sorted by material
+ * key, so a search can be limited to the positions with the same material
+ * by one binary search.
+ */
+
+#ifndef __SIM_H__
+#define __SIM_H__	1
+
+#include "chess.h"
+
+#include <stddef.h>	// for size_t
+
+#define SIM_HEADER_SIZE		64
+#define SIM_VERSION		1
+#define SIM_WORDS		12	// bitboards per signature
+#define SIM_BLOCK		8	// records per block of signatures
+#define SIM_BLOCK_SIZE		(SIM_WORDS * SIM_BLOCK * 8)
+#define SIM_MAX_HITS		1000
+
+/* Distances of the records of nblocks blocks to a query signature */
+typedef void (*sim_kernel_t)(const uint64_t *blocks, const uint64_t *query, size_t nblocks, uint32_t *dist);
+
+/* A mapped index */
+struct sim {
+	const uint8_t *map;
+	size_t size;
+	uint64_t count;			// number of records
+	const uint64_t *material;
+	const uint64_t *refs;
+	const uint64_t *blocks;
+	sim_kernel_t kernel;
+	const char *kernel_name;
+};
+
+struct sim_hit {
+	uint64_t index;			// record number
+	uint32_t dist;
+};
+
+
+/* Function prototypes */
+void sim_signature(const struct board *brd, uint64_t *sig);
+uint64_t sim_material(const struct board *brd);
+uint64_t sim_blocks_offset(uint64_t count);
+void sim_put_header(uint8_t *buf, uint64_t count);
+bool sim_open(struct sim *s, const char *path);
+void sim_close(struct sim *s);
+void sim_ref(const struct sim *s, uint64_t i, uint32_t *game, uint16_t *ply);
+uint64_t sim_material_range(const struct sim *s, uint64_t material, uint64_t *first);
+int sim_nearest(const struct sim *s, const uint64_t *query, uint64_t first, uint64_t count,
+		int k, struct sim_hit *hits);
+
+
+#endif	/* __SIM_H__ */
@@ -0,0 +1,263 @@
+/* @file:	tezdhar/src/tables.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/tables.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Attack tables of the process, or shared with other processes
+ * 		through shared memory.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "bitboard.h"
+#include "mem.h"
+#include "tables.h"
+
+#include <errno.h>	// for errno, EACCES, EINTR
+#include <stdio.h>	// for fprintf, perror
+#include <stdlib.h>	// for atoi
+#include <string.h>	// for memcmp, memcpy, strncmp
+
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>	// for O_CREAT, O_RDWR
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for close, ftruncate
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>	// for fstat
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>	// for mmap, munmap, shm_open
+#endif
+
+#ifdef HAVE_SYS_FILE_H
+#  include <sys/file.h>	// for flock
+#endif
+
+#define TABLES_SIZE	(TABLES_HEADER_SIZE + sizeof(struct attack_tables))
+
+/* tables of this process, never touched if shared ones are used or if
+ * they are in huge pages */
+static struct attack_tables own_tables;
+static struct attack_tables *large_tables;
+static enum mem_pages pages;
+
+struct attack_tables *attack_tables = &own_tables;
+
+static const char tables_magic[4] = {'T', 'Z', 'A', 'T'};
+
+
+/* Build the attack tables at attack_tables */
+static void tables_build(void)
+{
+	init_leaper_attacks();
+	init_magic_numbers();
+	init_slider_attacks();
+}
+
+
+static uint64_t tables_checksum(const struct attack_tables *t)
+{
+	const uint64_t *w = (const uint64_t *)t;
+	uint64_t h = 0;
+
+	for (size_t i = 0; i < sizeof(*t) / sizeof(*w); i++) {
+		h = (h ^ w[i]) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 29;
+	}
+	return h;
+}
+
+
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H && defined HAVE_SYS_FILE_H
+
+/* Build the tables in an empty object, or in one left unfinished by a
+ * process which died while building it, with the lock of the object held.
+ * Returns false if the object holds other tables */
+static bool tables_fill(const int fd, const char *name, bool *built)
+{
+	const uint16_t version = TABLES_VERSION, hsize = TABLES_HEADER_SIZE;
+	const uint64_t size = sizeof(struct attack_tables);
+	struct stat st;
+	uint64_t sum;
+	uint8_t *h;
+
+	if (fstat(fd, &st)) {
+		perror(name);
+		return false;
+	}
+	if (st.st_size && (size_t)st.st_size != TABLES_SIZE) {
+		fprintf(stderr, "Attack tables of another version in %s\n", name);
+		return false;
+	}
+	if (!st.st_size && ftruncate(fd, (off_t)TABLES_SIZE)) {
+		perror(name);
+		return false;
+	}
+
+	if ((h = mmap(NULL, TABLES_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		perror(name);
+		return false;
+	}
+
+	/* the magic is written last, so that an object without it is empty or
+	 * unfinished */
+	if (!memcmp(h, "\0\0\0\0", 4)) {
+		attack_tables = (struct attack_tables *)(h + TABLES_HEADER_SIZE);
+		tables_build();
+		attack_tables = &own_tables;
+
+		sum = tables_checksum((const struct attack_tables *)(h + TABLES_HEADER_SIZE));
+		memcpy(h + 4, &version, 2);
+		memcpy(h + 6, &hsize, 2);
+		memcpy(h + 8, &size, 8);
+		memcpy(h + 16, &sum, 8);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		memcpy(h, tables_magic, sizeof(tables_magic));
+		*built = true;
+	}
+	munmap(h, TABLES_SIZE);
+	return true;
+}
+
+
+/* Map the tables of the object read-only and check them */
+static bool tables_attach(const int fd, const char *name)
+{
+	uint64_t size, sum;
+	uint16_t version, hsize;
+	struct stat st;
+	uint8_t *h;
+
+	/* an object of another size could not be read to its end */
+	if (fstat(fd, &st) || (size_t)st.st_size != TABLES_SIZE) {
+		fprintf(stderr, "No attack tables in %s\n", name);
+		return false;
+	}
+	if ((h = mmap(NULL, TABLES_SIZE, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		perror(name);
+		return false;
+	}
+
+	memcpy(&version, h + 4, 2);
+	memcpy(&hsize, h + 6, 2);
+	memcpy(&size, h + 8, 8);
+	memcpy(&sum, h + 16, 8);
+	if (memcmp(h, tables_magic, sizeof(tables_magic)) || version != TABLES_VERSION ||
+			hsize != TABLES_HEADER_SIZE || size != sizeof(struct attack_tables)) {
+		fprintf(stderr, "Attack tables of another version in %s\n", name);
+		munmap(h, TABLES_SIZE);
+		return false;
+	}
+	if (sum != tables_checksum((const struct attack_tables *)(h + TABLES_HEADER_SIZE))) {
+		fprintf(stderr, "Attack tables damaged in %s\n", name);
+		munmap(h, TABLES_SIZE);
+		return false;
+	}
+
+	/* stays mapped for the life of the process */
+	attack_tables = (struct attack_tables *)(h + TABLES_HEADER_SIZE);
+	return true;
+}
+
+#endif
+
+
+/* Use the attack tables shared in the object name, a POSIX shared memory
+ * object "/name" or an inherited descriptor "fd:N", building them in it if
+ * it is empty. built tells if this process built them. Returns false if
+ * the tables can not be shared, and are left unbuilt */
+bool tables_open(const char *name, bool *built)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H && defined HAVE_SYS_FILE_H
+	const bool inherited = !strncmp(name, "fd:", 3);
+	bool ok = true;
+	int fd;
+
+	*built = false;
+	if (inherited) {
+		fd = atoi(name + 3);
+	} else if ((fd = shm_open(name, O_RDWR | O_CREAT, 0644)) < 0 && errno == EACCES) {
+		/* the tables of another user may still be read */
+		fd = shm_open(name, O_RDONLY, 0);
+	}
+	if (fd < 0) {
+		perror(name);
+		return false;
+	}
+
+	while (flock(fd, LOCK_EX) && errno == EINTR) {
+	}
+	if ((fcntl(fd, F_GETFL) & O_ACCMODE) == O_RDWR) {
+		ok = tables_fill(fd, name, built);
+	}
+	flock(fd, LOCK_UN);
+
+	ok = ok && tables_attach(fd, name);
+	if (!inherited) {
+		close(fd);
+	}
+	return ok;
+#else
+	(void)built;
+	fprintf(stderr, "Shared attack tables need mmap() and flock(): %s\n", name);
+	return false;
+#endif
+}
+
+
+/* Use the tables shared in the object name if not NULL, else or if they
+ * can not be shared build the tables of the process, in huge pages if
+ * possible as the sliders read them at random */
+void tables_init(const char *name)
+{
+	bool built;
+
+	if (name && tables_open(name, &built)) {
+		return;
+	}
+
+	if ((large_tables = mem_alloc(sizeof(*large_tables), &pages)) && pages == MEM_PAGES_NORMAL) {
+		mem_free(large_tables, sizeof(*large_tables));
+		large_tables = NULL;
+	}
+	if (!large_tables) {
+		pages = MEM_PAGES_NORMAL;
+	}
+	attack_tables = large_tables ? large_tables : &own_tables;
+	tables_build();
+}
+
+
+/* Pages of the tables built by tables_init() */
+enum mem_pages tables_pages(void)
+{
+	return pages;
+}
+
+
+/* Are the tables in use mapped from a shared memory object */
+bool tables_shared(void)
+{
+	return attack_tables != &own_tables && attack_tables != large_tables;
+}
+
+
+/* Free the tables of the process in huge pages, e.g. to build them again
+ * in other pages. Shared tables stay mapped */
+void tables_free(void)
+{
+	if (attack_tables == large_tables) {
+		attack_tables = &own_tables;
+	}
+	mem_free(large_tables, sizeof(*large_tables));
+	large_tables = NULL;
+	pages = MEM_PAGES_NORMAL;
+}
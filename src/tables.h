@@ -0,0 +1,52 @@
+/* @file:	tezdhar/src/tables.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/tables.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Attack tables shared by engine processes through shared
+ * 		memory.
+ *
+ *
+ *			-------------
+ *			Shared Tables
+ *			-------------
+ *
+ * Every process builds 2.3 MiB of attack tables at startup, mostly for
+ * the sliders. Many engine processes on one host can map a single copy
+ * instead, from a POSIX shared memory object ("/name") or from a
+ * descriptor inherited from the parent ("fd:N"), e.g. of a memfd. The
+ * object is 64 bytes of header followed by struct attack_tables:
+ *
+ *	magic "TZAT", version and header size (16 bits each), size of the
+ *	tables and their checksum (64 bits each)
+ *
+ * The first process finds the object empty and builds the tables in it,
+ * holding flock() on it, so that the others wait for it. Every process
+ * then maps the object read-only and uses it only if the header matches
+ * its own tables and the checksum is right, else it builds private ones.
+ * An object of another version is never rebuilt, as processes of that
+ * version may be using it.
+ *
+ * Tables which are not shared are built in huge pages if the host has
+ * them (see mem.h), else in a static array.
+ */
+
+#ifndef __TABLES_H__
+#define __TABLES_H__	1
+
+#include "chess.h"
+#include "mem.h"
+
+#define TABLES_HEADER_SIZE	64
+#define TABLES_VERSION		1
+
+
+/* Function prototypes */
+bool tables_open(const char *name, bool *built);
+void tables_init(const char *name);
+enum mem_pages tables_pages(void);
+bool tables_shared(void);
+void tables_free(void);
+
+
+#endif	/* __TABLES_H__ */
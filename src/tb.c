@@ -0,0 +1,836 @@
+/* @file:	tezdhar/src/tb.c
+ * @project:	Tezdhar Chess Engine
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/tb.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GNU GPLv3
+ * @desc:	Endgame tablebase indexing, PackBits block codec and the
+ * 		engine side WDL/DTM prober. Tablebase files are mapped with
+ * 		mmap() and only the block holding the probed entry is ever
+ * 		decompressed into a small shared block cache.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "bitboard.h"
+#include "chess.h"
+#include "tb.h"
+
+#include <stdio.h>	// for snprintf, fprintf
+#include <stdlib.h>	// for malloc, free
+#include <string.h>	// for memcpy, memset, strcmp
+
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>	// for open
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for close, sysconf
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>	// for fstat
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>	// for mmap, madvise
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_mutex_t
+#endif
+
+#define TB_MAX_TABLES	512	// hash slots for opened tables (power of 2)
+#define TB_CACHE_SLOTS	64	// decompressed blocks kept in memory
+#define TB_PATH_LEN	4096
+
+/* Order in which non-king pieces of a side are indexed and named */
+static const enum chessmen tb_order[] = {QUEEN, ROOK, BISHOP, KNIGHT, PAWN};
+static const char tb_letter[] = "KQNBRP";	// indexed by enum chessmen
+static const int tb_value[] = {0, 9, 3, 3, 5, 1};	// indexed by enum chessmen
+
+/* White king squares of the a1-d1-d4 triangle used by pawnless tables */
+static const int8_t tb_triangle[10] = {A1, B1, C1, D1, B2, C2, D2, C3, D3, D4};
+
+
+/* One mapped WDL or DTM file */
+struct tb_file {
+	const uint8_t *map;		// mmap'd file contents
+	size_t size;			// file size
+	const struct tb_header *hdr;	// header at the start of the map
+	const uint64_t *offset;		// block offsets following the header
+	bool tried;			// open() has already been attempted
+};
+
+/* All files of one material configuration */
+struct tb_table {
+	struct tb_material mat;
+	struct tb_file file[2];		// indexed by enum tb_kind
+	bool used;
+};
+
+/* Decompressed block cache slot */
+struct tb_cache_slot {
+	const struct tb_file *file;	// owner of the cached block
+	uint64_t block;			// block number within the file
+	uint8_t data[TB_BLOCK_SIZE];
+};
+
+static struct tb_table *tb_tables;		// hash table of known tables
+static struct tb_cache_slot *tb_cache;		// decompressed block cache
+static char tb_path[TB_PATH_LEN];		// directory with table files
+static int tb_largest;				// largest table found, in pieces
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t tb_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+static inline void tb_mutex_lock(void)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&tb_lock);
+#endif
+}
+
+static inline void tb_mutex_unlock(void)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&tb_lock);
+#endif
+}
+
+
+static enum chessmen tb_chessman(const char c)
+{
+	switch (c) {
+		case 'K': return KING;
+		case 'Q': return QUEEN;
+		case 'R': return ROOK;
+		case 'B': return BISHOP;
+		case 'N': return KNIGHT;
+		case 'P': return PAWN;
+		default:  return EMPTY;
+	}
+}
+
+
+/* Strength of one side, used to decide which side is named first. The
+ * material value is compared first, then the piece counts in Q,R,B,N,P order
+ * so that every material split has exactly one canonical orientation */
+static uint32_t tb_side_key(const int cnt[])
+{
+	uint32_t key = 0;
+
+	for (int i = 0; i < 5; i++) {
+		key = (key << 3) | (uint32_t)cnt[tb_order[i]];
+	}
+
+	for (int i = 0; i < 5; i++) {
+		key += (uint32_t)(tb_value[tb_order[i]] * cnt[tb_order[i]]) << 16;
+	}
+
+	return key;
+}
+
+
+/* Build canonical material configuration from an unordered list of pieces.
+ * If black holds the stronger material, the colors are swapped and flipped
+ * is set, so that the caller can mirror the position before indexing it */
+bool tb_material_from_pieces(const enum chessmen *type, const enum color *color,
+		int n, struct tb_material *mat, bool *flipped)
+{
+	int cnt[2][6] = {{0}};
+	int w, b, slot = 0;
+	size_t len = 0;
+
+	if (!type || !color || !mat || n < 2 || n > TB_MAX_PIECES) {
+		return false;
+	}
+
+	for (int i = 0; i < n; i++) {
+		if (type[i] > PAWN) {
+			return false;
+		}
+		cnt[color[i]][type[i]]++;
+	}
+
+	if (cnt[WHITE][KING] != 1 || cnt[BLACK][KING] != 1) {
+		return false;
+	}
+
+	w = WHITE; b = BLACK;
+	if (tb_side_key(cnt[BLACK]) > tb_side_key(cnt[WHITE])) {
+		w = BLACK; b = WHITE;
+	}
+	if (flipped) {
+		*flipped = (w == BLACK);
+	}
+
+	memset(mat, 0, sizeof(*mat));
+	mat->count = n;
+	mat->type[slot] = KING; mat->color[slot++] = WHITE;
+	mat->type[slot] = KING; mat->color[slot++] = BLACK;
+
+	mat->name[len++] = 'K';
+	for (int i = 0; i < 5; i++) {
+		for (int c = 0; c < cnt[w][tb_order[i]]; c++) {
+			mat->type[slot] = tb_order[i];
+			mat->color[slot++] = WHITE;
+			mat->name[len++] = tb_letter[tb_order[i]];
+		}
+	}
+
+	mat->name[len++] = 'v';
+	mat->name[len++] = 'K';
+	for (int i = 0; i < 5; i++) {
+		for (int c = 0; c < cnt[b][tb_order[i]]; c++) {
+			mat->type[slot] = tb_order[i];
+			mat->color[slot++] = BLACK;
+			mat->name[len++] = tb_letter[tb_order[i]];
+		}
+	}
+	mat->name[len] = '\0';
+
+	mat->pawns = cnt[WHITE][PAWN] + cnt[BLACK][PAWN];
+	mat->entries = mat->pawns ? 32 * 64 : 10 * 64;
+	for (int i = 2; i < n; i++) {
+		mat->entries *= (mat->type[i] == PAWN) ? 48 : 64;
+	}
+
+	return true;
+}
+
+
+/* Parse material name like "KRPvKR" into canonical configuration */
+bool tb_parse_material(const char *name, struct tb_material *mat)
+{
+	enum chessmen type[TB_MAX_PIECES];
+	enum color color[TB_MAX_PIECES], side = WHITE;
+	int n = 0;
+
+	if (!name) {
+		return false;
+	}
+
+	for (; *name; name++) {
+		if (*name == 'v' || *name == 'V') {
+			if (side == BLACK) {
+				return false;
+			}
+			side = BLACK;
+			continue;
+		}
+		if (n == TB_MAX_PIECES || tb_chessman(*name) == EMPTY) {
+			return false;
+		}
+		type[n] = tb_chessman(*name);
+		color[n++] = side;
+	}
+
+	return (side == BLACK) && tb_material_from_pieces(type, color, n, mat, NULL);
+}
+
+
+/* Mirror a square along the a1-h8 diagonal */
+static inline int8_t tb_transpose(const int8_t sq)
+{
+	return (int8_t)(((sq >> 3) | (sq << 3)) & 63);
+}
+
+
+/* Calculate index of a position whose pieces are given in slot order. The
+ * board symmetries are applied here, so the caller need not care about the
+ * placement of the white king */
+uint64_t tb_index(const struct tb_pos *pos)
+{
+	const struct tb_material *mat = pos->mat;
+	int8_t sq[TB_MAX_PIECES] = {0};
+	int8_t x = 0;		// square transformation (xor mask)
+	bool diag = false;	// mirror along a1-h8 diagonal
+	uint64_t idx;
+	int wk;
+
+	if ((pos->sq[0] & 7) > D_FILE) {
+		x ^= 7;
+	}
+
+	if (!mat->pawns) {
+		if ((pos->sq[0] ^ x) >> 3 > RANK_4) {
+			x ^= 56;
+		}
+		wk = pos->sq[0] ^ x;
+		diag = (wk >> 3) > (wk & 7);
+
+		/* with the white king on the diagonal, the first piece off
+		 * the diagonal decides, so every position has one index */
+		for (int i = 1; (wk >> 3) == (wk & 7) && i < mat->count; i++) {
+			int s = pos->sq[i] ^ x;
+			if ((s >> 3) != (s & 7)) {
+				diag = (s >> 3) > (s & 7);
+				break;
+			}
+		}
+	}
+
+	for (int i = 0; i < mat->count; i++) {
+		sq[i] = (int8_t)(pos->sq[i] ^ x);
+		if (diag) {
+			sq[i] = tb_transpose(sq[i]);
+		}
+	}
+
+	if (mat->pawns) {
+		idx = (uint64_t)((sq[0] >> 3) * 4 + (sq[0] & 7));
+	} else {
+		for (idx = 0; tb_triangle[idx] != sq[0]; idx++);
+	}
+	idx = idx * 64 + (uint64_t)sq[1];
+
+	for (int i = 2; i < mat->count; i++) {
+		if (mat->type[i] == PAWN) {
+			idx = idx * 48 + (uint64_t)(sq[i] - 8);
+		} else {
+			idx = idx * 64 + (uint64_t)sq[i];
+		}
+	}
+
+	return idx;
+}
+
+
+/* Decode index back to squares of each slot. The decoded position is
+ * always in canonical orientation */
+void tb_decode(const struct tb_material *mat, uint64_t idx, int8_t *sq)
+{
+	uint64_t kk;
+
+	for (size_t i = (size_t)mat->count; i-- > 2; ) {
+		if (mat->type[i] == PAWN) {
+			sq[i] = (int8_t)(idx % 48 + 8);
+			idx /= 48;
+		} else {
+			sq[i] = (int8_t)(idx % 64);
+			idx /= 64;
+		}
+	}
+
+	sq[1] = (int8_t)(idx % 64);
+	kk = idx / 64;
+	sq[0] = mat->pawns ? (int8_t)((kk / 4) * 8 + kk % 4) : tb_triangle[kk];
+}
+
+
+/* PackBits run length encoding: a header byte n in 0..127 is followed by
+ * n+1 literal bytes, while n in -127..-1 is followed by one byte which is
+ * repeated 1-n times. The destination must have room for len + len/128 + 1
+ * bytes. Returns the number of bytes written */
+size_t tb_packbits_encode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+	size_t i = 0, o = 0, run, lit, start;
+
+	while (i < len) {
+		for (run = 1; i + run < len && run < 128 && src[i + run] == src[i]; run++);
+
+		if (run >= 2) {
+			dst[o++] = (uint8_t)(257 - run);
+			dst[o++] = src[i];
+			i += run;
+			continue;
+		}
+
+		start = i;
+		for (lit = 0; i < len && lit < 128; i++, lit++) {
+			if (i + 2 < len && src[i] == src[i + 1] && src[i] == src[i + 2]) {
+				break;
+			}
+		}
+		dst[o++] = (uint8_t)(lit - 1);
+		memcpy(dst + o, src + start, lit);
+		o += lit;
+	}
+
+	return o;
+}
+
+
+/* Decode a PackBits block, which must expand to exactly dstlen bytes */
+bool tb_packbits_decode(const uint8_t *src, size_t srclen, uint8_t *dst, size_t dstlen)
+{
+	size_t i = 0, o = 0, n;
+
+	while (i < srclen) {
+		if (src[i] < 128) {
+			n = (size_t)src[i++] + 1;
+			if (i + n > srclen || o + n > dstlen) {
+				return false;
+			}
+			memcpy(dst + o, src + i, n);
+			i += n;
+		} else if (src[i] > 128) {
+			n = 257 - (size_t)src[i++];
+			if (i >= srclen || o + n > dstlen) {
+				return false;
+			}
+			memset(dst + o, src[i++], n);
+		} else {
+			i++;	// -128 is a no-op
+			n = 0;
+		}
+		o += n;
+	}
+
+	return o == dstlen;
+}
+
+
+/* size of uncompressed table data in bytes */
+static uint64_t tb_data_bytes(const enum tb_kind kind, const uint64_t entries)
+{
+	return kind == TB_KIND_WDL ? (2 * entries + 3) / 4 : 2 * entries;
+}
+
+
+static bool tb_file_name(char *buf, size_t len, const char *name, enum tb_kind kind)
+{
+	return snprintf(buf, len, "%s/%s%s", tb_path[0] ? tb_path : ".", name,
+			kind == TB_KIND_WDL ? TB_WDL_EXT : TB_DTM_EXT) < (int)len;
+}
+
+
+/* Map a tablebase file into memory and validate its header */
+static bool tb_map_file(const char *name, enum tb_kind kind, uint64_t entries, struct tb_file *f)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	char file[TB_PATH_LEN + TB_NAME_LEN + 8];
+	struct stat st;
+	void *map;
+	int fd;
+
+	if (!tb_file_name(file, sizeof(file), name, kind) ||
+			(fd = open(file, O_RDONLY)) < 0) {
+		return false;
+	}
+
+	if (fstat(fd, &st) || (size_t)st.st_size < sizeof(struct tb_header)) {
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror("mmap failed");
+		return false;
+	}
+
+	f->map = map;
+	f->size = (size_t)st.st_size;
+	f->hdr = map;
+	f->offset = (const uint64_t *)(f->hdr + 1);
+
+	if (f->hdr->magic != TB_MAGIC || f->hdr->version != TB_VERSION ||
+			f->hdr->kind != (uint32_t)kind ||
+			f->hdr->entries != entries ||
+			f->hdr->block_size != TB_BLOCK_SIZE ||
+			sizeof(struct tb_header) + (f->hdr->blocks + 1) * 8 > f->size ||
+			f->offset[f->hdr->blocks] > f->size) {
+		fprintf(stderr, "Corrupt tablebase file: %s\n", file);
+		munmap(map, f->size);
+		memset(f, 0, sizeof(*f));
+		return false;
+	}
+
+#ifdef HAVE_MADVISE
+	/* probes hit random blocks, so kernel readahead would only waste
+	 * page cache on neighbouring blocks which are never used */
+	madvise(map, f->size, MADV_RANDOM);
+#endif
+	return true;
+#else
+	(void)name; (void)kind; (void)entries; (void)f;
+	return false;
+#endif
+}
+
+
+static void tb_unmap_file(struct tb_file *f)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	if (f->map) {
+		munmap((void *)(uintptr_t)f->map, f->size);
+	}
+#endif
+	memset(f, 0, sizeof(*f));
+}
+
+
+/* Decompress a complete table into memory. Used by the generator to look
+ * up the results of captures and promotions in already generated tables */
+uint8_t *tb_load_table(const char *name, enum tb_kind kind, uint64_t *entries)
+{
+	struct tb_material mat;
+	struct tb_file f = {0};
+	uint64_t bytes, len;
+	uint8_t *buf;
+
+	if (!tb_parse_material(name, &mat) ||
+			!tb_map_file(mat.name, kind, mat.entries, &f)) {
+		return NULL;
+	}
+
+	bytes = tb_data_bytes(kind, mat.entries);
+	if (!(buf = malloc(bytes))) {
+		perror("malloc failed");
+		tb_unmap_file(&f);
+		return NULL;
+	}
+
+	for (uint64_t b = 0; b < f.hdr->blocks; b++) {
+		len = bytes - b * TB_BLOCK_SIZE;
+		if (len > TB_BLOCK_SIZE) {
+			len = TB_BLOCK_SIZE;
+		}
+		if (!tb_packbits_decode(f.map + f.offset[b], f.offset[b + 1] - f.offset[b],
+					buf + b * TB_BLOCK_SIZE, len)) {
+			fprintf(stderr, "Corrupt block %llu in table %s\n",
+					(unsigned long long)b, mat.name);
+			free(buf);
+			tb_unmap_file(&f);
+			return NULL;
+		}
+	}
+
+	tb_unmap_file(&f);
+	if (entries) {
+		*entries = mat.entries;
+	}
+	return buf;
+}
+
+
+/* FNV-1a hash of material name */
+static uint32_t tb_name_hash(const char *name)
+{
+	uint32_t h = 2166136261U;
+
+	while (*name) {
+		h = (h ^ (uint8_t)*name++) * 16777619U;
+	}
+	return h;
+}
+
+
+/* Find or insert the table of a material configuration. Must be called
+ * with the tablebase lock held */
+static struct tb_table *tb_find_table(const struct tb_material *mat)
+{
+	uint32_t h = tb_name_hash(mat->name);
+
+	for (int i = 0; i < TB_MAX_TABLES; i++, h++) {
+		struct tb_table *t = &tb_tables[h & (TB_MAX_TABLES - 1)];
+
+		if (!t->used) {
+			t->used = true;
+			t->mat = *mat;
+			return t;
+		}
+		if (!strcmp(t->mat.name, mat->name)) {
+			return t;
+		}
+	}
+
+	return NULL;
+}
+
+
+/* With MADV_RANDOM every page of a compressed block would fault in with
+ * its own read, so ask the kernel to read the whole block in one go */
+static void tb_readahead(const struct tb_file * const f, const uint64_t block)
+{
+#ifdef HAVE_MADVISE
+	static long page_size;
+	uintptr_t start, end;
+
+	if (!page_size) {
+		page_size = sysconf(_SC_PAGESIZE);
+		if (page_size <= 0) {
+			page_size = 4096;
+		}
+	}
+
+	start = (uintptr_t)(f->map + f->offset[block]) & ~((uintptr_t)page_size - 1);
+	end = (uintptr_t)(f->map + f->offset[block + 1]);
+	if (end - start > (uintptr_t)page_size) {
+		madvise((void *)start, end - start, MADV_WILLNEED);
+	}
+#else
+	(void)f; (void)block;
+#endif
+}
+
+
+/* Look up the raw entry at position pos of a table file, opening the file
+ * and decompressing the containing block if necessary */
+static bool tb_read_entry(struct tb_table *t, enum tb_kind kind, uint64_t pos, uint8_t *val)
+{
+	struct tb_file *f = &t->file[kind];
+	struct tb_cache_slot *slot;
+	uint64_t byte, block, bytes, len;
+	bool ok = true;
+
+	byte = (kind == TB_KIND_WDL) ? pos / 4 : pos;
+	block = byte / TB_BLOCK_SIZE;
+
+	tb_mutex_lock();
+
+	if (!f->tried) {
+		f->tried = true;
+		tb_map_file(t->mat.name, kind, t->mat.entries, f);
+	}
+
+	if (!f->map) {
+		tb_mutex_unlock();
+		return false;
+	}
+
+	slot = &tb_cache[(tb_name_hash(t->mat.name) + kind + block * 0x9e3779b1U) % TB_CACHE_SLOTS];
+	if (slot->file != f || slot->block != block) {
+		bytes = tb_data_bytes(kind, t->mat.entries);
+		len = bytes - block * TB_BLOCK_SIZE;
+		if (len > TB_BLOCK_SIZE) {
+			len = TB_BLOCK_SIZE;
+		}
+		tb_readahead(f, block);
+		ok = tb_packbits_decode(f->map + f->offset[block],
+				f->offset[block + 1] - f->offset[block],
+				slot->data, len);
+		slot->file = ok ? f : NULL;
+		slot->block = block;
+	}
+
+	if (ok) {
+		*val = slot->data[byte % TB_BLOCK_SIZE];
+		if (kind == TB_KIND_WDL) {
+			*val = (*val >> ((pos % 4) * 2)) & 3;
+		}
+	}
+
+	tb_mutex_unlock();
+	return ok;
+}
+
+
+/* Reduce board position to a tablebase position of canonical orientation */
+static bool tb_setup_pos(const struct board * const brd, struct tb_pos *pos,
+		struct tb_material *mat)
+{
+	const uint64_t *bb = (const uint64_t *)&brd->bb;
+	/* struct bitboards member order, white and black interleaved */
+	static const enum chessmen bb_type[12] = {KING, KING, QUEEN, QUEEN,
+		BISHOP, BISHOP, KNIGHT, KNIGHT, ROOK, ROOK, PAWN, PAWN};
+	enum chessmen type[TB_MAX_PIECES];
+	enum color color[TB_MAX_PIECES];
+	int8_t sq[TB_MAX_PIECES];
+	bool used[TB_MAX_PIECES] = {false};
+	bool flipped;
+	int n = 0;
+
+	if (brd->castling[WHITE_KS] || brd->castling[WHITE_QS] ||
+			brd->castling[BLACK_KS] || brd->castling[BLACK_QS] ||
+			brd->enpassant != -1) {
+		return false;
+	}
+
+	for (int i = 0; i < 12; i++) {
+		for (uint64_t b = bb[i]; b; POP_LSB(b)) {
+			if (n == TB_MAX_PIECES) {
+				return false;
+			}
+			type[n] = bb_type[i];
+			color[n] = (enum color)(i & 1);
+			sq[n++] = (int8_t)LSB(b);
+		}
+	}
+
+	if (!tb_material_from_pieces(type, color, n, mat, &flipped)) {
+		return false;
+	}
+
+	pos->mat = mat;
+	pos->turn = flipped ? !brd->turn : brd->turn;
+
+	for (int s = 0; s < n; s++) {
+		for (int i = 0; i < n; i++) {
+			enum color c = flipped ? !color[i] : color[i];
+			if (!used[i] && type[i] == mat->type[s] && c == mat->color[s]) {
+				used[i] = true;
+				pos->sq[s] = flipped ? (int8_t)(sq[i] ^ 56) : sq[i];
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+static bool tb_probe(const struct board * const brd, enum tb_kind kind, uint8_t *val)
+{
+	struct tb_material mat;
+	struct tb_table *t;
+	struct tb_pos pos;
+	uint64_t idx;
+
+	if (!tb_tables || !tb_setup_pos(brd, &pos, &mat) || mat.count > tb_largest) {
+		return false;
+	}
+
+	idx = tb_index(&pos);
+
+	tb_mutex_lock();
+	t = tb_find_table(&mat);
+	tb_mutex_unlock();
+
+	return t && tb_read_entry(t, kind, pos.turn * mat.entries + idx, val);
+}
+
+
+/* Probe win-draw-loss value of a position for the side to move */
+bool tb_probe_wdl(const struct board * const brd, enum tb_wdl *wdl)
+{
+	uint8_t val;
+
+	if (!wdl || !tb_probe(brd, TB_KIND_WDL, &val) || val > TB_WIN) {
+		return false;
+	}
+
+	*wdl = (enum tb_wdl)val;
+	return true;
+}
+
+
+/* Probe depth to mate of a position for the side to move. A positive value
+ * is a win in so many moves, a negative value a loss and 0 is a draw */
+bool tb_probe_dtm(const struct board * const brd, int *dtm)
+{
+	uint8_t val;
+
+	if (!dtm || !tb_probe(brd, TB_KIND_DTM, &val)) {
+		return false;
+	}
+
+	*dtm = TB_DTM_IS_LOSS(val) ? -(val - 128) : val;
+	return true;
+}
+
+
+/* largest number of pieces for which tables were found */
+int tb_max_pieces(void)
+{
+	return tb_largest;
+}
+
+
+/* Enumerate canonical material configurations with the given number of
+ * pieces. Each side has one king and any multiset of Q, R, B, N, P pieces.
+ * Returns the number of configurations stored in mats */
+int tb_materials(const int pieces, struct tb_material *mats, const int max)
+{
+	char side[64][TB_MAX_PIECES];	// all multisets of up to 3 pieces
+	char name[TB_NAME_LEN];
+	struct tb_material mat;
+	int nsides = 0, n = 0;
+
+	/* multisets are generated as non-decreasing triples of indices into
+	 * tb_order, where index 5 stands for "no piece" */
+	for (int a = 0; a <= 5; a++) {
+		for (int b = a; b <= 5; b++) {
+			for (int c = b; c <= 5; c++) {
+				int len = 0;
+				if (a < 5) side[nsides][len++] = tb_letter[tb_order[a]];
+				if (b < 5) side[nsides][len++] = tb_letter[tb_order[b]];
+				if (c < 5) side[nsides][len++] = tb_letter[tb_order[c]];
+				side[nsides++][len] = '\0';
+			}
+		}
+	}
+
+	for (int w = 0; w < nsides; w++) {
+		for (int b = 0; b < nsides; b++) {
+			if (snprintf(name, sizeof(name), "K%svK%s", side[w], side[b]) >= (int)sizeof(name) ||
+					(int)strlen(name) - 1 != pieces || !tb_parse_material(name, &mat) ||
+					strcmp(mat.name, name) || n >= max) {
+				continue;
+			}
+			mats[n++] = mat;
+		}
+	}
+
+	return n;
+}
+
+
+/* Find the largest tables available below path. Files are opened lazily on
+ * their first probe, here we only look for the presence of the WDL files */
+static void tb_scan_path(void)
+{
+	char file[TB_PATH_LEN + TB_NAME_LEN + 8];
+	struct tb_material mats[256];
+	FILE *fp;
+
+	tb_largest = 0;
+	for (int pieces = TB_MAX_PIECES; pieces >= 2 && !tb_largest; pieces--) {
+		int n = tb_materials(pieces, mats, 256);
+		for (int i = 0; i < n && !tb_largest; i++) {
+			if (tb_file_name(file, sizeof(file), mats[i].name, TB_KIND_WDL) &&
+					(fp = fopen(file, "rb"))) {
+				fclose(fp);
+				tb_largest = pieces;
+			}
+		}
+	}
+}
+
+
+/* Initialize the prober with the directory containing the tablebases */
+bool tb_init(const char *path)
+{
+	tb_free();
+
+	if (!path || strlen(path) >= TB_PATH_LEN) {
+		return false;
+	}
+	strcpy(tb_path, path);
+
+	tb_tables = calloc(TB_MAX_TABLES, sizeof(struct tb_table));
+	tb_cache = calloc(TB_CACHE_SLOTS, sizeof(struct tb_cache_slot));
+	if (!tb_tables || !tb_cache) {
+		perror("calloc failed");
+		tb_free();
+		return false;
+	}
+
+	tb_scan_path();
+	dbg_print("Found %d-piece tablebases in %s\n", tb_largest, tb_path);
+	return tb_largest > 0;
+}
+
+
+/* Unmap all tables and release the block cache */
+void tb_free(void)
+{
+	if (tb_tables) {
+		for (int i = 0; i < TB_MAX_TABLES; i++) {
+			tb_unmap_file(&tb_tables[i].file[TB_KIND_WDL]);
+			tb_unmap_file(&tb_tables[i].file[TB_KIND_DTM]);
+		}
+	}
+
+	free(tb_tables);
+	free(tb_cache);
+	tb_tables = NULL;
+	tb_cache = NULL;
+	tb_largest = 0;
+}
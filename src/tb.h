@@ -0,0 +1,139 @@
+/* @file:	tezdhar/src/tb.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/tb.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Endgame tablebase material configurations, position indexing
+ * 		and the block compressed on-disk WDL/DTM file format shared
+ * 		by the tablebase generator and the engine side prober.
+ *
+ *
+ *			-------------------------------
+ *			Tablebase Position Index Layout
+ *			-------------------------------
+ *
+ * Every table is named after its material, stronger side first, like
+ * "KQvK" or "KRPvKR". Pieces are indexed in a fixed order: white king,
+ * black king, then the remaining white pieces and the remaining black
+ * pieces, each in Q, R, B, N, P order.
+ *
+ * The two kings are folded into a single "kk slot" after applying the board
+ * symmetries. Pawnless tables use the 8-fold symmetry of the board, so the
+ * white king is always placed inside the a1-d1-d4 triangle (10 squares).
+ * When it stands on the a1-d4 diagonal, the first other piece off the
+ * diagonal is kept below it, so that no position has two indices.
+ * Tables with pawns can only be mirrored left-right, so the white king is
+ * kept on files a-d (32 squares). Pawns can never stand on the first or the
+ * last rank, so each pawn is indexed with 48 squares instead of 64.
+ *
+ *	index = ((kk_slot * range[2] + sq[2]) * range[3] + sq[3]) ...
+ *
+ * Both sides to move are stored in the same file, white to move first.
+ * Positions which can not occur on board (overlapping pieces, adjacent kings
+ * or the side not to move being in check) and indices which are never used
+ * by the diagonal rule above are "don't care" entries, which the generator
+ * fills with the previous value to lengthen the runs.
+ *
+ *
+ *			--------------------------
+ *			Tablebase File Format
+ *			--------------------------
+ *
+ *	struct tb_header	fixed size header (see below)
+ *	uint64_t offset[n+1]	offset of each compressed block from the start
+ *				of the file, the last one marks the end of data
+ *	uint8_t data[]		PackBits compressed blocks
+ *
+ * Each block holds TB_BLOCK_SIZE uncompressed bytes, so the block of any
+ * entry can be found with a single division, and only that block has to be
+ * decompressed on a probe. WDL files pack four entries per byte (2 bits:
+ * 0 = loss, 1 = draw, 2 = win for the side to move). DTM files store one
+ * byte per entry in the TB_DTM_* encoding described below.
+ */
+
+#ifndef __TB_H__
+#define __TB_H__	1
+
+#include "chess.h"
+
+#define TB_MAX_PIECES	5		// largest supported table
+#define TB_NAME_LEN	16		// e.g. "KQRvKR" plus Null terminator
+#define TB_BLOCK_SIZE	8192		// uncompressed bytes per block
+#define TB_MAGIC	0x42545a54U	// "TZTB" in little-endian
+#define TB_VERSION	1
+
+#define TB_WDL_EXT	".tzw"		// win-draw-loss file extension
+#define TB_DTM_EXT	".tzm"		// depth-to-mate file extension
+
+/* DTM byte encoding, always from the point of view of the side to move.
+ * Mate lengths are counted in full moves, i.e. a "win in 1" is a mate in
+ * one ply and a "loss in 0" is a checkmated side to move */
+#define TB_DTM_DRAW		0	// draw (or don't care)
+#define TB_DTM_WIN(n)		((uint8_t)(n))		// n = 1 .. 127
+#define TB_DTM_LOSS(n)		((uint8_t)(128 + (n)))	// n = 0 .. 127
+#define TB_DTM_IS_WIN(v)	((v) >= 1 && (v) <= 127)
+#define TB_DTM_IS_LOSS(v)	((v) >= 128)
+#define TB_DTM_MOVES(v)		((v) >= 128 ? (v) - 128 : (v))
+#define TB_DTM_MAX		127
+
+/* WDL value of a position for the side to move */
+enum tb_wdl {
+	TB_LOSS	= 0,
+	TB_DRAW	= 1,
+	TB_WIN	= 2
+};
+
+/* Kind of tablebase file */
+enum tb_kind {
+	TB_KIND_WDL = 0,
+	TB_KIND_DTM = 1
+};
+
+/* Material configuration of a table in index order */
+struct tb_material {
+	char name[TB_NAME_LEN];		// canonical name, e.g. "KRPvKR"
+	enum chessmen type[TB_MAX_PIECES];	// piece type of each index slot
+	enum color color[TB_MAX_PIECES];	// piece color of each index slot
+	uint64_t entries;		// positions per side to move
+	int count;			// pieces including both kings
+	int pawns;			// number of pawns of both colors
+};
+
+/* On-disk header of WDL and DTM files */
+struct tb_header {
+	uint32_t magic;			// TB_MAGIC
+	uint32_t version;		// TB_VERSION
+	uint32_t kind;			// enum tb_kind
+	uint32_t block_size;		// uncompressed bytes per block
+	uint64_t entries;		// positions per side to move
+	uint64_t blocks;		// number of compressed blocks
+	uint8_t max_dtm;		// longest mate in table (in moves)
+	uint8_t reserved[7];		// zero, keeps the header 8-byte aligned
+	char name[TB_NAME_LEN];		// material name
+};
+
+/* A position reduced to the pieces of a material configuration */
+struct tb_pos {
+	const struct tb_material *mat;	// material configuration
+	int8_t sq[TB_MAX_PIECES];	// square of each index slot
+	enum color turn;		// side to move
+};
+
+
+/* Function prototypes */
+bool tb_parse_material(const char *name, struct tb_material *mat);
+bool tb_material_from_pieces(const enum chessmen *type, const enum color *color, int n, struct tb_material *mat, bool *flipped);
+uint64_t tb_index(const struct tb_pos *pos);
+void tb_decode(const struct tb_material *mat, uint64_t idx, int8_t *sq);
+size_t tb_packbits_encode(const uint8_t *src, size_t len, uint8_t *dst);
+bool tb_packbits_decode(const uint8_t *src, size_t srclen, uint8_t *dst, size_t dstlen);
+uint8_t *tb_load_table(const char *name, enum tb_kind kind, uint64_t *entries);
+int tb_materials(const int pieces, struct tb_material *mats, const int max);
+bool tb_init(const char *path);
+void tb_free(void);
+int tb_max_pieces(void);
+bool tb_probe_wdl(const struct board * const brd, enum tb_wdl *wdl);
+bool tb_probe_dtm(const struct board * const brd, int *dtm);
+
+
+#endif	/* __TB_H__ */
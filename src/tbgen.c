@@ -0,0 +1,1064 @@
+/* @file:	tezdhar/src/tbgen.c
+ * @project:	Tezdhar Chess Engine
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/tbgen.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GNU GPLv3
+ * @desc:	Multithreaded retrograde generator for 2 to 5 piece endgame
+ * 		tablebases (tezdhar-tbgen). Writes block compressed WDL and
+ * 		DTM files which are probed by the engine through mmap().
+ *
+ *
+ *			----------------------------------
+ *			Retrograde Analysis with Bitmaps
+ *			----------------------------------
+ *
+ * Every position of a table has one DTM byte per side to move. Positions are
+ * resolved level by level, where level n finds all wins in n moves and then
+ * all losses in n moves:
+ *
+ *  1. Initialization: illegal positions are marked in the "broken" bitmap,
+ *     checkmates become losses in 0 and form the first loss frontier. Moves
+ *     which leave the table (captures and promotions) are looked up in the
+ *     already generated smaller tables, and the best of them is kept in a
+ *     separate conversion byte of the position.
+ *
+ *  2. Win in n: every position of the loss frontier is un-moved with the
+ *     attack tables. Each unresolved predecessor has a move into a lost
+ *     position, so it is won in n. Positions whose best conversion wins in n
+ *     are collected by a linear scan. New wins form the win frontier.
+ *
+ *  3. Loss in n: predecessors of the win frontier are candidates, which are
+ *     verified by generating all their moves forward. A candidate is lost
+ *     if every move leads to a won position for the opponent and no
+ *     conversion does better than a loss in n.
+ *
+ * The frontiers are bitmaps with one bit per position, so memory use is one
+ * DTM byte, one conversion byte and a few bits per position. Each level is
+ * split into chunks of indices which are handed out to worker threads; the
+ * threads update the shared DTM bytes with compare-and-swap and the frontier
+ * bitmaps with atomic OR. Positions never resolved are draws.
+ *
+ * En-passant captures and castling are not considered, as usual for
+ * tablebases. Identical pieces of one side are indexed independently, so
+ * such positions are simply stored more than once.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "bitboard.h"
+#include "chess.h"
+#include "tb.h"
+
+#include <stdio.h>	// for printf, fprintf
+#include <stdlib.h>	// for calloc, free, qsort
+#include <string.h>	// for memcpy, memset, strcmp
+#include <time.h>	// for time, difftime
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for getopt, sysconf, access
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create
+#endif
+
+#define TBGEN_CHUNK		(1ULL << 16)	// indices per work unit
+#define TBGEN_MAX_MOVES		128		// moves of up to 5 pieces
+#define TBGEN_MAX_TABLES	256		// tables in one run
+#define TBGEN_CONV_NONE		0		// no move leaves the table
+#define TBGEN_CONV_DRAW		128		// best conversion draws
+
+/* A move of the generator, possibly leaving the table */
+struct tbgen_move {
+	int8_t slot;		// moving piece
+	int8_t to;		// destination square
+	int8_t victim;		// captured piece slot or -1
+	enum chessmen promo;	// promoted piece or EMPTY
+};
+
+/* A move leaving the table leads into a table of different material. The
+ * descriptor maps the slots of this table onto the slots of the other one */
+struct tbgen_conv {
+	struct tb_material mat;		// material after the conversion
+	const uint8_t *dtm;		// DTM entries of the smaller table
+	int8_t map[TB_MAX_PIECES];	// slot in this table to slot in mat
+	bool flipped;			// colors are swapped in mat
+};
+
+/* Generator state of one table */
+struct tbgen {
+	struct tb_material mat;
+	uint64_t n;			// entries per side to move
+	uint8_t *val[2];		// DTM bytes in progress
+	uint8_t *conv[2];		// best conversion of each position
+	uint64_t *broken[2];		// illegal positions
+	uint64_t *floss[2];		// frontier of new losses
+	uint64_t *fwin[2];		// frontier of new wins
+
+	/* conversions indexed by [victim + 1][promoting slot + 1][piece] */
+	struct tbgen_conv *cv[TB_MAX_PIECES + 1][TB_MAX_PIECES + 1][EMPTY];
+	uint8_t *sub[TBGEN_MAX_TABLES];	// loaded smaller tables
+	char subname[TBGEN_MAX_TABLES][TB_NAME_LEN];
+	int nsub;
+
+	/* work distribution */
+	void (*work)(struct tbgen *g, uint64_t begin, uint64_t end);
+	uint64_t next;			// first index of next chunk
+	uint64_t found;			// positions resolved in current phase
+	enum color side;		// side to move being resolved
+	int level;			// current level in moves
+	int max_conv;			// longest conversion result in moves
+	int threads;
+	bool overflow;			// a mate longer than TB_DTM_MAX
+};
+
+
+static inline bool tbgen_test(const uint64_t *bm, const uint64_t idx)
+{
+	return (bm[idx >> 6] >> (idx & 63)) & 1;
+}
+
+static inline void tbgen_mark(uint64_t *bm, const uint64_t idx)
+{
+	__atomic_fetch_or(&bm[idx >> 6], 1ULL << (idx & 63), __ATOMIC_RELAXED);
+}
+
+
+/* attacks of a piece standing on sq for the given occupancy */
+static uint64_t tbgen_attacks(const enum chessmen type, const enum color c,
+		const int8_t sq, const uint64_t occ)
+{
+	switch (type) {
+		case KING:	return get_king_attacks((enum square)sq);
+		case QUEEN:	return get_queen_attacks((enum square)sq, occ);
+		case ROOK:	return get_rook_attacks((enum square)sq, occ);
+		case BISHOP:	return get_bishop_attacks((enum square)sq, occ);
+		case KNIGHT:	return get_knight_attacks((enum square)sq);
+		case PAWN:	return get_pawn_attacks(c, (enum square)sq);
+		case EMPTY:
+		default:	return 0ULL;
+	}
+}
+
+
+/* is square attacked by any piece of color 'by', ignoring slot 'skip' */
+static bool tbgen_attacked(const struct tb_material *mat, const int8_t *sq,
+		const int skip, const int8_t target, const enum color by)
+{
+	uint64_t occ = 0ULL;
+
+	for (int i = 0; i < mat->count; i++) {
+		if (i != skip) {
+			occ |= BIT(sq[i]);
+		}
+	}
+
+	for (int i = 0; i < mat->count; i++) {
+		if (i != skip && mat->color[i] == by &&
+				(tbgen_attacks(mat->type[i], by, sq[i], occ) & BIT(target))) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/* A position is legal if no two pieces share a square, the kings are not
+ * adjacent and the side not to move is not in check */
+static bool tbgen_legal(const struct tb_material *mat, const int8_t *sq, const enum color turn)
+{
+	uint64_t occ = 0ULL;
+
+	for (int i = 0; i < mat->count; i++) {
+		if (occ & BIT(sq[i])) {
+			return false;
+		}
+		occ |= BIT(sq[i]);
+	}
+
+	if (get_king_attacks((enum square)sq[0]) & BIT(sq[1])) {
+		return false;
+	}
+
+	return !tbgen_attacked(mat, sq, -1, sq[turn == WHITE ? 1 : 0], turn);
+}
+
+
+static int tbgen_slot_at(const struct tb_material *mat, const int8_t *sq, const int8_t s)
+{
+	for (int i = 0; i < mat->count; i++) {
+		if (sq[i] == s) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+static int tbgen_add_moves(const int8_t slot, uint64_t targets, const bool promo, const struct tb_material *mat, const int8_t *sq,
+		struct tbgen_move *mv, int n)
+{
+	static const enum chessmen promos[] = {QUEEN, ROOK, BISHOP, KNIGHT};
+
+	for (; targets; POP_LSB(targets)) {
+		int8_t to = (int8_t)LSB(targets);
+		int8_t victim = (int8_t)tbgen_slot_at(mat, sq, to);
+
+		for (int p = 0; p < (promo ? 4 : 1); p++) {
+			mv[n].slot = slot;
+			mv[n].to = to;
+			mv[n].victim = victim;
+			mv[n++].promo = promo ? promos[p] : EMPTY;
+		}
+	}
+
+	return n;
+}
+
+
+/* Generate all legal moves of the side to move */
+static int tbgen_gen_moves(const struct tb_material *mat, const int8_t *sq,
+		const enum color turn, struct tbgen_move *mv)
+{
+	struct tbgen_move pseudo[TBGEN_MAX_MOVES];
+	uint64_t occ = 0ULL, own = 0ULL, opp;
+	int n = 0, legal = 0;
+	int8_t csq[TB_MAX_PIECES];
+
+	for (int i = 0; i < mat->count; i++) {
+		occ |= BIT(sq[i]);
+		if (mat->color[i] == turn) {
+			own |= BIT(sq[i]);
+		}
+	}
+	/* the king can never be captured in a legal position */
+	opp = occ & ~own & ~BIT(sq[turn == WHITE ? 1 : 0]);
+
+	for (int8_t i = 0; i < mat->count; i++) {
+		int8_t from = sq[i];
+
+		if (mat->color[i] != turn) {
+			continue;
+		}
+
+		if (mat->type[i] == PAWN) {
+			int8_t up = turn == WHITE ? 8 : -8;
+			int8_t last = turn == WHITE ? RANK_8 : RANK_1;
+			bool promo = ((from + up) >> 3) == last;
+			uint64_t push = BIT(from + up) & ~occ;
+
+			if (push && (from >> 3) == (turn == WHITE ? RANK_2 : RANK_7)) {
+				push |= BIT(from + 2 * up) & ~occ;
+			}
+			n = tbgen_add_moves(i, push, promo, mat, sq, pseudo, n);
+			n = tbgen_add_moves(i, get_pawn_attacks(turn, (enum square)from) & opp,
+					promo, mat, sq, pseudo, n);
+		} else {
+			n = tbgen_add_moves(i, tbgen_attacks(mat->type[i], turn, from, occ)
+					& (opp | ~occ), false, mat, sq, pseudo, n);
+		}
+	}
+
+	/* keep the moves which do not leave the own king in check */
+	for (int m = 0; m < n; m++) {
+		memcpy(csq, sq, sizeof(csq));
+		csq[pseudo[m].slot] = pseudo[m].to;
+		if (!tbgen_attacked(mat, csq, pseudo[m].victim,
+					csq[turn == WHITE ? 0 : 1], !turn)) {
+			mv[legal++] = pseudo[m];
+		}
+	}
+
+	return legal;
+}
+
+
+/* Result of a move leaving the table, from the point of view of the side
+ * making the move, in the DTM encoding (TBGEN_CONV_DRAW for draws) */
+static uint8_t tbgen_conv_value(struct tbgen *g, const int8_t *sq,
+		const enum color turn, const struct tbgen_move *m)
+{
+	const struct tbgen_conv *cv;
+	struct tb_pos child;
+	uint64_t idx;
+	uint8_t v;
+	int moves;
+
+	cv = g->cv[m->victim + 1][m->promo != EMPTY ? m->slot + 1 : 0][m->promo != EMPTY ? m->promo : KING];
+	child.mat = &cv->mat;
+	child.turn = cv->flipped ? turn : !turn;
+
+	for (int i = 0; i < g->mat.count; i++) {
+		if (i != m->victim) {
+			int8_t s = (i == m->slot) ? m->to : sq[i];
+			child.sq[cv->map[i]] = cv->flipped ? (int8_t)(s ^ 56) : s;
+		}
+	}
+
+	idx = tb_index(&child);
+	v = cv->dtm[child.turn * cv->mat.entries + idx];
+
+	if (v == TB_DTM_DRAW) {
+		return TBGEN_CONV_DRAW;
+	}
+
+	if (TB_DTM_IS_WIN(v)) {
+		return TB_DTM_LOSS(TB_DTM_MOVES(v));
+	}
+
+	moves = TB_DTM_MOVES(v) + 1;
+	if (moves > TB_DTM_MAX) {
+		g->overflow = true;
+		moves = TB_DTM_MAX;
+	}
+	return TB_DTM_WIN(moves);
+}
+
+
+/* compare DTM values from the point of view of the side to move */
+static int tbgen_rank(const uint8_t v)
+{
+	if (v == TBGEN_CONV_NONE || v == TBGEN_CONV_DRAW) {
+		return 0;
+	}
+	return TB_DTM_IS_WIN(v) ? 1000 - v : -1000 + TB_DTM_MOVES(v);
+}
+
+
+static void tbgen_init_work(struct tbgen *g, uint64_t begin, uint64_t end)
+{
+	struct tbgen_move mv[TBGEN_MAX_MOVES];
+	struct tb_pos pos = {.mat = &g->mat};
+	int n, max_conv = 0;
+
+	for (int s = WHITE; s <= BLACK; s++) {
+		for (uint64_t idx = begin; idx < end; idx++) {
+			uint8_t best = TBGEN_CONV_NONE, v;
+
+			tb_decode(&g->mat, idx, pos.sq);
+			if (tb_index(&pos) != idx || !tbgen_legal(&g->mat, pos.sq, (enum color)s)) {
+				g->broken[s][idx >> 6] |= 1ULL << (idx & 63);
+				continue;
+			}
+
+			n = tbgen_gen_moves(&g->mat, pos.sq, (enum color)s, mv);
+			for (int m = 0; m < n; m++) {
+				if (mv[m].victim < 0 && mv[m].promo == EMPTY) {
+					continue;
+				}
+				v = tbgen_conv_value(g, pos.sq, (enum color)s, &mv[m]);
+				if (best == TBGEN_CONV_NONE || tbgen_rank(v) > tbgen_rank(best)) {
+					best = v;
+				}
+			}
+
+			if (!n && tbgen_attacked(&g->mat, pos.sq, -1, pos.sq[s], !s)) {
+				g->val[s][idx] = TB_DTM_LOSS(0);	// checkmate
+				g->floss[s][idx >> 6] |= 1ULL << (idx & 63);
+			}
+
+			g->conv[s][idx] = best;
+			if (best != TBGEN_CONV_NONE && best != TBGEN_CONV_DRAW &&
+					TB_DTM_MOVES(best) > max_conv) {
+				max_conv = TB_DTM_MOVES(best);
+			}
+		}
+	}
+
+	/* only ever grows, so a racy maximum is fine with a CAS loop */
+	for (int old = __atomic_load_n(&g->max_conv, __ATOMIC_RELAXED); old < max_conv &&
+			!__atomic_compare_exchange_n(&g->max_conv, &old, max_conv, false,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED););
+}
+
+
+/* Set value of an unresolved position and add it to the frontier */
+static bool tbgen_resolve(struct tbgen *g, const enum color s, const uint64_t idx,
+		const uint8_t v, uint64_t *frontier)
+{
+	uint8_t unknown = TB_DTM_DRAW;
+
+	if (__atomic_compare_exchange_n(&g->val[s][idx], &unknown, v, false,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		tbgen_mark(frontier, idx);
+		return true;
+	}
+	return false;
+}
+
+
+/* Un-move the pieces of color 'mover', calling back for each predecessor.
+ * Un-moves never capture or un-promote, those leave the table */
+static uint64_t tbgen_unmoves(struct tbgen *g, const int8_t *sq, const enum color mover,
+		bool (*fn)(struct tbgen *g, const struct tb_pos *pos))
+{
+	struct tb_pos pos = {.mat = &g->mat, .turn = mover};
+	uint64_t occ = 0ULL, from, found = 0;
+
+	for (int i = 0; i < g->mat.count; i++) {
+		occ |= BIT(sq[i]);
+	}
+
+	memcpy(pos.sq, sq, sizeof(pos.sq));
+	for (int i = 0; i < g->mat.count; i++) {
+		int8_t to = sq[i];
+
+		if (g->mat.color[i] != mover) {
+			continue;
+		}
+
+		if (g->mat.type[i] == PAWN) {
+			int8_t down = mover == WHITE ? -8 : 8;
+			from = 0ULL;
+			if ((to + down) >= A2 && (to + down) <= H7) {
+				from = BIT(to + down) & ~occ;
+			}
+			if (from && (to >> 3) == (mover == WHITE ? RANK_4 : RANK_5)) {
+				from |= BIT(to + 2 * down) & ~occ;
+			}
+		} else {
+			from = tbgen_attacks(g->mat.type[i], mover, to, occ) & ~occ;
+		}
+
+		for (; from; POP_LSB(from)) {
+			pos.sq[i] = (int8_t)LSB(from);
+			found += fn(g, &pos);
+		}
+		pos.sq[i] = to;
+	}
+
+	return found;
+}
+
+
+/* Predecessor has a move into a lost position, so it is won */
+static bool tbgen_win_pred(struct tbgen *g, const struct tb_pos *pos)
+{
+	uint64_t idx = tb_index(pos);
+
+	return !tbgen_test(g->broken[pos->turn], idx) &&
+		tbgen_resolve(g, pos->turn, idx, TB_DTM_WIN(g->level), g->fwin[pos->turn]);
+}
+
+
+/* Verify that every move of an unresolved position loses */
+static bool tbgen_verify_loss(struct tbgen *g, const int8_t *sq, const enum color s, const uint64_t idx)
+{
+	struct tbgen_move mv[TBGEN_MAX_MOVES];
+	struct tb_pos child = {.mat = &g->mat, .turn = !s};
+	uint8_t c = g->conv[s][idx];
+	int n;
+
+	if (c == TBGEN_CONV_DRAW || TB_DTM_IS_WIN(c) ||
+			(TB_DTM_IS_LOSS(c) && TB_DTM_MOVES(c) > g->level)) {
+		return false;
+	}
+
+	n = tbgen_gen_moves(&g->mat, sq, s, mv);
+	for (int m = 0; m < n; m++) {
+		if (mv[m].victim >= 0 || mv[m].promo != EMPTY) {
+			continue;
+		}
+		memcpy(child.sq, sq, sizeof(child.sq));
+		child.sq[mv[m].slot] = mv[m].to;
+		if (!TB_DTM_IS_WIN(g->val[!s][tb_index(&child)])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/* Predecessor of a won position is a loss candidate */
+static bool tbgen_loss_pred(struct tbgen *g, const struct tb_pos *pos)
+{
+	const enum color s = pos->turn;
+	uint64_t idx = tb_index(pos);
+	int8_t sq[TB_MAX_PIECES];
+
+	if (tbgen_test(g->broken[s], idx) || g->val[s][idx] != TB_DTM_DRAW) {
+		return false;
+	}
+
+	/* verify in canonical orientation, as stored in the table */
+	tb_decode(&g->mat, idx, sq);
+	return tbgen_verify_loss(g, sq, s, idx) &&
+		tbgen_resolve(g, s, idx, TB_DTM_LOSS(g->level), g->floss[s]);
+}
+
+
+static void tbgen_win_work(struct tbgen *g, uint64_t begin, uint64_t end)
+{
+	const enum color s = g->side;
+	const uint8_t win = TB_DTM_WIN(g->level);
+	int8_t sq[TB_MAX_PIECES];
+	uint64_t found = 0;
+
+	for (uint64_t w = begin >> 6; w < (end + 63) >> 6; w++) {
+		for (uint64_t bits = g->floss[!s][w]; bits; POP_LSB(bits)) {
+			tb_decode(&g->mat, (w << 6) + (uint64_t)LSB(bits), sq);
+			found += tbgen_unmoves(g, sq, s, tbgen_win_pred);
+		}
+	}
+
+	for (uint64_t idx = begin; idx < end; idx++) {
+		if (g->conv[s][idx] == win && !tbgen_test(g->broken[s], idx)) {
+			found += tbgen_resolve(g, s, idx, win, g->fwin[s]);
+		}
+	}
+
+	__atomic_fetch_add(&g->found, found, __ATOMIC_RELAXED);
+}
+
+
+static void tbgen_loss_work(struct tbgen *g, uint64_t begin, uint64_t end)
+{
+	const enum color s = g->side;
+	const uint8_t loss = TB_DTM_LOSS(g->level);
+	int8_t sq[TB_MAX_PIECES];
+	uint64_t found = 0;
+
+	for (uint64_t w = begin >> 6; w < (end + 63) >> 6; w++) {
+		for (uint64_t bits = g->fwin[!s][w]; bits; POP_LSB(bits)) {
+			tb_decode(&g->mat, (w << 6) + (uint64_t)LSB(bits), sq);
+			found += tbgen_unmoves(g, sq, s, tbgen_loss_pred);
+		}
+	}
+
+	for (uint64_t idx = begin; idx < end; idx++) {
+		if (g->conv[s][idx] == loss && g->val[s][idx] == TB_DTM_DRAW &&
+				!tbgen_test(g->broken[s], idx)) {
+			tb_decode(&g->mat, idx, sq);
+			if (tbgen_verify_loss(g, sq, s, idx)) {
+				found += tbgen_resolve(g, s, idx, loss, g->floss[s]);
+			}
+		}
+	}
+
+	__atomic_fetch_add(&g->found, found, __ATOMIC_RELAXED);
+}
+
+
+static void *tbgen_worker(void *arg)
+{
+	struct tbgen *g = arg;
+	uint64_t begin;
+
+	while ((begin = __atomic_fetch_add(&g->next, TBGEN_CHUNK, __ATOMIC_RELAXED)) < g->n) {
+		g->work(g, begin, begin + TBGEN_CHUNK < g->n ? begin + TBGEN_CHUNK : g->n);
+	}
+
+	return NULL;
+}
+
+
+/* Run one phase over all indices on every worker thread */
+static uint64_t tbgen_run(struct tbgen *g, void (*work)(struct tbgen *, uint64_t, uint64_t))
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_t tid[256];
+	int t, started = 0;
+#endif
+
+	g->work = work;
+	g->next = 0;
+	g->found = 0;
+
+#ifdef HAVE_PTHREAD_H
+
+	for (t = 1; t < g->threads && t < 256; t++) {
+		if (pthread_create(&tid[started], NULL, tbgen_worker, g) == 0) {
+			started++;
+		}
+	}
+	tbgen_worker(g);
+	for (t = 0; t < started; t++) {
+		pthread_join(tid[t], NULL);
+	}
+#else
+	tbgen_worker(g);
+#endif
+
+	return g->found;
+}
+
+
+/* Load a smaller table once and keep it for all conversions into it */
+static const uint8_t *tbgen_subtable(struct tbgen *g, const char *name)
+{
+	for (int i = 0; i < g->nsub; i++) {
+		if (!strcmp(g->subname[i], name)) {
+			return g->sub[i];
+		}
+	}
+
+	if (g->nsub == TBGEN_MAX_TABLES ||
+			!(g->sub[g->nsub] = tb_load_table(name, TB_KIND_DTM, NULL))) {
+		fprintf(stderr, "Unable to load tablebase %s\n", name);
+		return NULL;
+	}
+
+	strcpy(g->subname[g->nsub], name);
+	return g->sub[g->nsub++];
+}
+
+
+/* Build descriptor of the table reached by capturing slot victim and/or
+ * promoting the pawn on slot promo_slot to piece promo */
+static bool tbgen_add_conv(struct tbgen *g, const int victim, const int promo_slot,
+		const enum chessmen promo)
+{
+	enum chessmen type[TB_MAX_PIECES] = {KING};
+	enum color color[TB_MAX_PIECES] = {WHITE};
+	int8_t slot[TB_MAX_PIECES] = {0};
+	bool used[TB_MAX_PIECES] = {false};
+	struct tbgen_conv *cv;
+	int n = 0;
+
+	if (!(cv = calloc(1, sizeof(*cv)))) {
+		perror("calloc failed");
+		return false;
+	}
+	g->cv[victim + 1][promo_slot + 1][promo_slot < 0 ? KING : promo] = cv;
+
+	for (int i = 0; i < g->mat.count; i++) {
+		if (i != victim) {
+			type[n] = (i == promo_slot) ? promo : g->mat.type[i];
+			color[n] = g->mat.color[i];
+			slot[n++] = (int8_t)i;
+		}
+	}
+
+	if (!tb_material_from_pieces(type, color, n, &cv->mat, &cv->flipped)) {
+		return false;
+	}
+
+	for (int j = 0; j < n; j++) {
+		for (int k = 0; k < n; k++) {
+			enum color c = cv->flipped ? !color[k] : color[k];
+			if (!used[k] && type[k] == cv->mat.type[j] && c == cv->mat.color[j]) {
+				used[k] = true;
+				cv->map[slot[k]] = (int8_t)j;
+				break;
+			}
+		}
+	}
+
+	return (cv->dtm = tbgen_subtable(g, cv->mat.name)) != NULL;
+}
+
+
+/* Prepare descriptors of all captures and promotions */
+static bool tbgen_init_conv(struct tbgen *g)
+{
+	static const enum chessmen promos[] = {QUEEN, ROOK, BISHOP, KNIGHT};
+	const struct tb_material *mat = &g->mat;
+
+	for (int v = -1; v < mat->count; v++) {
+		if (v >= 0 && mat->type[v] == KING) {
+			continue;
+		}
+		if (v >= 0 && !tbgen_add_conv(g, v, -1, EMPTY)) {
+			return false;
+		}
+		for (int p = 0; p < mat->count; p++) {
+			if (mat->type[p] != PAWN || p == v ||
+					(v >= 0 && mat->color[v] == mat->color[p])) {
+				continue;
+			}
+			for (int t = 0; t < 4; t++) {
+				if (!tbgen_add_conv(g, v, p, promos[t])) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+
+static void tbgen_free(struct tbgen *g)
+{
+	for (int s = WHITE; s <= BLACK; s++) {
+		free(g->val[s]);
+		free(g->conv[s]);
+		free(g->broken[s]);
+		free(g->floss[s]);
+		free(g->fwin[s]);
+	}
+
+	for (int i = 0; i < TB_MAX_PIECES + 1; i++) {
+		for (int j = 0; j < TB_MAX_PIECES + 1; j++) {
+			for (int k = 0; k < EMPTY; k++) {
+				free(g->cv[i][j][k]);
+			}
+		}
+	}
+
+	for (int i = 0; i < g->nsub; i++) {
+		free(g->sub[i]);
+	}
+	free(g);
+}
+
+
+/* uncompressed entry byte of a position, don't care entries repeat the
+ * previous value to extend runs */
+static uint8_t tbgen_entry(const struct tbgen *g, const enum tb_kind kind,
+		const uint64_t pos, uint8_t *prev)
+{
+	const int s = pos >= g->n;
+	const uint64_t idx = pos - (s ? g->n : 0);
+	uint8_t v;
+
+	if (tbgen_test(g->broken[s], idx)) {
+		return *prev;
+	}
+
+	v = g->val[s][idx];
+	if (kind == TB_KIND_WDL) {
+		v = TB_DTM_IS_WIN(v) ? TB_WIN : TB_DTM_IS_LOSS(v) ? TB_LOSS : TB_DRAW;
+	}
+	return *prev = v;
+}
+
+
+/* Compress the table into a block indexed file */
+static bool tbgen_write(const struct tbgen *g, const char *dir, const enum tb_kind kind, const int max_dtm)
+{
+	char file[4096], tmp[4096 + 8];
+	struct tb_header hdr;
+	uint8_t raw[TB_BLOCK_SIZE], packed[TB_BLOCK_SIZE + TB_BLOCK_SIZE / 128 + 16];
+	uint64_t bytes, *offset, pos = 0, total = 2 * g->n;
+	uint8_t prev = 0;
+	size_t len;
+	FILE *fp;
+
+	bytes = kind == TB_KIND_WDL ? (total + 3) / 4 : total;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = TB_MAGIC;
+	hdr.version = TB_VERSION;
+	hdr.kind = kind;
+	hdr.block_size = TB_BLOCK_SIZE;
+	hdr.entries = g->n;
+	hdr.blocks = (bytes + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE;
+	hdr.max_dtm = (uint8_t)max_dtm;
+	strcpy(hdr.name, g->mat.name);
+
+	if (!(offset = calloc(hdr.blocks + 1, sizeof(uint64_t)))) {
+		perror("calloc failed");
+		return false;
+	}
+
+	snprintf(file, sizeof(file), "%s/%s%s", dir, g->mat.name,
+			kind == TB_KIND_WDL ? TB_WDL_EXT : TB_DTM_EXT);
+	snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+	if (!(fp = fopen(tmp, "wb"))) {
+		perror(tmp);
+		free(offset);
+		return false;
+	}
+
+	/* header and offsets are rewritten once all blocks are known */
+	fwrite(&hdr, sizeof(hdr), 1, fp);
+	fwrite(offset, sizeof(uint64_t), hdr.blocks + 1, fp);
+	offset[0] = sizeof(hdr) + (hdr.blocks + 1) * sizeof(uint64_t);
+
+	for (uint64_t b = 0; b < hdr.blocks; b++) {
+		len = (size_t)(bytes - b * TB_BLOCK_SIZE < TB_BLOCK_SIZE ?
+				bytes - b * TB_BLOCK_SIZE : TB_BLOCK_SIZE);
+
+		for (size_t i = 0; i < len; i++) {
+			if (kind == TB_KIND_DTM) {
+				raw[i] = tbgen_entry(g, kind, pos++, &prev);
+				continue;
+			}
+			raw[i] = 0;
+			for (int k = 0; k < 4 && pos < total; k++) {
+				raw[i] |= (uint8_t)(tbgen_entry(g, kind, pos++, &prev) << (2 * k));
+			}
+		}
+
+		len = tb_packbits_encode(raw, len, packed);
+		fwrite(packed, 1, len, fp);
+		offset[b + 1] = offset[b] + len;
+	}
+
+	fseek(fp, (long)sizeof(hdr), SEEK_SET);
+	fwrite(offset, sizeof(uint64_t), hdr.blocks + 1, fp);
+
+	if (ferror(fp) | fclose(fp) || rename(tmp, file)) {
+		perror(file);
+		free(offset);
+		return false;
+	}
+
+	printf("  %-24s %12llu bytes (%.1f%% of %llu)\n", file,
+			(unsigned long long)offset[hdr.blocks],
+			100.0 * (double)offset[hdr.blocks] / (double)bytes,
+			(unsigned long long)bytes);
+	free(offset);
+	return true;
+}
+
+
+/* Generate WDL and DTM files of one material configuration */
+static bool tbgen_generate(const struct tb_material *mat, const int threads, const char *dir)
+{
+	uint64_t words, found, wdl[2][3] = {{0}};
+	struct tbgen *g;
+	time_t start = time(NULL);
+	int max_dtm = 0;
+	bool ok = false;
+
+	if (!(g = calloc(1, sizeof(*g)))) {
+		perror("calloc failed");
+		return false;
+	}
+	g->mat = *mat;
+	g->n = mat->entries;
+	g->threads = threads;
+	words = (g->n + 63) / 64;
+
+	printf("Generating %s: %llu positions per side, %.1f MiB, %d threads\n",
+			mat->name, (unsigned long long)g->n,
+			(double)(2 * g->n * 2 + 10 * words * 8) / (1024.0 * 1024.0), threads);
+
+	for (int s = WHITE; s <= BLACK; s++) {
+		g->val[s] = calloc(g->n, 1);
+		g->conv[s] = calloc(g->n, 1);
+		g->broken[s] = calloc(words, sizeof(uint64_t));
+		g->floss[s] = calloc(words, sizeof(uint64_t));
+		g->fwin[s] = calloc(words, sizeof(uint64_t));
+		if (!g->val[s] || !g->conv[s] || !g->broken[s] || !g->floss[s] || !g->fwin[s]) {
+			perror("calloc failed");
+			goto out;
+		}
+	}
+
+	if (!tbgen_init_conv(g)) {
+		goto out;
+	}
+
+	tbgen_run(g, tbgen_init_work);
+
+	for (g->level = 1; g->level <= TB_DTM_MAX; g->level++) {
+		found = 0;
+		for (int s = WHITE; s <= BLACK; s++) {
+			g->side = (enum color)s;
+			found += tbgen_run(g, tbgen_win_work);
+		}
+		for (int s = WHITE; s <= BLACK; s++) {
+			memset(g->floss[s], 0, words * sizeof(uint64_t));
+		}
+
+		for (int s = WHITE; s <= BLACK; s++) {
+			g->side = (enum color)s;
+			found += tbgen_run(g, tbgen_loss_work);
+		}
+		for (int s = WHITE; s <= BLACK; s++) {
+			memset(g->fwin[s], 0, words * sizeof(uint64_t));
+		}
+
+		if (found) {
+			max_dtm = g->level;
+		} else if (g->level > g->max_conv) {
+			break;
+		}
+		dbg_print("%s: level %d resolved %llu positions\n", mat->name,
+				g->level, (unsigned long long)found);
+	}
+
+	if (g->level > TB_DTM_MAX || g->overflow) {
+		fprintf(stderr, "Warning: %s has mates longer than %d moves\n",
+				mat->name, TB_DTM_MAX);
+	}
+
+	for (int s = WHITE; s <= BLACK; s++) {
+		for (uint64_t idx = 0; idx < g->n; idx++) {
+			uint8_t v = g->val[s][idx];
+			if (!tbgen_test(g->broken[s], idx)) {
+				wdl[s][TB_DTM_IS_WIN(v) ? TB_WIN : TB_DTM_IS_LOSS(v) ? TB_LOSS : TB_DRAW]++;
+			}
+		}
+		printf("  %s to move: %llu wins, %llu draws, %llu losses\n",
+				s == WHITE ? "White" : "Black",
+				(unsigned long long)wdl[s][TB_WIN],
+				(unsigned long long)wdl[s][TB_DRAW],
+				(unsigned long long)wdl[s][TB_LOSS]);
+	}
+	printf("  longest mate: %d moves, generated in %.0f s\n", max_dtm,
+			difftime(time(NULL), start));
+
+	ok = tbgen_write(g, dir, TB_KIND_WDL, max_dtm) &&
+		tbgen_write(g, dir, TB_KIND_DTM, max_dtm);
+out:
+	tbgen_free(g);
+	return ok;
+}
+
+
+/* Add material and all tables reachable by captures and promotions */
+static int tbgen_add_deps(const struct tb_material *mat, struct tb_material *list, int n)
+{
+	static const enum chessmen promos[] = {QUEEN, ROOK, BISHOP, KNIGHT};
+	enum chessmen type[TB_MAX_PIECES];
+	enum color color[TB_MAX_PIECES];
+	struct tb_material child;
+
+	for (int i = 0; i < n; i++) {
+		if (!strcmp(list[i].name, mat->name)) {
+			return n;
+		}
+	}
+	if (n == TBGEN_MAX_TABLES) {
+		return n;
+	}
+	list[n++] = *mat;
+
+	for (int i = 2; i < mat->count; i++) {
+		/* capture of piece i, the last piece takes its slot */
+		memcpy(type, mat->type, sizeof(type));
+		memcpy(color, mat->color, sizeof(color));
+		type[i] = mat->type[mat->count - 1];
+		color[i] = mat->color[mat->count - 1];
+		if (tb_material_from_pieces(type, color, mat->count - 1, &child, NULL)) {
+			n = tbgen_add_deps(&child, list, n);
+		}
+
+		/* promotion of pawn i */
+		if (mat->type[i] == PAWN) {
+			for (int t = 0; t < 4; t++) {
+				memcpy(type, mat->type, sizeof(type));
+				type[i] = promos[t];
+				if (tb_material_from_pieces(type, mat->color, mat->count, &child, NULL)) {
+					n = tbgen_add_deps(&child, list, n);
+				}
+			}
+		}
+	}
+
+	return n;
+}
+
+
+/* smaller tables first, and tables with fewer pawns before those with
+ * more, so that every table is generated after its conversions */
+static int tbgen_cmp(const void *a, const void *b)
+{
+	const struct tb_material *x = a, *y = b;
+
+	if (x->count != y->count) {
+		return x->count - y->count;
+	}
+	if (x->pawns != y->pawns) {
+		return x->pawns - y->pawns;
+	}
+	return strcmp(x->name, y->name);
+}
+
+
+static bool tbgen_exists(const char *dir, const char *name)
+{
+	char file[4096];
+
+	for (int k = TB_KIND_WDL; k <= TB_KIND_DTM; k++) {
+		snprintf(file, sizeof(file), "%s/%s%s", dir, name,
+				k == TB_KIND_WDL ? TB_WDL_EXT : TB_DTM_EXT);
+		if (access(file, R_OK)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+static void tbgen_usage(const char *prog)
+{
+	printf("Usage: %s [-j threads] [-d dir] [-f] TABLE|PIECES ...\n\n", prog);
+	printf("Generate endgame tablebases and all tables they depend on.\n");
+	printf("TABLE is a material like KQvK or KRPvKR, PIECES (2-%d) selects\n", TB_MAX_PIECES);
+	printf("all tables with so many pieces.\n\n");
+	printf("  -j threads	number of worker threads (default: all cores)\n");
+	printf("  -d dir	output directory (default: current directory)\n");
+	printf("  -f		regenerate tables which already exist\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct tb_material mat, *list;
+	const char *dir = ".";
+	bool force = false;
+	int opt, n = 0, threads = 1;
+
+#if defined HAVE_SYSCONF && defined _SC_NPROCESSORS_ONLN
+	threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	while ((opt = getopt(argc, argv, "j:d:fh")) != -1) {
+		switch (opt) {
+			case 'j': threads = atoi(optarg); break;
+			case 'd': dir = optarg; break;
+			case 'f': force = true; break;
+			case 'h': tbgen_usage(argv[0]); return EXIT_SUCCESS;
+			default:  tbgen_usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+
+	if (optind == argc || threads < 1) {
+		tbgen_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!(list = calloc(TBGEN_MAX_TABLES, sizeof(*list)))) {
+		perror("calloc failed");
+		return EXIT_FAILURE;
+	}
+
+	for (; optind < argc; optind++) {
+		const char *arg = argv[optind];
+		struct tb_material all[TBGEN_MAX_TABLES];
+
+		if (arg[0] >= '2' && arg[0] <= '0' + TB_MAX_PIECES && !arg[1]) {
+			int cnt = tb_materials(arg[0] - '0', all, TBGEN_MAX_TABLES);
+			for (int i = 0; i < cnt; i++) {
+				n = tbgen_add_deps(&all[i], list, n);
+			}
+		} else if (tb_parse_material(arg, &mat)) {
+			n = tbgen_add_deps(&mat, list, n);
+		} else {
+			fprintf(stderr, "Invalid table: %s\n", arg);
+			free(list);
+			return EXIT_FAILURE;
+		}
+	}
+
+	qsort(list, (size_t)n, sizeof(*list), tbgen_cmp);
+
+	init_leaper_attacks();
+	init_magic_numbers();
+	init_slider_attacks();
+	tb_init(dir);
+
+	for (int i = 0; i < n; i++) {
+		if (!force && tbgen_exists(dir, list[i].name)) {
+			printf("Skipping %s, already generated\n", list[i].name);
+			continue;
+		}
+		if (!tbgen_generate(&list[i], threads, dir)) {
+			fprintf(stderr, "Failed to generate %s\n", list[i].name);
+			free(list);
+			return EXIT_FAILURE;
+		}
+	}
+
+	free(list);
+	return EXIT_SUCCESS;
+}
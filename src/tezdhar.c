@@ -0,0 +1,279 @@
+/* @file:	tezdhar/src/tezdhar.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/tezdhar.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	C API of libtezdhar, see tezdhar.h.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "search.h"
+#include "tables.h"
+#include "tezdhar.h"
+#include "tt.h"
+
+#include <stdio.h>	// for snprintf, perror
+#include <stdlib.h>	// for calloc, free, getenv
+#include <string.h>	// for memcpy, strcpy, strlen, strspn, strcspn
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_once
+#endif
+
+#define TEZDHAR_PV_LEN	(MAX_PLY * MAX_UCI_LEN)
+
+/* What the handle is doing, for tezdhar_stop() */
+enum tezdhar_state {
+	TEZDHAR_IDLE,
+	TEZDHAR_SEARCHING,		// in tezdhar_search()
+	TEZDHAR_STOPPING		// and tezdhar_stop() was called
+};
+
+struct tezdhar_engine {
+	struct board brd;		// position to search
+	struct search s;
+	struct tt tt;
+	tezdhar_info_fn fn;		// callback of the running search
+	void *arg;
+	int state;			// enum tezdhar_state, atomic
+	char pv[TEZDHAR_PV_LEN];
+};
+
+
+/* Build the attack tables and hash keys of the process. The attack tables
+ * are shared with other processes if TEZDHAR_TABLES names a shared memory
+ * object, see tables.h */
+static void tezdhar_init_tables(void)
+{
+	tables_init(getenv("TEZDHAR_TABLES"));
+	init_zobrist_keys();
+}
+
+
+/* The tables are built by the first handle, once even if handles are
+ * created on several threads at once */
+static void tezdhar_init_once(void)
+{
+#ifdef HAVE_PTHREAD_H
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	pthread_once(&once, tezdhar_init_tables);
+#else
+	static bool done;
+
+	if (!done) {
+		tezdhar_init_tables();
+		done = true;
+	}
+#endif
+}
+
+
+const char *tezdhar_version(void)
+{
+	return VERSION;
+}
+
+
+/* Create a handle with a transposition table of hash_mb megabytes, 0 for
+ * none, set to the initial position. Returns NULL if out of memory */
+struct tezdhar_engine *tezdhar_create(const size_t hash_mb)
+{
+	struct tezdhar_engine *e;
+
+	tezdhar_init_once();
+	if (!(e = calloc(1, sizeof(*e)))) {
+		perror("calloc failed");
+		return NULL;
+	}
+	if ((hash_mb && !tt_init(&e->tt, hash_mb * 1024)) || !tezdhar_set_position(e, NULL, NULL)) {
+		tezdhar_destroy(e);
+		return NULL;
+	}
+	return e;
+}
+
+
+void tezdhar_destroy(struct tezdhar_engine *e)
+{
+	if (e) {
+		tt_free(&e->tt);
+		free(e);
+	}
+}
+
+
+/* Forget the results of earlier searches */
+void tezdhar_new_game(struct tezdhar_engine *e)
+{
+	if (e->tt.table) {
+		tt_clear(&e->tt);
+	}
+}
+
+
+/* Set the position from a FEN, NULL for the initial position, and a list
+ * of moves made from it separated by spaces, NULL for none. The position
+ * is left unchanged if either is not valid */
+bool tezdhar_set_position(struct tezdhar_engine *e, const char *fen, const char *moves)
+{
+	char buf[MAX_FEN_LEN], uci[MAX_UCI_LEN];
+	struct board brd;
+	struct move mv;
+	struct undo u;
+	size_t n;
+	move_t m;
+
+	if (fen && strlen(fen) >= MAX_FEN_LEN) {
+		return false;
+	}
+	strcpy(buf, fen ? fen : INITIAL_FEN);
+	if (!init_board(buf, &brd, AI, AI)) {
+		return false;
+	}
+
+	while (moves && *(moves += strspn(moves, " ")) != '\0') {
+		n = strcspn(moves, " ");
+		if (n >= sizeof(uci)) {
+			return false;
+		}
+		memcpy(uci, moves, n);
+		uci[n] = '\0';
+		moves += n;
+
+		mv = parse_input_move(uci);
+		if (mv.invalid || (m = resolve_move(&brd, &mv)) == MOVE_NONE || !make_move(&brd, m, &u)) {
+			return false;
+		}
+	}
+
+	e->brd = brd;
+	return true;
+}
+
+
+/* Hand the lines of a completed iteration to the callback of the search */
+static void tezdhar_report(const struct search *s, const int depth)
+{
+	struct tezdhar_engine *e = s->report_arg;
+	struct tezdhar_info info;
+	char uci[MAX_UCI_LEN];
+	size_t n;
+
+	if (!e->fn) {
+		return;
+	}
+
+	info.depth = depth;
+	info.seldepth = s->stats.seldepth;
+	info.nodes = s->stats.nodes;
+	info.time = search_elapsed(s);
+	info.pv = e->pv;
+
+	for (int i = 0; i < s->nlines; i++) {
+		const struct search_line *l = &s->lines[i];
+
+		info.line = i + 1;
+		info.score = l->score;
+		if (l->score > SCORE_MATE - MAX_PLY) {
+			info.mate = (SCORE_MATE - l->score + 1) / 2;
+		} else if (l->score < -SCORE_MATE + MAX_PLY) {
+			info.mate = -(SCORE_MATE + l->score) / 2;
+		} else {
+			info.mate = 0;
+		}
+
+		n = 0;
+		e->pv[0] = '\0';
+		for (int j = 0; j < l->pv_len && n + MAX_UCI_LEN + 1 < sizeof(e->pv); j++) {
+			move_to_uci(l->pv[j], uci);
+			n += (size_t)snprintf(e->pv + n, sizeof(e->pv) - n, "%s%s", j ? " " : "", uci);
+		}
+		e->fn(&info, e->arg);
+	}
+}
+
+
+/* Search the position within the limits, calling fn, if not NULL, after
+ * every iteration. The best move is written to best, or "(none)" if the
+ * side to move has no legal move, in which case false is returned */
+bool tezdhar_search(struct tezdhar_engine *e, const struct tezdhar_limits *limits, tezdhar_info_fn fn,
+		void *arg, char *best, const size_t len)
+{
+	struct search_limits sl = {0, 0, 0, 0, 0};
+	char uci[MAX_UCI_LEN] = "(none)";
+	move_t m;
+
+	if (limits) {
+		sl.depth = limits->depth;
+		sl.movetime = limits->movetime;
+		sl.nodes = limits->nodes;
+		sl.multipv = limits->multipv;
+	}
+
+	__atomic_store_n(&e->state, TEZDHAR_SEARCHING, __ATOMIC_SEQ_CST);
+	search_init(&e->s, &e->brd, &sl);
+	e->s.tt = e->tt.table ? &e->tt : NULL;
+	e->s.report = tezdhar_report;		// never print
+	e->s.report_arg = e;
+	e->fn = fn;
+	e->arg = arg;
+
+	/* a stop which came before search_init() was cleared by it */
+	if (__atomic_load_n(&e->state, __ATOMIC_SEQ_CST) == TEZDHAR_STOPPING) {
+		search_stop(&e->s);
+	}
+	m = search_position(&e->s);
+	__atomic_store_n(&e->state, TEZDHAR_IDLE, __ATOMIC_SEQ_CST);
+	if (m != MOVE_NONE) {
+		move_to_uci(m, uci);
+	}
+	if (best && len) {
+		snprintf(best, len, "%s", uci);
+	}
+	return m != MOVE_NONE;
+}
+
+
+/* End the running search of the handle as soon as possible, from any
+ * thread. The stop is recorded on the handle, so that a search which has
+ * not reached search_init() yet stops too, but one which is not running
+ * is not stopped once it starts */
+void tezdhar_stop(struct tezdhar_engine *e)
+{
+	int searching = TEZDHAR_SEARCHING;
+
+	__atomic_compare_exchange_n(&e->state, &searching, TEZDHAR_STOPPING, false,
+			__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	search_stop(&e->s);
+}
+
+
+/* Quiescence scores of n positions given as FENs, TEZDHAR_NO_SCORE for
+ * those which are not valid. Returns the number of valid positions */
+size_t tezdhar_evaluate(struct tezdhar_engine *e, const char *const *fens, const size_t n, int *scores)
+{
+	const struct search_limits sl = {0, 0, 0, 0, 0};
+	char buf[MAX_FEN_LEN];
+	struct board brd;
+	size_t valid = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		scores[i] = TEZDHAR_NO_SCORE;
+		if (!fens[i] || strlen(fens[i]) >= MAX_FEN_LEN) {
+			continue;
+		}
+		strcpy(buf, fens[i]);
+		if (!init_board(buf, &brd, AI, AI)) {
+			continue;
+		}
+		search_init(&e->s, &brd, &sl);
+		scores[i] = search_quiesce(&e->s);
+		valid++;
+	}
+	return valid;
+}
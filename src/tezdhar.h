@@ -0,0 +1,98 @@
+/* @file:	tezdhar/src/tezdhar.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/tezdhar.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	C API of libtezdhar, for running the engine inside another
+ * 		program.
+ *
+ *
+ *			--------------
+ *			Engine Handles
+ *			--------------
+ *
+ * An engine handle holds all the mutable state of the engine: the
+ * position, the search and its transposition table. The attack tables and
+ * hash keys are built once per process by the first tezdhar_create() and
+ * only read afterwards, so they are shared by all handles.
+ *
+ * A handle is used by one thread at a time, and any number of handles may
+ * search at once on different threads. tezdhar_stop() is the exception: it
+ * may be called from any thread to end a running search of the handle.
+ *
+ *	struct tezdhar_engine *e = tezdhar_create(64);
+ *	char best[8];
+ *
+ *	tezdhar_set_position(e, NULL, "e2e4 e7e5");
+ *	tezdhar_search(e, &(struct tezdhar_limits){.depth = 8}, NULL, NULL, best, sizeof(best));
+ *	tezdhar_destroy(e);
+ *
+ * Moves are in UCI notation, scores in centipawns from the point of view
+ * of the side to move.
+ */
+
+#ifndef __TEZDHAR_H__
+#define __TEZDHAR_H__	1
+
+#include <stdbool.h>	// for bool
+#include <stddef.h>	// for size_t
+#include <stdint.h>	// for uint64_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined __GNUC__
+#  define TEZDHAR_API	__attribute__((visibility("default")))
+#else
+#  define TEZDHAR_API
+#endif
+
+#define TEZDHAR_API_VERSION	1
+#define TEZDHAR_NO_SCORE	(-32768)	// score of a position which is not valid
+
+struct tezdhar_engine;
+
+/* Limits of a search, zero for none. Without any the search runs until
+ * tezdhar_stop() */
+struct tezdhar_limits {
+	int depth;			// plies
+	long movetime;			// milliseconds
+	uint64_t nodes;
+	int multipv;			// best moves scored exactly and reported
+};
+
+/* A line of a completed iteration */
+struct tezdhar_info {
+	int depth;
+	int seldepth;
+	int line;			// 1 for the best move, up to multipv
+	int score;			// centipawns
+	int mate;			// moves to mate, negative if mated, 0 if none
+	uint64_t nodes;
+	long time;			// milliseconds
+	const char *pv;			// moves separated by spaces
+};
+
+/* Called on the searching thread for every line of every completed
+ * iteration */
+typedef void (*tezdhar_info_fn)(const struct tezdhar_info *info, void *arg);
+
+
+/* Function prototypes */
+TEZDHAR_API const char *tezdhar_version(void);
+TEZDHAR_API struct tezdhar_engine *tezdhar_create(size_t hash_mb);
+TEZDHAR_API void tezdhar_destroy(struct tezdhar_engine *e);
+TEZDHAR_API void tezdhar_new_game(struct tezdhar_engine *e);
+TEZDHAR_API bool tezdhar_set_position(struct tezdhar_engine *e, const char *fen, const char *moves);
+TEZDHAR_API bool tezdhar_search(struct tezdhar_engine *e, const struct tezdhar_limits *limits,
+		tezdhar_info_fn fn, void *arg, char *best, size_t len);
+TEZDHAR_API void tezdhar_stop(struct tezdhar_engine *e);
+TEZDHAR_API size_t tezdhar_evaluate(struct tezdhar_engine *e, const char *const *fens, size_t n, int *scores);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __TEZDHAR_H__ */
@@ -0,0 +1,448 @@
+/* @file:	tezdhar/src/train.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/train.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Pack training positions into 32 bytes and stream them to and
+ * 		from block files. Positions are decoded straight into the
+ * 		bitboards of struct board, without going through FEN.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "bitboard.h"
+#include "train.h"
+
+#include <stdio.h>	// for perror, fprintf
+#include <stdlib.h>	// for abs, malloc, free
+#include <string.h>	// for memcmp, memcpy, memset
+
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>	// for open
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for close, read, write
+#endif
+
+static const uint8_t train_magic[4] = {'T', 'Z', 'T', 'P'};
+
+
+static uint64_t read_le(const uint8_t *p, const size_t bytes)
+{
+	uint64_t v = 0;
+
+	for (size_t i = bytes; i-- > 0; ) {
+		v = (v << 8) | p[i];
+	}
+
+	return v;
+}
+
+
+static void write_le(uint8_t *p, uint64_t v, const int bytes)
+{
+	for (int i = 0; i < bytes; i++) {
+		p[i] = (uint8_t)(v & 0xff);
+		v >>= 8;
+	}
+}
+
+
+/* Pack a position into TRAIN_POS_SIZE bytes. Fails if it has more than
+ * 32 pieces, which no legal position has */
+bool train_pack(const struct train_pos *p, uint8_t *rec)
+{
+	const struct board *brd = &p->brd;
+	uint64_t occ = get_all_pieces(&brd->bb);
+	unsigned flags = 0;
+	int n = 0;
+
+	if (BITS(occ) > 32) {
+		return false;
+	}
+
+	memset(rec, 0, TRAIN_POS_SIZE);
+	write_le(rec, occ, 8);
+	for (; occ; POP_LSB(occ)) {
+		const int sq = LSB(occ);
+
+		rec[8 + n / 2] |= (uint8_t)(brd->sqr[sq >> 3][sq & 7] << (4 * (n & 1)));
+		n++;
+	}
+
+	for (int i = 0; i < 4; i++) {
+		flags |= brd->castling[i] ? 1U << i : 0;
+	}
+	if (brd->enpassant >= 0) {
+		flags |= (unsigned)((brd->enpassant & 7) + 1) << 4;
+	}
+	rec[24] = (uint8_t)flags;
+	rec[25] = (uint8_t)((brd->halfMoves < 127 ? brd->halfMoves : 127) | (brd->turn == BLACK ? 0x80 : 0));
+	write_le(rec + 26, (brd->fullMoves < 0x3fff ? brd->fullMoves : 0x3fff) |
+			((unsigned)(p->result + 1) << 14), 2);
+	write_le(rec + 28, (uint16_t)p->score, 2);
+	write_le(rec + 30, train_encode_move(p->best), 2);
+
+	return true;
+}
+
+
+/* Unpack a position, setting up the squares and bitboards directly */
+void train_unpack(const uint8_t *rec, struct train_pos *p)
+{
+	struct board *brd = &p->brd;
+	uint64_t occ = read_le(rec, 8);
+	const unsigned counts = (unsigned)read_le(rec + 26, 2);
+	int n = 0;
+
+	memset(brd, 0, sizeof(*brd));
+	for (; occ; POP_LSB(occ)) {
+		const int sq = LSB(occ);
+		const enum pieces pc = (enum pieces)((rec[8 + n / 2] >> (4 * (n & 1))) & 0xf);
+		uint64_t *bb = piece_bitboard(&brd->bb, pc);
+
+		brd->sqr[sq >> 3][sq & 7] = pc;
+		if (bb) {
+			SET_BIT(*bb, sq);
+		}
+		n++;
+	}
+
+	for (int i = 0; i < 4; i++) {
+		brd->castling[i] = (rec[24] >> i) & 1;
+	}
+	brd->turn = rec[25] & 0x80 ? BLACK : WHITE;
+	brd->status = brd->turn == WHITE ? WHITE_TURN : BLACK_TURN;
+	brd->whitePlayer = brd->blackPlayer = AI;
+	brd->enpassant = -1;
+	if (rec[24] >> 4) {
+		brd->enpassant = (int8_t)(((rec[24] >> 4) - 1) + (brd->turn == WHITE ? 40 : 16));
+	}
+	brd->halfMoves = rec[25] & 0x7f;
+	brd->fullMoves = (uint16_t)(counts & 0x3fff);
+	brd->key = zobrist_key(brd);
+
+	p->result = (int8_t)((int)(counts >> 14) - 1);
+	p->score = (int16_t)read_le(rec + 28, 2);
+	p->best = train_decode_move(brd, (uint16_t)read_le(rec + 30, 2));
+}
+
+
+uint16_t train_encode_move(const move_t m)
+{
+	const unsigned promo = MOVE_PROMOTED(m) ? piece_type(MOVE_PROMOTED(m)) : 0;
+
+	if (m == MOVE_NONE) {
+		return 0;
+	}
+
+	return (uint16_t)(MOVE_FROM(m) | (MOVE_TO(m) << 6) | (promo << 12));
+}
+
+
+/* Rebuild a move from its squares and the pieces on board. The move is not
+ * checked for legality, MOVE_NONE if there is no piece to move */
+move_t train_decode_move(const struct board *brd, const uint16_t m)
+{
+	const int from = m & 63, to = (m >> 6) & 63;
+	const enum chessmen promo = (enum chessmen)((m >> 12) & 7);
+	const enum pieces pc = brd->sqr[from >> 3][from & 7];
+	enum pieces cap = brd->sqr[to >> 3][to & 7];
+	U32 flags = 0;
+
+	if (!m || pc == EMPTY_SQR) {
+		return MOVE_NONE;
+	}
+
+	if (piece_type(pc) == PAWN) {
+		if (to == brd->enpassant && cap == EMPTY_SQR && (from & 7) != (to & 7)) {
+			cap = make_piece(PAWN, !piece_color(pc));
+			flags = MOVE_EP;
+		} else if (abs(to - from) == 16) {
+			flags = MOVE_DOUBLE_PUSH;
+		}
+	} else if (piece_type(pc) == KING && abs(to - from) == 2) {
+		flags = MOVE_CASTLING;
+	}
+
+	return encode_move(from, to, pc, cap,
+			promo >= QUEEN && promo <= ROOK ? make_piece(promo, piece_color(pc)) : EMPTY_SQR,
+			flags);
+}
+
+
+static bool train_write_all(const int fd, const uint8_t *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len) {
+		if ((n = write(fd, buf, len)) <= 0) {
+			perror("write failed");
+			return false;
+		}
+		buf += n;
+		len -= (size_t)n;
+	}
+
+	return true;
+}
+
+
+static bool train_read_all(const int fd, uint8_t *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len) {
+		if ((n = read(fd, buf, len)) <= 0) {
+			return false;
+		}
+		buf += n;
+		len -= (size_t)n;
+	}
+
+	return true;
+}
+
+
+/* Create a training file, flags is 0 or TRAIN_CHAIN */
+bool train_create(struct train_writer *w, const char *path, const unsigned flags)
+{
+	uint8_t header[TRAIN_HEADER_SIZE] = {0};
+
+	memset(w, 0, sizeof(*w));
+	w->flags = flags;
+	if ((w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+		perror(path);
+		return false;
+	}
+	if (!(w->buf = malloc(TRAIN_BLOCK_HEADER + TRAIN_BLOCK))) {
+		perror("malloc failed");
+		close(w->fd);
+		return false;
+	}
+
+	memcpy(header, train_magic, sizeof(train_magic));
+	write_le(header + 4, TRAIN_VERSION, 2);
+	write_le(header + 6, flags, 2);
+	w->ok = train_write_all(w->fd, header, sizeof(header));
+	return w->ok;
+}
+
+
+/* Write out the block being filled */
+static bool train_flush(struct train_writer *w)
+{
+	if (w->count && w->ok) {
+		write_le(w->buf, w->len, 4);
+		write_le(w->buf + 4, w->count, 4);
+		w->ok = train_write_all(w->fd, w->buf, TRAIN_BLOCK_HEADER + w->len);
+	}
+
+	w->len = 0;
+	w->count = 0;
+	w->chain = 0;
+	return w->ok;
+}
+
+
+/* Append a position. 'played' is the move leading to it from the position
+ * written before, or MOVE_NONE at the start of a game. It is only used to
+ * chain the positions of a game in TRAIN_CHAIN files */
+bool train_write(struct train_writer *w, const struct train_pos *p, const move_t played)
+{
+	const size_t full = TRAIN_POS_SIZE + (w->flags & TRAIN_CHAIN ? 2 : 0);
+	bool link = (w->flags & TRAIN_CHAIN) && w->chain && played != MOVE_NONE &&
+		p->result == w->result;
+	uint8_t *rec;
+	uint64_t links;
+
+	/* a chain does not reach into the next block */
+	if (w->len + (link ? TRAIN_LINK_SIZE : full) > TRAIN_BLOCK) {
+		if (!train_flush(w)) {
+			return false;
+		}
+		link = false;
+	}
+	rec = w->buf + TRAIN_BLOCK_HEADER + w->len;
+
+	if (link) {
+		write_le(rec, train_encode_move(played), 2);
+		write_le(rec + 2, train_encode_move(p->best), 2);
+		write_le(rec + 4, (uint16_t)p->score, 2);
+		w->len += TRAIN_LINK_SIZE;
+
+		links = read_le(w->buf + w->chain, 2) + 1;
+		write_le(w->buf + w->chain, links, 2);
+		if (links == 0xffff) {
+			w->chain = 0;
+		}
+	} else {
+		if (!train_pack(p, rec)) {
+			fprintf(stderr, "Position with more than 32 pieces not written\n");
+			w->chain = 0;
+			return true;
+		}
+		if (w->flags & TRAIN_CHAIN) {
+			write_le(rec + TRAIN_POS_SIZE, 0, 2);
+			w->chain = TRAIN_BLOCK_HEADER + w->len + TRAIN_POS_SIZE;
+			w->result = p->result;
+		}
+		w->len += full;
+	}
+
+	w->count++;
+	w->positions++;
+	return w->ok;
+}
+
+
+/* Append a position already packed by train_pack, e.g. one copied from
+ * another file. It never joins a chain */
+bool train_write_packed(struct train_writer *w, const uint8_t *rec)
+{
+	const size_t full = TRAIN_POS_SIZE + (w->flags & TRAIN_CHAIN ? 2 : 0);
+	uint8_t *dst;
+
+	if (w->len + full > TRAIN_BLOCK && !train_flush(w)) {
+		return false;
+	}
+	dst = w->buf + TRAIN_BLOCK_HEADER + w->len;
+
+	memcpy(dst, rec, TRAIN_POS_SIZE);
+	if (w->flags & TRAIN_CHAIN) {
+		write_le(dst + TRAIN_POS_SIZE, 0, 2);
+	}
+	w->chain = 0;
+	w->len += full;
+	w->count++;
+	w->positions++;
+	return w->ok;
+}
+
+
+/* Write the last block and close the file */
+bool train_finish(struct train_writer *w)
+{
+	bool ok = train_flush(w);
+
+	if (close(w->fd)) {
+		perror("close failed");
+		ok = false;
+	}
+	free(w->buf);
+	w->buf = NULL;
+	return ok;
+}
+
+
+bool train_open(struct train_reader *r, const char *path)
+{
+	uint8_t header[TRAIN_HEADER_SIZE];
+
+	memset(r, 0, sizeof(*r));
+	if ((r->fd = open(path, O_RDONLY)) < 0) {
+		perror(path);
+		return false;
+	}
+
+	if (!train_read_all(r->fd, header, sizeof(header)) ||
+			memcmp(header, train_magic, sizeof(train_magic)) ||
+			read_le(header + 4, 2) != TRAIN_VERSION) {
+		fprintf(stderr, "Not a training data file: %s\n", path);
+		close(r->fd);
+		return false;
+	}
+	if (!(r->buf = malloc(TRAIN_BLOCK))) {
+		perror("malloc failed");
+		close(r->fd);
+		return false;
+	}
+
+	r->flags = (unsigned)read_le(header + 6, 2);
+	r->ok = true;
+	return true;
+}
+
+
+/* Read the next block, false at the end of the file */
+static bool train_next_block(struct train_reader *r)
+{
+	uint8_t header[TRAIN_BLOCK_HEADER];
+
+	if (!train_read_all(r->fd, header, sizeof(header))) {
+		return false;
+	}
+
+	r->len = (size_t)read_le(header, 4);
+	r->pos = 0;
+	r->links = 0;
+	if (r->len > TRAIN_BLOCK || !train_read_all(r->fd, r->buf, r->len)) {
+		fprintf(stderr, "Truncated training data block\n");
+		r->ok = false;
+		return false;
+	}
+
+	return true;
+}
+
+
+/* Read the next position, false at the end of the file or if the file is
+ * corrupt, which is told by r->ok */
+bool train_read(struct train_reader *r, struct train_pos *p)
+{
+	const uint8_t *rec;
+	struct undo u;
+	move_t m;
+
+	if (r->pos >= r->len && !train_next_block(r)) {
+		return false;
+	}
+	rec = r->buf + r->pos;
+
+	if (r->links) {
+		if (r->pos + TRAIN_LINK_SIZE > r->len) {
+			r->ok = false;
+			return false;
+		}
+		m = train_decode_move(&r->last.brd, (uint16_t)read_le(rec, 2));
+		if (m == MOVE_NONE || !make_move(&r->last.brd, m, &u)) {
+			fprintf(stderr, "Illegal chained move in training data\n");
+			r->ok = false;
+			return false;
+		}
+		r->last.best = train_decode_move(&r->last.brd, (uint16_t)read_le(rec + 2, 2));
+		r->last.score = (int16_t)read_le(rec + 4, 2);
+		r->pos += TRAIN_LINK_SIZE;
+		r->links--;
+	} else {
+		const size_t size = TRAIN_POS_SIZE + (r->flags & TRAIN_CHAIN ? 2 : 0);
+
+		if (r->pos + size > r->len) {
+			r->ok = false;
+			return false;
+		}
+		train_unpack(rec, &r->last);
+		if (r->flags & TRAIN_CHAIN) {
+			r->links = (unsigned)read_le(rec + TRAIN_POS_SIZE, 2);
+		}
+		r->pos += size;
+	}
+
+	*p = r->last;
+	return true;
+}
+
+
+void train_close(struct train_reader *r)
+{
+	if (r->fd >= 0) {
+		close(r->fd);
+	}
+	free(r->buf);
+	memset(r, 0, sizeof(*r));
+	r->fd = -1;
+}
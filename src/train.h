@@ -0,0 +1,112 @@
+/* @file:	tezdhar/src/train.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/train.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Compact binary format of training positions, with the search
+ * 		score, best move and game result of every position.
+ *
+ *
+ *			-----------------------
+ *			Packed Position Layout
+ *			-----------------------
+ *
+ * A position takes 32 bytes, all numbers little-endian:
+ *
+ *	0 .. 7		occupancy bitboard
+ *	8 .. 23		4 bit piece codes (enum pieces) of the occupied squares,
+ *			from a1 upwards, the first piece in the low nibble
+ *	24		bits 0 .. 3	castling rights, as in board.castling
+ *			bits 4 .. 7	en-passant file plus 1, 0 if none
+ *	25		bits 0 .. 6	half move clock, at most 127
+ *			bit  7		side to move, 1 for Black
+ *	26 .. 27	bits 0 .. 13	full move number
+ *			bits 14 .. 15	game result for White: 0 loss, 1 draw, 2 win
+ *	28 .. 29	score in centipawns for the side to move
+ *	30 .. 31	best move: bits 0 .. 5 from, 6 .. 11 to, 12 .. 14
+ *			promoted piece (enum chessmen, 0 if none)
+ *
+ * No position has more than 32 pieces, so 16 bytes of piece codes always
+ * suffice. The en-passant rank follows from the side to move.
+ *
+ *
+ *			-----------------
+ *			File and Blocks
+ *			-----------------
+ *
+ * A file starts with a 16 byte header: the magic "TZTP", a version and
+ * flags, both 16 bits. Then follow blocks of up to TRAIN_BLOCK bytes, each
+ * with an 8 byte header of its payload size and number of positions.
+ *
+ * Without TRAIN_CHAIN the payload is an array of packed positions, so
+ * position i of a block is at i * TRAIN_POS_SIZE. With TRAIN_CHAIN
+ * consecutive positions of a game are stored as the move leading to them:
+ * a packed position is followed by a 16 bit count of chained positions,
+ * each 6 bytes of played move, best move and score. They share the result
+ * of the packed position. A game then costs about 6 bytes per position
+ * instead of 32, but a chain must be decoded in order by making moves.
+ */
+
+#ifndef __TRAIN_H__
+#define __TRAIN_H__	1
+
+#include "chess.h"
+
+#include <stddef.h>	// for size_t
+
+#define TRAIN_POS_SIZE		32		// bytes of a packed position
+#define TRAIN_LINK_SIZE		6		// bytes of a chained position
+#define TRAIN_HEADER_SIZE	16		// bytes of the file header
+#define TRAIN_BLOCK_HEADER	8		// bytes of a block header
+#define TRAIN_BLOCK		(1 << 20)	// most payload bytes of a block
+#define TRAIN_VERSION		1
+
+/* File flags */
+#define TRAIN_CHAIN		1		// positions of a game are chained
+
+/* A training position */
+struct train_pos {
+	struct board brd;
+	int16_t score;			// for the side to move
+	move_t best;
+	int8_t result;			// for White: -1 loss, 0 draw, 1 win
+};
+
+struct train_writer {
+	int fd;
+	unsigned flags;
+	uint8_t *buf;			// block being filled, header included
+	size_t len;			// payload bytes in buf
+	uint32_t count;			// positions in buf
+	size_t chain;			// offset of the open chain count, 0 if none
+	int8_t result;			// result of the open chain
+	uint64_t positions;		// positions written
+	bool ok;			// no write failed
+};
+
+struct train_reader {
+	int fd;
+	unsigned flags;
+	uint8_t *buf;			// payload of the current block
+	size_t len, pos;
+	unsigned links;			// chained positions left in the chain
+	struct train_pos last;		// position decoded last
+	bool ok;			// not corrupt
+};
+
+
+/* Function prototypes */
+bool train_pack(const struct train_pos *p, uint8_t *rec);
+void train_unpack(const uint8_t *rec, struct train_pos *p);
+uint16_t train_encode_move(move_t m);
+move_t train_decode_move(const struct board *brd, uint16_t m);
+bool train_create(struct train_writer *w, const char *path, unsigned flags);
+bool train_write(struct train_writer *w, const struct train_pos *p, move_t played);
+bool train_write_packed(struct train_writer *w, const uint8_t *rec);
+bool train_finish(struct train_writer *w);
+bool train_open(struct train_reader *r, const char *path);
+bool train_read(struct train_reader *r, struct train_pos *p);
+void train_close(struct train_reader *r);
+
+
+#endif	/* __TRAIN_H__ */
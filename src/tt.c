@@ -0,0 +1,232 @@
+/* @file:	tezdhar/src/tt.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/tt.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Transposition table of search results.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "mem.h"
+#include "tt.h"
+
+#include <stdio.h>	// for fprintf, perror
+#include <string.h>	// for memcmp, memcpy, memset
+
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>	// for open
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for close, ftruncate
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>	// for fstat
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>	// for mmap, msync, munmap
+#endif
+
+static const char tt_magic[4] = {'T', 'Z', 'T', 'T'};
+
+
+/* Power of two number of entries fitting in kb kilobytes */
+static size_t tt_entries(const size_t kb)
+{
+	size_t entries = 1;
+
+	while (entries * 2 * sizeof(struct tt_entry) <= kb * 1024) {
+		entries *= 2;
+	}
+	return entries;
+}
+
+
+/* Allocate a table of at most kb kilobytes, rounded down to a power of
+ * two number of entries, in huge pages if possible */
+bool tt_init(struct tt *tt, const size_t kb)
+{
+	const size_t entries = tt_entries(kb);
+
+	memset(tt, 0, sizeof(*tt));
+	if (!(tt->table = mem_alloc(entries * sizeof(struct tt_entry), &tt->pages))) {
+		return false;
+	}
+	tt->mask = entries - 1;
+	return true;
+}
+
+
+/* Write the header of a table file */
+static void tt_put_header(struct tt *tt)
+{
+	uint8_t *h = tt->map;
+	const uint16_t version = TT_VERSION, size = sizeof(struct tt_entry);
+	const uint64_t entries = tt->mask + 1, scheme = zobrist_scheme();
+
+	memset(h, 0, TT_HEADER_SIZE);
+	memcpy(h, tt_magic, sizeof(tt_magic));
+	memcpy(h + 4, &version, 2);
+	memcpy(h + 6, &size, 2);
+	memcpy(h + 8, &entries, 8);
+	memcpy(h + 16, &tt->generation, 8);
+	memcpy(h + 24, &scheme, 8);
+}
+
+
+/* Map the table file at path, or create it with a table of at most kb
+ * kilobytes if it is missing or empty. The table of an existing file keeps
+ * its size and entries, and its generation is counted up */
+bool tt_open(struct tt *tt, const char *path, const size_t kb)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	uint64_t entries, scheme;
+	uint16_t version, size;
+	struct stat st;
+	bool created;
+	uint8_t *h;
+	void *map;
+	int fd;
+
+	memset(tt, 0, sizeof(*tt));
+	if ((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0 || fstat(fd, &st)) {
+		perror(path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+
+	if ((created = !st.st_size)) {
+		entries = tt_entries(kb);
+		st.st_size = (off_t)(TT_HEADER_SIZE + entries * sizeof(struct tt_entry));
+		if (ftruncate(fd, st.st_size)) {
+			perror(path);
+			close(fd);
+			return false;
+		}
+	} else if (st.st_size < TT_HEADER_SIZE) {
+		fprintf(stderr, "Not a transposition table file: %s\n", path);
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror("mmap failed");
+		return false;
+	}
+	tt->map = h = map;
+	tt->map_size = (size_t)st.st_size;
+
+	if (created) {
+		/* the entries are zero from ftruncate() */
+		tt->mask = (size_t)entries - 1;
+	} else {
+		memcpy(&version, h + 4, 2);
+		memcpy(&size, h + 6, 2);
+		memcpy(&entries, h + 8, 8);
+		memcpy(&tt->generation, h + 16, 8);
+		memcpy(&scheme, h + 24, 8);
+
+		if (memcmp(h, tt_magic, sizeof(tt_magic)) || version != TT_VERSION ||
+				size != sizeof(struct tt_entry) || !entries || (entries & (entries - 1)) ||
+				TT_HEADER_SIZE + entries * sizeof(struct tt_entry) != tt->map_size) {
+			fprintf(stderr, "Not a transposition table file: %s\n", path);
+			tt_free(tt);
+			return false;
+		}
+		if (scheme != zobrist_scheme()) {
+			fprintf(stderr, "Transposition table file made with other hash keys: %s\n", path);
+			tt_free(tt);
+			return false;
+		}
+		tt->mask = (size_t)entries - 1;
+		tt->generation++;
+	}
+
+	tt->table = (struct tt_entry *)(h + TT_HEADER_SIZE);
+	tt_put_header(tt);
+	return true;
+#else
+	memset(tt, 0, sizeof(*tt));
+	fprintf(stderr, "Transposition table files need mmap(): %s\n", path);
+	return false;
+#endif
+}
+
+
+/* Write a mapped table back to its file, nothing to do for an allocated
+ * one */
+bool tt_sync(struct tt *tt)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	if (tt->map && msync(tt->map, tt->map_size, MS_SYNC)) {
+		perror("msync failed");
+		return false;
+	}
+#endif
+	return true;
+}
+
+
+void tt_free(struct tt *tt)
+{
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+	if (tt->map) {
+		tt_sync(tt);
+		munmap(tt->map, tt->map_size);
+		memset(tt, 0, sizeof(*tt));
+		return;
+	}
+#endif
+	mem_free(tt->table, (tt->mask + 1) * sizeof(struct tt_entry));
+	memset(tt, 0, sizeof(*tt));
+}
+
+
+/* Forget all entries, e.g. before a new game */
+void tt_clear(struct tt *tt)
+{
+	memset(tt->table, 0, (tt->mask + 1) * sizeof(struct tt_entry));
+}
+
+
+bool tt_probe(const struct tt *tt, const uint64_t key, struct tt_entry *e)
+{
+	const struct tt_entry *slot = &tt->table[key & tt->mask];
+
+	if (slot->bound == TT_NONE || slot->key != key) {
+		return false;
+	}
+
+	*e = *slot;
+	return true;
+}
+
+
+void tt_store(struct tt *tt, const uint64_t key, const move_t move, const int score,
+		const int depth, const enum tt_bound bound)
+{
+	struct tt_entry *slot = &tt->table[key & tt->mask];
+
+	if (slot->key == key && slot->bound != TT_NONE && slot->depth > depth) {
+		return;
+	}
+
+	/* keep the known best move of the position if this result has none */
+	if (slot->key != key || move != MOVE_NONE) {
+		slot->move = move;
+	}
+	slot->key = key;
+	slot->score = (int16_t)score;
+	slot->depth = (int8_t)(depth < 127 ? depth : 127);
+	slot->bound = (uint8_t)bound;
+}
@@ -0,0 +1,81 @@
+/* @file:	tezdhar/src/tt.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/tt.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Transposition table of search results, indexed by Zobrist key.
+ *
+ * A table belongs to one search thread at a time and is not locked. It is
+ * a power of two array of 16 byte entries, each holding the full key, the
+ * best move, and the score, depth and bound of a searched node. A new
+ * result replaces the entry of another position, or a shallower result of
+ * the same position. Tables are allocated in huge pages if the host has
+ * them, see mem.h.
+ *
+ *
+ *			-----------
+ *			Table Files
+ *			-----------
+ *
+ * A table may live in a file instead, mapped with mmap() and shared with
+ * the file, so that a long analysis can be adjourned and resumed with all
+ * its results. The file is a 64 byte header followed by the entries as
+ * they are in memory, on the host which wrote it:
+ *
+ *	magic "TZTT", version and entry size (16 bits each), number of
+ *	entries, generation and key scheme (64 bits each)
+ *
+ * The generation counts the times the file was opened, and the key scheme
+ * is the fingerprint of the Zobrist keys, so that a file is refused if the
+ * keys have changed. tt_sync() writes the table back with msync().
+ */
+
+#ifndef __TT_H__
+#define __TT_H__	1
+
+#include "chess.h"
+#include "mem.h"
+
+#include <stddef.h>	// for size_t
+
+/* What the stored score tells about the true score */
+enum tt_bound {
+	TT_NONE,
+	TT_UPPER,			// true score is at most the score
+	TT_LOWER,			// true score is at least the score
+	TT_EXACT
+};
+
+struct tt_entry {
+	uint64_t key;
+	move_t move;			// best move, MOVE_NONE if unknown
+	int16_t score;
+	int8_t depth;
+	uint8_t bound;			// enum tt_bound
+};
+
+#define TT_HEADER_SIZE	64
+#define TT_VERSION	1
+#define TT_FILE_MB	256		// default size of a new table file
+
+struct tt {
+	struct tt_entry *table;
+	size_t mask;			// number of entries minus 1
+	void *map;			// mapped table file, NULL if allocated
+	size_t map_size;
+	uint64_t generation;		// of the table file
+	enum mem_pages pages;		// of an allocated table
+};
+
+
+/* Function prototypes */
+bool tt_init(struct tt *tt, size_t kb);
+bool tt_open(struct tt *tt, const char *path, size_t kb);
+bool tt_sync(struct tt *tt);
+void tt_free(struct tt *tt);
+void tt_clear(struct tt *tt);
+bool tt_probe(const struct tt *tt, uint64_t key, struct tt_entry *e);
+void tt_store(struct tt *tt, uint64_t key, move_t move, int score, int depth, enum tt_bound bound);
+
+
+#endif	/* __TT_H__ */
@@ -0,0 +1,762 @@
+/* @file:	tezdhar/src/uci.c
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/uci.c
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	UCI front end with an input thread, a search thread and a
+ * 		buffered writer thread.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "chess.h"
+#include "book.h"
+#include "mem.h"
+#include "search.h"
+#include "tb.h"
+#include "tt.h"
+#include "uci.h"
+
+#include <stdarg.h>	// for va_list
+#include <stdio.h>	// for fprintf, getline, vsnprintf
+#include <stdlib.h>	// for atoi, atol, strtoull, realloc, free
+#include <string.h>	// for memcpy, strcmp, strncmp, strstr, strlen
+
+#ifdef HAVE_STRINGS_H
+#  include <strings.h>	// for strcasecmp
+#endif
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>	// for write
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>	// for pthread_create, pthread_mutex_lock
+#endif
+
+#define UCI_LINE_LEN	(SEARCH_INFO_LEN + 64)	// longest line written
+#define UCI_DEFAULT_MTG	30	// moves to go assumed without movestogo
+
+/* Output buffer drained by the writer thread */
+struct uci_writer {
+	char *buf;			// lines not yet written
+	size_t len, cap;
+	char *spare;			// buffer being written
+	size_t spare_cap;
+	bool quit;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t tid;
+	bool started;
+#endif
+};
+
+/* Limits of a "go" command */
+struct uci_go {
+	long wtime, btime, winc, binc, movetime;
+	int movestogo, depth, mate;
+	uint64_t nodes;
+	bool infinite, ponder;
+};
+
+struct uci {
+	struct uci_writer out;
+
+	char base[MAX_FEN_LEN];		// "startpos" or FEN of the game
+	struct board start;		// position of base
+	struct board brd;		// position after the moves
+	move_t *moves;			// moves played from start
+	struct undo *undo;
+	size_t nmoves, cap;
+
+	struct book *book;
+	enum book_select book_sel;
+	bool own_book;
+	int tb_probe_limit;
+	long overhead;			// Move Overhead in milliseconds
+	struct tt tt;			// allocated, or mapped from HashFile
+	size_t hash_mb;			// Hash option
+
+	struct search s;
+	bool searching;			// search thread is running
+	bool wait;			// infinite or ponder: hold bestmove back
+	bool stopped;			// "stop" received
+	bool ponderhit;			// "ponderhit" received
+	long ponder_time;		// movetime to use after ponderhit
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t tid;
+#endif
+};
+
+static struct uci engine;		// too large for the stack
+
+
+/* Write all of buf to stdout */
+static void uci_write_all(const char *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len && (n = write(STDOUT_FILENO, buf, len)) > 0) {
+		buf += n;
+		len -= (size_t)n;
+	}
+}
+
+
+/* Append to the output buffer, growing it if needed */
+static void uci_append(struct uci_writer *wr, const char *line, const size_t len)
+{
+	char *buf;
+
+	if (wr->len + len > wr->cap) {
+		size_t cap = wr->cap ? 2 * wr->cap : 4096;
+
+		while (cap < wr->len + len) {
+			cap *= 2;
+		}
+		if (!(buf = realloc(wr->buf, cap))) {
+			perror("realloc failed");
+			return;
+		}
+		wr->buf = buf;
+		wr->cap = cap;
+	}
+
+	memcpy(wr->buf + wr->len, line, len);
+	wr->len += len;
+}
+
+
+#ifdef HAVE_PTHREAD_H
+/* Writer thread. The filled buffer is swapped with the spare one, so that
+ * lines are appended while the previous ones are being written */
+static void *uci_writer_thread(void *arg)
+{
+	struct uci_writer *wr = arg;
+	char *buf;
+	size_t len, cap;
+
+	pthread_mutex_lock(&wr->lock);
+	for (;;) {
+		while (!wr->len && !wr->quit) {
+			pthread_cond_wait(&wr->cond, &wr->lock);
+		}
+		if (!wr->len) {
+			break;
+		}
+
+		buf = wr->buf;
+		len = wr->len;
+		cap = wr->cap;
+		wr->buf = wr->spare;
+		wr->cap = wr->spare_cap;
+		wr->len = 0;
+		wr->spare = buf;
+		wr->spare_cap = cap;
+
+		pthread_mutex_unlock(&wr->lock);
+		uci_write_all(buf, len);
+		pthread_mutex_lock(&wr->lock);
+	}
+	pthread_mutex_unlock(&wr->lock);
+
+	return NULL;
+}
+#endif
+
+
+static void uci_send(struct uci_writer *wr, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* Queue a line for the writer thread, the newline is added */
+static void uci_send(struct uci_writer *wr, const char *fmt, ...)
+{
+	char line[UCI_LINE_LEN];
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+	va_end(ap);
+
+	if (n < 0) {
+		return;
+	}
+	if ((size_t)n > sizeof(line) - 2) {
+		n = (int)sizeof(line) - 2;
+	}
+	line[n++] = '\n';
+
+#ifdef HAVE_PTHREAD_H
+	if (wr->started) {
+		pthread_mutex_lock(&wr->lock);
+		uci_append(wr, line, (size_t)n);
+		pthread_cond_signal(&wr->cond);
+		pthread_mutex_unlock(&wr->lock);
+		return;
+	}
+#endif
+	uci_append(wr, line, (size_t)n);
+	uci_write_all(wr->buf, wr->len);
+	wr->len = 0;
+}
+
+
+static void uci_writer_start(struct uci_writer *wr)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_init(&wr->lock, NULL);
+	pthread_cond_init(&wr->cond, NULL);
+	wr->started = !pthread_create(&wr->tid, NULL, uci_writer_thread, wr);
+#else
+	(void)wr;
+#endif
+}
+
+
+/* Write out everything queued and stop the writer thread */
+static void uci_writer_stop(struct uci_writer *wr)
+{
+#ifdef HAVE_PTHREAD_H
+	if (wr->started) {
+		pthread_mutex_lock(&wr->lock);
+		wr->quit = true;
+		pthread_cond_signal(&wr->cond);
+		pthread_mutex_unlock(&wr->lock);
+		pthread_join(wr->tid, NULL);
+		wr->started = false;
+	}
+#endif
+	free(wr->buf);
+	free(wr->spare);
+	wr->buf = wr->spare = NULL;
+	wr->len = wr->cap = wr->spare_cap = 0;
+}
+
+
+/* Next word of a command line, NULL at its end */
+static char *uci_token(char **p)
+{
+	char *tok, *s = *p;
+
+	while (*s == ' ' || *s == '\t') {
+		s++;
+	}
+	if (!*s) {
+		*p = s;
+		return NULL;
+	}
+
+	tok = s;
+	while (*s && *s != ' ' && *s != '\t') {
+		s++;
+	}
+	if (*s) {
+		*s++ = '\0';
+	}
+	*p = s;
+	return tok;
+}
+
+
+/* Iteration callback of the search */
+static void uci_report(const struct search *s, const int depth)
+{
+	char line[SEARCH_INFO_LEN];
+
+	format_search_info(s, depth, line, sizeof(line));
+	uci_send(&engine.out, "%s", line);
+}
+
+
+/* Send the best move, with the reply expected by the PV of s if any */
+static void uci_bestmove(struct uci *u, const move_t best, const struct search *s)
+{
+	char uci[MAX_UCI_LEN], ponder[MAX_UCI_LEN];
+
+	if (best == MOVE_NONE) {
+		uci_send(&u->out, "bestmove (none)");
+		return;
+	}
+
+	move_to_uci(best, uci);
+	if (s && s->pv_len[0] > 1 && s->pv[0][0] == best) {
+		move_to_uci(s->pv[0][1], ponder);
+		uci_send(&u->out, "bestmove %s ponder %s", uci, ponder);
+	} else {
+		uci_send(&u->out, "bestmove %s", uci);
+	}
+}
+
+
+/* Search thread. In infinite and ponder mode the best move must not be
+ * sent before "stop" or "ponderhit", even if the search ends earlier */
+static void *uci_search_thread(void *arg)
+{
+	struct uci *u = arg;
+	const move_t best = search_position(&u->s);
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&u->lock);
+	while (u->wait && !u->stopped && !u->ponderhit) {
+		pthread_cond_wait(&u->cond, &u->lock);
+	}
+	pthread_mutex_unlock(&u->lock);
+#endif
+
+	uci_bestmove(u, best, &u->s);
+	return NULL;
+}
+
+
+/* Stop the running search, if any, and wait for its bestmove */
+static void uci_stop(struct uci *u)
+{
+	if (!u->searching) {
+		return;
+	}
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&u->lock);
+	u->stopped = true;
+	pthread_cond_signal(&u->cond);
+	pthread_mutex_unlock(&u->lock);
+	search_stop(&u->s);
+	pthread_join(u->tid, NULL);
+#endif
+	u->searching = false;
+}
+
+
+/* Time to spend on this move out of the clock, 0 if there is no clock */
+static long uci_time_budget(const struct uci *u, const struct uci_go *g)
+{
+	const long time = u->brd.turn == WHITE ? g->wtime : g->btime;
+	const long inc = u->brd.turn == WHITE ? g->winc : g->binc;
+	const int mtg = g->movestogo > 0 ? g->movestogo : UCI_DEFAULT_MTG;
+	long budget;
+
+	if (g->movetime) {
+		budget = g->movetime - u->overhead;
+	} else if (time) {
+		budget = time / mtg + inc * 3 / 4;
+		if (budget > time - u->overhead) {
+			budget = time - u->overhead;
+		}
+	} else {
+		return 0;
+	}
+
+	return budget > 1 ? budget : 1;
+}
+
+
+static bool uci_keyword(const char *tok)
+{
+	static const char * const words[] = {
+		"wtime", "btime", "winc", "binc", "movestogo", "depth", "nodes",
+		"mate", "movetime", "infinite", "ponder", "searchmoves"
+	};
+
+	for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+		if (!strcmp(tok, words[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/* Resolve a UCI move like "e7e8q" in the current position */
+static move_t uci_parse_move(struct uci *u, const char *tok)
+{
+	const struct move mv = parse_input_move(tok);
+
+	return mv.invalid ? MOVE_NONE : resolve_move(&u->brd, &mv);
+}
+
+
+static void uci_go(struct uci *u, char *p)
+{
+	struct search_limits limits = {0, 0, 0, u->tb_probe_limit, 0};
+	struct uci_go g = {0, 0, 0, 0, 0, 0, 0, 0, 0, false, false};
+	struct move_list searchmoves;
+	struct board pos;
+	char *tok, *val;
+	move_t m;
+
+	uci_stop(u);
+	searchmoves.count = 0;
+
+	tok = uci_token(&p);
+	while (tok) {
+		if (!strcmp(tok, "infinite") || !strcmp(tok, "ponder")) {
+			*(tok[0] == 'i' ? &g.infinite : &g.ponder) = true;
+			tok = uci_token(&p);
+			continue;
+		}
+		if (!strcmp(tok, "searchmoves")) {
+			while ((tok = uci_token(&p)) && !uci_keyword(tok)) {
+				if ((m = uci_parse_move(u, tok)) != MOVE_NONE && searchmoves.count < MAX_MOVES) {
+					searchmoves.moves[searchmoves.count++] = m;
+				}
+			}
+			continue;
+		}
+		if (!(val = uci_token(&p))) {
+			break;
+		}
+
+		if (!strcmp(tok, "wtime"))		g.wtime = atol(val);
+		else if (!strcmp(tok, "btime"))		g.btime = atol(val);
+		else if (!strcmp(tok, "winc"))		g.winc = atol(val);
+		else if (!strcmp(tok, "binc"))		g.binc = atol(val);
+		else if (!strcmp(tok, "movestogo"))	g.movestogo = atoi(val);
+		else if (!strcmp(tok, "depth"))		g.depth = atoi(val);
+		else if (!strcmp(tok, "nodes"))		g.nodes = strtoull(val, NULL, 10);
+		else if (!strcmp(tok, "mate"))		g.mate = atoi(val);
+		else if (!strcmp(tok, "movetime"))	g.movetime = atol(val);
+		tok = uci_token(&p);
+	}
+
+	/* the book answers at once, unless the GUI wants analysis */
+	pos = u->brd;
+	if (u->own_book && !g.infinite && !g.ponder && !searchmoves.count &&
+			(m = book_move(u->book, &pos, u->book_sel)) != MOVE_NONE) {
+		uci_send(&u->out, "info string book move");
+		uci_bestmove(u, m, NULL);
+		return;
+	}
+
+	limits.depth = g.mate > 0 ? 2 * g.mate - 1 : g.depth;
+	limits.nodes = g.nodes;
+	if (!g.infinite) {
+		limits.movetime = uci_time_budget(u, &g);
+	}
+
+	/* pondering runs without a time limit until ponderhit */
+	u->ponder_time = limits.movetime;
+	if (g.ponder) {
+		limits.movetime = 0;
+	}
+
+	search_init(&u->s, &u->brd, &limits);
+	u->s.report = uci_report;
+	u->s.tt = u->tt.table ? &u->tt : NULL;
+	u->s.searchmoves = searchmoves;
+	u->wait = g.infinite || g.ponder;
+	u->stopped = false;
+	u->ponderhit = false;
+
+#ifdef HAVE_PTHREAD_H
+	if (!pthread_create(&u->tid, NULL, uci_search_thread, u)) {
+		u->searching = true;
+		return;
+	}
+	perror("pthread_create failed");
+#endif
+	/* without threads the search blocks input until it is done */
+	u->wait = false;
+	uci_search_thread(u);
+}
+
+
+/* Keep searching, now on the clock of the move the GUI expected */
+static void uci_ponderhit(struct uci *u)
+{
+	if (!u->searching) {
+		return;
+	}
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&u->lock);
+	if (u->ponder_time) {
+		__atomic_store_n(&u->s.limits.movetime, u->ponder_time + search_elapsed(&u->s), __ATOMIC_RELAXED);
+	}
+	u->ponderhit = true;
+	pthread_cond_signal(&u->cond);
+	pthread_mutex_unlock(&u->lock);
+#endif
+}
+
+
+/* Make room for one more move of the game */
+static bool uci_reserve(struct uci *u)
+{
+	const size_t cap = u->cap ? 2 * u->cap : 256;
+	struct undo *undo;
+	move_t *moves;
+
+	if (u->nmoves < u->cap) {
+		return true;
+	}
+
+	if ((moves = realloc(u->moves, cap * sizeof(*moves)))) {
+		u->moves = moves;
+	}
+	if ((undo = realloc(u->undo, cap * sizeof(*undo)))) {
+		u->undo = undo;
+	}
+	if (!moves || !undo) {
+		perror("realloc failed");
+		return false;
+	}
+
+	u->cap = cap;
+	return true;
+}
+
+
+/* Take back moves until only n are left */
+static void uci_unmake_to(struct uci *u, const size_t n)
+{
+	while (u->nmoves > n) {
+		u->nmoves--;
+		unmake_move(&u->brd, u->moves[u->nmoves], &u->undo[u->nmoves]);
+	}
+}
+
+
+/* "position startpos|fen FEN [moves ...]". Moves matching the game so far
+ * are skipped, only the moves after the first difference are made */
+static void uci_position(struct uci *u, char *p)
+{
+	char base[MAX_FEN_LEN], fen[MAX_FEN_LEN], uci[MAX_UCI_LEN];
+	size_t len = 0, i = 0;
+	bool moves;
+	char *tok;
+	move_t m;
+
+	if (!(tok = uci_token(&p))) {
+		return;
+	}
+
+	if (!strcmp(tok, "startpos")) {
+		strcpy(base, "startpos");
+		strcpy(fen, INITIAL_FEN);
+		tok = uci_token(&p);
+	} else if (!strcmp(tok, "fen")) {
+		base[0] = '\0';
+		while ((tok = uci_token(&p)) && strcmp(tok, "moves")) {
+			const size_t n = strlen(tok);
+
+			if (len + n + 2 > sizeof(base)) {
+				uci_send(&u->out, "info string FEN too long");
+				return;
+			}
+			if (len) {
+				base[len++] = ' ';
+			}
+			memcpy(base + len, tok, n + 1);
+			len += n;
+		}
+		strcpy(fen, base);
+	} else {
+		uci_send(&u->out, "info string unknown position %s", tok);
+		return;
+	}
+
+	if (strcmp(base, u->base)) {
+		struct board brd;
+
+		if (!init_board(fen, &brd, AI, AI)) {
+			uci_send(&u->out, "info string invalid FEN %s", base);
+			return;
+		}
+		strcpy(u->base, base);
+		u->start = brd;
+		u->brd = brd;
+		u->nmoves = 0;
+	}
+
+	moves = tok && !strcmp(tok, "moves");
+	while (moves && (tok = uci_token(&p))) {
+		if (i < u->nmoves) {
+			move_to_uci(u->moves[i], uci);
+			if (!strcmp(tok, uci)) {
+				i++;
+				continue;
+			}
+			uci_unmake_to(u, i);
+		}
+
+		if ((m = uci_parse_move(u, tok)) == MOVE_NONE || !uci_reserve(u)) {
+			uci_send(&u->out, "info string illegal move %s", tok);
+			break;
+		}
+		make_move(&u->brd, m, &u->undo[u->nmoves]);
+		u->moves[u->nmoves++] = m;
+		i++;
+	}
+
+	uci_unmake_to(u, i);
+}
+
+
+/* "setoption name NAME [value VALUE]", names are case insensitive */
+static void uci_setoption(struct uci *u, char *p)
+{
+	char *name, *value, *v;
+
+	while (*p == ' ') {
+		p++;
+	}
+	if (strncmp(p, "name ", 5)) {
+		return;
+	}
+	name = p + 5;
+	if ((v = strstr(name, " value "))) {
+		*v = '\0';
+		value = v + 7;
+	} else {
+		value = name + strlen(name);
+	}
+
+	uci_stop(u);
+
+	if (!strcasecmp(name, "OwnBook")) {
+		u->own_book = !strcmp(value, "true");
+	} else if (!strcasecmp(name, "BookBest")) {
+		u->book_sel = !strcmp(value, "true") ? BOOK_BEST : BOOK_WEIGHTED;
+	} else if (!strcasecmp(name, "BookFile")) {
+		book_close(u->book);
+		if (*value && strcmp(value, "<empty>") && !book_open(u->book, value)) {
+			uci_send(&u->out, "info string cannot open book %s", value);
+		}
+	} else if (!strcasecmp(name, "TablebasePath")) {
+		tb_free();
+		if (*value && strcmp(value, "<empty>") && !tb_init(value)) {
+			uci_send(&u->out, "info string no tablebases found in %s", value);
+		}
+	} else if (!strcasecmp(name, "TablebaseProbeLimit")) {
+		u->tb_probe_limit = atoi(value);
+	} else if (!strcasecmp(name, "Move Overhead")) {
+		u->overhead = atol(value);
+	} else if (!strcasecmp(name, "Hash")) {
+		u->hash_mb = (size_t)atol(value);
+		u->hash_mb = u->hash_mb < 1 ? 1 : u->hash_mb > UCI_MAX_HASH_MB ? UCI_MAX_HASH_MB : u->hash_mb;
+		tt_free(&u->tt);
+		if (!tt_init(&u->tt, u->hash_mb * 1024)) {
+			uci_send(&u->out, "info string cannot allocate %zu MB of hash", u->hash_mb);
+		} else {
+			uci_send(&u->out, "info string hash %zu MB in %s pages", u->hash_mb, mem_pages_name(u->tt.pages));
+		}
+	} else if (!strcasecmp(name, "HashFile")) {
+		/* an existing file keeps its size, a new one gets Hash */
+		tt_free(&u->tt);
+		if (*value && strcmp(value, "<empty>") && tt_open(&u->tt, value, u->hash_mb * 1024)) {
+			uci_send(&u->out, "info string hash file %s generation %llu, %zu MB", value,
+					(unsigned long long)u->tt.generation, u->tt.map_size >> 20);
+		} else if (!tt_init(&u->tt, u->hash_mb * 1024)) {
+			uci_send(&u->out, "info string cannot allocate %zu MB of hash", u->hash_mb);
+		}
+	} else if (!strcasecmp(name, "SaveHash")) {
+		if (!u->tt.map) {
+			uci_send(&u->out, "info string no HashFile to save to");
+		} else if (tt_sync(&u->tt)) {
+			uci_send(&u->out, "info string hash saved");
+		}
+	} else if (strcasecmp(name, "Ponder")) {
+		uci_send(&u->out, "info string unknown option %s", name);
+	}
+}
+
+
+static void uci_id(struct uci *u)
+{
+	uci_send(&u->out, "id name Tezdhar %s", VERSION);
+	uci_send(&u->out, "id author %s", AUTHOR);
+	uci_send(&u->out, "option name Ponder type check default false");
+	uci_send(&u->out, "option name OwnBook type check default %s", u->own_book ? "true" : "false");
+	uci_send(&u->out, "option name BookFile type string default <empty>");
+	uci_send(&u->out, "option name BookBest type check default %s",
+			u->book_sel == BOOK_BEST ? "true" : "false");
+	uci_send(&u->out, "option name TablebasePath type string default <empty>");
+	uci_send(&u->out, "option name TablebaseProbeLimit type spin default %d min 0 max %d",
+			u->tb_probe_limit, TB_MAX_PIECES);
+	uci_send(&u->out, "option name Move Overhead type spin default %d min 0 max 5000", UCI_OVERHEAD);
+	uci_send(&u->out, "option name Hash type spin default %d min 1 max %d", UCI_HASH_MB, UCI_MAX_HASH_MB);
+	uci_send(&u->out, "option name HashFile type string default <empty>");
+	uci_send(&u->out, "option name SaveHash type button");
+	uci_send(&u->out, "uciok");
+}
+
+
+/* Read and execute UCI commands from stdin until "quit" or end of file */
+int uci_loop(struct book *bk, const enum book_select sel, const int tb_probe_limit)
+{
+	struct uci *u = &engine;
+	char *line = NULL, *p, *cmd, startpos[] = "startpos";
+	size_t cap = 0;
+	ssize_t n;
+
+	fflush(stdout);		// anything printed before, e.g. the banner
+	u->book = bk;
+	u->book_sel = sel;
+	u->own_book = bk->map != NULL;
+	u->tb_probe_limit = tb_probe_limit;
+	u->overhead = UCI_OVERHEAD;
+	u->hash_mb = UCI_HASH_MB;
+	if (!tt_init(&u->tt, u->hash_mb * 1024)) {
+		fprintf(stderr, "Searching without hash table\n");
+	}
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_init(&u->lock, NULL);
+	pthread_cond_init(&u->cond, NULL);
+#endif
+	uci_writer_start(&u->out);
+
+	while ((n = getline(&line, &cap, stdin)) >= 0) {
+		while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) {
+			line[--n] = '\0';
+		}
+		p = line;
+		if (!(cmd = uci_token(&p))) {
+			continue;
+		}
+
+		if (!strcmp(cmd, "uci")) {
+			uci_id(u);
+		} else if (!strcmp(cmd, "isready")) {
+			uci_send(&u->out, "readyok");
+		} else if (!strcmp(cmd, "setoption")) {
+			uci_setoption(u, p);
+		} else if (!strcmp(cmd, "ucinewgame")) {
+			uci_stop(u);
+			u->base[0] = '\0';
+			u->nmoves = 0;
+			/* a hash file holds an adjourned analysis, kept for resuming */
+			if (u->tt.table && !u->tt.map) {
+				tt_clear(&u->tt);
+			}
+		} else if (!strcmp(cmd, "position")) {
+			uci_stop(u);
+			uci_position(u, p);
+		} else if (!strcmp(cmd, "go")) {
+			if (!u->base[0]) {
+				uci_position(u, startpos);
+			}
+			uci_go(u, p);
+		} else if (!strcmp(cmd, "stop")) {
+			uci_stop(u);
+		} else if (!strcmp(cmd, "ponderhit")) {
+			uci_ponderhit(u);
+		} else if (!strcmp(cmd, "quit")) {
+			break;
+		} else if (strcmp(cmd, "debug") && strcmp(cmd, "register")) {
+			uci_send(&u->out, "info string unknown command %s", cmd);
+		}
+	}
+
+	uci_stop(u);
+	uci_writer_stop(&u->out);
+	tt_free(&u->tt);
+	free(line);
+	free(u->moves);
+	free(u->undo);
+	return EXIT_SUCCESS;
+}
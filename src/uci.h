@@ -0,0 +1,43 @@
+/* @file:	tezdhar/src/uci.h
+ * @url:	https://github.com/mnm-sys/tezdhar/blob/main/src/uci.h
+ * @author:	Manavendra Nath Manav (mnm.kernel@gmail.com)
+ * @created:	Oct. 2026
+ * @license:	GPLv3
+ * @desc:	Universal Chess Interface (UCI) front end.
+ *
+ *
+ *			-------
+ *			Threads
+ *			-------
+ *
+ * The calling thread becomes the input thread: it reads and executes
+ * commands, so that "stop", "ponderhit" and "isready" are answered while
+ * a search is running. Every "go" starts a search on a worker thread,
+ * which is joined by the next "go", "stop" or "quit".
+ *
+ * Nothing is written to stdout directly. Lines are appended to a buffer
+ * and a writer thread hands them to write(), so a slow GUI reading the
+ * pipe never stalls the search in the middle of an iteration.
+ *
+ * The position of the last "position" command is kept along with the
+ * moves played from it. A GUI sends the whole game with every move, so
+ * the moves already played are only compared and just the new ones are
+ * made on the board; moves which differ are unmade first.
+ */
+
+#ifndef __UCI_H__
+#define __UCI_H__	1
+
+#include "chess.h"
+#include "book.h"
+
+#define UCI_OVERHEAD	30		// default Move Overhead in milliseconds
+#define UCI_HASH_MB	16		// default Hash in megabytes
+#define UCI_MAX_HASH_MB	65536
+
+
+/* Function prototypes */
+int uci_loop(struct book *bk, enum book_select sel, int tb_probe_limit);
+
+
+#endif	/* __UCI_H__ */